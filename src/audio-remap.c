@@ -0,0 +1,165 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <stdbool.h>
+#include <string.h>
+#include <util/sse-intrin.h>
+#include "audio-remap.h"
+
+#define MINUS_3DB 0.70710678f
+
+enum speaker {
+	SPEAKER_NONE,
+	SPEAKER_FL,
+	SPEAKER_FR,
+	SPEAKER_FC,
+	SPEAKER_LFE,
+	SPEAKER_RL,
+	SPEAKER_RR,
+	SPEAKER_RC,
+	SPEAKER_SL,
+	SPEAKER_SR,
+	SPEAKER_COUNT,
+};
+
+/* Positions of the channels of each layout, indexed by channel count */
+static const enum speaker layouts[MAX_AUDIO_CHANNELS + 1][MAX_AUDIO_CHANNELS] = {
+	[1] = {SPEAKER_FC},
+	[2] = {SPEAKER_FL, SPEAKER_FR},
+	[3] = {SPEAKER_FL, SPEAKER_FR, SPEAKER_LFE},
+	[4] = {SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_RC},
+	[5] = {SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_RC},
+	[6] = {SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_RL, SPEAKER_RR},
+	[8] = {SPEAKER_FL, SPEAKER_FR, SPEAKER_FC, SPEAKER_LFE, SPEAKER_RL, SPEAKER_RR, SPEAKER_SL, SPEAKER_SR},
+};
+
+/* Where a speaker goes when the other layout doesn't have it, tried in order.
+ * Each target gets the speaker at -3dB, so a pair keeps the same loudness. */
+static const enum speaker fallbacks[SPEAKER_COUNT][2][2] = {
+	[SPEAKER_FL] = {{SPEAKER_FC}},
+	[SPEAKER_FR] = {{SPEAKER_FC}},
+	[SPEAKER_FC] = {{SPEAKER_FL, SPEAKER_FR}},
+	[SPEAKER_RL] = {{SPEAKER_SL}, {SPEAKER_FL}},
+	[SPEAKER_RR] = {{SPEAKER_SR}, {SPEAKER_FR}},
+	[SPEAKER_RC] = {{SPEAKER_RL, SPEAKER_RR}, {SPEAKER_SL, SPEAKER_SR}},
+	[SPEAKER_SL] = {{SPEAKER_RL}, {SPEAKER_FL}},
+	[SPEAKER_SR] = {{SPEAKER_RR}, {SPEAKER_FR}},
+};
+
+static int find_speaker(size_t channels, enum speaker speaker)
+{
+	for (size_t i = 0; i < channels; i++) {
+		if (layouts[channels][i] == speaker)
+			return (int)i;
+	}
+	return -1;
+}
+
+static bool has_speakers(size_t channels, const enum speaker *speakers)
+{
+	for (size_t i = 0; i < 2 && speakers[i] != SPEAKER_NONE; i++) {
+		if (find_speaker(channels, speakers[i]) < 0)
+			return false;
+	}
+	return true;
+}
+
+static void add_speaker(struct audio_remap *remap, size_t src, enum speaker speaker, float gain, int depth)
+{
+	int dst = find_speaker(remap->dst_channels, speaker);
+	if (dst >= 0) {
+		remap->gains[dst][src] += gain;
+		return;
+	}
+
+	/* Speakers without a fallback, like the LFE, are left out */
+	const enum speaker(*options)[2] = fallbacks[speaker];
+	size_t count = options[0][0] == SPEAKER_NONE ? 0 : options[1][0] == SPEAKER_NONE ? 1 : 2;
+	if (!count || depth > 2)
+		return;
+
+	/* If the other layout has none of them, the last one falls back further */
+	size_t pick = count - 1;
+	for (size_t i = 0; i < count; i++) {
+		if (has_speakers(remap->dst_channels, options[i])) {
+			pick = i;
+			break;
+		}
+	}
+	for (size_t i = 0; i < 2 && options[pick][i] != SPEAKER_NONE; i++)
+		add_speaker(remap, src, options[pick][i], gain * MINUS_3DB, depth + 1);
+}
+
+void audio_remap_init(struct audio_remap *remap, size_t src_channels, size_t dst_channels)
+{
+	memset(remap, 0, sizeof(*remap));
+	remap->src_channels = src_channels < MAX_AUDIO_CHANNELS ? src_channels : MAX_AUDIO_CHANNELS;
+	remap->dst_channels = dst_channels < MAX_AUDIO_CHANNELS ? dst_channels : MAX_AUDIO_CHANNELS;
+
+	/* Unknown layouts keep the channels they have in common */
+	if (layouts[remap->src_channels][0] == SPEAKER_NONE || layouts[remap->dst_channels][0] == SPEAKER_NONE) {
+		for (size_t i = 0; i < remap->src_channels && i < remap->dst_channels; i++)
+			remap->gains[i][i] = 1.0f;
+		return;
+	}
+
+	for (size_t src = 0; src < remap->src_channels; src++)
+		add_speaker(remap, src, layouts[remap->src_channels][src], 1.0f, 0);
+}
+
+/* dst += src * gain, with gain going up by step on each frame */
+void audio_mix_ramp(float *dst, const float *src, float gain, float step, size_t frames)
+{
+	size_t i = 0;
+	__m128 g = _mm_setr_ps(gain, gain + step, gain + 2.0f * step, gain + 3.0f * step);
+	__m128 g_step = _mm_set1_ps(4.0f * step);
+	for (; i + 4 <= frames; i += 4) {
+		__m128 s = _mm_loadu_ps(src + i);
+		__m128 d = _mm_loadu_ps(dst + i);
+		_mm_storeu_ps(dst + i, _mm_add_ps(d, _mm_mul_ps(s, g)));
+		g = _mm_add_ps(g, g_step);
+	}
+	for (; i < frames; i++)
+		dst[i] += src[i] * (gain + (float)i * step);
+}
+
+/* data *= gain, with gain going up by step on each frame */
+void audio_gain_ramp(float *data, float gain, float step, size_t frames)
+{
+	size_t i = 0;
+	__m128 g = _mm_setr_ps(gain, gain + step, gain + 2.0f * step, gain + 3.0f * step);
+	__m128 g_step = _mm_set1_ps(4.0f * step);
+	for (; i + 4 <= frames; i += 4) {
+		_mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+		g = _mm_add_ps(g, g_step);
+	}
+	for (; i < frames; i++)
+		data[i] *= gain + (float)i * step;
+}
+
+void audio_remap_process(const struct audio_remap *remap, float *const *dst, const float *const *src,
+			 size_t frames)
+{
+	for (size_t d = 0; d < remap->dst_channels; d++) {
+		memset(dst[d], 0, frames * sizeof(float));
+		for (size_t s = 0; s < remap->src_channels; s++) {
+			if (remap->gains[d][s] != 0.0f)
+				audio_mix_ramp(dst[d], src[s], remap->gains[d][s], 0.0f, frames);
+		}
+	}
+}
@@ -0,0 +1,43 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+
+/* Gains from each channel of one speaker layout to each channel of another,
+ * with channels in the order libobs uses for planar audio. Layouts are told
+ * apart by their channel count, which is unique for every layout libobs has.
+ */
+struct audio_remap {
+	size_t src_channels;
+	size_t dst_channels;
+	float gains[MAX_AUDIO_CHANNELS][MAX_AUDIO_CHANNELS]; // [dst][src]
+};
+
+extern void audio_remap_init(struct audio_remap *remap, size_t src_channels, size_t dst_channels);
+
+/* Up-mixes or down-mixes `frames` frames of planar float audio. `dst` and
+ * `src` must not overlap. */
+extern void audio_remap_process(const struct audio_remap *remap, float *const *dst, const float *const *src,
+				size_t frames);
+
+/* Gain ramps for mixing two planes, as used by crossfades. The gain starts at
+ * `gain` and goes up by `step` (or down, if negative) on each frame. */
+extern void audio_mix_ramp(float *dst, const float *src, float gain, float step, size_t frames);
+extern void audio_gain_ramp(float *data, float gain, float step, size_t frames);
@@ -0,0 +1,164 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <plugin-support.h>
+#include "catalog.h"
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+
+/* Every offset is checked once here, so items can be read without checks */
+static bool validate(struct catalog *catalog)
+{
+	const struct mapped_file *map = &catalog->map;
+	const struct catalog_header *header = (const struct catalog_header *)map->data;
+
+	if (map->size < sizeof(*header) || memcmp(header->magic, CATALOG_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->version != CATALOG_VERSION)
+		return false;
+
+	uint64_t records_size = (uint64_t)header->count * sizeof(struct catalog_record);
+	if (map->size - sizeof(*header) < records_size ||
+	    map->size - sizeof(*header) - records_size != header->strings_size)
+		return false;
+
+	const struct catalog_record *records = (const struct catalog_record *)(map->data + sizeof(*header));
+	const char *strings = (const char *)records + records_size;
+	if (!header->strings_size || strings[header->strings_size - 1] != '\0')
+		return false;
+
+	for (uint32_t i = 0; i < header->count; i++) {
+		if (records[i].path >= header->strings_size || records[i].id >= header->strings_size ||
+		    records[i].sort > FOLDER_SORT_SIZE)
+			return false;
+	}
+
+	if (fnv1a(FNV_OFFSET_BASIS, records, map->size - sizeof(*header)) != header->checksum)
+		return false;
+
+	catalog->header = header;
+	catalog->records = records;
+	catalog->strings = strings;
+	return true;
+}
+
+bool catalog_open(struct catalog *catalog, const char *path)
+{
+	memset(catalog, 0, sizeof(*catalog));
+	if (!mapped_file_open(&catalog->map, path))
+		return false;
+
+	if (!validate(catalog)) {
+		obs_log(LOG_WARNING, "%s is not a valid playlist catalog", path);
+		catalog_close(catalog);
+		return false;
+	}
+	return true;
+}
+
+void catalog_close(struct catalog *catalog)
+{
+	if (catalog->map.data)
+		mapped_file_close(&catalog->map);
+	memset(catalog, 0, sizeof(*catalog));
+}
+
+static uint32_t add_string(struct darray *strings, const char *str)
+{
+	DARRAY(char) buf;
+	buf.da = *strings;
+	size_t offset = buf.num;
+	da_push_back_array(buf, str ? str : "", (str ? strlen(str) : 0) + 1);
+	*strings = buf.da;
+	return (uint32_t)offset;
+}
+
+bool catalog_write(const char *path, const struct catalog_item *items, size_t count, uint64_t *checksum)
+{
+	struct catalog_header header = {.version = CATALOG_VERSION};
+	DARRAY(struct catalog_record) records;
+	DARRAY(char) strings;
+	struct dstr temp_path = {0};
+	bool success = false;
+
+	if (count > UINT32_MAX)
+		return false;
+
+	da_init(records);
+	da_init(strings);
+	da_resize(records, count);
+	for (size_t i = 0; i < count; i++) {
+		struct catalog_record *record = &records.array[i];
+		record->path = add_string(&strings.da, items[i].path);
+		record->id = add_string(&strings.da, items[i].id);
+		record->start_ms = items[i].start_ms;
+		record->end_ms = items[i].end_ms;
+		record->sort = items[i].sort;
+		record->sort_reverse = items[i].sort_reverse;
+		if (strings.num > UINT32_MAX)
+			goto fail;
+	}
+	if (!strings.num)
+		add_string(&strings.da, ""); // an empty catalog still needs its last byte to be a NUL
+
+	memcpy(header.magic, CATALOG_MAGIC, sizeof(header.magic));
+	header.count = (uint32_t)count;
+	header.strings_size = strings.num;
+	header.checksum = fnv1a(FNV_OFFSET_BASIS, records.array, records.num * sizeof(*records.array));
+	header.checksum = fnv1a(header.checksum, strings.array, strings.num);
+
+	dstr_copy(&temp_path, path);
+	dstr_cat(&temp_path, ".tmp");
+	FILE *f = os_fopen(temp_path.array, "wb");
+	if (!f)
+		goto fail;
+
+	bool written = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		       (!records.num || fwrite(records.array, sizeof(*records.array), records.num, f) == records.num) &&
+		       fwrite(strings.array, 1, strings.num, f) == strings.num;
+	written = fclose(f) == 0 && written;
+
+	if (written && os_safe_replace(path, temp_path.array, NULL) == 0) {
+		*checksum = header.checksum;
+		success = true;
+	} else {
+		os_unlink(temp_path.array);
+	}
+
+fail:
+	if (!success)
+		obs_log(LOG_WARNING, "Failed to write playlist catalog %s", path);
+	dstr_free(&temp_path);
+	da_free(strings);
+	da_free(records);
+	return success;
+}
@@ -0,0 +1,97 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+#include "mapped-file.h"
+#include "folder-sort.h"
+
+/* A playlist saved in its own file, for lists too big to keep in the scene
+ * collection. The file is mapped and read in place: a header, one record per
+ * item, then the NUL-terminated strings the records point into. Numbers are
+ * in the byte order of the machine that wrote it.
+ */
+#define CATALOG_MAGIC "MPSCATLG"
+#define CATALOG_VERSION 2
+
+struct catalog_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	uint64_t strings_size;
+	uint64_t checksum; // FNV-1a of everything after the header
+};
+
+struct catalog_record {
+	uint32_t path; // offsets in the strings
+	uint32_t id;
+	int64_t start_ms;
+	int64_t end_ms;
+	uint32_t sort; // enum folder_sort
+	uint32_t sort_reverse;
+};
+
+/* An item of the playlist, read from a catalog or from the settings */
+struct catalog_item {
+	const char *path;
+	const char *id;
+	int64_t start_ms;
+	int64_t end_ms;
+	enum folder_sort sort;
+	bool sort_reverse;
+};
+
+struct catalog {
+	struct mapped_file map;
+	const struct catalog_header *header;
+	const struct catalog_record *records;
+	const char *strings;
+};
+
+/* Fails if the file is not a catalog, is truncated or doesn't match its
+ * checksum.
+ */
+extern bool catalog_open(struct catalog *catalog, const char *path);
+extern void catalog_close(struct catalog *catalog);
+
+static inline size_t catalog_count(const struct catalog *catalog)
+{
+	return catalog->header->count;
+}
+
+static inline uint64_t catalog_checksum(const struct catalog *catalog)
+{
+	return catalog->header->checksum;
+}
+
+static inline void catalog_get_item(const struct catalog *catalog, size_t idx, struct catalog_item *item)
+{
+	const struct catalog_record *record = &catalog->records[idx];
+	item->path = catalog->strings + record->path;
+	item->id = catalog->strings + record->id;
+	item->start_ms = record->start_ms;
+	item->end_ms = record->end_ms;
+	item->sort = (enum folder_sort)record->sort;
+	item->sort_reverse = record->sort_reverse != 0;
+}
+
+/* Writes to a temporary file first, so a catalog in use is only replaced once
+ * the new one is complete.
+ */
+extern bool catalog_write(const char *path, const struct catalog_item *items, size_t count, uint64_t *checksum);
@@ -0,0 +1,94 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <util/darray.h>
+#include <util/threading.h>
+#include "decoder-pool.h"
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct decoder_pool_entry *) entries;
+
+void decoder_pool_add(struct decoder_pool_entry *entry)
+{
+	pthread_mutex_lock(&mutex);
+	da_push_back(entries, &entry);
+	pthread_mutex_unlock(&mutex);
+}
+
+void decoder_pool_remove(struct decoder_pool_entry *entry)
+{
+	pthread_mutex_lock(&mutex);
+	da_erase_item(entries, &entry);
+	pthread_mutex_unlock(&mutex);
+}
+
+void decoder_pool_set_max_open(struct decoder_pool_entry *entry, size_t max_open)
+{
+	pthread_mutex_lock(&mutex);
+	entry->max_open = max_open;
+	pthread_mutex_unlock(&mutex);
+}
+
+/* Whether `a` should be closed before `b`. Requires `mutex`. */
+static inline bool closes_before(const struct decoder_pool_entry *a, const struct decoder_pool_entry *b)
+{
+	if (a->priority != b->priority)
+		return a->priority > b->priority;
+	return a->last_shown_ts < b->last_shown_ts;
+}
+
+enum decoder_action decoder_pool_update(struct decoder_pool_entry *entry, enum decoder_priority priority, bool open,
+					uint64_t ts)
+{
+	enum decoder_action action = DECODER_ACTION_KEEP;
+
+	pthread_mutex_lock(&mutex);
+	entry->priority = priority;
+	entry->open = open;
+	if (priority != DECODER_PRIORITY_HIDDEN)
+		entry->last_shown_ts = ts;
+
+	size_t max_open = 0;
+	size_t open_count = 0;
+	const struct decoder_pool_entry *first_closed = NULL;
+	for (size_t i = 0; i < entries.num; i++) {
+		const struct decoder_pool_entry *other = entries.array[i];
+		if (other->max_open && (!max_open || other->max_open < max_open))
+			max_open = other->max_open;
+		if (!other->open)
+			continue;
+		open_count++;
+		if (other->priority != DECODER_PRIORITY_ACTIVE && (!first_closed || closes_before(other, first_closed)))
+			first_closed = other;
+	}
+
+	if (!open && priority != DECODER_PRIORITY_HIDDEN && (!max_open || open_count < max_open))
+		action = DECODER_ACTION_REOPEN;
+	else if (open && max_open && open_count > max_open && first_closed == entry)
+		action = DECODER_ACTION_RELEASE;
+	pthread_mutex_unlock(&mutex);
+
+	return action;
+}
+
+void decoder_pool_free(void)
+{
+	pthread_mutex_lock(&mutex);
+	da_free(entries);
+	pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,60 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+
+/* Limits how many internal media sources of all playlist sources have a file
+ * open at once. When there are too many, the files of hidden sources are
+ * closed first, the least recently shown first, then the ones only shown in
+ * the preview. Files of active sources are never closed.
+ */
+enum decoder_priority {
+	DECODER_PRIORITY_ACTIVE, // or playing while hidden
+	DECODER_PRIORITY_PREVIEW,
+	DECODER_PRIORITY_HIDDEN,
+};
+
+enum decoder_action {
+	DECODER_ACTION_KEEP,
+	DECODER_ACTION_RELEASE, // close the file
+	DECODER_ACTION_REOPEN,  // open it again, there is room for it
+};
+
+/* Only changed by the pool */
+struct decoder_pool_entry {
+	enum decoder_priority priority;
+	bool open;
+	uint64_t last_shown_ts;
+	size_t max_open;
+};
+
+extern void decoder_pool_add(struct decoder_pool_entry *entry);
+extern void decoder_pool_remove(struct decoder_pool_entry *entry);
+
+/* 0 for no limit. The pool is shared, so the lowest limit of all entries is
+ * used. */
+extern void decoder_pool_set_max_open(struct decoder_pool_entry *entry, size_t max_open);
+
+/* Updates the state of a source, and returns what it should do with its file.
+ * Called by the video thread on each tick. */
+extern enum decoder_action decoder_pool_update(struct decoder_pool_entry *entry, enum decoder_priority priority,
+					       bool open, uint64_t ts);
+
+extern void decoder_pool_free(void);
@@ -0,0 +1,90 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <plugin-support.h>
+#include "duration-cache.h"
+
+#define DURATION_CACHE_FILE "durations.json"
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static obs_data_t *cache = NULL;
+static char *cache_path = NULL;
+
+/* Requires `cache_mutex` */
+static void load_cache(void)
+{
+	if (cache)
+		return;
+
+	char *dir = obs_module_config_path("");
+	if (dir) {
+		os_mkdirs(dir);
+		bfree(dir);
+	}
+	cache_path = obs_module_config_path(DURATION_CACHE_FILE);
+	if (cache_path)
+		cache = obs_data_create_from_json_file_safe(cache_path, "bak");
+	if (!cache)
+		cache = obs_data_create();
+}
+
+bool duration_cache_get(const char *path, int64_t mtime, int64_t *duration_ms)
+{
+	pthread_mutex_lock(&cache_mutex);
+	load_cache();
+	obs_data_t *entry = obs_data_get_obj(cache, path);
+	bool found = entry && obs_data_get_int(entry, "mtime") == mtime;
+	if (found)
+		*duration_ms = obs_data_get_int(entry, "duration_ms");
+	obs_data_release(entry);
+	pthread_mutex_unlock(&cache_mutex);
+	return found;
+}
+
+/* Only saved when it changed, as every change of file sets it */
+void duration_cache_set(const char *path, int64_t mtime, int64_t duration_ms)
+{
+	pthread_mutex_lock(&cache_mutex);
+	load_cache();
+	obs_data_t *entry = obs_data_get_obj(cache, path);
+	if (!entry || obs_data_get_int(entry, "mtime") != mtime || obs_data_get_int(entry, "duration_ms") != duration_ms) {
+		obs_data_release(entry);
+		entry = obs_data_create();
+		obs_data_set_int(entry, "mtime", mtime);
+		obs_data_set_int(entry, "duration_ms", duration_ms);
+		obs_data_set_obj(cache, path, entry);
+		if (cache_path && !obs_data_save_json_safe(cache, cache_path, "tmp", "bak"))
+			obs_log(LOG_WARNING, "Failed to save duration cache to '%s'", cache_path);
+	}
+	obs_data_release(entry);
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+void duration_cache_free(void)
+{
+	pthread_mutex_lock(&cache_mutex);
+	obs_data_release(cache);
+	cache = NULL;
+	bfree(cache_path);
+	cache_path = NULL;
+	pthread_mutex_unlock(&cache_mutex);
+}
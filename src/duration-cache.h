@@ -0,0 +1,29 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+
+/* Durations of files, learned when they are played, shared by all sources and
+ * saved in the plugin's config folder. Entries are only used while the file's
+ * mtime is unchanged, see loudness_file_mtime.
+ */
+extern bool duration_cache_get(const char *path, int64_t mtime, int64_t *duration_ms);
+extern void duration_cache_set(const char *path, int64_t mtime, int64_t duration_ms);
+extern void duration_cache_free(void);
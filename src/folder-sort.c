@@ -0,0 +1,229 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <string.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "folder-sort.h"
+
+#define INSERTION_SORT_MAX 16
+#define NUMBER_MARKER '0'
+
+void folder_sort_init(struct folder_sort_keys *keys, enum folder_sort sort)
+{
+	keys->sort = sort;
+	da_init(keys->data);
+	da_init(keys->keys);
+}
+
+void folder_sort_free(struct folder_sort_keys *keys)
+{
+	da_free(keys->data);
+	da_free(keys->keys);
+}
+
+static inline bool is_digit(uint8_t c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static void push_u64(struct folder_sort_keys *keys, uint64_t value)
+{
+	uint8_t bytes[8];
+	for (size_t i = 0; i < 8; i++)
+		bytes[i] = (uint8_t)(value >> (56 - i * 8));
+	da_push_back_array(keys->data, bytes, sizeof(bytes));
+}
+
+/* Letters are lowercased, and each run of digits becomes NUMBER_MARKER, the
+ * count of digits without leading zeros, then the digits, so a longer number
+ * is a bigger one. Digits are only found in numbers, so the marker sorts
+ * where digits sort among other characters.
+ */
+static void push_name(struct folder_sort_keys *keys, const char *name)
+{
+	const uint8_t *p = (const uint8_t *)name;
+
+	while (*p) {
+		if (is_digit(*p)) {
+			while (*p == '0' && is_digit(p[1]))
+				p++;
+			const uint8_t *start = p;
+			while (is_digit(*p))
+				p++;
+
+			size_t len = (size_t)(p - start);
+			uint8_t header[2] = {NUMBER_MARKER, len > UINT8_MAX ? UINT8_MAX : (uint8_t)len};
+			da_push_back_array(keys->data, header, sizeof(header));
+			da_push_back_array(keys->data, start, len);
+		} else {
+			uint8_t c = *p >= 'A' && *p <= 'Z' ? (uint8_t)(*p + ('a' - 'A')) : *p;
+			da_push_back(keys->data, &c);
+			p++;
+		}
+	}
+
+	/* ends the natural key, then the name itself breaks ties like "a01"
+	 * and "A1" */
+	uint8_t end = 0;
+	da_push_back(keys->data, &end);
+	da_push_back_array(keys->data, (const uint8_t *)name, strlen(name));
+}
+
+void folder_sort_add(struct folder_sort_keys *keys, const char *name, int64_t mtime, uint64_t size)
+{
+	struct folder_sort_key *key = da_push_back_new(keys->keys);
+	key->offset = keys->data.num;
+	key->index = keys->keys.num - 1;
+
+	if (keys->sort == FOLDER_SORT_MTIME)
+		push_u64(keys, (uint64_t)mtime ^ (1ULL << 63));
+	else if (keys->sort == FOLDER_SORT_SIZE)
+		push_u64(keys, size);
+	if (keys->sort != FOLDER_SORT_NONE)
+		push_name(keys, name);
+
+	key->size = keys->data.num - key->offset;
+}
+
+static inline int compare_keys(const uint8_t *data, const struct folder_sort_key *a, const struct folder_sort_key *b)
+{
+	int cmp = memcmp(data + a->offset, data + b->offset, a->size < b->size ? a->size : b->size);
+	if (cmp)
+		return cmp;
+	return a->size < b->size ? -1 : a->size > b->size;
+}
+
+static void merge(const uint8_t *data, const struct folder_sort_key *a, size_t a_num, const struct folder_sort_key *b,
+		  size_t b_num, struct folder_sort_key *out)
+{
+	size_t i = 0;
+	size_t j = 0;
+
+	while (i < a_num && j < b_num)
+		*out++ = compare_keys(data, &b[j], &a[i]) < 0 ? b[j++] : a[i++];
+	memcpy(out, a + i, (a_num - i) * sizeof(*a));
+	memcpy(out + (a_num - i), b + j, (b_num - j) * sizeof(*b));
+}
+
+/* Sorts `keys` using `tmp`, which must have room for as many keys */
+static void merge_sort(const uint8_t *data, struct folder_sort_key *keys, struct folder_sort_key *tmp, size_t count)
+{
+	if (count <= INSERTION_SORT_MAX) {
+		for (size_t i = 1; i < count; i++) {
+			struct folder_sort_key key = keys[i];
+			size_t j = i;
+			for (; j > 0 && compare_keys(data, &key, &keys[j - 1]) < 0; j--)
+				keys[j] = keys[j - 1];
+			keys[j] = key;
+		}
+		return;
+	}
+
+	size_t half = count / 2;
+	merge_sort(data, keys, tmp, half);
+	merge_sort(data, keys + half, tmp + half, count - half);
+	if (compare_keys(data, &keys[half - 1], &keys[half]) <= 0)
+		return;
+
+	merge(data, keys, half, keys + half, count - half, tmp);
+	memcpy(keys, tmp, count * sizeof(*keys));
+}
+
+struct sort_job {
+	const uint8_t *data;
+	struct folder_sort_key *keys;
+	struct folder_sort_key *tmp;
+	size_t count;
+	pthread_t thread;
+	bool started;
+};
+
+static void *sort_thread(void *param)
+{
+	struct sort_job *job = param;
+	os_set_thread_name("media-playlist-source: folder sort");
+	merge_sort(job->data, job->keys, job->tmp, job->count);
+	return NULL;
+}
+
+/* Each thread sorts a run of the keys, and the runs are then merged two by
+ * two. A thread that can't be started has its run sorted here.
+ */
+static void parallel_merge_sort(const uint8_t *data, struct folder_sort_key *keys, struct folder_sort_key *tmp,
+				size_t count, size_t threads)
+{
+	struct sort_job jobs[FOLDER_SORT_MAX_THREADS];
+	size_t run = (count + threads - 1) / threads;
+
+	for (size_t i = 0; i < threads; i++) {
+		size_t start = i * run < count ? i * run : count;
+		struct sort_job *job = &jobs[i];
+		job->data = data;
+		job->keys = keys + start;
+		job->tmp = tmp + start;
+		job->count = count - start < run ? count - start : run;
+		job->started = pthread_create(&job->thread, NULL, sort_thread, job) == 0;
+	}
+	for (size_t i = 0; i < threads; i++) {
+		if (jobs[i].started)
+			pthread_join(jobs[i].thread, NULL);
+		else
+			merge_sort(data, jobs[i].keys, jobs[i].tmp, jobs[i].count);
+	}
+
+	for (size_t width = run; width < count; width *= 2) {
+		for (size_t start = 0; start + width < count; start += width * 2) {
+			size_t end = start + width * 2 < count ? start + width * 2 : count;
+			merge(data, keys + start, width, keys + start + width, end - start - width, tmp + start);
+			memcpy(keys + start, tmp + start, (end - start) * sizeof(*keys));
+		}
+	}
+}
+
+void folder_sort_run(struct folder_sort_keys *keys, bool reverse)
+{
+	size_t count = keys->keys.num;
+	struct folder_sort_key *array = keys->keys.array;
+
+	if (keys->sort != FOLDER_SORT_NONE && count > 1) {
+		struct folder_sort_key *tmp = bmalloc(count * sizeof(*tmp));
+		size_t threads = 1;
+		if (count >= FOLDER_SORT_PARALLEL_MIN) {
+			int cores = os_get_logical_cores();
+			threads = cores < 1 ? 1 : (size_t)cores;
+			if (threads > FOLDER_SORT_MAX_THREADS)
+				threads = FOLDER_SORT_MAX_THREADS;
+		}
+
+		if (threads > 1)
+			parallel_merge_sort(keys->data.array, array, tmp, count, threads);
+		else
+			merge_sort(keys->data.array, array, tmp, count);
+		bfree(tmp);
+	}
+
+	if (reverse) {
+		for (size_t i = 0; i < count / 2; i++) {
+			struct folder_sort_key key = array[i];
+			array[i] = array[count - 1 - i];
+			array[count - 1 - i] = key;
+		}
+	}
+}
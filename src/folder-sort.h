@@ -0,0 +1,62 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+#include <util/darray.h>
+
+/* clang-format off */
+
+enum folder_sort {
+	FOLDER_SORT_NONE,  // the order the folder is read in
+	FOLDER_SORT_NAME,  // natural order, ignoring case, so "2" comes before "10"
+	FOLDER_SORT_MTIME, // oldest first
+	FOLDER_SORT_SIZE,  // smallest first
+};
+
+/* clang-format on */
+
+/* Folders with at least this many items are sorted on several threads */
+#define FOLDER_SORT_PARALLEL_MIN 16384
+#define FOLDER_SORT_MAX_THREADS 8
+
+/* The key of an item is made once, while the folder is scanned, and is
+ * compared with memcmp. Names are encoded so that numbers compare by value,
+ * and the mtime or size comes first as big-endian bytes. The name itself ends
+ * every key, so items only compare equal if their names are the same.
+ */
+struct folder_sort_key {
+	size_t offset; // in `data`
+	size_t size;
+	size_t index; // of the item, in the order it was added
+};
+
+struct folder_sort_keys {
+	enum folder_sort sort;
+	DARRAY(uint8_t) data;
+	DARRAY(struct folder_sort_key) keys;
+};
+
+extern void folder_sort_init(struct folder_sort_keys *keys, enum folder_sort sort);
+extern void folder_sort_free(struct folder_sort_keys *keys);
+extern void folder_sort_add(struct folder_sort_keys *keys, const char *name, int64_t mtime, uint64_t size);
+
+/* Sorts the keys, so the item at `i` is `keys.array[i].index`. The sort is
+ * stable, and `reverse` reverses the result. */
+extern void folder_sort_run(struct folder_sort_keys *keys, bool reverse);
@@ -0,0 +1,466 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <math.h>
+#include <sys/stat.h>
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <plugin-support.h>
+#include "loudness.h"
+
+#define LOUDNESS_ABSOLUTE_GATE -70.0
+#define LOUDNESS_RELATIVE_GATE -10.0
+#define LOUDNESS_MAX_QUEUED_SECONDS 30
+#define LOUDNESS_CACHE_FILE "loudness.json"
+
+/* ------------------------------------------------------------------------- */
+/* Meter */
+
+/* Channel weights of BS.1770, in the order libobs uses, by channel count. The
+ * LFE is left out, and surrounds are weighted +1.5dB. */
+static const double channel_weights[MAX_AUDIO_CHANNELS + 1][MAX_AUDIO_CHANNELS] = {
+	[1] = {1.0},
+	[2] = {1.0, 1.0},
+	[3] = {1.0, 1.0, 0.0},
+	[4] = {1.0, 1.0, 1.0, 1.41},
+	[5] = {1.0, 1.0, 1.0, 0.0, 1.41},
+	[6] = {1.0, 1.0, 1.0, 0.0, 1.41, 1.41},
+	[8] = {1.0, 1.0, 1.0, 0.0, 1.41, 1.41, 1.41, 1.41},
+};
+
+static inline double energy_to_lufs(double energy)
+{
+	return -0.691 + 10.0 * log10(energy);
+}
+
+static inline double lufs_to_energy(double lufs)
+{
+	return pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+/* The K-weighting filters of BS.1770, for any sample rate */
+static void init_k_weighting(struct loudness_meter *meter, uint32_t sample_rate)
+{
+	double f0 = 1681.974450955533;
+	double gain = 3.999843853973347;
+	double q = 0.7071752369554196;
+	double k = tan(M_PI * f0 / (double)sample_rate);
+	double vh = pow(10.0, gain / 20.0);
+	double vb = pow(vh, 0.4996667741545416);
+	double a0 = 1.0 + k / q + k * k;
+
+	meter->shelf[0] = (vh + vb * k / q + k * k) / a0;
+	meter->shelf[1] = 2.0 * (k * k - vh) / a0;
+	meter->shelf[2] = (vh - vb * k / q + k * k) / a0;
+	meter->shelf[3] = 2.0 * (k * k - 1.0) / a0;
+	meter->shelf[4] = (1.0 - k / q + k * k) / a0;
+
+	f0 = 38.13547087602444;
+	q = 0.5003270373238773;
+	k = tan(M_PI * f0 / (double)sample_rate);
+	a0 = 1.0 + k / q + k * k;
+
+	meter->highpass[0] = 1.0;
+	meter->highpass[1] = -2.0;
+	meter->highpass[2] = 1.0;
+	meter->highpass[3] = 2.0 * (k * k - 1.0) / a0;
+	meter->highpass[4] = (1.0 - k / q + k * k) / a0;
+}
+
+void loudness_meter_init(struct loudness_meter *meter, size_t channels, uint32_t sample_rate)
+{
+	memset(meter, 0, sizeof(*meter));
+	meter->channels = channels < MAX_AUDIO_CHANNELS ? channels : MAX_AUDIO_CHANNELS;
+	for (size_t i = 0; i < meter->channels; i++) {
+		/* unknown layouts weigh every channel the same */
+		bool known = channel_weights[meter->channels][0] != 0.0;
+		meter->weights[i] = known ? channel_weights[meter->channels][i] : 1.0;
+	}
+	init_k_weighting(meter, sample_rate);
+	meter->step_frames = sample_rate / 10;
+}
+
+void loudness_meter_free(struct loudness_meter *meter)
+{
+	da_free(meter->blocks);
+}
+
+static inline double biquad(const double *c, double *state, double x)
+{
+	double y = c[0] * x + state[0];
+	state[0] = c[1] * x - c[3] * y + state[1];
+	state[1] = c[2] * x - c[4] * y;
+	return y;
+}
+
+/* A block is the last four steps, so blocks overlap by 75% */
+static void finish_step(struct loudness_meter *meter)
+{
+	meter->steps[meter->step_count % 4] = meter->step_sum / (double)meter->step_frames;
+	meter->step_count++;
+	meter->step_sum = 0.0;
+	meter->step_pos = 0;
+
+	if (meter->step_count >= 4) {
+		double block = (meter->steps[0] + meter->steps[1] + meter->steps[2] + meter->steps[3]) / 4.0;
+		da_push_back(meter->blocks, &block);
+	}
+}
+
+void loudness_meter_add(struct loudness_meter *meter, const float *const *planes, size_t frames)
+{
+	size_t pos = 0;
+	while (pos < frames) {
+		size_t count = meter->step_frames - meter->step_pos;
+		if (count > frames - pos)
+			count = frames - pos;
+
+		for (size_t ch = 0; ch < meter->channels; ch++) {
+			if (meter->weights[ch] == 0.0)
+				continue;
+
+			const float *in = planes[ch] + pos;
+			double *state = meter->state[ch];
+			double sum = 0.0;
+			for (size_t i = 0; i < count; i++) {
+				double y = biquad(meter->shelf, state, (double)in[i]);
+				y = biquad(meter->highpass, state + 2, y);
+				sum += y * y;
+			}
+			meter->step_sum += sum * meter->weights[ch];
+		}
+
+		pos += count;
+		meter->step_pos += count;
+		if (meter->step_pos == meter->step_frames)
+			finish_step(meter);
+	}
+}
+
+bool loudness_meter_integrated(const struct loudness_meter *meter, double *lufs)
+{
+	double absolute = lufs_to_energy(LOUDNESS_ABSOLUTE_GATE);
+	double sum = 0.0;
+	size_t count = 0;
+
+	for (size_t i = 0; i < meter->blocks.num; i++) {
+		if (meter->blocks.array[i] > absolute) {
+			sum += meter->blocks.array[i];
+			count++;
+		}
+	}
+	if (!count)
+		return false;
+
+	double relative = lufs_to_energy(energy_to_lufs(sum / (double)count) + LOUDNESS_RELATIVE_GATE);
+	sum = 0.0;
+	count = 0;
+	for (size_t i = 0; i < meter->blocks.num; i++) {
+		if (meter->blocks.array[i] > absolute && meter->blocks.array[i] > relative) {
+			sum += meter->blocks.array[i];
+			count++;
+		}
+	}
+
+	*lufs = energy_to_lufs(sum / (double)count);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Analyzer */
+
+enum chunk_type {
+	CHUNK_BEGIN,
+	CHUNK_SAMPLES,
+	CHUNK_END,
+};
+
+struct loudness_chunk {
+	enum chunk_type type;
+	char *path;
+	int64_t mtime;
+	size_t channels;
+	uint32_t sample_rate;
+	bool complete;
+	size_t frames;
+	float data[]; // planar
+};
+
+static void process_chunk(struct loudness_analyzer *analyzer, struct loudness_chunk *chunk)
+{
+	if (chunk->type == CHUNK_BEGIN) {
+		if (analyzer->measuring)
+			loudness_meter_free(&analyzer->meter);
+		bfree(analyzer->path);
+		analyzer->path = chunk->path;
+		analyzer->mtime = chunk->mtime;
+		chunk->path = NULL;
+		loudness_meter_init(&analyzer->meter, chunk->channels, chunk->sample_rate);
+		analyzer->measuring = true;
+
+	} else if (chunk->type == CHUNK_SAMPLES && analyzer->measuring) {
+		/* the output layout changed, the file can't be measured */
+		if (chunk->channels != analyzer->meter.channels) {
+			loudness_meter_free(&analyzer->meter);
+			analyzer->measuring = false;
+			return;
+		}
+
+		const float *planes[MAX_AUDIO_CHANNELS];
+		for (size_t i = 0; i < chunk->channels; i++)
+			planes[i] = chunk->data + i * chunk->frames;
+		loudness_meter_add(&analyzer->meter, planes, chunk->frames);
+
+	} else if (chunk->type == CHUNK_END && analyzer->measuring) {
+		double lufs;
+		if (chunk->complete && loudness_meter_integrated(&analyzer->meter, &lufs)) {
+			loudness_cache_set(analyzer->path, analyzer->mtime, lufs);
+			stats_add(analyzer->stats, STATS_COUNTER_LOUDNESS_ANALYZED, 1);
+			obs_log(LOG_DEBUG, "Measured '%s' at %.1f LUFS", analyzer->path, lufs);
+		}
+		loudness_meter_free(&analyzer->meter);
+		analyzer->measuring = false;
+	}
+}
+
+static void *analyzer_thread(void *data)
+{
+	struct loudness_analyzer *analyzer = data;
+
+	os_set_thread_name("media-playlist-source: loudness");
+
+	while (os_event_wait(analyzer->event) == 0) {
+		while (!os_atomic_load_bool(&analyzer->stop)) {
+			struct loudness_chunk *chunk = NULL;
+
+			pthread_mutex_lock(&analyzer->mutex);
+			if (analyzer->chunks.size) {
+				deque_pop_front(&analyzer->chunks, &chunk, sizeof(chunk));
+				if (chunk->type == CHUNK_SAMPLES)
+					analyzer->queued_frames -= chunk->frames;
+			}
+			pthread_mutex_unlock(&analyzer->mutex);
+
+			if (!chunk)
+				break;
+			process_chunk(analyzer, chunk);
+			bfree(chunk->path);
+			bfree(chunk);
+		}
+
+		if (os_atomic_load_bool(&analyzer->stop))
+			break;
+	}
+
+	return NULL;
+}
+
+bool loudness_analyzer_init(struct loudness_analyzer *analyzer, struct mps_stats *stats)
+{
+	analyzer->stats = stats;
+	pthread_mutex_init_value(&analyzer->mutex);
+	if (pthread_mutex_init(&analyzer->mutex, NULL) != 0)
+		return false;
+	if (os_event_init(&analyzer->event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+	if (pthread_create(&analyzer->thread, NULL, analyzer_thread, analyzer) != 0)
+		return false;
+	analyzer->thread_active = true;
+	return true;
+}
+
+void loudness_analyzer_free(struct loudness_analyzer *analyzer)
+{
+	if (analyzer->thread_active) {
+		os_atomic_set_bool(&analyzer->stop, true);
+		os_event_signal(analyzer->event);
+		pthread_join(analyzer->thread, NULL);
+	}
+	os_event_destroy(analyzer->event);
+
+	while (analyzer->chunks.size) {
+		struct loudness_chunk *chunk;
+		deque_pop_front(&analyzer->chunks, &chunk, sizeof(chunk));
+		bfree(chunk->path);
+		bfree(chunk);
+	}
+	deque_free(&analyzer->chunks);
+	if (analyzer->measuring)
+		loudness_meter_free(&analyzer->meter);
+	bfree(analyzer->path);
+	pthread_mutex_destroy(&analyzer->mutex);
+}
+
+/* Requires `mutex` */
+static void push_chunk(struct loudness_analyzer *analyzer, struct loudness_chunk *chunk)
+{
+	deque_push_back(&analyzer->chunks, &chunk, sizeof(chunk));
+	if (chunk->type == CHUNK_SAMPLES)
+		analyzer->queued_frames += chunk->frames;
+}
+
+void loudness_analyzer_begin(struct loudness_analyzer *analyzer, const char *path, int64_t mtime, size_t channels,
+			     uint32_t sample_rate)
+{
+	struct loudness_chunk *chunk = bzalloc(sizeof(*chunk));
+	chunk->type = CHUNK_BEGIN;
+	chunk->path = bstrdup(path);
+	chunk->mtime = mtime;
+	chunk->channels = channels;
+	chunk->sample_rate = sample_rate;
+
+	pthread_mutex_lock(&analyzer->mutex);
+	push_chunk(analyzer, chunk);
+	analyzer->max_frames = (size_t)sample_rate * LOUDNESS_MAX_QUEUED_SECONDS;
+	analyzer->accepting = true;
+	analyzer->dropping = false;
+	pthread_mutex_unlock(&analyzer->mutex);
+	os_event_signal(analyzer->event);
+}
+
+/* Copies relayed audio for the analyzer thread. Called by the video thread. */
+void loudness_analyzer_push(struct loudness_analyzer *analyzer, const float *const *planes, size_t channels,
+			    size_t frames)
+{
+	pthread_mutex_lock(&analyzer->mutex);
+	if (!analyzer->accepting || analyzer->dropping) {
+		pthread_mutex_unlock(&analyzer->mutex);
+		return;
+	}
+	if (analyzer->queued_frames + frames > analyzer->max_frames) {
+		analyzer->dropping = true;
+		pthread_mutex_unlock(&analyzer->mutex);
+		return;
+	}
+	pthread_mutex_unlock(&analyzer->mutex);
+
+	struct loudness_chunk *chunk = bmalloc(sizeof(*chunk) + channels * frames * sizeof(float));
+	memset(chunk, 0, sizeof(*chunk));
+	chunk->type = CHUNK_SAMPLES;
+	chunk->channels = channels;
+	chunk->frames = frames;
+	for (size_t i = 0; i < channels; i++)
+		memcpy(chunk->data + i * frames, planes[i], frames * sizeof(float));
+
+	pthread_mutex_lock(&analyzer->mutex);
+	push_chunk(analyzer, chunk);
+	pthread_mutex_unlock(&analyzer->mutex);
+	os_event_signal(analyzer->event);
+}
+
+/* Some audio of the file being measured was dropped before it was relayed, so
+ * it won't be added to the cache. */
+void loudness_analyzer_skip(struct loudness_analyzer *analyzer)
+{
+	pthread_mutex_lock(&analyzer->mutex);
+	analyzer->dropping = true;
+	pthread_mutex_unlock(&analyzer->mutex);
+}
+
+/* Ends the file being measured. It is only added to the cache if it was
+ * `complete`, meaning it played to its end. */
+void loudness_analyzer_end(struct loudness_analyzer *analyzer, bool complete)
+{
+	pthread_mutex_lock(&analyzer->mutex);
+	if (!analyzer->accepting) {
+		pthread_mutex_unlock(&analyzer->mutex);
+		return;
+	}
+
+	struct loudness_chunk *chunk = bzalloc(sizeof(*chunk));
+	chunk->type = CHUNK_END;
+	chunk->complete = complete && !analyzer->dropping;
+	push_chunk(analyzer, chunk);
+	analyzer->accepting = false;
+	pthread_mutex_unlock(&analyzer->mutex);
+	os_event_signal(analyzer->event);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Cache */
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static obs_data_t *cache = NULL;
+static char *cache_path = NULL;
+
+int64_t loudness_file_mtime(const char *path)
+{
+	struct stat st;
+	if (os_stat(path, &st) != 0)
+		return 0;
+	return (int64_t)st.st_mtime;
+}
+
+/* Requires `cache_mutex` */
+static void load_cache(void)
+{
+	if (cache)
+		return;
+
+	char *dir = obs_module_config_path("");
+	if (dir) {
+		os_mkdirs(dir);
+		bfree(dir);
+	}
+	cache_path = obs_module_config_path(LOUDNESS_CACHE_FILE);
+	if (cache_path)
+		cache = obs_data_create_from_json_file_safe(cache_path, "bak");
+	if (!cache)
+		cache = obs_data_create();
+}
+
+bool loudness_cache_get(const char *path, int64_t mtime, double *lufs)
+{
+	pthread_mutex_lock(&cache_mutex);
+	load_cache();
+	obs_data_t *entry = obs_data_get_obj(cache, path);
+	bool found = entry && obs_data_get_int(entry, "mtime") == mtime;
+	if (found)
+		*lufs = obs_data_get_double(entry, "lufs");
+	obs_data_release(entry);
+	pthread_mutex_unlock(&cache_mutex);
+	return found;
+}
+
+void loudness_cache_set(const char *path, int64_t mtime, double lufs)
+{
+	obs_data_t *entry = obs_data_create();
+	obs_data_set_int(entry, "mtime", mtime);
+	obs_data_set_double(entry, "lufs", lufs);
+
+	pthread_mutex_lock(&cache_mutex);
+	load_cache();
+	obs_data_set_obj(cache, path, entry);
+	if (cache_path && !obs_data_save_json_safe(cache, cache_path, "tmp", "bak"))
+		obs_log(LOG_WARNING, "Failed to save loudness cache to '%s'", cache_path);
+	pthread_mutex_unlock(&cache_mutex);
+
+	obs_data_release(entry);
+}
+
+void loudness_cache_free(void)
+{
+	pthread_mutex_lock(&cache_mutex);
+	obs_data_release(cache);
+	cache = NULL;
+	bfree(cache_path);
+	cache_path = NULL;
+	pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,92 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+#include <util/threading.h>
+#include <util/darray.h>
+#include <util/deque.h>
+#include "stats.h"
+
+/* Integrated loudness as in ITU-R BS.1770 and EBU R128: K-weighted, measured
+ * in 400ms blocks every 100ms, with the -70 LUFS absolute gate and the -10 LU
+ * relative gate.
+ */
+struct loudness_meter {
+	size_t channels;
+	double weights[MAX_AUDIO_CHANNELS];
+	double shelf[5]; // b0, b1, b2, a1, a2
+	double highpass[5];
+	double state[MAX_AUDIO_CHANNELS][4]; // of both filters, transposed direct form II
+
+	size_t step_frames; // 100ms
+	size_t step_pos;
+	double step_sum;
+	double steps[4]; // mean squares of the last steps
+	size_t step_count;
+	DARRAY(double) blocks;
+};
+
+extern void loudness_meter_init(struct loudness_meter *meter, size_t channels, uint32_t sample_rate);
+extern void loudness_meter_free(struct loudness_meter *meter);
+extern void loudness_meter_add(struct loudness_meter *meter, const float *const *planes, size_t frames);
+/* Returns false if less than one block was measured, or all of it was silent */
+extern bool loudness_meter_integrated(const struct loudness_meter *meter, double *lufs);
+
+/* Measures files as they are relayed, on its own thread. A file that plays
+ * from begin to end without the analyzer falling behind is added to the
+ * loudness cache, so it is only measured once.
+ */
+struct loudness_analyzer {
+	pthread_t thread;
+	bool thread_active;
+	volatile bool stop;
+	os_event_t *event;
+
+	pthread_mutex_t mutex;
+	struct deque chunks; // struct loudness_chunk *
+	size_t queued_frames;
+	size_t max_frames;
+	bool accepting; // between begin and end
+	bool dropping;  // the analyzer fell behind, until the next file
+
+	/* only used by the analyzer thread */
+	struct loudness_meter meter;
+	char *path;
+	int64_t mtime;
+	bool measuring;
+	struct mps_stats *stats;
+};
+
+extern bool loudness_analyzer_init(struct loudness_analyzer *analyzer, struct mps_stats *stats);
+extern void loudness_analyzer_free(struct loudness_analyzer *analyzer);
+extern void loudness_analyzer_begin(struct loudness_analyzer *analyzer, const char *path, int64_t mtime,
+				    size_t channels, uint32_t sample_rate);
+extern void loudness_analyzer_push(struct loudness_analyzer *analyzer, const float *const *planes, size_t channels,
+				   size_t frames);
+extern void loudness_analyzer_skip(struct loudness_analyzer *analyzer);
+extern void loudness_analyzer_end(struct loudness_analyzer *analyzer, bool complete);
+
+/* Measured loudness of files, shared by all sources and saved in the plugin's
+ * config folder. Entries are only used while the file's mtime is unchanged.
+ */
+extern int64_t loudness_file_mtime(const char *path);
+extern bool loudness_cache_get(const char *path, int64_t mtime, double *lufs);
+extern void loudness_cache_set(const char *path, int64_t mtime, double lufs);
+extern void loudness_cache_free(void);
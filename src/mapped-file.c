@@ -0,0 +1,96 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <sys/stat.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include "mapped-file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool mapped_file_open(struct mapped_file *map, const char *path)
+{
+	map->data = "";
+	map->size = 0;
+
+#ifdef _WIN32
+	wchar_t *wpath = NULL;
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return false;
+	HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+				  FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	bfree(wpath);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	bool success = GetFileSizeEx(file, &size) != 0;
+	if (success && size.QuadPart > 0) {
+		HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		const void *data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (mapping)
+			CloseHandle(mapping);
+		if (data) {
+			map->data = data;
+			map->size = (size_t)size.QuadPart;
+		} else {
+			success = false;
+		}
+	}
+	CloseHandle(file);
+	return success;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	bool success = fstat(fd, &st) == 0;
+	if (success && st.st_size > 0) {
+		void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+			map->data = data;
+			map->size = (size_t)st.st_size;
+		} else {
+			success = false;
+		}
+	}
+	close(fd);
+	return success;
+#endif
+}
+
+void mapped_file_close(struct mapped_file *map)
+{
+	if (!map->size)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(map->data);
+#else
+	munmap((void *)map->data, map->size);
+#endif
+	map->data = "";
+	map->size = 0;
+}
@@ -0,0 +1,34 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A whole file mapped read-only, so big files are read straight from the page
+ * cache without being copied first. Empty files are not mapped, and `data`
+ * points to an empty string instead.
+ */
+struct mapped_file {
+	const char *data;
+	size_t size;
+};
+
+extern bool mapped_file_open(struct mapped_file *map, const char *path);
+extern void mapped_file_close(struct mapped_file *map);
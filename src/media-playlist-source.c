@@ -16,6 +16,9 @@ You should have received a copy of the GNU General Public License along
 with this program. If not, see <https://www.gnu.org/licenses/>
 */
 
+#include <inttypes.h>
+#include <math.h>
+#include <sys/stat.h>
 #include "media-playlist-source.h"
 
 #define S_PLAYLIST "playlist"
@@ -29,9 +32,27 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #define S_CURRENT_MEDIA_INDEX "current_media_index"
 #define S_CURRENT_FOLDER_ITEM_FILENAME "current_folder_item_filename"
 #define S_ID "uuid"
+#define S_ITEM_START "start_ms"
+#define S_ITEM_END "end_ms"
+#define S_ITEM_SORT "sort"
+#define S_ITEM_SORT_REVERSE "sort_reverse"
+#define S_CATALOG "catalog"
+#define S_CATALOG_CHECKSUM "catalog_checksum"
 #define S_IS_URL "is_url"
 #define S_SPEED "speed_percent"
 #define S_REFRESH_FILENAME "refresh_filename"
+#define S_AUDIO_MAX_LATENCY "audio_max_latency_ms"
+#define S_AUDIO_OVERFLOW_POLICY "audio_overflow_policy"
+#define S_CROSSFADE "crossfade_ms"
+#define S_LOUDNESS_NORMALIZE "loudness_normalize"
+#define S_LOUDNESS_TARGET "loudness_target"
+#define S_IDLE_RELEASE "idle_release_s"
+#define S_MAX_OPEN_FILES "max_open_files"
+#define S_FAST_FAIL "fast_fail_s"
+#define S_LAZY_LOAD "lazy_load"
+#define S_RESUME_POSITION "resume_position"
+#define S_URL_CACHE "url_cache"
+#define S_URL_CACHE_SIZE "url_cache_size_mb"
 
 /* Media Source Settings */
 #define S_FFMPEG_LOCAL_FILE "local_file"
@@ -50,9 +71,17 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #define T_VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE T_("VisibilityBehavior.PauseUnpause")
 #define T_VISIBILITY_BEHAVIOR_ALWAYS_PLAY T_("VisibilityBehavior.AlwaysPlay")
 #define T_VISIBILITY_BEHAVIOR_STOP_PLAY_NEXT T_("VisibilityBehavior.StopPlayNext")
+#define T_VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK T_("VisibilityBehavior.VirtualClock")
 #define T_RESTART_BEHAVIOR T_("RestartBehavior")
 #define T_RESTART_BEHAVIOR_CURRENT_FILE T_("RestartBehavior.CurrentFile")
 #define T_RESTART_BEHAVIOR_FIRST_FILE T_("RestartBehavior.FirstFile")
+#define T_RESUME_POSITION T_("ResumePosition")
+#define T_RESUME_POSITION_TOOLTIP T_("ResumePosition.Tooltip")
+#define T_LAZY_LOAD T_("LazyLoad")
+#define T_LAZY_LOAD_TOOLTIP T_("LazyLoad.Tooltip")
+#define T_LAZY_LOAD_OFF T_("LazyLoad.Off")
+#define T_LAZY_LOAD_WHEN_SHOWN T_("LazyLoad.WhenShown")
+#define T_LAZY_LOAD_IN_BACKGROUND T_("LazyLoad.InBackground")
 #define T_CURRENT_FILE_NAME T_("CurrentFileName")
 #define T_SELECT_FILE T_("SelectFile")
 #define T_NO_FILE_SELECTED T_("NoFileSelected")
@@ -62,6 +91,63 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #define T_SPEED T_("Speed")
 #define T_SPEED_WARNING T_("SpeedWarning")
 #define T_REFRESH_FILENAME T_("RefreshFilename")
+#define T_AUDIO_MAX_LATENCY T_("AudioMaxLatency")
+#define T_AUDIO_MAX_LATENCY_TOOLTIP T_("AudioMaxLatency.Tooltip")
+#define T_AUDIO_OVERFLOW_POLICY T_("AudioOverflowPolicy")
+#define T_AUDIO_OVERFLOW_DROP_OLDEST T_("AudioOverflowPolicy.DropOldest")
+#define T_AUDIO_OVERFLOW_DROP_NEWEST T_("AudioOverflowPolicy.DropNewest")
+#define T_CROSSFADE T_("Crossfade")
+#define T_CROSSFADE_TOOLTIP T_("Crossfade.Tooltip")
+#define T_LOUDNESS_NORMALIZE T_("LoudnessNormalize")
+#define T_LOUDNESS_NORMALIZE_TOOLTIP T_("LoudnessNormalize.Tooltip")
+#define T_LOUDNESS_TARGET T_("LoudnessTarget")
+#define T_CATALOG T_("Catalog")
+#define T_IDLE_RELEASE T_("IdleRelease")
+#define T_IDLE_RELEASE_TOOLTIP T_("IdleRelease.Tooltip")
+#define T_MAX_OPEN_FILES T_("MaxOpenFiles")
+#define T_MAX_OPEN_FILES_TOOLTIP T_("MaxOpenFiles.Tooltip")
+#define T_FAST_FAIL T_("FastFail")
+#define T_FAST_FAIL_TOOLTIP T_("FastFail.Tooltip")
+#define T_URL_CACHE T_("UrlCache")
+#define T_URL_CACHE_TOOLTIP T_("UrlCache.Tooltip")
+#define T_URL_CACHE_SIZE T_("UrlCacheSize")
+#define T_CATALOG_TOOLTIP T_("Catalog.Tooltip")
+#define T_CATALOG_ERROR T_("Catalog.Error")
+
+/* Like libobs, smaller differences between where the last packet ended and
+ * the next one's timestamp are jitter, and bigger ones are a real jump */
+#define AUDIO_SMOOTHING_THRESHOLD_NS 70000000ULL
+
+/* A crossfade is given up if the incoming file sends no audio for this long
+ * after the ramps should have ended */
+#define CROSSFADE_TIMEOUT_NS 1000000000ULL
+#define HALF_PI 1.57079632679f
+
+/* Loudness gains are limited, so quiet noise is not brought up too much, and
+ * changed over a few milliseconds between files */
+#define LOUDNESS_MAX_BOOST_DB 12.0
+#define LOUDNESS_MAX_CUT_DB -30.0
+#define LOUDNESS_RAMP_FRAMES 480
+
+/* The missing files dialog waits this long for paths that are slow to check,
+ * like ones on a network share that doesn't answer */
+#define MISSING_FILES_TIMEOUT_MS 2000
+
+/* URL items this far ahead are downloaded to the URL cache */
+#define URL_CACHE_PREFETCH_COUNT 2
+
+/* Most files skipped when catching up with the time a source was hidden, so a
+ * looping playlist of very short files can't hold up the navigation thread */
+#define CATCH_UP_MAX_FILES 10000
+
+/* Lazy sources loaded in the background wait this long after they were
+ * created, and at least one interval after the source before them, so the
+ * sources of a scene collection aren't all loaded at once */
+#define LAZY_LOAD_WARM_DELAY_MS 5000
+#define LAZY_LOAD_WARM_INTERVAL_MS 250
+
+/* How often where the file is gets journaled, with "resume_position" */
+#define POSITION_JOURNAL_INTERVAL_NS 5000000000ULL
 
 #define T_PLAY_PAUSE T_("PlayPause")
 #define T_RESTART T_("Restart")
@@ -69,6 +155,59 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #define T_PLAYLIST_NEXT T_("Next")
 #define T_PLAYLIST_PREV T_("Previous")
 
+/* Publishes the current playlist state for lock-free readers.
+ *
+ * There are two snapshots, the readers only use the one at `snapshot_idx`.
+ * The other one is only written to once all readers have left it, and after
+ * switching `snapshot_idx`, this waits until all readers of the previous
+ * snapshot have left too. So once this returns, nothing can read the files of
+ * the previous snapshot anymore, and they can be freed.
+ */
+static void publish_snapshot(struct media_playlist_source *mps)
+{
+	pthread_mutex_lock(&mps->snapshot_mutex);
+	long old_idx = os_atomic_load_long(&mps->snapshot_idx);
+	long new_idx = !old_idx;
+
+	while (os_atomic_load_long(&mps->snapshot_readers[new_idx]))
+		os_sleep_ms(0);
+
+	struct playlist_snapshot *snapshot = &mps->snapshots[new_idx];
+	snapshot->files.da = mps->files.da;
+	snapshot->actual_media = mps->actual_media;
+	snapshot->current_media_index = mps->current_media_index;
+	snapshot->total_file_count = get_total_file_count(mps);
+	os_atomic_set_long(&mps->snapshot_idx, new_idx);
+
+	while (os_atomic_load_long(&mps->snapshot_readers[old_idx]))
+		os_sleep_ms(0);
+	pthread_mutex_unlock(&mps->snapshot_mutex);
+}
+
+/* Readers must not call anything that publishes before releasing. */
+static const struct playlist_snapshot *snapshot_acquire(struct media_playlist_source *mps, long *idx)
+{
+	while (true) {
+		*idx = os_atomic_load_long(&mps->snapshot_idx);
+		os_atomic_inc_long(&mps->snapshot_readers[*idx]);
+		/* the writer may have moved on before we were counted */
+		if (os_atomic_load_long(&mps->snapshot_idx) == *idx)
+			return &mps->snapshots[*idx];
+		os_atomic_dec_long(&mps->snapshot_readers[*idx]);
+	}
+}
+
+static void snapshot_release(struct media_playlist_source *mps, long idx)
+{
+	os_atomic_dec_long(&mps->snapshot_readers[idx]);
+}
+
+/* The internal media source of the current file */
+static inline obs_source_t *get_current_media_source(struct media_playlist_source *mps)
+{
+	return mps->media_sources[os_atomic_load_long(&mps->current_child)];
+}
+
 static inline void set_current_media_index(struct media_playlist_source *mps, size_t index)
 {
 	if (get_total_file_count(mps) > 0) {
@@ -85,6 +224,7 @@ static inline void set_current_media_index(struct media_playlist_source *mps, si
 		bfree(mps->current_media_filename);
 		mps->current_media_filename = NULL;
 	}
+	publish_snapshot(mps);
 }
 
 static size_t get_total_file_count(struct media_playlist_source *mps)
@@ -114,6 +254,7 @@ static inline void set_current_folder_item_index(struct media_playlist_source *m
 		if (!mps->current_media->is_folder) {
 			mps->current_folder_item_index = 0;
 			mps->actual_media = mps->current_media;
+			publish_snapshot(mps);
 			return;
 		}
 
@@ -128,6 +269,7 @@ static inline void set_current_folder_item_index(struct media_playlist_source *m
 		mps->current_folder_item_index = 0;
 		mps->actual_media = NULL;
 	}
+	publish_snapshot(mps);
 }
 
 static inline void reset_folder_item_index(struct media_playlist_source *mps)
@@ -163,23 +305,30 @@ static bool valid_extension(const char *ext)
 static void update_current_filename_setting(struct media_playlist_source *mps, obs_data_t *data)
 {
 	struct dstr long_desc = {0};
+	long idx;
 	if (!mps || !data)
 		return;
-	if (!mps->actual_media) {
+
+	const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+	const struct media_file_data *actual_media = snapshot->actual_media;
+	if (!actual_media) {
+		snapshot_release(mps, idx);
 		obs_data_set_string(data, S_CURRENT_FILE_NAME, " ");
 		return;
-	} else if (mps->actual_media->parent) {
-		dstr_catf(&long_desc, "%zu-%zu", mps->actual_media->parent->index + 1, mps->actual_media->index + 1);
+	} else if (actual_media->parent) {
+		dstr_catf(&long_desc, "%zu-%zu", actual_media->parent->index + 1, actual_media->index + 1);
 	} else {
-		dstr_catf(&long_desc, "%zu", mps->actual_media->index + 1);
+		dstr_catf(&long_desc, "%zu", actual_media->index + 1);
 	}
-	dstr_catf(&long_desc, ": %s", mps->actual_media->path);
+	dstr_catf(&long_desc, ": %s", actual_media->path);
+	snapshot_release(mps, idx);
+
 	obs_data_set_string(data, S_CURRENT_FILE_NAME, long_desc.array);
 	dstr_free(&long_desc);
 }
 
 /* Empties path selected in media source,
- * for when there is no item in the list
+ * for when there is no item in the list. Called by the navigation thread.
  */
 static void clear_media_source(void *data)
 {
@@ -188,25 +337,18 @@ static void clear_media_source(void *data)
 	obs_data_set_bool(settings, S_FFMPEG_IS_LOCAL_FILE, true);
 	obs_data_set_string(settings, S_FFMPEG_INPUT, "");
 	obs_data_set_string(settings, S_FFMPEG_LOCAL_FILE, "");
-	obs_source_update(mps->current_media_source, settings);
+	obs_source_update(get_current_media_source(mps), settings);
 	obs_data_release(settings);
 	obs_source_media_stop(mps->source);
 }
 
-/* Checks if the media source has to be updated, because updating its
- * settings causes it to restart. Can also force update it.
+/* Sets the actual media from the current media and folder item index. The
+ * file is opened by the navigation thread, see post_open.
  * Should first call set_current_media_index before calling this
- *
- * Forced updates:
- * * Using play_folder_item_at_index
- * * Using play_media_at_index
- * * during mps_update (files/folders can be changed)
  */
-static void update_media_source(void *data, bool forced)
+static void update_media_source(void *data)
 {
 	struct media_playlist_source *mps = data;
-	obs_source_t *media_source = mps->current_media_source;
-	obs_data_t *settings = obs_source_get_settings(media_source);
 	if (mps->current_media->is_folder) {
 		assert(mps->current_folder_item_index < mps->current_media->folder_items.num);
 		mps->actual_media = &mps->current_media->folder_items.array[mps->current_folder_item_index];
@@ -215,51 +357,130 @@ static void update_media_source(void *data, bool forced)
 		mps->actual_media = mps->current_media;
 	}
 
+	publish_snapshot(mps);
+}
+
+/* Marks where a file started or ended in the relayed audio, so that files are
+ * measured from their first to their last packet. Requires `audio_mutex`.
+ */
+static void queue_file_marker(struct media_playlist_source *mps, struct file_loudness *opened)
+{
+	struct audio_packet packet = {.file_opened = opened, .file_ended = !opened};
+	deque_push_back(&mps->audio_packets, &packet, sizeof(packet));
+}
+
+static void free_file_loudness(struct file_loudness *file)
+{
+	if (file) {
+		bfree(file->path);
+		bfree(file);
+	}
+}
+
+/* Looks up the loudness of a file that is being opened. If it is not known,
+ * the file is measured while it plays, see handle_file_marker.
+ */
+static void set_loudness_file(struct media_playlist_source *mps, const char *path, bool is_url)
+{
+	pthread_mutex_lock(&mps->audio_mutex);
+	bool normalize = mps->loudness_normalize;
+	pthread_mutex_unlock(&mps->audio_mutex);
+
+	struct file_loudness *file = bzalloc(sizeof(*file));
+	file->lufs = NAN;
+	if (normalize && !is_url) {
+		file->mtime = loudness_file_mtime(path);
+		if (file->mtime && !loudness_cache_get(path, file->mtime, &file->lufs))
+			file->path = bstrdup(path);
+	}
+
+	pthread_mutex_lock(&mps->audio_mutex);
+	queue_file_marker(mps, file);
+	pthread_mutex_unlock(&mps->audio_mutex);
+}
+
+/* Seeks the internal media source to the in-point of its file. Nothing is
+ * shown or relayed until it gets there, see outside_trim.
+ */
+static void seek_to_in_point(struct media_playlist_source *mps)
+{
+	long start_ms = os_atomic_load_long(&mps->trim_start_ms);
+	os_atomic_set_long(&mps->trim_seek_ms, start_ms);
+	if (start_ms > 0) {
+		os_atomic_set_bool(&mps->trim_seeking, true);
+		obs_source_media_set_time(get_current_media_source(mps), start_ms);
+	}
+}
+
+/* Applies the settings posted by mps_update. Called by the navigation thread */
+static void apply_media_settings(struct media_playlist_source *mps, obs_data_t *settings)
+{
+	obs_source_update(get_current_media_source(mps), settings);
+	seek_to_in_point(mps); // updating restarts the file
+}
+
+/* Opens the path in the internal media source. Does not need `mutex`, so
+ * the navigation thread calls this after releasing it.
+ */
+static void open_media_source(struct media_playlist_source *mps, const char *path, bool is_url, int64_t start_ms,
+			      int64_t end_ms)
+{
+	uint64_t start_ts = stats_timer_begin();
+	obs_source_t *media_source = get_current_media_source(mps);
+	stats_transition_open(&mps->stats);
+	obs_data_t *settings = obs_source_get_settings(media_source);
+
 	// if path is same, we have to force restart it, otherwise it doesn't restart
 	bool old_is_url = !obs_data_get_bool(settings, S_FFMPEG_IS_LOCAL_FILE);
 	const char *old_path_setting = old_is_url ? S_FFMPEG_INPUT : S_FFMPEG_LOCAL_FILE;
 	const char *old_path = obs_data_get_string(settings, old_path_setting);
-	bool should_restart = strcmp(old_path, mps->actual_media->path) == 0;
-
-	//bool current_is_url =
-	//	!obs_data_get_bool(settings, S_FFMPEG_IS_LOCAL_FILE);
-	const char *path_setting = mps->actual_media->is_url ? S_FFMPEG_INPUT : S_FFMPEG_LOCAL_FILE;
-
-	/*forced = forced || current_is_url != mps->current_media->is_url;
-	if (!forced) {
-		const char *path = obs_data_get_string(settings, path_setting);
-		forced = strcmp(path, mps->current_media->path) != 0;
-	}*/
-
-	if (forced) {
-		obs_data_set_bool(settings, S_FFMPEG_IS_LOCAL_FILE, !mps->actual_media->is_url);
-		obs_data_set_string(settings, path_setting, mps->actual_media->path);
-		obs_data_set_int(settings, S_SPEED, mps->speed);
-		obs_source_update(media_source, settings);
-		mps->user_stopped = false;
-
-		if (should_restart) {
-			obs_source_media_restart(media_source);
-		}
+	bool should_restart = strcmp(old_path, path) == 0;
+
+	char *cached_path = is_url && os_atomic_load_bool(&mps->url_cache) ? url_cache_get(path) : NULL;
+	if (cached_path) {
+		path = cached_path;
+		is_url = false;
 	}
 
+	const char *path_setting = is_url ? S_FFMPEG_INPUT : S_FFMPEG_LOCAL_FILE;
+
+	obs_data_set_bool(settings, S_FFMPEG_IS_LOCAL_FILE, !is_url);
+	obs_data_set_string(settings, path_setting, path);
+	os_atomic_set_bool(&mps->media_started, false);
+	obs_data_set_int(settings, S_SPEED, mps->speed);
+	set_loudness_file(mps, path, is_url);
+	os_atomic_set_long(&mps->trim_start_ms, (long)start_ms);
+	os_atomic_set_long(&mps->trim_seek_ms, (long)start_ms);
+	os_atomic_set_long(&mps->trim_end_ms, (long)end_ms);
+	os_atomic_set_bool(&mps->trim_seeking, start_ms > 0);
+	os_atomic_set_bool(&mps->idle_released, false);
+	obs_source_update(media_source, settings);
+	os_atomic_set_bool(&mps->user_stopped, false);
+
+	if (should_restart) {
+		obs_source_media_restart(media_source);
+	}
+	seek_to_in_point(mps);
+
 	obs_data_release(settings);
+	bfree(cached_path);
+	os_atomic_inc_long(&mps->media_open_count);
+	stats_timer_end(&mps->stats, STATS_TIMER_TRANSITION, start_ts);
+	stats_transition_opened(&mps->stats);
 }
 
 static void select_index_proc_(struct media_playlist_source *mps, size_t media_index, size_t folder_item_index)
 {
-	if (media_index < mps->files.num) {
-		pthread_mutex_lock(&mps->mutex);
-		set_current_media_index(mps, media_index);
-		set_current_folder_item_index(mps, folder_item_index);
-		if (mps->actual_media) {
-			update_media_source(mps, true);
-			if (mps->shuffle) {
-				shuffler_select(&mps->shuffler, mps->actual_media);
-			}
-		}
-		pthread_mutex_unlock(&mps->mutex);
-	}
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.select = true;
+	mps->nav_request.media_index = media_index;
+	mps->nav_request.folder_item_index = folder_item_index;
+	mps->nav_request.steps = 0;
+	mps->nav_request.end_reached = false;
+	mps->nav_request.crossfade = false;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+	os_event_signal(mps->nav_event);
 }
 
 static void select_index_proc(void *data, calldata_t *cd)
@@ -272,49 +493,354 @@ static void select_index_proc(void *data, calldata_t *cd)
 	select_index_proc_(mps, media_index, folder_item_index);
 }
 
-static void play_folder_item_at_index(void *data, size_t index)
+/* Gets the next `count` items that will be played, without moving. With
+ * shuffle, this stops at the end of the current shuffle cycle.
+ * Requires `mutex`.
+ */
+static void get_upcoming_media(struct media_playlist_source *mps, size_t count, struct darray *out)
+{
+	DARRAY(struct media_file_data *) upcoming;
+	upcoming.da = *out;
+
+	if (mps->shuffle) {
+		struct media_file_data *const *items;
+		size_t num = shuffler_peek_upcoming(&mps->shuffler, count, &items);
+		da_push_back_array(upcoming, items, num);
+	} else if (mps->current_media) {
+		size_t total = get_total_file_count(mps);
+		size_t index = mps->current_media_index;
+		size_t folder_item_index = mps->current_folder_item_index;
+
+		// list each file once at most, even with loop
+		if (count > total)
+			count = total;
+
+		while (upcoming.num < count) {
+			struct media_file_data *media = &mps->files.array[index];
+			if (media->is_folder && folder_item_index + 1 < media->folder_items.num) {
+				folder_item_index++;
+			} else {
+				if (index + 1 < mps->files.num) {
+					index++;
+				} else if (mps->loop) {
+					index = 0;
+				} else {
+					break;
+				}
+				folder_item_index = 0;
+				media = &mps->files.array[index];
+				if (media->is_folder && !media->folder_items.num)
+					continue;
+			}
+
+			struct media_file_data *item = media->is_folder ? &media->folder_items.array[folder_item_index]
+									: media;
+			da_push_back(upcoming, &item);
+		}
+	}
+
+	*out = upcoming.da;
+}
+
+/* Requires `mutex` */
+static void prefetch_upcoming_urls(struct media_playlist_source *mps)
+{
+	DARRAY(struct media_file_data *) upcoming;
+
+	if (!os_atomic_load_bool(&mps->url_cache))
+		return;
+
+	da_init(upcoming);
+	get_upcoming_media(mps, URL_CACHE_PREFETCH_COUNT, &upcoming.da);
+	for (size_t i = 0; i < upcoming.num; i++) {
+		if (upcoming.array[i]->is_url)
+			url_cache_prefetch(upcoming.array[i]->path);
+	}
+	da_free(upcoming);
+}
+
+static void peek_upcoming_proc(void *data, calldata_t *cd)
 {
 	struct media_playlist_source *mps = data;
-	if (mps->current_media->is_folder && index < mps->current_media->folder_items.num) {
-		mps->current_folder_item_index = index;
-		mps->actual_media = &mps->current_media->folder_items.array[index];
-		bfree(mps->current_media_filename);
-		mps->current_media_filename = bstrdup(mps->actual_media->filename);
-		update_media_source(mps, true);
-		obs_source_save(mps->source);
+	long long count = 0;
+	DARRAY(struct media_file_data *) upcoming;
+	obs_data_t *result = obs_data_create();
+	obs_data_array_t *array = obs_data_array_create();
+
+	da_init(upcoming);
+	calldata_get_int(cd, "count", &count);
+
+	if (count > 0) {
+		pthread_mutex_lock(&mps->mutex);
+		get_upcoming_media(mps, (size_t)count, &upcoming.da);
+		for (size_t i = 0; i < upcoming.num; i++) {
+			struct media_file_data *media = upcoming.array[i];
+			obs_data_t *item = obs_data_create();
+			obs_data_set_string(item, "path", media->path);
+			obs_data_set_int(item, "media_index", media->parent_id ? media->parent->index : media->index);
+			obs_data_set_int(item, "folder_item_index", media->parent_id ? media->index : 0);
+			obs_data_array_push_back(array, item);
+			obs_data_release(item);
+		}
+		pthread_mutex_unlock(&mps->mutex);
 	}
+
+	obs_data_set_array(result, "upcoming", array);
+	calldata_set_string(cd, "upcoming", obs_data_get_json(result));
+
+	da_free(upcoming);
+	obs_data_array_release(array);
+	obs_data_release(result);
 }
 
-static void play_media_at_index(void *data, size_t index, bool play_last_folder_item)
+static void get_stats_proc(void *data, calldata_t *cd)
 {
 	struct media_playlist_source *mps = data;
-	set_current_media_index(mps, index);
-	if (index >= mps->files.num || !mps->actual_media) {
-		clear_media_source(mps);
+	obs_data_t *stats = stats_get_data(&mps->stats);
+
+	calldata_set_string(cd, "stats", obs_data_get_json(stats));
+	obs_data_release(stats);
+}
+
+static void export_trace_proc(void *data, calldata_t *cd)
+{
+	struct media_playlist_source *mps = data;
+	const char *path = calldata_string(cd, "path");
+	bool success = false;
+
+	if (path && *path)
+		success = stats_export_trace(&mps->stats, path, obs_source_get_name(mps->source));
+	calldata_set_bool(cd, "success", success);
+}
+
+/* Frees the strings of catalog items that were copied */
+static void free_catalog_items(struct catalog_item *items, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		bfree((char *)items[i].path);
+		bfree((char *)items[i].id);
+	}
+}
+
+/* Writes a catalog, and points `settings` to it. Called without `mutex`, so the
+ * items must be copies.
+ */
+static bool write_catalog(const char *path, const struct catalog_item *items, size_t count, obs_data_t *settings)
+{
+	struct dstr checksum_str = {0};
+	uint64_t checksum;
+
+	if (!catalog_write(path, items, count, &checksum))
+		return false;
+
+	dstr_printf(&checksum_str, "%016" PRIx64, checksum);
+	obs_data_set_string(settings, S_CATALOG, path);
+	obs_data_set_string(settings, S_CATALOG_CHECKSUM, checksum_str.array);
+	dstr_free(&checksum_str);
+	return true;
+}
+
+/* The whole playlist is written, including the files that were added to the
+ * list after a catalog was saved, so the list is emptied.
+ */
+static void save_catalog_proc(void *data, calldata_t *cd)
+{
+	struct media_playlist_source *mps = data;
+	const char *path = calldata_string(cd, "path");
+	DARRAY(struct catalog_item) items;
+	bool success = false;
+
+	/* a lazy source doesn't have its playlist yet */
+	if (!path || !*path || !os_atomic_load_bool(&mps->loaded)) {
+		calldata_set_bool(cd, "success", false);
 		return;
 	}
 
-	if (mps->current_media->is_folder) {
-		if (mps->current_media->folder_items.num) {
-			// when Previous Item is clicked to go back to a folder
-			if (play_last_folder_item) {
-				mps->current_folder_item_index = mps->current_media->folder_items.num - 1;
-			} else {
-				mps->current_folder_item_index = 0;
-			}
+	da_init(items);
+	pthread_mutex_lock(&mps->mutex);
+	for (size_t i = 0; i < mps->files.num; i++) {
+		const struct media_file_data *file = &mps->files.array[i];
+		struct catalog_item *item = da_push_back_new(items);
+		item->path = bstrdup(file->path);
+		item->id = bstrdup(file->id);
+		item->start_ms = file->start_ms;
+		item->end_ms = file->end_ms;
+		item->sort = file->sort;
+		item->sort_reverse = file->sort_reverse;
+	}
+	pthread_mutex_unlock(&mps->mutex);
 
-			play_folder_item_at_index(mps, mps->current_folder_item_index);
-		} else {
-			if (play_last_folder_item) {
-				obs_source_media_previous(mps->source);
-			} else {
-				obs_source_media_next(mps->source);
-			}
-		}
+	obs_data_t *settings = obs_data_create();
+	success = write_catalog(path, items.array, items.num, settings);
+	if (success) {
+		obs_data_array_t *array = obs_data_array_create();
+		obs_data_set_array(settings, S_PLAYLIST, array);
+		obs_source_update(mps->source, settings);
+		obs_data_array_release(array);
+	}
+	obs_data_release(settings);
+	free_catalog_items(items.array, items.num);
+	da_free(items);
+	calldata_set_bool(cd, "success", success);
+}
+
+/* The shuffle order is too big to be put in the source settings, so it's kept
+ * in a file in the module config folder, named after the source uuid.
+ */
+static char *get_shuffle_state_path(struct media_playlist_source *mps)
+{
+	struct dstr path = {0};
+	char *dir = obs_module_config_path("shuffle");
+	if (!dir)
+		return NULL;
+
+	os_mkdirs(dir);
+	dstr_printf(&path, "%s/%s.bin", dir, obs_source_get_uuid(mps->source));
+	bfree(dir);
+	return path.array;
+}
+
+/* Where the file is changes all the time, so rather than saving the source,
+ * it's journaled to a small file of its own, named after the source uuid.
+ */
+static char *get_position_path(struct media_playlist_source *mps)
+{
+	struct dstr path = {0};
+	char *dir = obs_module_config_path("positions");
+	if (!dir)
+		return NULL;
+
+	os_mkdirs(dir);
+	dstr_printf(&path, "%s/%s.json", dir, obs_source_get_uuid(mps->source));
+	bfree(dir);
+	return path.array;
+}
+
+/* Called by the navigation thread */
+static void save_position(struct media_playlist_source *mps)
+{
+	char *path = NULL;
+	if (!mps->resume_position) // turned off after the request was posted
 		return;
+
+	pthread_mutex_lock(&mps->mutex);
+	if (mps->actual_media)
+		path = bstrdup(mps->actual_media->path);
+	pthread_mutex_unlock(&mps->mutex);
+
+	char *journal_path = path ? get_position_path(mps) : NULL;
+	if (journal_path) {
+		obs_data_t *position = obs_data_create();
+		int64_t time_ms = os_atomic_load_bool(&mps->idle_released)
+					  ? mps->idle_time_ms
+					  : obs_source_media_get_time(get_current_media_source(mps));
+		obs_data_set_string(position, "path", path);
+		obs_data_set_int(position, "time_ms", time_ms);
+		if (!obs_data_save_json_safe(position, journal_path, "tmp", NULL))
+			obs_log(LOG_WARNING, "Failed to save position to '%s'", journal_path);
+		obs_data_release(position);
 	}
-	update_media_source(mps, true);
-	obs_source_save(mps->source);
+
+	bfree(journal_path);
+	bfree(path);
+}
+
+static void delete_position(struct media_playlist_source *mps)
+{
+	char *journal_path = get_position_path(mps);
+	if (journal_path)
+		os_unlink(journal_path);
+	bfree(journal_path);
+}
+
+/* Seeks the file opened by the first update to where it was journaled, if it
+ * is the same file. Like for the in-point, nothing is shown or relayed until
+ * it gets there. Called by the navigation thread.
+ */
+static void seek_to_saved_position(struct media_playlist_source *mps, const char *path, int64_t start_ms,
+				   int64_t end_ms)
+{
+	char *journal_path = get_position_path(mps);
+	obs_data_t *position = journal_path ? obs_data_create_from_json_file(journal_path) : NULL;
+
+	if (position && strcmp(obs_data_get_string(position, "path"), path) == 0) {
+		int64_t time_ms = obs_data_get_int(position, "time_ms");
+		if (time_ms > start_ms && (!end_ms || time_ms < end_ms)) {
+			os_atomic_set_long(&mps->trim_seek_ms, (long)time_ms);
+			os_atomic_set_bool(&mps->trim_seeking, true);
+			obs_source_media_set_time(get_current_media_source(mps), time_ms);
+		}
+	}
+
+	obs_data_release(position);
+	bfree(journal_path);
+}
+
+static void save_shuffle_state(struct media_playlist_source *mps)
+{
+	DARRAY(uint8_t) state;
+	struct dstr temp_path = {0};
+	char *path = NULL;
+	FILE *file;
+
+	/* only the state is copied under `mutex`, it is written without it */
+	da_init(state);
+	pthread_mutex_lock(&mps->mutex);
+	if (mps->shuffle && mps->shuffler.shuffled_files.num)
+		shuffler_save_state(&mps->shuffler, &mps->files.da, &state.da);
+	pthread_mutex_unlock(&mps->mutex);
+	if (!state.num)
+		goto end;
+
+	path = get_shuffle_state_path(mps);
+	if (!path)
+		goto end;
+
+	dstr_printf(&temp_path, "%s.tmp", path);
+	file = os_fopen(temp_path.array, "wb");
+	if (!file)
+		goto end;
+
+	bool written = fwrite(state.array, 1, state.num, file) == state.num;
+	fclose(file);
+	if (!written || os_safe_replace(path, temp_path.array, NULL) != 0) {
+		obs_log(LOG_WARNING, "Failed to save shuffle state to '%s'", path);
+		os_unlink(temp_path.array);
+	}
+
+end:
+	dstr_free(&temp_path);
+	da_free(state);
+	bfree(path);
+}
+
+static bool load_shuffle_state(struct media_playlist_source *mps, struct darray *files)
+{
+	bool loaded = false;
+	char *path = get_shuffle_state_path(mps);
+	FILE *file = path ? os_fopen(path, "rb") : NULL;
+
+	if (file) {
+		int64_t size = os_fgetsize(file);
+		if (size > 0) {
+			uint8_t *state = bmalloc((size_t)size);
+			if (fread(state, 1, (size_t)size, file) == (size_t)size)
+				loaded = shuffler_load_state(&mps->shuffler, files, state, (size_t)size);
+			bfree(state);
+		}
+		fclose(file);
+	}
+
+	bfree(path);
+	return loaded;
+}
+
+static void delete_shuffle_state(struct media_playlist_source *mps)
+{
+	char *path = get_shuffle_state_path(mps);
+	if (path)
+		os_unlink(path);
+	bfree(path);
 }
 
 static size_t find_folder_item_index(struct darray *array, const char *filename)
@@ -343,28 +869,42 @@ static enum obs_media_state mps_get_state(void *data)
 {
 	struct media_playlist_source *mps = data;
 	enum obs_media_state media_state;
-	if (get_total_file_count(mps) > 0) {
-		media_state = obs_source_media_get_state(mps->current_media_source);
+	long idx;
+
+	const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+	bool has_files = snapshot->total_file_count > 0;
+	snapshot_release(mps, idx);
+
+	if (has_files) {
+		media_state = obs_source_media_get_state(get_current_media_source(mps));
 	} else {
 		media_state = OBS_MEDIA_STATE_NONE;
 	}
-	UNUSED_PARAMETER(mps);
 	return media_state;
 }
 
+/* Emits the end of the playlist, after the first file was made the current
+ * one. Called by the navigation thread without `mutex`, as handlers of
+ * media_ended may update the source.
+ */
 static void mps_end_reached(void *data)
 {
 	struct media_playlist_source *mps = data;
 	set_media_state(mps, OBS_MEDIA_STATE_ENDED);
 	obs_source_media_ended(mps->source);
-	set_current_media_index(mps, 0);
+
+	/* the last file was stopped at its out-point rather than at its end */
+	if (obs_source_media_get_state(get_current_media_source(mps)) == OBS_MEDIA_STATE_PLAYING) {
+		os_atomic_set_bool(&mps->user_stopped, true);
+		obs_source_media_stop(get_current_media_source(mps));
+	}
 	obs_source_save(mps->source);
 }
 
 static void media_source_ended(void *data, calldata_t *cd)
 {
-	UNUSED_PARAMETER(cd);
 	struct media_playlist_source *mps = data;
+	long idx;
 
 	/* In OBS 29.1.3 and below, stopping a currently playing media source triggers
 	 * both the STOPPED and ENDED signals. In the future, it should actually just
@@ -373,60 +913,457 @@ static void media_source_ended(void *data, calldata_t *cd)
 	 * EDIT: Tested in OBS 31, now problem is deactivate is sending an ENDED signal
 	 * rather than a STOPPED. So in mps_deactivate, we set user_stopped to true
 	 */
-	if (mps->user_stopped) {
-		mps->user_stopped = false;
+	if (os_atomic_exchange_bool(&mps->user_stopped, false))
+		return;
+
+	/* the outgoing file ending is not the end of the current file */
+	if (cd && calldata_ptr(cd, "source") != get_current_media_source(mps))
+		return;
+
+	/* Already moved on at the out-point */
+	if (cd && os_atomic_load_long(&mps->trim_end_posted_open) == os_atomic_load_long(&mps->media_open_count))
+		return;
+
+	pthread_mutex_lock(&mps->audio_mutex);
+	queue_file_marker(mps, NULL);
+	pthread_mutex_unlock(&mps->audio_mutex);
+
+	/* The next file was already posted to crossfade into */
+	if (os_atomic_load_bool(&mps->crossfade_pending))
 		return;
-	} else if (mps->current_media_index < mps->files.num - 1 || mps->loop) {
+
+	const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+	bool has_next = snapshot->current_media_index < snapshot->files.num - 1;
+	snapshot_release(mps, idx);
+
+	if (has_next || mps->loop) {
+		stats_transition_ended(&mps->stats);
 		obs_source_media_next(mps->source);
 	} else {
-		mps_end_reached(mps);
+		pthread_mutex_lock(&mps->nav_mutex);
+		memset(&mps->nav_request, 0, sizeof(mps->nav_request));
+		mps->nav_request.end_reached = true;
+		pthread_mutex_unlock(&mps->nav_mutex);
+		stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+		os_event_signal(mps->nav_event);
 	}
 }
 
-void mps_audio_callback(void *data, obs_source_t *source, const struct audio_data *audio_data, bool muted)
+/* Pops the planes of `packet` into `audio_buf`, and up-mixes or down-mixes them
+ * if the output has a different layout now. The deques are copied from rather
+ * than pointed into, as a packet can wrap around the end of one.
+ * Requires `audio_mutex`.
+ */
+static void pop_audio_packet(struct media_playlist_source *mps, const struct audio_packet *packet, size_t channels,
+			     float **planes)
 {
-	UNUSED_PARAMETER(muted);
-	UNUSED_PARAMETER(source);
-	struct media_playlist_source *mps = data;
-	pthread_mutex_lock(&mps->audio_mutex);
-	size_t size = audio_data->frames * sizeof(float);
-	for (size_t i = 0; i < mps->num_channels; i++) {
-		deque_push_back(&mps->audio_data[i], audio_data->data[i], size);
+	if (packet->frames > mps->audio_buf_frames) {
+		mps->audio_buf_frames = packet->frames;
+		mps->audio_buf =
+			brealloc(mps->audio_buf, mps->audio_buf_frames * MAX_AUDIO_CHANNELS * 2 * sizeof(float));
 	}
-	deque_push_back(&mps->audio_frames, &audio_data->frames, sizeof(audio_data->frames));
-	deque_push_back(&mps->audio_timestamps, &audio_data->timestamp, sizeof(audio_data->timestamp));
-	pthread_mutex_unlock(&mps->audio_mutex);
+
+	float *popped[MAX_AUDIO_CHANNELS];
+	for (size_t i = 0; i < packet->channels; i++) {
+		popped[i] = mps->audio_buf + i * mps->audio_buf_frames;
+		deque_pop_front(&mps->audio_data[i], popped[i], packet->frames * sizeof(float));
+	}
+
+	if (packet->channels == channels) {
+		for (size_t i = 0; i < channels; i++)
+			planes[i] = popped[i];
+		return;
+	}
+
+	if (mps->audio_remap.src_channels != packet->channels || mps->audio_remap.dst_channels != channels)
+		audio_remap_init(&mps->audio_remap, packet->channels, channels);
+	for (size_t i = 0; i < channels; i++)
+		planes[i] = mps->audio_buf + (MAX_AUDIO_CHANNELS + i) * mps->audio_buf_frames;
+	audio_remap_process(&mps->audio_remap, planes, (const float *const *)popped, packet->frames);
 }
 
-static bool play_selected_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+/* Queues audio of the outgoing file of a crossfade. It is queued as it was
+ * sent, as the crossfade is given up if the output layout changes.
+ * Requires `audio_mutex`.
+ */
+static void queue_fade_audio(struct media_playlist_source *mps, const struct audio_data *audio_data, size_t channels)
 {
-	UNUSED_PARAMETER(props);
-	UNUSED_PARAMETER(property);
-	struct media_playlist_source *mps = data;
-	signal_handler_t *sh = obs_source_get_signal_handler(mps->source);
-	obs_data_t *settings = obs_source_get_settings(mps->source);
-	size_t media_index = 0;
-	size_t folder_item_index = 0;
-	const char *index_str = obs_data_get_string(settings, S_SELECT_FILE);
-	if (strcmp(index_str, "0") != 0) {
-		char **indexes = strlist_split(index_str, '-', false);
-
-		media_index = strtol(indexes[0], NULL, 10) - 1;
-		if (indexes[1]) {
-			folder_item_index = strtol(indexes[1], NULL, 10) - 1;
-		}
-		select_index_proc_(mps, media_index, folder_item_index);
+	if (channels != mps->fade_channels)
+		return;
 
-		strlist_free(indexes);
+	for (size_t i = 0; i < channels; i++) {
+		deque_push_back(&mps->fade_audio_data[i], audio_data->data[i], audio_data->frames * sizeof(float));
 	}
-	obs_data_release(settings);
-	/*update_current_filename_property(
-		mps, obs_properties_get(props, S_CURRENT_FILE_NAME));*/
-	update_current_filename_setting(mps, settings);
-	//obs_source_update_properties(mps->source);
+	mps->fade_queued_frames += audio_data->frames;
 
-	signal_handler_signal(sh, "media_next", NULL);
-	return true;
+	if (mps->fade_queued_frames > mps->audio_max_frames) {
+		size_t drop = mps->fade_queued_frames - mps->audio_max_frames;
+		for (size_t i = 0; i < channels; i++) {
+			deque_pop_front(&mps->fade_audio_data[i], NULL, drop * sizeof(float));
+		}
+		mps->fade_queued_frames -= drop;
+	}
+}
+
+/* Pops up to `frames` frames of the outgoing file into `fade_buf`. Returns
+ * how many there were. Requires `audio_mutex`.
+ */
+static size_t pop_fade_audio(struct media_playlist_source *mps, size_t frames, float **planes)
+{
+	if (frames > mps->fade_queued_frames)
+		frames = mps->fade_queued_frames;
+	if (frames > mps->fade_buf_frames) {
+		mps->fade_buf_frames = frames;
+		mps->fade_buf = brealloc(mps->fade_buf, mps->fade_buf_frames * MAX_AUDIO_CHANNELS * sizeof(float));
+	}
+
+	for (size_t i = 0; i < mps->fade_channels; i++) {
+		planes[i] = mps->fade_buf + i * mps->fade_buf_frames;
+		deque_pop_front(&mps->fade_audio_data[i], planes[i], frames * sizeof(float));
+	}
+	mps->fade_queued_frames -= frames;
+	return frames;
+}
+
+/* Mixes a packet of the incoming file with the outgoing file, with equal power
+ * ramps. The curves are followed at each packet's ends and ramped linearly in
+ * between. Requires `audio_mutex`.
+ */
+static void mix_crossfade(struct media_playlist_source *mps, float **planes, size_t channels, size_t frames)
+{
+	size_t end = mps->fade_pos + frames < mps->fade_frames ? mps->fade_pos + frames : mps->fade_frames;
+	float x0 = (float)mps->fade_pos / (float)mps->fade_frames * HALF_PI;
+	float x1 = (float)end / (float)mps->fade_frames * HALF_PI;
+	float in_gain = sinf(x0);
+	float in_step = (sinf(x1) - in_gain) / (float)frames;
+	float out_gain = cosf(x0) * mps->fade_gain;
+	float out_step = (cosf(x1) * mps->fade_gain - out_gain) / (float)frames;
+
+	for (size_t i = 0; i < channels; i++)
+		audio_gain_ramp(planes[i], in_gain, in_step, frames);
+
+	if (channels == mps->fade_channels) {
+		float *fade_planes[MAX_AUDIO_CHANNELS];
+		size_t fade_frames = pop_fade_audio(mps, frames, fade_planes);
+		for (size_t i = 0; i < channels && fade_frames; i++)
+			audio_mix_ramp(planes[i], fade_planes[i], out_gain, out_step, fade_frames);
+	}
+	mps->fade_pos = end;
+}
+
+/* Until the incoming file sends audio, the outgoing one is relayed on its own.
+ * Requires `audio_mutex`.
+ */
+static void relay_fade_audio(struct media_playlist_source *mps, const struct audio_output_info *aoi)
+{
+	struct obs_source_audio audio = {0};
+	audio.format = aoi->format;
+	audio.samples_per_sec = aoi->samples_per_sec;
+	audio.speakers = aoi->speakers;
+	audio.timestamp = mps->audio_next_ts ? mps->audio_next_ts : os_gettime_ns();
+	audio.frames = (uint32_t)pop_fade_audio(mps, mps->fade_queued_frames, (float **)audio.data);
+	for (size_t i = 0; i < mps->fade_channels && mps->fade_gain != 1.0f; i++)
+		audio_gain_ramp((float *)audio.data[i], mps->fade_gain, 0.0f, audio.frames);
+
+	mps->audio_next_ts = audio.timestamp + (uint64_t)audio.frames * 1000000000ULL / audio.samples_per_sec;
+	obs_source_output_audio(mps->source, &audio);
+}
+
+/* Applies the loudness gain of the current file to a relayed packet.
+ * Requires `audio_mutex`.
+ */
+static void apply_loudness_gain(struct media_playlist_source *mps, float **planes, size_t channels, size_t frames)
+{
+	float gain = 1.0f;
+	if (mps->loudness_normalize && isfinite(mps->loudness_lufs)) {
+		double db = mps->loudness_target - mps->loudness_lufs;
+		if (db > LOUDNESS_MAX_BOOST_DB)
+			db = LOUDNESS_MAX_BOOST_DB;
+		else if (db < LOUDNESS_MAX_CUT_DB)
+			db = LOUDNESS_MAX_CUT_DB;
+		gain = (float)pow(10.0, db / 20.0);
+	}
+	if (gain == 1.0f && mps->loudness_applied_gain == 1.0f)
+		return;
+
+	size_t ramp = frames < LOUDNESS_RAMP_FRAMES ? frames : LOUDNESS_RAMP_FRAMES;
+	float step = (gain - mps->loudness_applied_gain) / (float)ramp;
+	for (size_t i = 0; i < channels; i++) {
+		audio_gain_ramp(planes[i], mps->loudness_applied_gain, step, ramp);
+		audio_gain_ramp(planes[i] + ramp, gain, 0.0f, frames - ramp);
+	}
+	mps->loudness_applied_gain = gain;
+}
+
+/* Starts and ends measuring files. Requires `audio_mutex`. */
+static void handle_file_marker(struct media_playlist_source *mps, const struct audio_packet *packet,
+			       size_t channels, uint32_t sample_rate)
+{
+	if (packet->file_ended) {
+		loudness_analyzer_end(&mps->loudness, true);
+	} else if (packet->file_opened) {
+		const struct file_loudness *file = packet->file_opened;
+		loudness_analyzer_end(&mps->loudness, false);
+		if (file->path)
+			loudness_analyzer_begin(&mps->loudness, file->path, file->mtime, channels, sample_rate);
+		mps->loudness_lufs = file->lufs;
+		free_file_loudness(packet->file_opened);
+	}
+}
+
+/* Requires `audio_mutex`. Markers are handled rather than dropped, so the
+ * files around them are still told apart. */
+static void drop_oldest_audio(struct media_playlist_source *mps)
+{
+	struct audio_packet packet;
+	deque_pop_front(&mps->audio_packets, &packet, sizeof(packet));
+	if (!packet.frames) {
+		const audio_t *a = obs_get_audio();
+		handle_file_marker(mps, &packet, audio_output_get_channels(a), audio_output_get_sample_rate(a));
+		return;
+	}
+	for (size_t i = 0; i < packet.channels; i++) {
+		deque_pop_front(&mps->audio_data[i], NULL, packet.frames * sizeof(float));
+	}
+	mps->audio_queued_frames -= packet.frames;
+	loudness_analyzer_skip(&mps->loudness);
+	stats_add(&mps->stats, STATS_COUNTER_AUDIO_DROPPED, 1);
+}
+
+/* Whether the open file is before its in-point or after its out-point, so it
+ * is not shown or relayed. The in-point is passed once the internal media
+ * source has seeked to it. `packet_ms` is the length of the audio that was
+ * just played, as the media time is where it ended.
+ */
+static bool outside_trim(struct media_playlist_source *mps, obs_source_t *media_source, int64_t packet_ms)
+{
+	bool seeking = os_atomic_load_bool(&mps->trim_seeking);
+	long end_ms = os_atomic_load_long(&mps->trim_end_ms);
+	if (!seeking && !end_ms)
+		return false;
+
+	int64_t time = obs_source_media_get_time(media_source);
+	if (seeking) {
+		if (time < os_atomic_load_long(&mps->trim_seek_ms))
+			return true;
+		os_atomic_set_bool(&mps->trim_seeking, false);
+	}
+	return end_ms && time - packet_ms >= end_ms;
+}
+
+void mps_audio_callback(void *data, obs_source_t *source, const struct audio_data *audio_data, bool muted)
+{
+	UNUSED_PARAMETER(muted);
+	struct media_playlist_source *mps = data;
+	struct audio_packet packet = {
+		.timestamp = audio_data->timestamp,
+		.frames = audio_data->frames,
+		.channels = (uint32_t)audio_output_get_channels(obs_get_audio()),
+	};
+	pthread_mutex_lock(&mps->audio_mutex);
+	if (source == mps->fade_media_source) {
+		queue_fade_audio(mps, audio_data, packet.channels);
+		pthread_mutex_unlock(&mps->audio_mutex);
+		return;
+	}
+	/* the outgoing file of a crossfade that is being closed */
+	if (source != get_current_media_source(mps)) {
+		pthread_mutex_unlock(&mps->audio_mutex);
+		return;
+	}
+	packet.fade_in = mps->fade_media_source != NULL;
+	if (!os_atomic_load_bool(&mps->media_started))
+		os_atomic_set_bool(&mps->media_started, true);
+
+	uint32_t sample_rate = audio_output_get_sample_rate(obs_get_audio());
+	if (outside_trim(mps, source, (int64_t)audio_data->frames * 1000 / sample_rate)) {
+		pthread_mutex_unlock(&mps->audio_mutex);
+		return;
+	}
+
+	stats_add(&mps->stats, STATS_COUNTER_AUDIO_PACKETS, 1);
+	stats_transition_audio(&mps->stats);
+
+	/* The queue is only emptied on video ticks, so it would grow without
+	 * limit if the graphics thread stalls */
+	if (mps->audio_queued_frames + audio_data->frames > mps->audio_max_frames) {
+		if (mps->audio_overflow_policy == AUDIO_OVERFLOW_DROP_NEWEST) {
+			stats_add(&mps->stats, STATS_COUNTER_AUDIO_DROPPED, 1);
+			pthread_mutex_unlock(&mps->audio_mutex);
+			return;
+		}
+		while (mps->audio_packets.size > 0 &&
+		       mps->audio_queued_frames + audio_data->frames > mps->audio_max_frames)
+			drop_oldest_audio(mps);
+	}
+
+	size_t size = audio_data->frames * sizeof(float);
+	for (size_t i = 0; i < packet.channels; i++) {
+		deque_push_back(&mps->audio_data[i], audio_data->data[i], size);
+	}
+	deque_push_back(&mps->audio_packets, &packet, sizeof(packet));
+	mps->audio_queued_frames += audio_data->frames;
+	pthread_mutex_unlock(&mps->audio_mutex);
+}
+
+/* Creates an internal media source, and relays its audio. Only the one of
+ * the current file, and the outgoing one of a crossfade, are active children.
+ */
+static obs_source_t *create_media_source(struct media_playlist_source *mps, obs_data_t *settings)
+{
+	obs_source_t *media_source = obs_source_create_private("ffmpeg_source", "current_media_source", settings);
+	obs_source_add_audio_capture_callback(media_source, mps_audio_callback, mps);
+
+	signal_handler_t *sh_media_source = obs_source_get_signal_handler(media_source);
+	signal_handler_connect(sh_media_source, "media_ended", media_source_ended, mps);
+	return media_source;
+}
+
+/* Moves the playing file to `fade_media_source`, where it plays out while the
+ * next file is opened in the other internal media source. Their audio is mixed
+ * on video ticks, and the outgoing one is closed by end_crossfade. Called by
+ * the navigation thread. Returns false if the playing file can not overlap the
+ * next one.
+ */
+static bool start_crossfade(struct media_playlist_source *mps)
+{
+	long child = os_atomic_load_long(&mps->current_child);
+	obs_source_t *outgoing = mps->media_sources[child];
+	obs_source_t *incoming = mps->media_sources[!child];
+	if (obs_source_media_get_state(outgoing) != OBS_MEDIA_STATE_PLAYING)
+		return false;
+
+	pthread_mutex_lock(&mps->audio_mutex);
+	bool fading = mps->fade_media_source != NULL || os_atomic_load_bool(&mps->fade_closing);
+	pthread_mutex_unlock(&mps->audio_mutex);
+	if (fading)
+		return false;
+
+	/* the file itself is opened in it by open_media_source */
+	obs_data_t *settings = obs_source_get_settings(incoming);
+	obs_data_t *outgoing_settings = obs_source_get_settings(outgoing);
+	obs_data_apply(settings, outgoing_settings);
+	obs_data_release(outgoing_settings);
+	obs_data_release(settings);
+	obs_source_add_active_child(mps->source, incoming);
+
+	const audio_t *a = obs_get_audio();
+	pthread_mutex_lock(&mps->audio_mutex);
+	mps->fade_media_source = outgoing;
+	mps->fade_channels = audio_output_get_channels(a);
+	mps->fade_queued_frames = 0;
+	mps->fade_frames = (size_t)(mps->crossfade_ms * audio_output_get_sample_rate(a) / 1000);
+	mps->fade_pos = 0;
+	mps->fade_start_ts = os_gettime_ns();
+	mps->fade_gain = mps->loudness_applied_gain;
+	os_atomic_set_bool(&mps->fade_cancel, false);
+	queue_file_marker(mps, NULL); // close enough to the end to be measured
+	os_atomic_set_long(&mps->current_child, !child);
+	pthread_mutex_unlock(&mps->audio_mutex);
+	return true;
+}
+
+/* Stops the outgoing file of a crossfade, on the next video tick */
+static inline void cancel_crossfade(struct media_playlist_source *mps)
+{
+	os_atomic_set_bool(&mps->fade_cancel, true);
+}
+
+/* Closes the outgoing file of a crossfade. Its internal media source can be
+ * used for the next crossfade once this is done. Called by the video thread.
+ */
+static void end_crossfade(struct media_playlist_source *mps, obs_source_t *outgoing)
+{
+	obs_source_remove_active_child(mps->source, outgoing);
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_string(settings, S_FFMPEG_LOCAL_FILE, "");
+	obs_data_set_string(settings, S_FFMPEG_INPUT, "");
+	obs_source_update(outgoing, settings);
+	obs_data_release(settings);
+	os_atomic_set_bool(&mps->fade_closing, false);
+}
+
+/* Passes the in-point of files without audio, and moves on at the out-point
+ * rather than waiting for the file to end. Called by the video thread.
+ */
+static void check_trim(struct media_playlist_source *mps)
+{
+	obs_source_t *media_source = get_current_media_source(mps);
+	if (obs_source_media_get_state(media_source) != OBS_MEDIA_STATE_PLAYING ||
+	    !outside_trim(mps, media_source, 0) || os_atomic_load_bool(&mps->trim_seeking))
+		return;
+
+	long open_count = os_atomic_load_long(&mps->media_open_count);
+	if (os_atomic_load_long(&mps->trim_end_posted_open) != open_count) {
+		os_atomic_set_long(&mps->trim_end_posted_open, open_count);
+		media_source_ended(mps, NULL);
+	}
+}
+
+/* Posts the next file early enough for it to overlap the end of this one.
+ * Called by the video thread.
+ */
+static void check_crossfade(struct media_playlist_source *mps)
+{
+	obs_source_t *media_source = get_current_media_source(mps);
+	long open_count = os_atomic_load_long(&mps->media_open_count);
+	if (mps->crossfade_ms <= 0 || mps->crossfade_posted_open == open_count ||
+	    obs_source_media_get_state(media_source) != OBS_MEDIA_STATE_PLAYING)
+		return;
+
+	/* files shorter than two crossfades are cut */
+	int64_t duration = mps_get_duration(mps);
+	int64_t remaining = duration - mps_get_time(mps);
+	if (duration < mps->crossfade_ms * 2 || remaining > mps->crossfade_ms)
+		return;
+
+	long idx;
+	const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+	bool has_next = snapshot->current_media_index < snapshot->files.num - 1;
+	snapshot_release(mps, idx);
+	if (!has_next && !mps->loop)
+		return;
+
+	mps->crossfade_posted_open = open_count;
+	os_atomic_set_bool(&mps->crossfade_pending, true);
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.steps += 1;
+	mps->nav_request.crossfade = true;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+	os_event_signal(mps->nav_event);
+}
+
+static bool play_selected_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	struct media_playlist_source *mps = data;
+	signal_handler_t *sh = obs_source_get_signal_handler(mps->source);
+	obs_data_t *settings = obs_source_get_settings(mps->source);
+	size_t media_index = 0;
+	size_t folder_item_index = 0;
+	const char *index_str = obs_data_get_string(settings, S_SELECT_FILE);
+	if (strcmp(index_str, "0") != 0) {
+		char **indexes = strlist_split(index_str, '-', false);
+
+		media_index = strtol(indexes[0], NULL, 10) - 1;
+		if (indexes[1]) {
+			folder_item_index = strtol(indexes[1], NULL, 10) - 1;
+		}
+		select_index_proc_(mps, media_index, folder_item_index);
+
+		strlist_free(indexes);
+	}
+	obs_data_release(settings);
+	/*update_current_filename_property(
+		mps, obs_properties_get(props, S_CURRENT_FILE_NAME));*/
+	update_current_filename_setting(mps, settings);
+	//obs_source_update_properties(mps->source);
+
+	signal_handler_signal(sh, "media_next", NULL);
+	return true;
 }
 
 static bool refresh_filename_clicked(obs_properties_t *props, obs_property_t *property, void *data)
@@ -473,25 +1410,33 @@ static void free_files(struct darray *array)
 	da_free(files);
 }
 
+/* Times of the source are within the in and out points of the file */
 static int64_t mps_get_duration(void *data)
 {
 	struct media_playlist_source *mps = data;
+	int64_t duration = obs_source_media_get_duration(get_current_media_source(mps));
+	int64_t start_ms = os_atomic_load_long(&mps->trim_start_ms);
+	int64_t end_ms = os_atomic_load_long(&mps->trim_end_ms);
 
-	return obs_source_media_get_duration(mps->current_media_source);
+	if (end_ms && end_ms < duration)
+		duration = end_ms;
+	return duration > start_ms ? duration - start_ms : 0;
 }
 
 static int64_t mps_get_time(void *data)
 {
 	struct media_playlist_source *mps = data;
+	int64_t time = obs_source_media_get_time(get_current_media_source(mps));
+	int64_t start_ms = os_atomic_load_long(&mps->trim_start_ms);
 
-	return obs_source_media_get_time(mps->current_media_source);
+	return time > start_ms ? time - start_ms : 0;
 }
 
 static void mps_set_time(void *data, int64_t ms)
 {
 	struct media_playlist_source *mps = data;
 
-	obs_source_media_set_time(mps->current_media_source, ms);
+	obs_source_media_set_time(get_current_media_source(mps), ms + os_atomic_load_long(&mps->trim_start_ms));
 }
 
 static void play_pause_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
@@ -538,181 +1483,773 @@ static void next_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool
 		obs_source_media_next(mps->source);
 }
 
-static void previous_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+static void previous_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(hotkey);
+
+	struct media_playlist_source *mps = data;
+
+	if (pressed && obs_source_showing(mps->source))
+		obs_source_media_previous(mps->source);
+}
+
+static void mps_play_pause(void *data, bool pause)
+{
+	struct media_playlist_source *mps = data;
+
+	obs_source_media_play_pause(get_current_media_source(mps), pause);
+	mps->paused = pause;
+	if (pause)
+		cancel_crossfade(mps);
+
+	if (pause)
+		set_media_state(mps, OBS_MEDIA_STATE_PAUSED);
+	else
+		set_media_state(mps, OBS_MEDIA_STATE_PLAYING);
+}
+
+static void mps_restart(void *data)
+{
+	struct media_playlist_source *mps = data;
+
+	os_atomic_set_bool(&mps->user_stopped, false);
+	cancel_crossfade(mps);
+
+	if (mps->restart_behavior == RESTART_BEHAVIOR_FIRST_FILE) {
+		select_index_proc_(mps, 0, 0);
+	} else if (mps->restart_behavior == RESTART_BEHAVIOR_CURRENT_FILE) {
+		// After the end, the first file is selected but not open yet
+		if (mps->state == OBS_MEDIA_STATE_ENDED)
+			post_open(mps, false);
+		else
+			post_restart(mps);
+		set_media_state(mps, OBS_MEDIA_STATE_PLAYING);
+	}
+}
+
+static void mps_stop(void *data)
+{
+	struct media_playlist_source *mps = data;
+
+	os_atomic_set_bool(&mps->user_stopped, true);
+	cancel_crossfade(mps);
+	obs_source_media_stop(get_current_media_source(mps));
+	set_media_state(mps, OBS_MEDIA_STATE_STOPPED);
+}
+
+/* Sets current media from actual media, after the shuffler moved */
+static void set_current_from_actual_media(struct media_playlist_source *mps)
+{
+	bfree(mps->current_media_filename);
+	if (mps->actual_media->parent_id) {
+		mps->current_media = mps->actual_media->parent;
+		mps->current_media_filename = bstrdup(mps->actual_media->filename);
+		mps->current_folder_item_index = mps->actual_media->index;
+	} else {
+		mps->current_media = mps->actual_media;
+		mps->current_media_filename = NULL;
+		mps->current_folder_item_index = 0;
+	}
+	mps->current_media_index = mps->current_media->index;
+	publish_snapshot(mps);
+}
+
+/* Moves to the next item without opening it. Empty folders are skipped.
+ * Returns false if there is no next item.
+ */
+static bool step_next(struct media_playlist_source *mps)
+{
+	if (!get_total_file_count(mps))
+		return false;
+
+	if (mps->shuffle) {
+		if (!shuffler_has_next(&mps->shuffler))
+			return false;
+		mps->actual_media = shuffler_next(&mps->shuffler);
+		set_current_from_actual_media(mps);
+		return true;
+	}
+
+	if (mps->current_media->is_folder && mps->current_media->folder_items.num > 0 &&
+	    mps->current_folder_item_index < mps->current_media->folder_items.num - 1) {
+		set_current_folder_item_index(mps, mps->current_folder_item_index + 1);
+		return true;
+	}
+
+	size_t index = mps->current_media_index;
+	for (size_t i = 0; i < mps->files.num; i++) {
+		if (index < mps->files.num - 1) {
+			++index;
+		} else if (mps->loop) {
+			index = 0;
+		} else {
+			return false;
+		}
+
+		struct media_file_data *media = &mps->files.array[index];
+		if (!media->is_folder || media->folder_items.num) {
+			set_current_media_index(mps, index);
+			set_current_folder_item_index(mps, 0);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Moves to the previous item without opening it. Going back to a folder
+ * selects its last item. Returns false if there is no previous item.
+ */
+static bool step_prev(struct media_playlist_source *mps)
+{
+	if (!get_total_file_count(mps))
+		return false;
+
+	if (mps->shuffle) {
+		if (!shuffler_has_prev(&mps->shuffler))
+			return false;
+		mps->actual_media = shuffler_prev(&mps->shuffler);
+		set_current_from_actual_media(mps);
+		return true;
+	}
+
+	if (mps->current_media->is_folder && mps->current_folder_item_index > 0 &&
+	    mps->current_folder_item_index < mps->current_media->folder_items.num) {
+		set_current_folder_item_index(mps, mps->current_folder_item_index - 1);
+		return true;
+	}
+
+	// when going back from the first item of a folder, play the last item of the previous folder
+	bool play_last_folder_item = mps->current_media->is_folder;
+	size_t index = mps->current_media_index;
+	for (size_t i = 0; i < mps->files.num; i++) {
+		if (index > 0) {
+			--index;
+		} else if (mps->loop) {
+			index = mps->files.num - 1;
+		} else {
+			return false;
+		}
+
+		struct media_file_data *media = &mps->files.array[index];
+		if (!media->is_folder || media->folder_items.num) {
+			set_current_media_index(mps, index);
+			set_current_folder_item_index(mps, play_last_folder_item ? media->folder_items.num - 1 : 0);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Files that failed to start are only played when selected. URLs are never
+ * quarantined, as they may work the next time. */
+static bool is_quarantined(const struct media_file_data *media)
+{
+	return media && !media->is_url && quarantine_contains(media->path);
+}
+
+/* Steps like step_next or step_prev, then over quarantined files, unless all
+ * the files are. Returns false if there is no next or previous item.
+ */
+static bool step_playable(struct media_playlist_source *mps, bool forward)
+{
+	if (!(forward ? step_next(mps) : step_prev(mps)))
+		return false;
+
+	size_t count = get_total_file_count(mps);
+	for (size_t i = 1; i < count && is_quarantined(mps->actual_media); i++) {
+		if (!(forward ? step_next(mps) : step_prev(mps)))
+			break;
+	}
+	return true;
+}
+
+static void post_navigation(struct media_playlist_source *mps, long long steps)
+{
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.steps += steps;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+	os_event_signal(mps->nav_event);
+}
+
+/* Only the navigation thread opens files, so the UI thread posts these too */
+static void post_open(struct media_playlist_source *mps, bool resume)
+{
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.open = true;
+	mps->nav_request.resume |= resume;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+	os_event_signal(mps->nav_event);
+}
+
+static void post_restart(struct media_playlist_source *mps)
+{
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.restart = true;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+	os_event_signal(mps->nav_event);
+}
+
+/* Takes the reference to `settings`, replacing settings not applied yet */
+static void post_media_settings(struct media_playlist_source *mps, obs_data_t *settings)
+{
+	pthread_mutex_lock(&mps->nav_mutex);
+	obs_data_t *old_settings = mps->nav_request.media_settings;
+	mps->nav_request.media_settings = settings;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	obs_data_release(old_settings);
+	os_event_signal(mps->nav_event);
+}
+
+static void process_navigation(struct media_playlist_source *mps, const struct nav_request *request)
+{
+	char *path = NULL;
+	bool is_url = false;
+	int64_t start_ms = 0;
+	int64_t end_ms = 0;
+	bool changed = false;
+	int64_t seek_ms = -1;
+	int64_t time_ms = 0;
+	bool fast_fail = request->fast_fail &&
+			 request->fast_fail_open == os_atomic_load_long(&mps->media_open_count);
+	char *failed_path = NULL;
+	bool ended = false;
+	bool clear = false;
+
+	if (request->load && !os_atomic_exchange_bool(&mps->loaded, true))
+		obs_source_update(mps->source, NULL);
+	if (request->save_position)
+		save_position(mps);
+
+	if (request->media_settings) {
+		apply_media_settings(mps, request->media_settings);
+		obs_data_release(request->media_settings);
+	}
+	if (request->release)
+		release_media_source(mps, request->evict);
+	else if (request->reopen)
+		reopen_media_source(mps);
+
+	if (request->end_reached || request->select || request->steps || request->catch_up)
+		remember_duration(mps);
+	if (request->catch_up)
+		time_ms = obs_source_media_get_time(get_current_media_source(mps));
+
+	pthread_mutex_lock(&mps->mutex);
+	if (fast_fail && mps->actual_media) {
+		obs_log(LOG_WARNING, "[%s] '%s' did not start within %lld ms, skipping it",
+			obs_source_get_name(mps->source), mps->actual_media->path, mps->fast_fail_ms);
+		if (!mps->actual_media->is_url)
+			failed_path = bstrdup(mps->actual_media->path);
+		stats_add(&mps->stats, STATS_COUNTER_FAST_FAILS, 1);
+	}
+
+	if (request->end_reached) {
+		set_current_media_index(mps, 0);
+		ended = true;
+	}
+
+	if (request->select && request->media_index < mps->files.num) {
+		set_current_media_index(mps, request->media_index);
+		set_current_folder_item_index(mps, request->folder_item_index);
+		if (mps->actual_media && mps->shuffle)
+			shuffler_select(&mps->shuffler, mps->actual_media);
+		changed = true;
+	}
+
+	for (long long i = 0; i < request->steps; i++) {
+		if (!step_playable(mps, true))
+			break;
+		changed = true;
+	}
+	for (long long i = 0; i > request->steps; i--) {
+		if (!step_playable(mps, false))
+			break;
+		changed = true;
+	}
+
+	/* a file that didn't start is skipped like one that ended */
+	if (fast_fail && !changed && !request->end_reached) {
+		if (step_playable(mps, true)) {
+			changed = true;
+		} else {
+			set_current_media_index(mps, 0);
+			ended = true;
+		}
+	}
+
+	/* a file selected while hidden starts from its beginning */
+	if (request->catch_up && !changed && catch_up_playlist(mps, time_ms, request->catch_up_ms, &seek_ms))
+		changed = true;
+
+	/* after mps_update, the current file may be gone or an empty folder */
+	if (request->open && !changed) {
+		changed = mps->current_media &&
+			  (!mps->current_media->is_folder || mps->current_media->folder_items.num);
+		clear = !changed;
+	}
+
+	if (changed && mps->actual_media) {
+		prefetch_upcoming_urls(mps);
+		path = bstrdup(mps->actual_media->path);
+		is_url = mps->actual_media->is_url;
+		start_ms = mps->actual_media->start_ms;
+		end_ms = mps->actual_media->end_ms;
+	}
+	pthread_mutex_unlock(&mps->mutex);
+
+	/* signals, saving and disk writes are done without `mutex` */
+	if (failed_path) {
+		quarantine_add(failed_path);
+		bfree(failed_path);
+	}
+	if (ended)
+		mps_end_reached(mps);
+
+	/* Only the final item is opened, however many steps were taken */
+	if (path) {
+		if (!request->crossfade || !start_crossfade(mps))
+			cancel_crossfade(mps);
+		open_media_source(mps, path, is_url, start_ms, end_ms);
+		if (request->resume)
+			seek_to_saved_position(mps, path, start_ms, end_ms);
+		obs_source_save(mps->source);
+		bfree(path);
+	} else if (clear) {
+		cancel_crossfade(mps);
+		clear_media_source(mps);
+	} else if (request->restart) {
+		obs_source_media_restart(get_current_media_source(mps));
+	}
+
+	if (request->catch_up) {
+		if (seek_ms > start_ms)
+			obs_source_media_set_time(get_current_media_source(mps), seek_ms);
+		if (obs_source_active(mps->source))
+			obs_source_media_play_pause(get_current_media_source(mps), false);
+	}
+
+	if (request->crossfade || request->select || request->end_reached) {
+		os_atomic_set_bool(&mps->crossfade_pending, false);
+
+		/* the end of the file was ignored while the crossfade was pending */
+		if (request->crossfade && !path &&
+		    obs_source_media_get_state(get_current_media_source(mps)) == OBS_MEDIA_STATE_ENDED)
+			media_source_ended(mps, NULL);
+	}
+}
+
+static void *navigation_thread(void *data)
+{
+	struct media_playlist_source *mps = data;
+
+	os_set_thread_name("media-playlist-source: navigation");
+
+	while (true) {
+		pthread_mutex_lock(&mps->nav_mutex);
+		uint64_t warm_ts = mps->warm_ts;
+		pthread_mutex_unlock(&mps->nav_mutex);
+
+		/* a lazy source may have to be loaded in the background */
+		uint64_t now = os_gettime_ns();
+		if (!warm_ts) {
+			if (os_event_wait(mps->nav_event) != 0)
+				break;
+		} else if (now < warm_ts) {
+			os_event_timedwait(mps->nav_event, (unsigned long)((warm_ts - now + 999999) / 1000000));
+		}
+		if (os_atomic_load_bool(&mps->nav_stop))
+			break;
+
+		/* everything posted until now is handled as one request */
+		struct nav_request request;
+		pthread_mutex_lock(&mps->nav_mutex);
+		request = mps->nav_request;
+		memset(&mps->nav_request, 0, sizeof(mps->nav_request));
+		if (mps->warm_ts && os_gettime_ns() >= mps->warm_ts) {
+			mps->warm_ts = 0;
+			request.load = true;
+		}
+		pthread_mutex_unlock(&mps->nav_mutex);
+
+		stats_add(&mps->stats, STATS_COUNTER_NAV_PROCESSED, 1);
+		process_navigation(mps, &request);
+	}
+
+	return NULL;
+}
+
+static void mps_playlist_next(void *data)
+{
+	struct media_playlist_source *mps = data;
+	post_navigation(mps, 1);
+}
+
+static void mps_playlist_prev(void *data)
+{
+	struct media_playlist_source *mps = data;
+	post_navigation(mps, -1);
+}
+
+/* A later request replaces an earlier one that wasn't handled yet */
+static void post_idle_request(struct media_playlist_source *mps, bool release, bool evict)
+{
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.release = release;
+	mps->nav_request.evict = release && evict;
+	mps->nav_request.reopen = !release;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	os_event_signal(mps->nav_event);
+}
+
+/* Closes the file of a source that is still hidden, so its decoder and
+ * buffers are freed. To make room in the decoder pool, it is also closed if
+ * the source is only shown in the preview. Called by the navigation thread. */
+static void release_media_source(struct media_playlist_source *mps, bool evict)
+{
+	if (os_atomic_load_bool(&mps->idle_released) ||
+	    (evict ? obs_source_active(mps->source) : obs_source_showing(mps->source)))
+		return;
+
+	mps->idle_time_ms = obs_source_media_get_time(get_current_media_source(mps));
+	cancel_crossfade(mps);
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_bool(settings, S_FFMPEG_IS_LOCAL_FILE, true);
+	obs_data_set_string(settings, S_FFMPEG_INPUT, "");
+	obs_data_set_string(settings, S_FFMPEG_LOCAL_FILE, "");
+	obs_source_update(get_current_media_source(mps), settings);
+	obs_data_release(settings);
+
+	os_atomic_set_bool(&mps->idle_released, true);
+	stats_add(&mps->stats, evict ? STATS_COUNTER_DECODER_EVICTIONS : STATS_COUNTER_IDLE_RELEASES, 1);
+}
+
+/* Opens the file closed by release_media_source again, where it was. If the
+ * source isn't active yet, it is paused there, so activating it only has to
+ * unpause or restart a file that is already open. */
+static void reopen_media_source(struct media_playlist_source *mps)
 {
-	UNUSED_PARAMETER(id);
-	UNUSED_PARAMETER(hotkey);
+	char *path = NULL;
+	bool is_url = false;
+	int64_t start_ms = 0;
+	int64_t end_ms = 0;
 
-	struct media_playlist_source *mps = data;
+	if (!os_atomic_exchange_bool(&mps->idle_released, false))
+		return;
 
-	if (pressed && obs_source_showing(mps->source))
-		obs_source_media_previous(mps->source);
+	pthread_mutex_lock(&mps->mutex);
+	if (mps->actual_media) {
+		path = bstrdup(mps->actual_media->path);
+		is_url = mps->actual_media->is_url;
+		start_ms = mps->actual_media->start_ms;
+		end_ms = mps->actual_media->end_ms;
+	}
+	pthread_mutex_unlock(&mps->mutex);
+
+	if (path) {
+		open_media_source(mps, path, is_url, start_ms, end_ms);
+		if (mps->idle_time_ms > start_ms)
+			obs_source_media_set_time(get_current_media_source(mps), mps->idle_time_ms);
+		if (!obs_source_active(mps->source))
+			obs_source_media_play_pause(get_current_media_source(mps), true);
+		bfree(path);
+	}
 }
 
-static void mps_play_pause(void *data, bool pause)
+/* Posts the release of the file once the source was hidden long enough. Not
+ * done if the file is closed or keeps playing while hidden anyway. Called by
+ * the video thread. */
+static void check_idle(struct media_playlist_source *mps)
 {
-	struct media_playlist_source *mps = data;
+	if (mps->idle_release_ms <= 0 || mps->close_when_inactive ||
+	    mps->visibility_behavior == VISIBILITY_BEHAVIOR_ALWAYS_PLAY || obs_source_showing(mps->source)) {
+		mps->hidden_ts = 0;
+		return;
+	}
 
-	obs_source_media_play_pause(mps->current_media_source, pause);
-	mps->paused = pause;
+	uint64_t ts = obs_get_video_frame_time();
+	if (!mps->hidden_ts) {
+		mps->hidden_ts = ts;
+	} else if (!os_atomic_load_bool(&mps->idle_released) &&
+		   ts - mps->hidden_ts >= (uint64_t)mps->idle_release_ms * 1000000ULL) {
+		mps->hidden_ts = ts;
+		post_idle_request(mps, true, false);
+	}
+}
 
-	if (pause)
-		set_media_state(mps, OBS_MEDIA_STATE_PAUSED);
-	else
-		set_media_state(mps, OBS_MEDIA_STATE_PLAYING);
+/* Whether the file being played has a frame to show. ffmpeg_source reports
+ * PLAYING as soon as it starts, before anything is decoded, and its state and
+ * time are still the previous file's until it applies the update, on its next
+ * video tick. So it only counts once its time advanced past 0, two of our
+ * ticks after it was opened, whichever order the sources are ticked in.
+ * Called by the video thread. */
+static bool media_has_frame(struct media_playlist_source *mps, obs_source_t *media_source)
+{
+	return mps->open_ticks >= 2 && os_atomic_load_long(&mps->media_open_count) == mps->fast_fail_open &&
+	       obs_source_media_get_state(media_source) == OBS_MEDIA_STATE_PLAYING &&
+	       obs_source_media_get_time(media_source) > 0;
 }
 
-static void mps_restart(void *data)
+/* Posts the quarantine of a file that was opened `fast_fail_ms` ago but hasn't
+ * shown a frame or sent audio, as a truncated file or one with an unsupported
+ * codec may never end. Only counted while the file should be playing: shown
+ * or active, not paused and not closed. A file that plays without audio while
+ * nothing shows it still has a media time. Called by the video thread. */
+static void check_fast_fail(struct media_playlist_source *mps)
 {
-	struct media_playlist_source *mps = data;
+	uint64_t ts = obs_get_video_frame_time();
+	long open_count = os_atomic_load_long(&mps->media_open_count);
+	if (open_count != mps->fast_fail_open) {
+		mps->fast_fail_open = open_count;
+		mps->fast_fail_ts = ts;
+		mps->open_ticks = 1;
+	} else if (mps->open_ticks < 2) {
+		mps->open_ticks++;
+	}
 
-	mps->user_stopped = false;
+	enum obs_media_state state = obs_source_media_get_state(get_current_media_source(mps));
+	bool waiting = state == OBS_MEDIA_STATE_OPENING || state == OBS_MEDIA_STATE_PLAYING ||
+		       state == OBS_MEDIA_STATE_ERROR;
+	if (mps->fast_fail_ms <= 0 || !open_count || !waiting || os_atomic_load_bool(&mps->media_started) ||
+	    os_atomic_load_bool(&mps->idle_released) ||
+	    (!obs_source_showing(mps->source) && !obs_source_active(mps->source))) {
+		mps->fast_fail_ts = ts;
+		return;
+	}
 
-	if (mps->restart_behavior == RESTART_BEHAVIOR_FIRST_FILE) {
-		play_media_at_index(mps, 0, false);
-	} else if (mps->restart_behavior == RESTART_BEHAVIOR_CURRENT_FILE) {
-		if (mps->state == OBS_MEDIA_STATE_ENDED) {
-			// Make sure that the first file is selected
-			// We do it here, because updating a media source will restart it
-			update_media_source(mps, true);
-		}
-		obs_source_media_restart(mps->current_media_source);
-		set_media_state(mps, OBS_MEDIA_STATE_PLAYING);
+	if (media_has_frame(mps, get_current_media_source(mps))) {
+		os_atomic_set_bool(&mps->media_started, true);
+	} else if (ts - mps->fast_fail_ts >= (uint64_t)mps->fast_fail_ms * 1000000ULL) {
+		/* posted once per file */
+		os_atomic_set_bool(&mps->media_started, true);
+		pthread_mutex_lock(&mps->nav_mutex);
+		mps->nav_request.fast_fail = true;
+		mps->nav_request.fast_fail_open = open_count;
+		pthread_mutex_unlock(&mps->nav_mutex);
+		stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+		os_event_signal(mps->nav_event);
 	}
 }
 
-static void mps_stop(void *data)
+/* Tells the decoder pool whether the file is open and how much it is needed,
+ * and closes or opens it again when the pool says so. A source that plays
+ * while hidden is needed as much as an active one. Called by the video
+ * thread. */
+static void check_decoder_pool(struct media_playlist_source *mps)
 {
-	struct media_playlist_source *mps = data;
-
-	mps->user_stopped = true;
-	obs_source_media_stop(mps->current_media_source);
-	set_media_state(mps, OBS_MEDIA_STATE_STOPPED);
+	enum decoder_priority priority = DECODER_PRIORITY_HIDDEN;
+	bool active = obs_source_active(mps->source);
+	if (active || (mps->visibility_behavior == VISIBILITY_BEHAVIOR_ALWAYS_PLAY && !mps->close_when_inactive))
+		priority = DECODER_PRIORITY_ACTIVE;
+	else if (obs_source_showing(mps->source))
+		priority = DECODER_PRIORITY_PREVIEW;
+
+	long idx;
+	const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+	bool open = snapshot->actual_media && !os_atomic_load_bool(&mps->idle_released) &&
+		    (active || !mps->close_when_inactive);
+	snapshot_release(mps, idx);
+
+	switch (decoder_pool_update(&mps->decoder, priority, open, obs_get_video_frame_time())) {
+	case DECODER_ACTION_RELEASE:
+		post_idle_request(mps, true, true);
+		break;
+	case DECODER_ACTION_REOPEN:
+		post_idle_request(mps, false, false);
+		break;
+	default:
+		break;
+	}
 }
 
-static void mps_playlist_next(void *data)
+/* Records the duration of the file in the internal media source, so that
+ * catch_up_playlist can skip over it later. Called by the navigation thread.
+ */
+static void remember_duration(struct media_playlist_source *mps)
 {
-	struct media_playlist_source *mps = data;
-	bool last_folder_item_reached = false;
+	char *path = NULL;
 
-	if (!get_total_file_count(mps))
+	if (mps->visibility_behavior != VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK || os_atomic_load_bool(&mps->idle_released))
+		return;
+
+	int64_t duration_ms = obs_source_media_get_duration(get_current_media_source(mps));
+	if (duration_ms <= 0)
 		return;
 
 	pthread_mutex_lock(&mps->mutex);
-	if (mps->shuffle) {
-		if (shuffler_has_next(&mps->shuffler)) {
-			mps->actual_media = shuffler_next(&mps->shuffler);
-			bfree(mps->current_media_filename);
-			if (mps->actual_media->parent_id) {
-				mps->current_media = mps->actual_media->parent;
-				mps->current_media_filename = bstrdup(mps->actual_media->filename);
-				mps->current_folder_item_index = mps->actual_media->index;
-			} else {
-				mps->current_media = mps->actual_media;
-				mps->current_media_filename = NULL;
-				mps->current_folder_item_index = 0;
-			}
-			mps->current_media_index = mps->current_media->index;
-			update_media_source(mps, true);
-			obs_source_save(mps->source);
-		}
-		goto end;
+	if (mps->actual_media && !mps->actual_media->is_url)
+		path = bstrdup(mps->actual_media->path);
+	pthread_mutex_unlock(&mps->mutex);
+
+	if (path) {
+		duration_cache_set(path, loudness_file_mtime(path), duration_ms);
+		bfree(path);
 	}
+}
 
-	if (mps->current_media->is_folder) {
-		if (mps->current_media->folder_items.num > 0 &&
-		    mps->current_folder_item_index < mps->current_media->folder_items.num - 1) {
-			++mps->current_folder_item_index;
-			play_folder_item_at_index(mps, mps->current_folder_item_index);
-			goto end;
-		} else {
-			last_folder_item_reached = true;
-			mps->current_folder_item_index = 0;
+/* Where the file stops playing: its out-point, or its end if its duration was
+ * recorded. 0 if it isn't known. */
+static int64_t get_known_end_ms(const struct media_file_data *file)
+{
+	int64_t duration_ms = 0;
+	if (!file->is_url)
+		duration_cache_get(file->path, loudness_file_mtime(file->path), &duration_ms);
+	if (file->end_ms > 0 && (!duration_ms || file->end_ms < duration_ms))
+		return file->end_ms;
+	return duration_ms;
+}
+
+/* Moves to the file the playlist would be at if it had kept playing for
+ * `elapsed_ms` from `time_ms` in the current file, using the durations of the
+ * files played before. A file whose duration isn't known yet is played from
+ * its start. Sets `seek_ms` to where to seek in the final file, and returns
+ * whether that is another file. Requires `mutex`.
+ */
+static bool catch_up_playlist(struct media_playlist_source *mps, int64_t time_ms, int64_t elapsed_ms, int64_t *seek_ms)
+{
+	bool changed = false;
+	int64_t pos = time_ms + elapsed_ms;
+
+	for (size_t i = 0; mps->actual_media && i < CATCH_UP_MAX_FILES; i++) {
+		int64_t end_ms = get_known_end_ms(mps->actual_media);
+		if (end_ms <= mps->actual_media->start_ms) {
+			pos = changed ? mps->actual_media->start_ms : time_ms;
+			break;
 		}
-	}
+		if (pos < end_ms)
+			break;
 
-	if (!mps->current_media->is_folder || last_folder_item_reached) {
-		if (mps->current_media_index < mps->files.num - 1) {
-			++mps->current_media_index;
-		} else if (mps->loop) {
-			mps->current_media_index = 0;
-		} else {
-			goto end;
+		/* the playlist would have ended, so let the file end */
+		if (!step_next(mps)) {
+			pos = end_ms;
+			break;
 		}
-		play_media_at_index(mps, mps->current_media_index, false);
+		changed = true;
+		pos = mps->actual_media->start_ms + pos - end_ms;
 	}
 
-end:
-	pthread_mutex_unlock(&mps->mutex);
+	*seek_ms = pos;
+	return changed;
 }
 
-static void mps_playlist_prev(void *data)
+/* Skips the time the source was hidden once the navigation thread gets to it.
+ * The file stays paused until then. */
+static void post_catch_up(struct media_playlist_source *mps)
 {
-	struct media_playlist_source *mps = data;
-	bool is_first_folder_item = false;
+	if (!mps->deactivated_ts) {
+		obs_source_media_play_pause(mps->source, false);
+		return;
+	}
 
-	if (!get_total_file_count(mps))
+	int64_t elapsed_ms = (int64_t)((obs_get_video_frame_time() - mps->deactivated_ts) / 1000000ULL);
+	mps->deactivated_ts = 0;
+
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.catch_up = true;
+	mps->nav_request.catch_up_ms += elapsed_ms;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	stats_add(&mps->stats, STATS_COUNTER_NAV_POSTED, 1);
+	os_event_signal(mps->nav_event);
+}
+
+/* Has the navigation thread journal where the file is, every
+ * POSITION_JOURNAL_INTERVAL_NS while it plays. Called by the video thread.
+ */
+static void check_position_journal(struct media_playlist_source *mps)
+{
+	if (!mps->resume_position)
 		return;
 
-	pthread_mutex_lock(&mps->mutex);
-	if (mps->shuffle) {
-		if (shuffler_has_prev(&mps->shuffler)) {
-			mps->actual_media = shuffler_prev(&mps->shuffler);
-			bfree(mps->current_media_filename);
-			if (mps->actual_media->parent_id) {
-				mps->current_media = mps->actual_media->parent;
-				mps->current_media_filename = bstrdup(mps->actual_media->filename);
-				mps->current_folder_item_index = mps->actual_media->index;
-			} else {
-				mps->current_media = mps->actual_media;
-				mps->current_media_filename = NULL;
-				mps->current_folder_item_index = 0;
-			}
-			mps->current_media_index = mps->current_media->index;
-			update_media_source(mps, true);
-			obs_source_save(mps->source);
-		}
-		goto end;
-	}
+	uint64_t ts = obs_get_video_frame_time();
+	if (ts - mps->last_journal_ts < POSITION_JOURNAL_INTERVAL_NS)
+		return;
+	mps->last_journal_ts = ts;
+	if (obs_source_media_get_state(get_current_media_source(mps)) != OBS_MEDIA_STATE_PLAYING)
+		return;
 
-	if (mps->current_media->is_folder) {
-		if (mps->current_folder_item_index > 0) {
-			--mps->current_folder_item_index;
-			play_folder_item_at_index(mps, mps->current_folder_item_index);
-			goto end;
-		} else {
-			is_first_folder_item = true;
-		}
-	}
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.save_position = true;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	os_event_signal(mps->nav_event);
+}
 
-	if (!mps->current_media->is_folder || is_first_folder_item) {
-		if (mps->current_media_index > 0) {
-			--mps->current_media_index;
-		} else if (mps->loop) {
-			mps->current_media_index = mps->files.num - 1;
-		} else {
-			goto end;
-		}
-		play_media_at_index(mps, mps->current_media_index, is_first_folder_item);
+/* Sets when a lazy source is loaded in the background, or cancels it if it
+ * is only loaded when shown now. The time is only kept from the last source
+ * scheduled, so it doesn't grow from one scene collection to the next.
+ */
+static void schedule_warm_up(struct media_playlist_source *mps)
+{
+	static pthread_mutex_t warm_mutex = PTHREAD_MUTEX_INITIALIZER;
+	static uint64_t last_warm_ts = 0;
+
+	pthread_mutex_lock(&mps->nav_mutex);
+	if (mps->lazy_load != LAZY_LOAD_IN_BACKGROUND) {
+		mps->warm_ts = 0;
+	} else if (!mps->warm_ts) {
+		uint64_t warm_ts = os_gettime_ns() + LAZY_LOAD_WARM_DELAY_MS * 1000000ULL;
+		pthread_mutex_lock(&warm_mutex);
+		if (warm_ts < last_warm_ts + LAZY_LOAD_WARM_INTERVAL_MS * 1000000ULL)
+			warm_ts = last_warm_ts + LAZY_LOAD_WARM_INTERVAL_MS * 1000000ULL;
+		last_warm_ts = warm_ts;
+		pthread_mutex_unlock(&warm_mutex);
+		mps->warm_ts = warm_ts;
 	}
+	pthread_mutex_unlock(&mps->nav_mutex);
+	os_event_signal(mps->nav_event);
+}
 
-end:
-	pthread_mutex_unlock(&mps->mutex);
+/* Loads the playlist of a lazy source on the navigation thread, so showing
+ * it doesn't wait for its folders to be scanned */
+static void post_load(struct media_playlist_source *mps)
+{
+	if (os_atomic_load_bool(&mps->loaded))
+		return;
+
+	pthread_mutex_lock(&mps->nav_mutex);
+	mps->nav_request.load = true;
+	pthread_mutex_unlock(&mps->nav_mutex);
+	os_event_signal(mps->nav_event);
+}
+
+/* Shown in the preview, or about to be activated */
+static void mps_show(void *data)
+{
+	struct media_playlist_source *mps = data;
+	post_load(mps);
+	if (os_atomic_load_bool(&mps->idle_released))
+		post_idle_request(mps, false, false);
+}
+
+static void preroll_proc(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(cd);
+	mps_show(data);
 }
 
 static void mps_activate(void *data)
 {
 	struct media_playlist_source *mps = data;
+	post_load(mps);
 	if (!get_total_file_count(mps))
 		return;
 
-	mps->user_stopped = false;
+	/* not shown in the preview first, so it couldn't be opened ahead */
+	if (os_atomic_load_bool(&mps->idle_released))
+		post_idle_request(mps, false, false);
+
+	os_atomic_set_bool(&mps->user_stopped, false);
 	if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_STOP_RESTART) {
 		obs_source_media_restart(mps->source);
 	} else if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE) {
 		obs_source_media_play_pause(mps->source, false);
 	} else if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_STOP_PLAY_NEXT) {
 		// we only play next when the source is deactivated so we don't do anything here
+	} else if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK) {
+		post_catch_up(mps);
 	}
 }
 
@@ -721,14 +2258,17 @@ static void mps_deactivate(void *data)
 	struct media_playlist_source *mps = data;
 
 	if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_STOP_RESTART) {
-		mps->user_stopped = true;
+		os_atomic_set_bool(&mps->user_stopped, true);
 		obs_source_media_stop(mps->source);
 	} else if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE) {
 		obs_source_media_play_pause(mps->source, true);
 	} else if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_STOP_PLAY_NEXT) {
-		mps->user_stopped = true;
+		os_atomic_set_bool(&mps->user_stopped, true);
 		obs_source_media_stop(mps->source);
 		obs_source_media_next(mps->source);
+	} else if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK) {
+		obs_source_media_play_pause(mps->source, true);
+		mps->deactivated_ts = obs_get_video_frame_time();
 	}
 }
 
@@ -736,20 +2276,68 @@ static void mps_destroy(void *data)
 {
 	struct media_playlist_source *mps = data;
 
-	obs_source_release(mps->current_media_source);
+	signal_handler_disconnect(obs_source_get_signal_handler(mps->source), "remove", mps_removed, mps);
+	decoder_pool_remove(&mps->decoder);
+	if (mps->nav_thread_active) {
+		os_atomic_set_bool(&mps->nav_stop, true);
+		os_event_signal(mps->nav_event);
+		pthread_join(mps->nav_thread, NULL);
+	}
+	os_event_destroy(mps->nav_event);
+	obs_data_release(mps->nav_request.media_settings); // posted but not applied
+
+	for (size_t i = 0; i < 2; i++) {
+		obs_source_remove_audio_capture_callback(mps->media_sources[i], mps_audio_callback, mps);
+		obs_source_release(mps->media_sources[i]);
+	}
 	shuffler_destroy(&mps->shuffler);
 	free_files(&mps->files.da);
+	playlist_file_cache_free(&mps->playlist_files);
 	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		deque_free(&mps->audio_data[i]);
 	}
-	deque_free(&mps->audio_frames);
-	deque_free(&mps->audio_timestamps);
+	while (mps->audio_packets.size > 0) {
+		struct audio_packet packet;
+		deque_pop_front(&mps->audio_packets, &packet, sizeof(packet));
+		free_file_loudness(packet.file_opened);
+	}
+	deque_free(&mps->audio_packets);
+	bfree(mps->audio_buf);
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+		deque_free(&mps->fade_audio_data[i]);
+	}
+	bfree(mps->fade_buf);
+	loudness_analyzer_free(&mps->loudness);
 	pthread_mutex_destroy(&mps->mutex);
 	pthread_mutex_destroy(&mps->audio_mutex);
+	pthread_mutex_destroy(&mps->snapshot_mutex);
+	pthread_mutex_destroy(&mps->nav_mutex);
+	stats_free(&mps->stats);
 	bfree(mps->current_media_filename);
+	for (size_t i = 0; i < mps->missing_catalog_paths.num; i++)
+		bfree(mps->missing_catalog_paths.array[i]);
+	da_free(mps->missing_catalog_paths);
 	bfree(mps);
 }
 
+/* The files kept for the source in the module config folder are deleted
+ * with it. The frontend also removes every source when it exits or switches
+ * scene collections, but only once it has cleared the output channels, and
+ * the files are kept then.
+ */
+static void mps_removed(void *data, calldata_t *cd)
+{
+	struct media_playlist_source *mps = data;
+	obs_source_t *output = obs_get_output_source(0);
+
+	UNUSED_PARAMETER(cd);
+	if (!output)
+		return;
+	obs_source_release(output);
+	delete_shuffle_state(mps);
+	delete_position(mps);
+}
+
 static void *mps_create(obs_data_t *settings, obs_source_t *source)
 {
 	UNUSED_PARAMETER(settings);
@@ -762,15 +2350,13 @@ static void *mps_create(obs_data_t *settings, obs_source_t *source)
 	shuffler_init(&mps->shuffler);
 
 	/* Internal media source */
-	obs_data_t *media_source_data = obs_data_create();
-	obs_data_set_bool(media_source_data, "log_changes", false);
-	mps->current_media_source =
-		obs_source_create_private("ffmpeg_source", "current_media_source", media_source_data);
-	obs_source_add_active_child(mps->source, mps->current_media_source);
-	obs_source_add_audio_capture_callback(mps->current_media_source, mps_audio_callback, mps);
-
-	signal_handler_t *sh_media_source = obs_source_get_signal_handler(mps->current_media_source);
-	signal_handler_connect(sh_media_source, "media_ended", media_source_ended, mps);
+	for (size_t i = 0; i < 2; i++) {
+		obs_data_t *media_source_data = obs_data_create();
+		obs_data_set_bool(media_source_data, "log_changes", false);
+		mps->media_sources[i] = create_media_source(mps, media_source_data);
+		obs_data_release(media_source_data);
+	}
+	obs_source_add_active_child(mps->source, mps->media_sources[0]);
 
 	mps->paused = false;
 
@@ -791,6 +2377,12 @@ static void *mps_create(obs_data_t *settings, obs_source_t *source)
 
 	proc_handler_t *ph = obs_source_get_proc_handler(source);
 	proc_handler_add(ph, "void select_index(int media_index, int folder_item_index)", select_index_proc, mps);
+	proc_handler_add(ph, "void peek_upcoming(int count, out string upcoming)", peek_upcoming_proc, mps);
+	proc_handler_add(ph, "void get_stats(out string stats)", get_stats_proc, mps);
+	proc_handler_add(ph, "void export_trace(string path, out bool success)", export_trace_proc, mps);
+	proc_handler_add(ph, "void save_catalog(string path, out bool success)", save_catalog_proc, mps);
+	proc_handler_add(ph, "void preroll()", preroll_proc, mps);
+	signal_handler_connect(obs_source_get_signal_handler(source), "remove", mps_removed, mps);
 
 	pthread_mutex_init_value(&mps->mutex);
 	if (pthread_mutex_init(&mps->mutex, NULL) != 0)
@@ -800,9 +2392,32 @@ static void *mps_create(obs_data_t *settings, obs_source_t *source)
 	if (pthread_mutex_init(&mps->audio_mutex, NULL) != 0)
 		goto error;
 
+	pthread_mutex_init_value(&mps->snapshot_mutex);
+	if (pthread_mutex_init(&mps->snapshot_mutex, NULL) != 0)
+		goto error;
+
+	pthread_mutex_init_value(&mps->nav_mutex);
+	if (pthread_mutex_init(&mps->nav_mutex, NULL) != 0)
+		goto error;
+
+	if (!stats_init(&mps->stats))
+		goto error;
+
+	mps->loudness_lufs = NAN;
+	mps->loudness_applied_gain = 1.0f;
+	mps->fade_gain = 1.0f;
+	if (!loudness_analyzer_init(&mps->loudness, &mps->stats))
+		goto error;
+
+	if (os_event_init(&mps->nav_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto error;
+	if (pthread_create(&mps->nav_thread, NULL, navigation_thread, mps) != 0)
+		goto error;
+	mps->nav_thread_active = true;
+	decoder_pool_add(&mps->decoder);
+
 	obs_source_update(source, NULL);
 
-	obs_data_release(media_source_data);
 	return mps;
 
 error:
@@ -813,8 +2428,22 @@ error:
 static void mps_video_render(void *data, gs_effect_t *effect)
 {
 	struct media_playlist_source *mps = data;
-	if (mps->actual_media) {
-		obs_source_video_render(mps->current_media_source);
+	long idx;
+
+	const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+	bool has_media = snapshot->actual_media != NULL;
+	snapshot_release(mps, idx);
+
+	/* nothing from before the in-point is shown. A crossfade may switch
+	 * the current child meanwhile, but both live as long as the source. */
+	obs_source_t *media_source = get_current_media_source(mps);
+	if (has_media && !os_atomic_load_bool(&mps->trim_seeking)) {
+		obs_source_video_render(media_source);
+		if ((os_atomic_load_bool(&mps->stats.waiting_video) || !os_atomic_load_bool(&mps->media_started)) &&
+		    media_has_frame(mps, media_source)) {
+			os_atomic_set_bool(&mps->media_started, true);
+			stats_transition_video(&mps->stats);
+		}
 	} else {
 		obs_source_video_render(NULL);
 	}
@@ -826,20 +2455,20 @@ static bool mps_audio_render(void *data, uint64_t *ts_out, struct obs_source_aud
 			     size_t channels, size_t sample_rate)
 {
 	struct media_playlist_source *mps = data;
-	if (!mps->current_media_source)
+	if (!get_current_media_source(mps))
 		return false;
 
 	struct obs_source_audio_mix child_audio;
 	uint64_t source_ts;
 
-	/*if (obs_source_audio_pending(mps->current_media_source))
+	/*if (obs_source_audio_pending(get_current_media_source(mps)))
 		return false;*/
 
-	source_ts = obs_source_get_audio_timestamp(mps->current_media_source);
+	source_ts = obs_source_get_audio_timestamp(get_current_media_source(mps));
 	if (!source_ts)
 		return false;
 
-	obs_source_get_audio_mix(mps->current_media_source, &child_audio);
+	obs_source_get_audio_mix(get_current_media_source(mps), &child_audio);
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
 		if ((mixers & (1 << mix)) == 0)
 			continue;
@@ -866,25 +2495,80 @@ static void mps_video_tick(void *data, float seconds)
 
 	const audio_t *a = obs_get_audio();
 	const struct audio_output_info *aoi = audio_output_get_info(a);
+	const size_t channels = audio_output_get_channels(a);
 	pthread_mutex_lock(&mps->audio_mutex);
-	while (mps->audio_frames.size > 0) {
-		struct obs_source_audio audio;
+	stats_hist_record(&mps->stats.audio_queue, (uint64_t)mps->audio_queued_frames * 1000 / aoi->samples_per_sec);
+	while (mps->audio_packets.size > 0) {
+		struct audio_packet packet;
+		deque_pop_front(&mps->audio_packets, &packet, sizeof(packet));
+		if (!packet.frames) {
+			handle_file_marker(mps, &packet, channels, aoi->samples_per_sec);
+			continue;
+		}
+		mps->audio_queued_frames -= packet.frames;
+
+		struct obs_source_audio audio = {0};
 		audio.format = aoi->format;
 		audio.samples_per_sec = aoi->samples_per_sec;
 		audio.speakers = aoi->speakers;
-		deque_pop_front(&mps->audio_frames, &audio.frames, sizeof(audio.frames));
-		deque_pop_front(&mps->audio_timestamps, &audio.timestamp, sizeof(audio.timestamp));
-		for (size_t i = 0; i < mps->num_channels; i++) {
-			audio.data[i] = (uint8_t *)mps->audio_data[i].data + mps->audio_data[i].start_pos;
+		audio.frames = packet.frames;
+		audio.timestamp = packet.timestamp;
+		pop_audio_packet(mps, &packet, channels, (float **)audio.data);
+		loudness_analyzer_push(&mps->loudness, (const float *const *)audio.data, channels, packet.frames);
+		apply_loudness_gain(mps, (float **)audio.data, channels, packet.frames);
+		if (packet.fade_in && mps->fade_media_source)
+			mix_crossfade(mps, (float **)audio.data, channels, packet.frames);
+
+		/* Keep the relayed audio continuous, unless the child jumped
+		 * (new file, seek, or dropped packets) */
+		if (mps->audio_next_ts) {
+			uint64_t diff = audio.timestamp > mps->audio_next_ts ? audio.timestamp - mps->audio_next_ts
+									      : mps->audio_next_ts - audio.timestamp;
+			if (diff < AUDIO_SMOOTHING_THRESHOLD_NS)
+				audio.timestamp = mps->audio_next_ts;
+			else
+				stats_add(&mps->stats, STATS_COUNTER_AUDIO_RESYNCS, 1);
 		}
+		mps->audio_next_ts = audio.timestamp + (uint64_t)audio.frames * 1000000000ULL / audio.samples_per_sec;
+
 		obs_source_output_audio(mps->source, &audio);
-		for (size_t i = 0; i < mps->num_channels; i++) {
-			deque_pop_front(&mps->audio_data[i], NULL, audio.frames * sizeof(float));
+	}
+
+	obs_source_t *faded = NULL;
+	if (mps->fade_media_source) {
+		if (!mps->fade_pos && mps->fade_queued_frames && mps->fade_channels == channels)
+			relay_fade_audio(mps, aoi);
+
+		uint64_t timeout = (uint64_t)mps->crossfade_ms * 1000000ULL + CROSSFADE_TIMEOUT_NS;
+		if (mps->fade_pos >= mps->fade_frames || os_atomic_load_bool(&mps->fade_cancel) ||
+		    os_gettime_ns() - mps->fade_start_ts > timeout) {
+			faded = mps->fade_media_source;
+			mps->fade_media_source = NULL;
+			os_atomic_set_bool(&mps->fade_closing, true);
+			for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+				deque_free(&mps->fade_audio_data[i]);
+			}
+			mps->fade_queued_frames = 0;
 		}
 	}
-	mps->num_channels = audio_output_get_channels(a);
 	pthread_mutex_unlock(&mps->audio_mutex);
 
+	if (faded)
+		end_crossfade(mps, faded);
+	check_trim(mps);
+	check_crossfade(mps);
+	check_idle(mps);
+	check_decoder_pool(mps);
+	check_position_journal(mps);
+	check_fast_fail(mps);
+
+	uint64_t ts = obs_get_video_frame_time();
+	if (ts - mps->stats.last_log_ts >= STATS_LOG_INTERVAL_NS) {
+		if (mps->stats.last_log_ts)
+			stats_log(&mps->stats, obs_source_get_name(mps->source));
+		mps->stats.last_log_ts = ts;
+	}
+
 	//if (mps->restart_on_activate && mps->use_cut) {
 	//	mps->elapsed = 0.0f;
 	//	mps->cur_item = mps->randomize ? random_file(mps) : 0;
@@ -935,21 +2619,23 @@ static void mps_enum_sources(void *data, obs_source_enum_proc_t cb, void *param)
 {
 	struct media_playlist_source *mps = data;
 
-	pthread_mutex_lock(&mps->mutex);
-	cb(mps->source, mps->current_media_source, param);
-	pthread_mutex_unlock(&mps->mutex);
+	/* the internal media sources are only released by mps_destroy, no need to lock */
+	for (size_t i = 0; i < 2; i++)
+		cb(mps->source, mps->media_sources[i], param);
 }
 
+/* The size of whichever internal media source is current. Neither is ever
+ * released before the source, so no lock or reference is needed. */
 static uint32_t mps_width(void *data)
 {
 	struct media_playlist_source *mps = data;
-	return obs_source_get_width(mps->current_media_source);
+	return obs_source_get_width(get_current_media_source(mps));
 }
 
 static uint32_t mps_height(void *data)
 {
 	struct media_playlist_source *mps = data;
-	return obs_source_get_height(mps->current_media_source);
+	return obs_source_get_height(get_current_media_source(mps));
 }
 
 static void mps_defaults(obs_data_t *settings)
@@ -958,8 +2644,20 @@ static void mps_defaults(obs_data_t *settings)
 	obs_data_set_default_bool(settings, S_SHUFFLE, false);
 	obs_data_set_default_int(settings, S_VISIBILITY_BEHAVIOR, VISIBILITY_BEHAVIOR_STOP_RESTART);
 	obs_data_set_default_int(settings, S_RESTART_BEHAVIOR, RESTART_BEHAVIOR_CURRENT_FILE);
+	obs_data_set_default_int(settings, S_LAZY_LOAD, LAZY_LOAD_OFF);
+	obs_data_set_default_bool(settings, S_RESUME_POSITION, false);
 	obs_data_set_default_string(settings, S_CURRENT_FILE_NAME, " ");
 	obs_data_set_default_int(settings, S_SPEED, 100);
+	obs_data_set_default_int(settings, S_AUDIO_MAX_LATENCY, 500);
+	obs_data_set_default_int(settings, S_AUDIO_OVERFLOW_POLICY, AUDIO_OVERFLOW_DROP_OLDEST);
+	obs_data_set_default_int(settings, S_CROSSFADE, 0);
+	obs_data_set_default_bool(settings, S_LOUDNESS_NORMALIZE, false);
+	obs_data_set_default_int(settings, S_LOUDNESS_TARGET, -16);
+	obs_data_set_default_int(settings, S_IDLE_RELEASE, 0);
+	obs_data_set_default_int(settings, S_MAX_OPEN_FILES, 0);
+	obs_data_set_default_int(settings, S_FAST_FAIL, 0);
+	obs_data_set_default_bool(settings, S_URL_CACHE, false);
+	obs_data_set_default_int(settings, S_URL_CACHE_SIZE, 2048);
 }
 
 static void add_media_to_selection(obs_property_t *list, struct media_file_data *data)
@@ -1019,9 +2717,10 @@ static obs_properties_t *mps_properties(void *data)
 
 	// get last directory opened for editable list
 	if (mps) {
-		pthread_mutex_lock(&mps->mutex);
-		if (mps->files.num) {
-			struct media_file_data *last = da_end(mps->files);
+		long idx;
+		const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+		if (snapshot->files.num) {
+			struct media_file_data *last = da_end(snapshot->files);
 			const char *slash;
 
 			dstr_copy(&path, last->path);
@@ -1030,7 +2729,7 @@ static obs_properties_t *mps_properties(void *data)
 			if (slash)
 				dstr_resize(&path, slash - path.array + 1);
 		}
-		pthread_mutex_unlock(&mps->mutex);
+		snapshot_release(mps, idx);
 	}
 
 	p = obs_properties_add_list(props, S_VISIBILITY_BEHAVIOR, T_VISIBILITY_BEHAVIOR, OBS_COMBO_TYPE_LIST,
@@ -1039,23 +2738,44 @@ static obs_properties_t *mps_properties(void *data)
 	obs_property_list_add_int(p, T_VISIBILITY_BEHAVIOR_STOP_PLAY_NEXT, VISIBILITY_BEHAVIOR_STOP_PLAY_NEXT);
 	obs_property_list_add_int(p, T_VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE, VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE);
 	obs_property_list_add_int(p, T_VISIBILITY_BEHAVIOR_ALWAYS_PLAY, VISIBILITY_BEHAVIOR_ALWAYS_PLAY);
+	obs_property_list_add_int(p, T_VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK, VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK);
 
 	p = obs_properties_add_list(props, S_RESTART_BEHAVIOR, T_RESTART_BEHAVIOR, OBS_COMBO_TYPE_LIST,
 				    OBS_COMBO_FORMAT_INT);
 	obs_property_list_add_int(p, T_RESTART_BEHAVIOR_CURRENT_FILE, RESTART_BEHAVIOR_CURRENT_FILE);
 	obs_property_list_add_int(p, T_RESTART_BEHAVIOR_FIRST_FILE, RESTART_BEHAVIOR_FIRST_FILE);
 
+	p = obs_properties_add_bool(props, S_RESUME_POSITION, T_RESUME_POSITION);
+	obs_property_set_long_description(p, T_RESUME_POSITION_TOOLTIP);
+
+	p = obs_properties_add_list(props, S_LAZY_LOAD, T_LAZY_LOAD, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, T_LAZY_LOAD_OFF, LAZY_LOAD_OFF);
+	obs_property_list_add_int(p, T_LAZY_LOAD_WHEN_SHOWN, LAZY_LOAD_WHEN_SHOWN);
+	obs_property_list_add_int(p, T_LAZY_LOAD_IN_BACKGROUND, LAZY_LOAD_IN_BACKGROUND);
+	obs_property_set_long_description(p, T_LAZY_LOAD_TOOLTIP);
+
 	obs_properties_add_bool(props, S_FFMPEG_HW_DECODE, T_USE_HARDWARE_DECODING);
 
 	p = obs_properties_add_bool(props, S_FFMPEG_CLOSE_WHEN_INACTIVE, T_FFMPEG_CLOSE_WHEN_INACTIVE);
 	obs_property_set_long_description(p, T_FFMPEG_CLOSE_WHEN_INACTIVE_TOOLTIP);
 
+	p = obs_properties_add_int(props, S_IDLE_RELEASE, T_IDLE_RELEASE, 0, 3600, 1);
+	obs_property_int_set_suffix(p, " s");
+	obs_property_set_long_description(p, T_IDLE_RELEASE_TOOLTIP);
+	p = obs_properties_add_int(props, S_MAX_OPEN_FILES, T_MAX_OPEN_FILES, 0, 1000, 1);
+	obs_property_set_long_description(p, T_MAX_OPEN_FILES_TOOLTIP);
+	p = obs_properties_add_int(props, S_FAST_FAIL, T_FAST_FAIL, 0, 300, 1);
+	obs_property_int_set_suffix(p, " s");
+	obs_property_set_long_description(p, T_FAST_FAIL_TOOLTIP);
+
 	dstr_copy(&filter, obs_module_text("MediaFileFilter.AllMediaFiles"));
 	dstr_cat(&filter, media_filter);
 	dstr_cat(&filter, obs_module_text("MediaFileFilter.VideoFiles"));
 	dstr_cat(&filter, video_filter);
 	dstr_cat(&filter, obs_module_text("MediaFileFilter.AudioFiles"));
 	dstr_cat(&filter, audio_filter);
+	dstr_cat(&filter, obs_module_text("MediaFileFilter.PlaylistFiles"));
+	dstr_cat(&filter, playlist_filter);
 	dstr_cat(&filter, obs_module_text("MediaFileFilter.AllFiles"));
 	dstr_cat(&filter, " (*.*)");
 
@@ -1065,6 +2785,14 @@ static obs_properties_t *mps_properties(void *data)
 	dstr_free(&filter);
 	dstr_free(&exts);
 
+	if (*obs_data_get_string(settings, S_CATALOG)) {
+		bool error = os_atomic_load_bool(&mps->catalog_error);
+		p = obs_properties_add_text(props, S_CATALOG, T_CATALOG, OBS_TEXT_INFO);
+		obs_property_set_long_description(p, error ? T_CATALOG_ERROR : T_CATALOG_TOOLTIP);
+		if (error)
+			obs_property_text_set_info_type(p, OBS_TEXT_INFO_ERROR);
+	}
+
 	p = obs_properties_add_text(props, S_CURRENT_FILE_NAME, T_CURRENT_FILE_NAME, OBS_TEXT_INFO);
 	obs_property_set_long_description(p, "Due to OBS limitations, this will only update if any settings"
 					     " are changed, the selected file is played, or the Properties "
@@ -1075,9 +2803,12 @@ static obs_properties_t *mps_properties(void *data)
 	p = obs_properties_add_list(props, S_SELECT_FILE, T_SELECT_FILE, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
 	obs_property_list_add_string(p, T_NO_FILE_SELECTED, "0");
 	if (mps) {
-		for (size_t i = 0; i < mps->files.num; i++) {
-			add_media_to_selection(p, &mps->files.array[i]);
+		long idx;
+		const struct playlist_snapshot *snapshot = snapshot_acquire(mps, &idx);
+		for (size_t i = 0; i < snapshot->files.num; i++) {
+			add_media_to_selection(p, &snapshot->files.array[i]);
 		}
+		snapshot_release(mps, idx);
 	}
 
 	obs_properties_add_button(props, "play_selected", "Play Selected File", play_selected_clicked);
@@ -1087,6 +2818,31 @@ static obs_properties_t *mps_properties(void *data)
 	p = obs_properties_add_text(props, "", T_SPEED_WARNING, OBS_TEXT_INFO);
 	obs_property_text_set_info_type(p, OBS_TEXT_INFO_WARNING);
 
+	p = obs_properties_add_int(props, S_AUDIO_MAX_LATENCY, T_AUDIO_MAX_LATENCY, 50, 5000, 10);
+	obs_property_int_set_suffix(p, " ms");
+	obs_property_set_long_description(p, T_AUDIO_MAX_LATENCY_TOOLTIP);
+
+	p = obs_properties_add_list(props, S_AUDIO_OVERFLOW_POLICY, T_AUDIO_OVERFLOW_POLICY, OBS_COMBO_TYPE_LIST,
+				    OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(p, T_AUDIO_OVERFLOW_DROP_OLDEST, AUDIO_OVERFLOW_DROP_OLDEST);
+	obs_property_list_add_int(p, T_AUDIO_OVERFLOW_DROP_NEWEST, AUDIO_OVERFLOW_DROP_NEWEST);
+
+	p = obs_properties_add_int(props, S_CROSSFADE, T_CROSSFADE, 0, 10000, 100);
+	obs_property_int_set_suffix(p, " ms");
+	obs_property_set_long_description(p, T_CROSSFADE_TOOLTIP);
+
+	p = obs_properties_add_bool(props, S_LOUDNESS_NORMALIZE, T_LOUDNESS_NORMALIZE);
+	obs_property_set_long_description(p, T_LOUDNESS_NORMALIZE_TOOLTIP);
+	p = obs_properties_add_int(props, S_LOUDNESS_TARGET, T_LOUDNESS_TARGET, -40, -5, 1);
+	obs_property_int_set_suffix(p, " LUFS");
+
+#ifdef HAVE_CURL
+	p = obs_properties_add_bool(props, S_URL_CACHE, T_URL_CACHE);
+	obs_property_set_long_description(p, T_URL_CACHE_TOOLTIP);
+	p = obs_properties_add_int(props, S_URL_CACHE_SIZE, T_URL_CACHE_SIZE, 100, 1000000, 100);
+	obs_property_int_set_suffix(p, " MB");
+#endif
+
 	obs_data_array_release(array);
 	obs_data_release(settings);
 
@@ -1109,7 +2865,43 @@ static void set_parents(struct darray *array)
 	}
 }
 
-static void add_file(struct darray *array, const char *path, const char *id)
+/* Folder items are all trimmed like their folder. An out-point before the
+ * in-point is ignored.
+ */
+static void set_trim_points(struct media_file_data *file, int64_t start_ms, int64_t end_ms)
+{
+	if (start_ms < 0)
+		start_ms = 0;
+	if (end_ms <= start_ms)
+		end_ms = 0;
+
+	file->start_ms = start_ms;
+	file->end_ms = end_ms;
+	for (size_t i = 0; i < file->folder_items.num; i++) {
+		file->folder_items.array[i].start_ms = start_ms;
+		file->folder_items.array[i].end_ms = end_ms;
+	}
+}
+
+/* Puts the items of a folder in the order of their sort keys */
+static void sort_folder_items(struct media_file_data *folder, struct folder_sort_keys *keys, bool reverse)
+{
+	DARRAY(struct media_file_data) sorted;
+
+	folder_sort_run(keys, reverse);
+	da_init(sorted);
+	da_reserve(sorted, folder->folder_items.num);
+	for (size_t i = 0; i < keys->keys.num; i++) {
+		struct media_file_data *item = da_push_back_new(sorted);
+		*item = folder->folder_items.array[keys->keys.array[i].index];
+		item->index = i;
+	}
+	da_free(folder->folder_items);
+	folder->folder_items.da = sorted.da;
+}
+
+static void add_file(struct darray *array, const char *path, const char *id, enum folder_sort sort, bool sort_reverse,
+		     struct mps_stats *stats)
 {
 	DARRAY(struct media_file_data) new_files;
 	new_files.da = *array;
@@ -1119,15 +2911,22 @@ static void add_file(struct darray *array, const char *path, const char *id)
 	data->index = new_files.num - 1;
 	data->path = bstrdup(path);
 	data->is_url = strstr(path, "://") != NULL;
+	data->sort = sort;
+	data->sort_reverse = sort_reverse;
 	da_init(data->folder_items);
 
+	uint64_t start_ts = stats_timer_begin();
 	os_dir_t *dir = os_opendir(path);
 
 	if (dir) {
 		struct dstr dir_path = {0};
 		struct os_dirent *ent;
+		struct folder_sort_keys keys;
+		bool sorted = sort != FOLDER_SORT_NONE || sort_reverse;
+		bool needs_stat = sort == FOLDER_SORT_MTIME || sort == FOLDER_SORT_SIZE;
 
 		data->is_folder = true;
+		folder_sort_init(&keys, sort);
 
 		while (true) {
 			const char *ext;
@@ -1151,31 +2950,107 @@ static void add_file(struct darray *array, const char *path, const char *id)
 			dstr_cat(&dir_path, ent->d_name);
 			folder_item.path = bstrdup(dir_path.array);
 
+			if (sorted) {
+				struct stat st;
+				if (!needs_stat || os_stat(dir_path.array, &st) != 0)
+					memset(&st, 0, sizeof(st));
+				folder_sort_add(&keys, ent->d_name, (int64_t)st.st_mtime, (uint64_t)st.st_size);
+			}
 			da_push_back(data->folder_items, &folder_item);
 		}
 
+		if (sorted)
+			sort_folder_items(data, &keys, sort_reverse);
+		folder_sort_free(&keys);
 		dstr_free(&dir_path);
 		os_closedir(dir);
+
+		stats_add(stats, STATS_COUNTER_FOLDER_ITEMS, (long)data->folder_items.num);
+		stats_timer_end(stats, STATS_TIMER_FOLDER_SCAN, start_ts);
 	}
 
 	*array = new_files.da;
 }
 
+/* Adds the files listed in an M3U, PLS or XSPF file as the items of a folder,
+ * so they are played, shuffled and selected like one. Files that aren't lists
+ * of files, like HLS streams, are left for the media source to play.
+ */
+static void add_playlist_file(struct media_file_data *data, struct playlist_file_cache *cache, struct mps_stats *stats)
+{
+	uint64_t start_ts = stats_timer_begin();
+	const struct playlist_entries *entries = playlist_file_cache_get(cache, data->path);
+	if (!entries)
+		return;
+
+	data->is_folder = true;
+	size_t count = playlist_entries_count(entries);
+	da_reserve(data->folder_items, count);
+	for (size_t i = 0; i < count; i++) {
+		const char *path = playlist_entry(entries, i);
+		struct media_file_data *folder_item = da_push_back_new(data->folder_items);
+		folder_item->filename = bstrdup(path); // entries can be in different folders
+		folder_item->parent_id = data->id;
+		folder_item->index = i;
+		folder_item->path = bstrdup(path);
+		folder_item->is_url = strstr(path, "://") != NULL;
+	}
+
+	stats_add(stats, STATS_COUNTER_FOLDER_ITEMS, (long)count);
+	stats_timer_end(stats, STATS_TIMER_FOLDER_SCAN, start_ts);
+}
+
+/* The catalog is only used if it is the one that was saved with the settings.
+ * Otherwise only the files in the list are played, and the error is shown in
+ * the Properties window, see `catalog_error`.
+ */
+static bool open_catalog(struct media_playlist_source *mps, obs_data_t *settings, struct catalog *catalog)
+{
+	const char *path = obs_data_get_string(settings, S_CATALOG);
+	const char *checksum = obs_data_get_string(settings, S_CATALOG_CHECKSUM);
+
+	os_atomic_set_bool(&mps->catalog_error, false);
+	if (!*path)
+		return false;
+	if (!catalog_open(catalog, path)) {
+		obs_log(LOG_ERROR, "[%s] Failed to open playlist catalog %s, only the files in the list are played",
+			obs_source_get_name(mps->source), path);
+		os_atomic_set_bool(&mps->catalog_error, true);
+		return false;
+	}
+	if (strtoull(checksum, NULL, 16) != catalog_checksum(catalog)) {
+		obs_log(LOG_ERROR, "[%s] Playlist catalog %s was changed, only the files in the list are played",
+			obs_source_get_name(mps->source), path);
+		os_atomic_set_bool(&mps->catalog_error, true);
+		catalog_close(catalog);
+		return false;
+	}
+	return true;
+}
+
 static void mps_update(void *data, obs_data_t *settings)
 {
 	DARRAY(struct media_file_data) new_files;
 	DARRAY(struct media_file_data) old_files;
 	struct media_playlist_source *mps = data;
 	obs_data_array_t *array;
+	struct catalog catalog;
+	bool use_catalog;
+	size_t catalog_items;
 	size_t count;
 	bool shuffle = false;
 	bool shuffle_changed = false;
 	enum visibility_behavior visibility_behavior = mps->visibility_behavior;
 	bool visibility_behavior_changed = false;
 	bool item_edited = false;
+	bool trim_edited = false;
+	bool shuffle_restored = false;
+	bool resume_position;
+	bool resume_turned_off;
 	bool restart_on_activate = true;
 	const char *old_media_path = NULL;
 	long long new_speed;
+	uint64_t start_ts = stats_timer_begin();
 	//const char *mode;
 
 	/* ------------------------------------- */
@@ -1188,39 +3063,76 @@ static void mps_update(void *data, obs_data_t *settings)
 		visibility_behavior_changed = true;
 	}
 	mps->restart_behavior = obs_data_get_int(settings, S_RESTART_BEHAVIOR);
+	mps->lazy_load = obs_data_get_int(settings, S_LAZY_LOAD);
+	resume_position = obs_data_get_bool(settings, S_RESUME_POSITION);
+	resume_turned_off = mps->resume_position && !resume_position;
+	mps->resume_position = resume_position;
+	if (resume_turned_off)
+		delete_position(mps);
 	shuffle = obs_data_get_bool(settings, S_SHUFFLE);
+
+	/* read by mps_save on other threads */
+	pthread_mutex_lock(&mps->mutex);
 	shuffle_changed = mps->shuffle != shuffle;
 	mps->shuffle = shuffle;
 	mps->loop = obs_data_get_bool(settings, S_LOOP);
 	shuffler_set_loop(&mps->shuffler, mps->loop);
+	pthread_mutex_unlock(&mps->mutex);
+	if (shuffle_changed && !shuffle)
+		delete_shuffle_state(mps);
 	new_speed = obs_data_get_int(settings, S_SPEED);
 	if (mps->speed != new_speed) {
-		mps->user_stopped = true;
+		os_atomic_set_bool(&mps->user_stopped, true);
 	}
 	mps->speed = new_speed;
 
+	const struct audio_output_info *aoi = audio_output_get_info(obs_get_audio());
+	pthread_mutex_lock(&mps->audio_mutex);
+	mps->audio_max_frames = (size_t)(obs_data_get_int(settings, S_AUDIO_MAX_LATENCY) * aoi->samples_per_sec / 1000);
+	mps->audio_overflow_policy = obs_data_get_int(settings, S_AUDIO_OVERFLOW_POLICY);
+	mps->loudness_normalize = obs_data_get_bool(settings, S_LOUDNESS_NORMALIZE);
+	mps->loudness_target = (double)obs_data_get_int(settings, S_LOUDNESS_TARGET);
+	pthread_mutex_unlock(&mps->audio_mutex);
+	mps->crossfade_ms = obs_data_get_int(settings, S_CROSSFADE);
+	os_atomic_set_bool(&mps->url_cache, obs_data_get_bool(settings, S_URL_CACHE));
+	if (os_atomic_load_bool(&mps->url_cache))
+		url_cache_set_max_size((uint64_t)obs_data_get_int(settings, S_URL_CACHE_SIZE) * 1024 * 1024);
+
 	/* Internal media source settings */
 	mps->use_hw_decoding = obs_data_get_bool(settings, S_FFMPEG_HW_DECODE);
 	mps->close_when_inactive = obs_data_get_bool(settings, S_FFMPEG_CLOSE_WHEN_INACTIVE);
+	mps->idle_release_ms = obs_data_get_int(settings, S_IDLE_RELEASE) * 1000;
+	decoder_pool_set_max_open(&mps->decoder, (size_t)obs_data_get_int(settings, S_MAX_OPEN_FILES));
+	mps->fast_fail_ms = obs_data_get_int(settings, S_FAST_FAIL) * 1000;
 	if (mps->visibility_behavior == VISIBILITY_BEHAVIOR_ALWAYS_PLAY ||
-	    mps->visibility_behavior == VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE) {
+	    mps->visibility_behavior == VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE ||
+	    mps->visibility_behavior == VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK) {
 		restart_on_activate = false;
 	}
-	obs_data_t *media_source_settings = obs_data_create();
-	obs_data_set_bool(media_source_settings, S_FFMPEG_RESTART_ON_ACTIVATE, restart_on_activate);
-	obs_data_set_bool(media_source_settings, S_FFMPEG_HW_DECODE, mps->use_hw_decoding);
-	obs_data_set_bool(media_source_settings, S_FFMPEG_CLOSE_WHEN_INACTIVE, mps->close_when_inactive);
-	obs_data_set_int(media_source_settings, S_SPEED, mps->speed);
-	obs_source_update(mps->current_media_source, media_source_settings);
-	obs_data_release(media_source_settings);
+	obs_data_t *media_settings = obs_data_create();
+	obs_data_set_bool(media_settings, S_FFMPEG_RESTART_ON_ACTIVATE, restart_on_activate);
+	obs_data_set_bool(media_settings, S_FFMPEG_HW_DECODE, mps->use_hw_decoding);
+	obs_data_set_bool(media_settings, S_FFMPEG_CLOSE_WHEN_INACTIVE, mps->close_when_inactive);
+	obs_data_set_int(media_settings, S_SPEED, mps->speed);
+	post_media_settings(mps, media_settings);
 	mps->state = obs_source_media_get_state(mps->source);
 	if (visibility_behavior_changed && !obs_source_active(mps->source) &&
 	    (mps->state == OBS_MEDIA_STATE_PLAYING || mps->state == OBS_MEDIA_STATE_PAUSED)) {
 		mps_deactivate(mps);
 	}
 
+	/* the playlist is loaded later, see post_load */
+	if (mps->lazy_load != LAZY_LOAD_OFF && !os_atomic_load_bool(&mps->loaded)) {
+		schedule_warm_up(mps);
+		return;
+	}
+	os_atomic_set_bool(&mps->loaded, true);
+
 	array = obs_data_get_array(settings, S_PLAYLIST);
-	count = obs_data_array_count(array);
+	/* files added to the list after the catalog was saved come after its items */
+	use_catalog = open_catalog(mps, settings, &catalog);
+	catalog_items = use_catalog ? catalog_count(&catalog) : 0;
+	count = catalog_items + obs_data_array_count(array);
 
 	if (!mps->first_update && mps->current_media) {
 		old_media_path = mps->current_media->path;
@@ -1233,9 +3145,24 @@ static void mps_update(void *data, obs_data_t *settings)
 	bool found = false;
 	pthread_mutex_lock(&mps->mutex);
 	for (size_t i = 0; i < count; i++) {
-		obs_data_t *item = obs_data_array_item(array, i);
-		const char *path = obs_data_get_string(item, "value");
-		const char *id = obs_data_get_string(item, S_ID);
+		obs_data_t *item = NULL;
+		struct catalog_item entry;
+		bool is_current = false;
+
+		if (i < catalog_items) {
+			catalog_get_item(&catalog, i, &entry);
+		} else {
+			item = obs_data_array_item(array, i - catalog_items);
+			entry.path = obs_data_get_string(item, "value");
+			entry.id = obs_data_get_string(item, S_ID);
+			entry.start_ms = obs_data_get_int(item, S_ITEM_START);
+			entry.end_ms = obs_data_get_int(item, S_ITEM_END);
+			entry.sort = obs_data_get_int(item, S_ITEM_SORT);
+			entry.sort_reverse = obs_data_get_bool(item, S_ITEM_SORT_REVERSE);
+		}
+
+		const char *path = entry.path;
+		const char *id = entry.id;
 
 		if (!path || !*path) {
 			obs_data_release(item);
@@ -1246,19 +3173,39 @@ static void mps_update(void *data, obs_data_t *settings)
 			// check for current_media->id only if media isn't changed, allowing scripts to set the index.
 			mps->current_media_index = i;
 			found = true;
+			is_current = true;
 			if (old_media_path)
 				item_edited = strcmp(old_media_path, path) != 0;
 		}
-		add_file(&new_files.da, path, id);
+		add_file(&new_files.da, path, id, entry.sort, entry.sort_reverse, &mps->stats);
+
+		struct media_file_data *file = da_end(new_files);
+		if (!file->is_folder && !file->is_url && playlist_file_is_supported(path))
+			add_playlist_file(file, &mps->playlist_files, &mps->stats);
+		set_trim_points(file, entry.start_ms, entry.end_ms);
+		if (is_current)
+			trim_edited = file->start_ms != mps->current_media->start_ms ||
+				      file->end_ms != mps->current_media->end_ms;
 		obs_data_release(item);
 	}
 	set_parents(&new_files.da);
+	if (use_catalog)
+		catalog_close(&catalog);
+	playlist_file_cache_trim(&mps->playlist_files);
 
 	if (mps->shuffle) {
-		if (shuffle_changed) {
-			shuffler_reshuffle(&mps->shuffler);
+		/* Continue the shuffle order from the last session */
+		if (mps->first_update)
+			shuffle_restored = load_shuffle_state(mps, &new_files.da);
+
+		if (!shuffle_restored) {
+			if (shuffle_changed) {
+				shuffler_reshuffle(&mps->shuffler);
+			}
+			uint64_t shuffler_start_ts = stats_timer_begin();
+			shuffler_update_files(&mps->shuffler, &new_files.da);
+			stats_timer_end(&mps->stats, STATS_TIMER_SHUFFLER_UPDATE, shuffler_start_ts);
 		}
-		shuffler_update_files(&mps->shuffler, &new_files.da);
 	} else if (shuffle_changed) {
 		bfree(mps->current_media_filename);
 		if (mps->actual_media && mps->actual_media->parent_id)
@@ -1268,9 +3215,6 @@ static void mps_update(void *data, obs_data_t *settings)
 	}
 	old_files.da = mps->files.da;
 	mps->files.da = new_files.da;
-	pthread_mutex_unlock(&mps->mutex);
-
-	free_files(&old_files.da);
 
 	if (found || mps->first_update) {
 		set_current_media_index(mps, mps->current_media_index);
@@ -1299,29 +3243,29 @@ static void mps_update(void *data, obs_data_t *settings)
 				mps_playlist_next(mps);
 			} else {
 				set_current_folder_item_index(mps, mps->current_folder_item_index);
-				if (mps->shuffle)
+				if (mps->shuffle && !(shuffle_restored &&
+						      shuffler_peek_current(&mps->shuffler) == mps->actual_media))
 					shuffler_select(&mps->shuffler, mps->actual_media);
 			}
 		} else {
 			mps->actual_media = mps->current_media;
-			if (mps->shuffle)
+			if (mps->shuffle &&
+			    !(shuffle_restored && shuffler_peek_current(&mps->shuffler) == mps->actual_media))
 				shuffler_select(&mps->shuffler, mps->actual_media);
 		}
 
-		if (mps->first_update || !found || item_edited) {
-			/* Clear if last file is a folder and is empty */
-			if (mps->current_media->is_folder && mps->current_media->folder_items.num == 0) {
-				clear_media_source(mps);
-			} else {
-				update_media_source(mps, true);
-			}
+		if (mps->first_update || !found || item_edited || trim_edited) {
+			/* Cleared by the navigation thread if last file is a folder and is empty */
+			if (!mps->current_media->is_folder || mps->current_media->folder_items.num)
+				update_media_source(mps);
+			post_open(mps, mps->first_update && mps->resume_position);
 		}
 	} else if (!mps->first_update) {
 		bfree(mps->current_media_filename);
 		mps->current_media_filename = NULL;
-		clear_media_source(mps);
+		post_open(mps, false);
 	}
-	obs_source_save(mps->source);
+	prefetch_upcoming_urls(mps);
 
 	/* So Current File Name is updated */
 	update_current_filename_setting(mps, settings);
@@ -1339,22 +3283,67 @@ static void mps_update(void *data, obs_data_t *settings)
 	//}
 	obs_data_array_release(array);
 	mps->first_update = false;
+	pthread_mutex_unlock(&mps->mutex);
+
+	/* Old files can only be freed once no snapshot points to them */
+	publish_snapshot(mps);
+	free_files(&old_files.da);
+	obs_source_save(mps->source); // mps_save takes `mutex`
+
+	stats_timer_end(&mps->stats, STATS_TIMER_UPDATE, start_ts);
 }
 
 static void mps_save(void *data, obs_data_t *settings)
 {
 	struct media_playlist_source *mps = data;
+
+	/* keep the saved position until the playlist is loaded */
+	if (!os_atomic_load_bool(&mps->loaded))
+		return;
+
+	pthread_mutex_lock(&mps->mutex);
 	obs_data_set_int(settings, S_CURRENT_MEDIA_INDEX, mps->current_media_index);
 	obs_data_set_string(settings, S_CURRENT_FOLDER_ITEM_FILENAME, mps->current_media_filename);
+	pthread_mutex_unlock(&mps->mutex);
 	update_current_filename_setting(mps, settings);
+	save_shuffle_state(mps);
 }
 
-static void mps_load(void *data, obs_data_t *settings)
+/* Writes the catalog in `settings` again, with `orig_path` replaced by
+ * `new_path`, or removed if it is empty */
+static void replace_catalog_file(struct media_playlist_source *mps, obs_data_t *settings, const char *orig_path,
+				 const char *new_path)
 {
-	struct media_playlist_source *mps = data;
-	mps->current_media_index = obs_data_get_int(settings, S_CURRENT_MEDIA_INDEX);
-	if (mps->files.num)
-		obs_log(LOG_DEBUG, "%s", mps->files.array[mps->current_media_index].id);
+	DARRAY(struct catalog_item) items;
+	struct catalog catalog;
+
+	if (!open_catalog(mps, settings, &catalog))
+		return;
+
+	da_init(items);
+	for (size_t i = 0; i < catalog_count(&catalog); i++) {
+		struct catalog_item entry;
+		catalog_get_item(&catalog, i, &entry);
+		if (strcmp(entry.path, orig_path) == 0) {
+			if (!new_path || !*new_path)
+				continue;
+			entry.path = new_path;
+		}
+
+		struct catalog_item *item = da_push_back_new(items);
+		*item = entry;
+		item->path = bstrdup(entry.path);
+		item->id = bstrdup(entry.id);
+	}
+	catalog_close(&catalog);
+
+	char *path = bstrdup(obs_data_get_string(settings, S_CATALOG));
+	if (!write_catalog(path, items.array, items.num, settings))
+		obs_log(LOG_WARNING, "[%s] Failed to write playlist catalog %s", obs_source_get_name(mps->source),
+			path);
+	bfree(path);
+	free_catalog_items(items.array, items.num);
+	da_free(items);
 }
 
 static void missing_file_callback(void *src, const char *new_path, void *data)
@@ -1367,7 +3356,8 @@ static void missing_file_callback(void *src, const char *new_path, void *data)
 	obs_data_array_t *files = obs_data_get_array(settings, S_PLAYLIST);
 
 	size_t l = obs_data_array_count(files);
-	for (size_t i = 0; i < l; i++) {
+	size_t i = 0;
+	for (; i < l; i++) {
 		obs_data_t *file = obs_data_array_item(files, i);
 		const char *path = obs_data_get_string(file, "value");
 
@@ -1384,12 +3374,28 @@ static void missing_file_callback(void *src, const char *new_path, void *data)
 		obs_data_release(file);
 	}
 
+	/* the catalog is written again, with the file replaced or removed */
+	if (i == l && *obs_data_get_string(settings, S_CATALOG))
+		replace_catalog_file(mps, settings, orig_path, new_path);
 	obs_source_update(source, settings);
 
 	obs_data_array_release(files);
 	obs_data_release(settings);
 }
 
+static void missing_catalog_callback(void *src, const char *new_path, void *data)
+{
+	UNUSED_PARAMETER(data);
+	struct media_playlist_source *mps = src;
+	obs_data_t *settings = obs_source_get_settings(mps->source);
+
+	obs_data_set_string(settings, S_CATALOG, new_path ? new_path : "");
+	if (!new_path || !*new_path)
+		obs_data_set_string(settings, S_CATALOG_CHECKSUM, "");
+	obs_source_update(mps->source, settings);
+	obs_data_release(settings);
+}
+
 static obs_missing_files_t *mps_missingfiles(void *data)
 {
 	struct media_playlist_source *mps = data;
@@ -1398,24 +3404,68 @@ static obs_missing_files_t *mps_missingfiles(void *data)
 	obs_source_t *source = mps->source;
 	obs_data_t *settings = obs_source_get_settings(source);
 	obs_data_array_t *files = obs_data_get_array(settings, S_PLAYLIST);
+	DARRAY(const char *) paths;
+	enum path_status *statuses;
+	size_t unknown = 0;
 
+	/* the strings stay in the settings */
+	da_init(paths);
 	size_t l = obs_data_array_count(files);
 	for (size_t i = 0; i < l; i++) {
 		obs_data_t *item = obs_data_array_item(files, i);
 		const char *path = obs_data_get_string(item, "value");
 
-		if (strcmp(path, "") != 0) {
-			if (!os_file_exists(path) && strstr(path, "://") == NULL) {
-				obs_missing_file_t *file = obs_missing_file_create(
-					path, missing_file_callback, OBS_MISSING_FILE_SOURCE, source, (void *)path);
+		if (strcmp(path, "") != 0 && strstr(path, "://") == NULL)
+			da_push_back(paths, &path);
+
+		obs_data_release(item);
+	}
 
-				obs_missing_files_add_file(missing_files, file);
+	/* the catalog is unmapped, so its paths are kept until the next call */
+	const char *catalog_path = obs_data_get_string(settings, S_CATALOG);
+	struct catalog catalog;
+	for (size_t i = 0; i < mps->missing_catalog_paths.num; i++)
+		bfree(mps->missing_catalog_paths.array[i]);
+	mps->missing_catalog_paths.num = 0;
+	if (*catalog_path && !os_file_exists(catalog_path)) {
+		obs_missing_file_t *file = obs_missing_file_create(catalog_path, missing_catalog_callback,
+								   OBS_MISSING_FILE_SOURCE, source, NULL);
+		obs_missing_files_add_file(missing_files, file);
+	} else if (open_catalog(mps, settings, &catalog)) {
+		for (size_t i = 0; i < catalog_count(&catalog); i++) {
+			struct catalog_item entry;
+			catalog_get_item(&catalog, i, &entry);
+			if (*entry.path && strstr(entry.path, "://") == NULL) {
+				char *path = bstrdup(entry.path);
+				da_push_back(mps->missing_catalog_paths, &path);
 			}
 		}
+		catalog_close(&catalog);
+		for (size_t i = 0; i < mps->missing_catalog_paths.num; i++) {
+			const char *path = mps->missing_catalog_paths.array[i];
+			da_push_back(paths, &path);
+		}
+	}
 
-		obs_data_release(item);
+	statuses = paths.num ? bmalloc(paths.num * sizeof(*statuses)) : NULL;
+	path_check_batch(paths.array, paths.num, statuses, MISSING_FILES_TIMEOUT_MS);
+	for (size_t i = 0; i < paths.num; i++) {
+		if (statuses[i] == PATH_STATUS_UNKNOWN) {
+			unknown++;
+		} else if (statuses[i] == PATH_STATUS_MISSING) {
+			obs_missing_file_t *file = obs_missing_file_create(paths.array[i], missing_file_callback,
+									   OBS_MISSING_FILE_SOURCE, source,
+									   (void *)paths.array[i]);
+
+			obs_missing_files_add_file(missing_files, file);
+		}
 	}
+	if (unknown)
+		obs_log(LOG_WARNING, "[%s] %zu files could not be checked in time, they are not shown as missing",
+			obs_source_get_name(source), unknown);
 
+	bfree(statuses);
+	da_free(paths);
 	obs_data_array_release(files);
 	obs_data_release(settings);
 
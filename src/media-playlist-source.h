@@ -27,6 +27,17 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #include <plugin-support.h>
 #include "playlist.h"
 #include "shuffler.h"
+#include "stats.h"
+#include "audio-remap.h"
+#include "loudness.h"
+#include "playlist-file.h"
+#include "catalog.h"
+#include "url-cache.h"
+#include "path-check.h"
+#include "decoder-pool.h"
+#include "duration-cache.h"
+#include "folder-sort.h"
+#include "quarantine.h"
 
 /* clang-format off */
 
@@ -35,6 +46,7 @@ enum visibility_behavior {
 	VISIBILITY_BEHAVIOR_PAUSE_UNPAUSE,
 	VISIBILITY_BEHAVIOR_ALWAYS_PLAY,
 	VISIBILITY_BEHAVIOR_STOP_PLAY_NEXT,
+	VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK,
 };
 
 enum restart_behavior {
@@ -42,17 +54,91 @@ enum restart_behavior {
 	RESTART_BEHAVIOR_FIRST_FILE,
 };
 
+enum lazy_load {
+	LAZY_LOAD_OFF,
+	LAZY_LOAD_WHEN_SHOWN,
+	LAZY_LOAD_IN_BACKGROUND, // or when shown, if that comes first
+};
+
+enum audio_overflow_policy {
+	AUDIO_OVERFLOW_DROP_OLDEST,
+	AUDIO_OVERFLOW_DROP_NEWEST,
+};
+
 /* clang-format on */
 
+/* Navigation posted since the navigation thread last ran. Steps are added
+ * up, so that pressing Next ten times only opens the final file. A select or
+ * the end of the playlist replaces what was posted before it.
+ */
+struct nav_request {
+	bool end_reached;
+	bool select;
+	size_t media_index;
+	size_t folder_item_index;
+	long long steps;
+	bool crossfade; // the steps should overlap the playing file, see start_crossfade
+	bool release;   // close the file of a hidden source, see release_media_source
+	bool evict;     // with `release`, close it even if shown in the preview
+	bool reopen;    // open it again where it was
+	bool catch_up;  // skip the time the source was hidden, see catch_up_playlist
+	bool load;      // load the playlist of a lazy source, see post_load
+	bool save_position; // journal where the file is, see save_position
+	bool open;          // open the current file again, see post_open
+	bool resume;        // with `open`, seek to the journaled position, see seek_to_saved_position
+	bool restart;       // restart the open file, see post_restart
+	obs_data_t *media_settings; // settings to apply to the internal media source, see post_media_settings
+	bool fast_fail;     // the file opened at `fast_fail_open` didn't start, see check_fast_fail
+	long fast_fail_open;
+	int64_t catch_up_ms;
+};
+
+/* Loudness of a file, sent along with the marker of where it was opened */
+struct file_loudness {
+	char *path; // file to measure, NULL if the loudness is known
+	int64_t mtime;
+	double lufs; // NAN if not known yet
+};
+
+/* A packet from the internal media source. The channel count is read when the
+ * packet is queued, as the output layout may change before it is relayed.
+ */
+struct audio_packet {
+	uint64_t timestamp;
+	uint32_t frames;
+	uint32_t channels;
+	bool fade_in; // sent while a crossfade was on, so it is the incoming file
+
+	/* Markers without audio, where a file started or ended in the stream */
+	struct file_loudness *file_opened; // owned by the packet
+	bool file_ended;
+};
+
+/* What the render and UI threads need to know about the playlist. Files are
+ * not copied, so old files must only be freed after the snapshot that still
+ * points to them is no longer read (see publish_snapshot).
+ */
+struct playlist_snapshot {
+	DARRAY(struct media_file_data) files;
+	struct media_file_data *actual_media;
+	size_t current_media_index;
+	size_t total_file_count;
+};
+
 struct media_playlist_source {
 	obs_source_t *source;
-	obs_source_t *current_media_source;
+
+	/* The internal media sources live as long as the source, so any thread
+	 * can use them without a reference. The current file plays in the one
+	 * at `current_child`, and the other one plays out a crossfade. */
+	obs_source_t *media_sources[2];
+	volatile long current_child; // only changed by the navigation thread, with `audio_mutex`
 
 	struct shuffler shuffler;
 	bool shuffle;
 	bool loop;
 	bool paused;
-	bool user_stopped;
+	volatile bool user_stopped; // set by the UI and navigation threads, read by media signals
 	bool use_hw_decoding;
 	bool close_when_inactive;
 	pthread_mutex_t mutex;
@@ -65,6 +151,22 @@ struct media_playlist_source {
 	size_t current_folder_item_index;
 	long long speed;
 	bool first_update;
+	struct playlist_file_cache playlist_files; // with `mutex`
+	volatile bool url_cache;
+	volatile bool catalog_error;      // the catalog in the settings could not be used, see open_catalog
+	DARRAY(char *) missing_catalog_paths; // reported by mps_missingfiles, which only gets them from the catalog
+
+	struct playlist_snapshot snapshots[2];
+	volatile long snapshot_idx;
+	volatile long snapshot_readers[2];
+	pthread_mutex_t snapshot_mutex; // only between writers
+
+	pthread_t nav_thread;
+	bool nav_thread_active;
+	volatile bool nav_stop;
+	os_event_t *nav_event;
+	pthread_mutex_t nav_mutex;
+	struct nav_request nav_request;
 
 	obs_hotkey_id play_pause_hotkey;
 	obs_hotkey_id restart_hotkey;
@@ -77,32 +179,126 @@ struct media_playlist_source {
 	enum restart_behavior restart_behavior;
 
 	struct deque audio_data[MAX_AUDIO_CHANNELS];
-	struct deque audio_frames;
-	struct deque audio_timestamps;
-	size_t num_channels;
+	struct deque audio_packets; // struct audio_packet
+	float *audio_buf;           // planes of a popped packet, then of it remapped
+	size_t audio_buf_frames;
+	struct audio_remap audio_remap;
+	size_t audio_queued_frames;
+	size_t audio_max_frames; // from the max latency setting
+	enum audio_overflow_policy audio_overflow_policy;
+	uint64_t audio_next_ts; // where the last relayed packet ended
 	pthread_mutex_t audio_mutex;
+
+	/* In and out points of the open file, 0 if it is not trimmed. Set when
+	 * it is opened, and read by the video and audio threads. */
+	volatile long trim_start_ms;
+	volatile long trim_end_ms;
+	volatile bool trim_seeking;         // not at `trim_seek_ms` yet, so nothing is shown or relayed
+	volatile long trim_seek_ms;         // the in-point, or the position the file resumed at
+	volatile long trim_end_posted_open; // media_open_count when the out-point was reached
+
+	/* Crossfade. The outgoing file keeps playing in `fade_media_source`
+	 * while the next one is opened in the other internal media source. */
+	int64_t crossfade_ms;
+	volatile long media_open_count;
+	long crossfade_posted_open; // media_open_count when the crossfade was posted, only used by the video thread
+	volatile bool crossfade_pending;
+	volatile bool fade_cancel;
+	obs_source_t *fade_media_source; // set with `audio_mutex`, closed by the video thread
+	volatile bool fade_closing;      // the video thread is still closing the outgoing file
+	struct deque fade_audio_data[MAX_AUDIO_CHANNELS];
+	size_t fade_channels;
+	size_t fade_queued_frames;
+	size_t fade_frames; // length of the ramps
+	size_t fade_pos;    // frames of the incoming file mixed so far
+	uint64_t fade_start_ts;
+	float *fade_buf;
+	size_t fade_buf_frames;
+	float fade_gain; // loudness gain of the outgoing file
+
+	/* A source hidden for `idle_release_ms` closes its file, and opens it
+	 * again where it was when it is shown, even if only in the preview. */
+	long long idle_release_ms;
+	uint64_t hidden_ts; // only used by the video thread, 0 while shown
+	volatile bool idle_released;
+	int64_t idle_time_ms; // where the file was when it was closed
+	struct decoder_pool_entry decoder; // the file may also be closed for the pool, see check_decoder_pool
+
+	/* With lazy loading, mps_update only reads the settings until the playlist
+	 * is loaded, when the source is first shown or at `warm_ts` (with
+	 * `nav_mutex`). */
+	enum lazy_load lazy_load;
+	volatile bool loaded;
+	uint64_t warm_ts;
+
+	/* Where the file is, is journaled to a file of its own every
+	 * POSITION_JOURNAL_INTERVAL_NS while playing, and the first update seeks
+	 * there, see seek_to_saved_position. */
+	bool resume_position;
+	uint64_t last_journal_ts; // only used by the video thread
+
+	/* A file that shows no frame and sends no audio within `fast_fail_ms` of
+	 * being opened is quarantined and skipped, see check_fast_fail. */
+	long long fast_fail_ms;
+	volatile bool media_started;
+	long fast_fail_open;   // media_open_count being watched, only used by the video thread
+	uint64_t fast_fail_ts; // when it started waiting, only used by the video thread
+	long open_ticks;       // video ticks since `fast_fail_open` changed, up to 2, see media_has_frame
+
+	/* With VISIBILITY_BEHAVIOR_VIRTUAL_CLOCK, when the source was deactivated,
+	 * 0 while active */
+	uint64_t deactivated_ts;
+
+	/* Loudness normalization, with `audio_mutex` */
+	bool loudness_normalize;
+	double loudness_target;
+	double loudness_lufs;        // of the file being relayed, NAN if not known yet
+	float loudness_applied_gain; // where the last packet's ramp ended
+	struct loudness_analyzer loudness;
+
+	struct mps_stats stats;
 };
 
 static const char *media_filter =
 	" (*.mp4 *.mpg *.m4v *.ts *.mov *.mxf *.flv *.mkv *.avi *.gif *.webm *.mp3 *.m4a *.ogg *.aac *.wav *.opus *.flac);;";
 static const char *video_filter = " (*.mp4 *.mpg *.m4v *.ts *.mov *.mxf *.flv *.mkv *.avi *.gif *.webm);;";
 static const char *audio_filter = " (*.mp3 *.m4a *.mka *.aac *.ogg *.wav *.opus *.flac);;";
+static const char *playlist_filter = " (*.m3u *.m3u8 *.pls *.xspf);;";
 
 static void set_current_media_index(struct media_playlist_source *mps, size_t index);
 static size_t get_total_file_count(struct media_playlist_source *mps);
 
 static inline void reset_folder_item_index(struct media_playlist_source *mps);
+static inline obs_source_t *get_current_media_source(struct media_playlist_source *mps);
+
+static void publish_snapshot(struct media_playlist_source *mps);
+static const struct playlist_snapshot *snapshot_acquire(struct media_playlist_source *mps, long *idx);
+static void snapshot_release(struct media_playlist_source *mps, long idx);
 
 static bool valid_extension(const char *ext);
 
 static void clear_media_source(void *data);
-static void update_media_source(void *data, bool forced);
+static void update_media_source(void *data);
+static void open_media_source(struct media_playlist_source *mps, const char *path, bool is_url, int64_t start_ms,
+			      int64_t end_ms);
+
+static void prefetch_upcoming_urls(struct media_playlist_source *mps);
 
 static void select_index_proc_(struct media_playlist_source *mps, size_t media_index, size_t folder_item_index);
 
 static void select_index_proc(void *data, calldata_t *cd);
-static void play_folder_item_at_index(void *data, size_t index);
-static void play_media_at_index(void *data, size_t index, bool play_last_folder_item);
+static void get_upcoming_media(struct media_playlist_source *mps, size_t count, struct darray *out);
+static void peek_upcoming_proc(void *data, calldata_t *cd);
+static void get_stats_proc(void *data, calldata_t *cd);
+static void export_trace_proc(void *data, calldata_t *cd);
+static void save_catalog_proc(void *data, calldata_t *cd);
+static void free_catalog_items(struct catalog_item *items, size_t count);
+static bool write_catalog(const char *path, const struct catalog_item *items, size_t count, obs_data_t *settings);
+
+static char *get_shuffle_state_path(struct media_playlist_source *mps);
+static void save_shuffle_state(struct media_playlist_source *mps);
+static bool load_shuffle_state(struct media_playlist_source *mps, struct darray *files);
+static void delete_shuffle_state(struct media_playlist_source *mps);
 
 static size_t find_folder_item_index(struct darray *array, const char *filename);
 
@@ -112,6 +308,7 @@ static enum obs_media_state mps_get_state(void *data);
 static void mps_end_reached(void *data);
 
 static void media_source_ended(void *data, calldata_t *cd);
+static void drop_oldest_audio(struct media_playlist_source *mps);
 void mps_audio_callback(void *data, obs_source_t *source, const struct audio_data *audio_data, bool muted);
 static bool play_selected_clicked(obs_properties_t *props, obs_property_t *property, void *data);
 
@@ -128,12 +325,41 @@ static void mps_set_time(void *data, int64_t ms);
 static void mps_play_pause(void *data, bool pause);
 static void mps_restart(void *data);
 static void mps_stop(void *data);
+static void set_current_from_actual_media(struct media_playlist_source *mps);
+static bool step_next(struct media_playlist_source *mps);
+static bool step_prev(struct media_playlist_source *mps);
+static void post_navigation(struct media_playlist_source *mps, long long steps);
+static void process_navigation(struct media_playlist_source *mps, const struct nav_request *request);
+static void *navigation_thread(void *data);
 static void mps_playlist_next(void *data);
 static void mps_playlist_prev(void *data);
 static void mps_activate(void *data);
 static void mps_deactivate(void *data);
+static void mps_show(void *data);
+static void post_idle_request(struct media_playlist_source *mps, bool release, bool evict);
+static void release_media_source(struct media_playlist_source *mps, bool evict);
+static void reopen_media_source(struct media_playlist_source *mps);
+static void check_idle(struct media_playlist_source *mps);
+static void check_decoder_pool(struct media_playlist_source *mps);
+static void remember_duration(struct media_playlist_source *mps);
+static void post_load(struct media_playlist_source *mps);
+static void schedule_warm_up(struct media_playlist_source *mps);
+static void post_open(struct media_playlist_source *mps, bool resume);
+static void post_restart(struct media_playlist_source *mps);
+static void post_media_settings(struct media_playlist_source *mps, obs_data_t *settings);
+static void apply_media_settings(struct media_playlist_source *mps, obs_data_t *settings);
+static void save_position(struct media_playlist_source *mps);
+static void delete_position(struct media_playlist_source *mps);
+static void check_position_journal(struct media_playlist_source *mps);
+static bool is_quarantined(const struct media_file_data *media);
+static bool step_playable(struct media_playlist_source *mps, bool forward);
+static bool media_has_frame(struct media_playlist_source *mps, obs_source_t *media_source);
+static void check_fast_fail(struct media_playlist_source *mps);
+static bool catch_up_playlist(struct media_playlist_source *mps, int64_t time_ms, int64_t elapsed_ms, int64_t *seek_ms);
+static void preroll_proc(void *data, calldata_t *cd);
 static void *mps_create(obs_data_t *settings, obs_source_t *source);
 static void mps_destroy(void *data);
+static void mps_removed(void *data, calldata_t *cd);
 static void mps_video_render(void *data, gs_effect_t *effect);
 static bool mps_audio_render(void *data, uint64_t *ts_out, struct obs_source_audio_mix *audio_output, uint32_t mixers,
 			     size_t channels, size_t sample_rate);
@@ -146,12 +372,15 @@ static void update_current_filename_property(struct media_playlist_source *mps,
 static obs_properties_t *mps_properties(void *data);
 static void mps_update(void *data, obs_data_t *settings);
 static void mps_save(void *data, obs_data_t *settings);
-static void mps_load(void *data, obs_data_t *settings);
 static void missing_file_callback(void *src, const char *new_path, void *data);
+static void missing_catalog_callback(void *src, const char *new_path, void *data);
+static void replace_catalog_file(struct media_playlist_source *mps, obs_data_t *settings, const char *orig_path,
+				 const char *new_path);
 static obs_missing_files_t *mps_missingfiles(void *data);
 
 static void set_parents(struct darray *array);
-static void add_file(struct darray *array, const char *path, const char *id);
+static void add_file(struct darray *array, const char *path, const char *id, enum folder_sort sort, bool sort_reverse,
+		     struct mps_stats *stats);
 static void free_files(struct darray *array);
 
 struct obs_source_info media_playlist_source_info = {
@@ -163,9 +392,9 @@ struct obs_source_info media_playlist_source_info = {
 	.destroy = mps_destroy,
 	.update = mps_update,
 	.save = mps_save,
-	//.load = mps_load,
 	.activate = mps_activate,
 	.deactivate = mps_deactivate,
+	.show = mps_show,
 	.video_render = mps_video_render,
 	.video_tick = mps_video_tick,
 	//.audio_render = mps_audio_render,
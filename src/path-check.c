@@ -0,0 +1,306 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <string.h>
+#include <sys/stat.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "path-check.h"
+
+#define INITIAL_BUCKETS 1024
+
+struct path_entry {
+	char *path;
+	uint64_t hash;
+	enum path_status status;
+	uint64_t checked_ts;
+	bool queued;
+	size_t next; // in the same bucket
+};
+
+/* A thread stuck in a stat is never joined. It is abandoned, and frees its
+ * own worker once the stat returns. Its result is only kept if the results
+ * were not freed meanwhile, see `generation`. */
+struct worker {
+	pthread_t thread;
+	uint64_t stat_ts; // when the current stat started, 0 if there is none
+	bool abandoned;
+	long generation;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct path_entry) entries;
+static DARRAY(size_t) buckets; // first entry of each bucket
+static DARRAY(size_t) queue;
+static size_t queue_pos;
+static long generation = 0; // bumped by path_check_free
+
+static struct worker *workers[PATH_CHECK_THREADS];
+static size_t thread_count = 0;
+static size_t abandoned_count = 0;
+static os_event_t *work_event = NULL;
+static os_event_t *result_event = NULL;
+static volatile bool stop = false;
+
+static uint64_t hash_path(const char *path)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (const char *c = path; *c; c++) {
+		hash ^= (uint8_t)*c;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/* Requires `mutex` */
+static void rehash(size_t bucket_count)
+{
+	da_resize(buckets, bucket_count);
+	for (size_t i = 0; i < bucket_count; i++)
+		buckets.array[i] = DARRAY_INVALID;
+	for (size_t i = 0; i < entries.num; i++) {
+		size_t *first = &buckets.array[entries.array[i].hash & (bucket_count - 1)];
+		entries.array[i].next = *first;
+		*first = i;
+	}
+}
+
+/* Requires `mutex` */
+static size_t find_or_add(const char *path)
+{
+	uint64_t hash = hash_path(path);
+
+	if (!buckets.num)
+		rehash(INITIAL_BUCKETS);
+	for (size_t i = buckets.array[hash & (buckets.num - 1)]; i != DARRAY_INVALID; i = entries.array[i].next) {
+		if (entries.array[i].hash == hash && strcmp(entries.array[i].path, path) == 0)
+			return i;
+	}
+
+	struct path_entry *entry = da_push_back_new(entries);
+	entry->path = bstrdup(path);
+	entry->hash = hash;
+	if (entries.num > buckets.num) {
+		rehash(buckets.num * 2);
+	} else {
+		size_t *first = &buckets.array[hash & (buckets.num - 1)];
+		entry->next = *first;
+		*first = entries.num - 1;
+	}
+	return entries.num - 1;
+}
+
+static enum path_status check_path(const char *path)
+{
+	struct stat st;
+	if (os_stat(path, &st) != 0)
+		return PATH_STATUS_MISSING;
+	return (st.st_mode & S_IFMT) == S_IFDIR ? PATH_STATUS_DIRECTORY : PATH_STATUS_FILE;
+}
+
+static void *check_thread(void *data)
+{
+	struct worker *worker = data;
+	os_set_thread_name("media-playlist-source: path check");
+
+	while (os_event_wait(work_event) == 0 && !os_atomic_load_bool(&stop)) {
+		while (!os_atomic_load_bool(&stop)) {
+			pthread_mutex_lock(&mutex);
+			if (queue_pos == queue.num || os_atomic_load_bool(&stop)) {
+				pthread_mutex_unlock(&mutex);
+				break;
+			}
+			size_t idx = queue.array[queue_pos++];
+			if (queue_pos == queue.num) {
+				da_resize(queue, 0);
+				queue_pos = 0;
+			} else {
+				os_event_signal(work_event); // for another thread
+			}
+			char *path = bstrdup(entries.array[idx].path);
+			worker->stat_ts = os_gettime_ns();
+			pthread_mutex_unlock(&mutex);
+
+			enum path_status status = check_path(path);
+			bfree(path);
+
+			pthread_mutex_lock(&mutex);
+			worker->stat_ts = 0;
+			bool abandoned = worker->abandoned;
+			if (worker->generation == generation) {
+				entries.array[idx].status = status;
+				entries.array[idx].checked_ts = os_gettime_ns();
+				entries.array[idx].queued = false;
+				os_event_signal(result_event);
+			}
+			if (abandoned)
+				abandoned_count--;
+			pthread_mutex_unlock(&mutex);
+
+			/* it was replaced, and the events may be gone */
+			if (abandoned) {
+				bfree(worker);
+				return NULL;
+			}
+		}
+	}
+
+	os_event_signal(work_event); // so the other threads stop too
+	return NULL;
+}
+
+/* Requires `mutex` */
+static struct worker *start_worker(void)
+{
+	struct worker *worker = bzalloc(sizeof(*worker));
+	worker->generation = generation;
+	if (pthread_create(&worker->thread, NULL, check_thread, worker) != 0) {
+		bfree(worker);
+		return NULL;
+	}
+	return worker;
+}
+
+/* Requires `mutex`. The worker frees itself when its stat returns. */
+static void abandon_worker(struct worker *worker)
+{
+	worker->abandoned = true;
+	pthread_detach(worker->thread);
+	abandoned_count++;
+}
+
+/* Requires `mutex` */
+static bool start_threads(void)
+{
+	if (thread_count)
+		return true;
+	if (!work_event && os_event_init(&work_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+	if (!result_event && os_event_init(&result_event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+
+	while (thread_count < PATH_CHECK_THREADS && (workers[thread_count] = start_worker()) != NULL)
+		thread_count++;
+	return thread_count > 0;
+}
+
+/* Replaces the threads that have been in a stat for `timeout_ns`, so a share
+ * that doesn't answer can't take up the whole pool. Requires `mutex`.
+ */
+static void replace_stuck_workers(uint64_t now, uint64_t timeout_ns)
+{
+	for (size_t i = 0; i < thread_count; i++) {
+		struct worker *worker = workers[i];
+		if (!worker->stat_ts || now - worker->stat_ts < timeout_ns ||
+		    abandoned_count >= PATH_CHECK_MAX_ABANDONED)
+			continue;
+
+		struct worker *replacement = start_worker();
+		if (!replacement)
+			return;
+		abandon_worker(worker);
+		workers[i] = replacement;
+	}
+}
+
+void path_check_batch(const char **paths, size_t count, enum path_status *statuses, unsigned long timeout_ms)
+{
+	if (!count)
+		return;
+
+	uint64_t now = os_gettime_ns();
+	uint64_t deadline = now + (uint64_t)timeout_ms * 1000000ULL;
+	size_t *indices = bmalloc(count * sizeof(*indices));
+	bool queued = false;
+
+	pthread_mutex_lock(&mutex);
+	bool started = start_threads();
+	for (size_t i = 0; i < count; i++) {
+		indices[i] = find_or_add(paths[i]);
+		struct path_entry *entry = &entries.array[indices[i]];
+		if (started && !entry->queued && (!entry->checked_ts || now - entry->checked_ts > PATH_CHECK_TTL_NS)) {
+			entry->queued = true;
+			da_push_back(queue, &indices[i]);
+			queued = true;
+		}
+	}
+	pthread_mutex_unlock(&mutex);
+	if (queued)
+		os_event_signal(work_event);
+
+	while (true) {
+		bool pending = false;
+		pthread_mutex_lock(&mutex);
+		for (size_t i = 0; i < count; i++) {
+			statuses[i] = entries.array[indices[i]].status;
+			pending = pending || entries.array[indices[i]].queued;
+		}
+		pthread_mutex_unlock(&mutex);
+
+		now = os_gettime_ns();
+		if (!pending || now >= deadline)
+			break;
+		os_event_timedwait(result_event, (unsigned long)((deadline - now + 999999) / 1000000));
+	}
+
+	pthread_mutex_lock(&mutex);
+	replace_stuck_workers(os_gettime_ns(), (uint64_t)timeout_ms * 1000000ULL);
+	pthread_mutex_unlock(&mutex);
+
+	bfree(indices);
+}
+
+void path_check_free(void)
+{
+	struct worker *idle[PATH_CHECK_THREADS];
+	size_t idle_count = 0;
+
+	/* threads still in a stat are left to finish it on their own */
+	pthread_mutex_lock(&mutex);
+	generation++;
+	os_atomic_set_bool(&stop, true);
+	for (size_t i = 0; i < thread_count; i++) {
+		if (workers[i]->stat_ts)
+			abandon_worker(workers[i]);
+		else
+			idle[idle_count++] = workers[i];
+	}
+	thread_count = 0;
+	pthread_mutex_unlock(&mutex);
+
+	if (idle_count) {
+		os_event_signal(work_event);
+		for (size_t i = 0; i < idle_count; i++) {
+			pthread_join(idle[i]->thread, NULL);
+			bfree(idle[i]);
+		}
+	}
+	os_event_destroy(work_event);
+	os_event_destroy(result_event);
+	work_event = NULL;
+	result_event = NULL;
+	os_atomic_set_bool(&stop, false);
+
+	for (size_t i = 0; i < entries.num; i++)
+		bfree(entries.array[i].path);
+	da_free(entries);
+	da_free(buckets);
+	da_free(queue);
+	queue_pos = 0;
+}
@@ -0,0 +1,48 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+
+/* Whether paths exist, checked on a few threads of their own so a network
+ * share that doesn't answer only holds up the paths on it. Results are shared
+ * by all sources, and are checked again once they are PATH_CHECK_TTL_NS old.
+ */
+#define PATH_CHECK_THREADS 8
+#define PATH_CHECK_TTL_NS 30000000000ULL
+#define PATH_CHECK_MAX_ABANDONED 64 // threads stuck in a stat that were replaced
+
+enum path_status {
+	PATH_STATUS_UNKNOWN, // not checked yet
+	PATH_STATUS_MISSING,
+	PATH_STATUS_FILE,
+	PATH_STATUS_DIRECTORY,
+};
+
+/* Checks the paths in parallel, and waits up to `timeout_ms` for them. Paths
+ * that are still being checked then get their last known status, and the
+ * result is kept for the next call. A thread that was stuck for all of
+ * `timeout_ms` is replaced. Only meant to be called by one thread at a time,
+ * like the UI thread.
+ */
+extern void path_check_batch(const char **paths, size_t count, enum path_status *statuses, unsigned long timeout_ms);
+
+/* Forgets all results. Checks in progress are not waited for, so a share that
+ * doesn't answer can't hold up shutdown. */
+extern void path_check_free(void);
@@ -0,0 +1,332 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <ctype.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include "mapped-file.h"
+#include "playlist-file.h"
+
+enum playlist_format {
+	FORMAT_NONE,
+	FORMAT_M3U,
+	FORMAT_PLS,
+	FORMAT_XSPF,
+};
+
+static enum playlist_format get_format(const char *path)
+{
+	const char *ext = os_get_path_extension(path);
+	if (!ext)
+		return FORMAT_NONE;
+	if (astrcmpi(ext, ".m3u") == 0 || astrcmpi(ext, ".m3u8") == 0)
+		return FORMAT_M3U;
+	if (astrcmpi(ext, ".pls") == 0)
+		return FORMAT_PLS;
+	if (astrcmpi(ext, ".xspf") == 0)
+		return FORMAT_XSPF;
+	return FORMAT_NONE;
+}
+
+bool playlist_file_is_supported(const char *path)
+{
+	return get_format(path) != FORMAT_NONE;
+}
+
+void playlist_entries_free(struct playlist_entries *entries)
+{
+	da_free(entries->buf);
+	da_free(entries->offsets);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Parsing */
+
+struct parser {
+	const char *dir; // of the playlist file, with a trailing slash
+	struct playlist_entries *entries;
+	struct dstr value;
+};
+
+static inline int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+static void percent_decode(struct dstr *str)
+{
+	char *out = str->array;
+	for (const char *in = str->array; *in; in++) {
+		int hi, lo;
+		if (in[0] == '%' && (hi = hex_value(in[1])) >= 0 && (lo = hex_value(in[2])) >= 0) {
+			*out++ = (char)(hi << 4 | lo);
+			in += 2;
+		} else {
+			*out++ = *in;
+		}
+	}
+	*out = 0;
+	str->len = out - str->array;
+}
+
+static void xml_decode(struct dstr *str)
+{
+	static const char *entities[][2] = {
+		{"&amp;", "&"}, {"&lt;", "<"}, {"&gt;", ">"}, {"&quot;", "\""}, {"&apos;", "'"},
+	};
+	if (!strchr(str->array, '&'))
+		return;
+	for (size_t i = 1; i < sizeof(entities) / sizeof(entities[0]); i++)
+		dstr_replace(str, entities[i][0], entities[i][1]);
+	dstr_replace(str, entities[0][0], entities[0][1]); // last, so "&amp;lt;" stays "&lt;"
+}
+
+static inline bool is_absolute(const char *path)
+{
+	return path[0] == '/' || path[0] == '\\' || (isalpha((unsigned char)path[0]) && path[1] == ':');
+}
+
+static void add_entry(struct parser *parser, const char *str, size_t len, bool xml)
+{
+	struct dstr *value = &parser->value;
+	dstr_ncopy(value, str, len);
+	if (xml)
+		xml_decode(value);
+	if (dstr_is_empty(value))
+		return;
+
+	if (astrcmpi_n(value->array, "file://", 7) == 0) {
+		dstr_remove(value, 0, 7);
+		/* file:///C:/ on Windows */
+		if (value->len > 2 && value->array[0] == '/' && isalpha((unsigned char)value->array[1]) &&
+		    value->array[2] == ':')
+			dstr_remove(value, 0, 1);
+		if (dstr_is_empty(value))
+			return;
+		percent_decode(value);
+	} else if (!strstr(value->array, "://") && !is_absolute(value->array)) {
+		dstr_insert(value, 0, parser->dir);
+	}
+
+	struct playlist_entries *entries = parser->entries;
+	size_t offset = entries->buf.num;
+	da_push_back(entries->offsets, &offset);
+	da_push_back_array(entries->buf, value->array, value->len + 1);
+}
+
+/* Returns the next line without its line break and surrounding spaces */
+static bool next_line(const char **pos, const char *end, const char **line, size_t *len)
+{
+	if (*pos >= end)
+		return false;
+
+	const char *start = *pos;
+	const char *newline = memchr(start, '\n', end - start);
+	const char *line_end = newline ? newline : end;
+	*pos = newline ? newline + 1 : end;
+
+	while (start < line_end && isspace((unsigned char)*start))
+		start++;
+	while (line_end > start && isspace((unsigned char)line_end[-1]))
+		line_end--;
+	*line = start;
+	*len = line_end - start;
+	return true;
+}
+
+static bool parse_m3u(struct parser *parser, const char *pos, const char *end)
+{
+	const char *line;
+	size_t len;
+	while (next_line(&pos, end, &line, &len)) {
+		if (!len)
+			continue;
+		if (line[0] == '#') {
+			/* segments of a stream, which the media source plays itself */
+			if (len > 7 && strncmp(line, "#EXT-X-", 7) == 0)
+				return false;
+			continue;
+		}
+		add_entry(parser, line, len, false);
+	}
+	return true;
+}
+
+/* Entries are FileN=path, in the order they appear */
+static bool parse_pls(struct parser *parser, const char *pos, const char *end)
+{
+	const char *line;
+	size_t len;
+	while (next_line(&pos, end, &line, &len)) {
+		if (len < 6 || astrcmpi_n(line, "file", 4) != 0 || !isdigit((unsigned char)line[4]))
+			continue;
+
+		const char *eq = memchr(line, '=', len);
+		if (!eq)
+			continue;
+		size_t i = 4;
+		while (line + i < eq && isdigit((unsigned char)line[i]))
+			i++;
+		if (line + i == eq)
+			add_entry(parser, eq + 1, len - (eq + 1 - line), false);
+	}
+	return true;
+}
+
+static const char *find(const char *pos, const char *end, const char *str)
+{
+	size_t len = strlen(str);
+	while (end - pos >= (ptrdiff_t)len) {
+		const char *c = memchr(pos, str[0], end - pos - len + 1);
+		if (!c)
+			return NULL;
+		if (memcmp(c, str, len) == 0)
+			return c;
+		pos = c + 1;
+	}
+	return NULL;
+}
+
+/* Only the locations of the tracks are needed, so the XML is not parsed */
+static bool parse_xspf(struct parser *parser, const char *pos, const char *end)
+{
+	const char *start;
+	while ((start = find(pos, end, "<location>")) != NULL) {
+		start += strlen("<location>");
+		const char *stop = find(start, end, "</location>");
+		if (!stop)
+			break;
+
+		while (start < stop && isspace((unsigned char)*start))
+			start++;
+		const char *value_end = stop;
+		while (value_end > start && isspace((unsigned char)value_end[-1]))
+			value_end--;
+		add_entry(parser, start, value_end - start, true);
+		pos = stop + strlen("</location>");
+	}
+	return true;
+}
+
+bool playlist_file_parse(const char *path, struct playlist_entries *entries)
+{
+	enum playlist_format format = get_format(path);
+	struct mapped_file map;
+	if (format == FORMAT_NONE || !mapped_file_open(&map, path))
+		return false;
+
+	struct parser parser = {.entries = entries};
+	struct dstr dir = {0};
+	const char *slash = strrchr(path, '/');
+	const char *backslash = strrchr(path, '\\');
+	if (backslash > slash)
+		slash = backslash;
+	if (slash)
+		dstr_ncopy(&dir, path, slash - path + 1);
+	else
+		dstr_copy(&dir, "");
+	parser.dir = dir.array;
+
+	const char *pos = map.data;
+	const char *end = map.data + map.size;
+	if (end - pos >= 3 && memcmp(pos, "\xEF\xBB\xBF", 3) == 0)
+		pos += 3;
+
+	bool success;
+	if (format == FORMAT_M3U)
+		success = parse_m3u(&parser, pos, end);
+	else if (format == FORMAT_PLS)
+		success = parse_pls(&parser, pos, end);
+	else
+		success = parse_xspf(&parser, pos, end);
+
+	dstr_free(&parser.value);
+	dstr_free(&dir);
+	mapped_file_close(&map);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Cache */
+
+static void free_cached_file(struct cached_playlist_file *file)
+{
+	bfree(file->path);
+	playlist_entries_free(&file->entries);
+}
+
+const struct playlist_entries *playlist_file_cache_get(struct playlist_file_cache *cache, const char *path)
+{
+	struct stat st;
+	if (os_stat(path, &st) != 0)
+		return NULL;
+
+	struct cached_playlist_file *file = NULL;
+	for (size_t i = 0; i < cache->files.num; i++) {
+		if (strcmp(cache->files.array[i].path, path) == 0) {
+			file = &cache->files.array[i];
+			break;
+		}
+	}
+
+	if (file && (file->mtime != (int64_t)st.st_mtime || file->size != (int64_t)st.st_size)) {
+		playlist_entries_free(&file->entries);
+		file->valid = false;
+		file->mtime = 0;
+	}
+	if (!file) {
+		file = da_push_back_new(cache->files);
+		file->path = bstrdup(path);
+	}
+	if (!file->mtime) {
+		file->mtime = (int64_t)st.st_mtime;
+		file->size = (int64_t)st.st_size;
+		file->valid = playlist_file_parse(path, &file->entries);
+	}
+
+	file->used = true;
+	return file->valid ? &file->entries : NULL;
+}
+
+void playlist_file_cache_trim(struct playlist_file_cache *cache)
+{
+	for (size_t i = cache->files.num; i > 0; i--) {
+		struct cached_playlist_file *file = &cache->files.array[i - 1];
+		if (!file->used) {
+			free_cached_file(file);
+			da_erase(cache->files, i - 1);
+		} else {
+			file->used = false;
+		}
+	}
+}
+
+void playlist_file_cache_free(struct playlist_file_cache *cache)
+{
+	for (size_t i = 0; i < cache->files.num; i++)
+		free_cached_file(&cache->files.array[i]);
+	da_free(cache->files);
+}
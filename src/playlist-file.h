@@ -0,0 +1,73 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+#include <util/darray.h>
+
+/* Paths listed in a playlist file, in order. They are stored back to back in
+ * `buf`, so a list of thousands of files is only a few allocations.
+ */
+struct playlist_entries {
+	DARRAY(char) buf;
+	DARRAY(size_t) offsets;
+};
+
+static inline size_t playlist_entries_count(const struct playlist_entries *entries)
+{
+	return entries->offsets.num;
+}
+
+static inline const char *playlist_entry(const struct playlist_entries *entries, size_t idx)
+{
+	return entries->buf.array + entries->offsets.array[idx];
+}
+
+extern void playlist_entries_free(struct playlist_entries *entries);
+
+/* Whether the path has the extension of an M3U, M3U8, PLS or XSPF file */
+extern bool playlist_file_is_supported(const char *path);
+
+/* Parses a playlist file. Relative paths are resolved from the folder of the
+ * playlist file, and file:// URIs are turned into paths. Returns false if the
+ * file can't be read, or if it is an HLS stream rather than a list of files.
+ */
+extern bool playlist_file_parse(const char *path, struct playlist_entries *entries);
+
+struct cached_playlist_file {
+	char *path;
+	int64_t mtime;
+	int64_t size;
+	bool valid; // false if it could not be parsed
+	bool used;  // since the last trim
+	struct playlist_entries entries;
+};
+
+/* Playlist files of a source, kept between updates so a file is only parsed
+ * again when its mtime or size changes.
+ */
+struct playlist_file_cache {
+	DARRAY(struct cached_playlist_file) files;
+};
+
+/* Returns NULL if the file is not a list of files */
+extern const struct playlist_entries *playlist_file_cache_get(struct playlist_file_cache *cache, const char *path);
+/* Drops the files that were not used since the last trim */
+extern void playlist_file_cache_trim(struct playlist_file_cache *cache);
+extern void playlist_file_cache_free(struct playlist_file_cache *cache);
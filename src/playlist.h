@@ -19,6 +19,7 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 #pragma once
 
 #include <util/darray.h>
+#include "folder-sort.h"
 
 struct media_file_data {
 	char *path;
@@ -30,4 +31,8 @@ struct media_file_data {
 	struct media_file_data *parent;
 	const char *parent_id; // for folder items
 	size_t index;          // makes it easier to switch back to non-shuffle mode
+	int64_t start_ms;      // in-point, 0 for the start of the file
+	int64_t end_ms;        // out-point, 0 for the end of the file
+	enum folder_sort sort; // of the folder items
+	bool sort_reverse;
 };
@@ -18,6 +18,12 @@ with this program. If not, see <https://www.gnu.org/licenses/>
 
 #include <obs-module.h>
 #include <plugin-support.h>
+#include "loudness.h"
+#include "url-cache.h"
+#include "path-check.h"
+#include "decoder-pool.h"
+#include "duration-cache.h"
+#include "quarantine.h"
 
 #ifdef TEST_SHUFFLER
 #include "shuffler.h"
@@ -40,5 +46,11 @@ bool obs_module_load(void)
 
 void obs_module_unload(void)
 {
+	loudness_cache_free();
+	url_cache_free();
+	path_check_free();
+	decoder_pool_free();
+	duration_cache_free();
+	quarantine_free();
 	obs_log(LOG_INFO, "plugin unloaded");
 }
@@ -0,0 +1,130 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <sys/stat.h>
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <plugin-support.h>
+#include "quarantine.h"
+
+#define QUARANTINE_FILE "quarantine.json"
+
+static pthread_mutex_t quarantine_mutex = PTHREAD_MUTEX_INITIALIZER;
+static obs_data_t *quarantine = NULL;
+static char *quarantine_path = NULL;
+static bool dirty = false; // files were taken out, saved with the next change or when freed
+
+/* Requires `quarantine_mutex` */
+static void load_quarantine(void)
+{
+	if (quarantine)
+		return;
+
+	char *dir = obs_module_config_path("");
+	if (dir) {
+		os_mkdirs(dir);
+		bfree(dir);
+	}
+
+	quarantine_path = obs_module_config_path(QUARANTINE_FILE);
+	if (quarantine_path)
+		quarantine = obs_data_create_from_json_file_safe(quarantine_path, "bak");
+	if (!quarantine)
+		quarantine = obs_data_create();
+}
+
+/* Requires `quarantine_mutex` */
+static void save_quarantine(void)
+{
+	if (quarantine_path && !obs_data_save_json_safe(quarantine, quarantine_path, "tmp", "bak"))
+		obs_log(LOG_WARNING, "Failed to save quarantined files to '%s'", quarantine_path);
+}
+
+static int64_t file_mtime(const char *path)
+{
+	struct stat st;
+	if (os_stat(path, &st) != 0)
+		return 0;
+	return (int64_t)st.st_mtime;
+}
+
+void quarantine_add(const char *path)
+{
+	int64_t mtime = file_mtime(path);
+
+	pthread_mutex_lock(&quarantine_mutex);
+	load_quarantine();
+	obs_data_t *entry = obs_data_create();
+	obs_data_set_int(entry, "mtime", mtime);
+	obs_data_set_obj(quarantine, path, entry);
+	obs_data_release(entry);
+	save_quarantine();
+	dirty = false;
+	pthread_mutex_unlock(&quarantine_mutex);
+}
+
+/* Requires `quarantine_mutex`, returns -1 if the file isn't quarantined */
+static int64_t quarantined_mtime(const char *path)
+{
+	load_quarantine();
+	obs_data_t *entry = obs_data_get_obj(quarantine, path);
+	int64_t mtime = entry ? obs_data_get_int(entry, "mtime") : -1;
+	obs_data_release(entry);
+	return mtime;
+}
+
+/* A file that changed since it was quarantined is taken out, so it is tried
+ * again. That is only saved later, as this is called while navigating. The
+ * file is checked without `quarantine_mutex`, so a share that doesn't answer
+ * only holds up the source that plays it.
+ */
+bool quarantine_contains(const char *path)
+{
+	pthread_mutex_lock(&quarantine_mutex);
+	int64_t mtime = quarantined_mtime(path);
+	pthread_mutex_unlock(&quarantine_mutex);
+	if (mtime < 0)
+		return false;
+
+	if (file_mtime(path) == mtime)
+		return true;
+
+	/* unless it was quarantined again in the meantime */
+	pthread_mutex_lock(&quarantine_mutex);
+	if (quarantined_mtime(path) == mtime) {
+		obs_data_erase(quarantine, path);
+		dirty = true;
+	}
+	pthread_mutex_unlock(&quarantine_mutex);
+	return false;
+}
+
+void quarantine_free(void)
+{
+	pthread_mutex_lock(&quarantine_mutex);
+	if (quarantine && dirty)
+		save_quarantine();
+	dirty = false;
+	obs_data_release(quarantine);
+	quarantine = NULL;
+	bfree(quarantine_path);
+	quarantine_path = NULL;
+	pthread_mutex_unlock(&quarantine_mutex);
+}
@@ -0,0 +1,29 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+
+/* Files that failed to start, shared by all sources and saved in the plugin's
+ * config folder. Navigation steps over them until the file changes, which is
+ * when its mtime is no longer the one it was quarantined with.
+ */
+extern void quarantine_add(const char *path);
+extern bool quarantine_contains(const char *path);
+extern void quarantine_free(void);
@@ -29,6 +29,7 @@ selects a specific file in the playlist. Also lets us do reshuffling keeping the
 history.
 */
 
+#include <util/platform.h>
 #include "shuffler.h"
 
 /* On auto-reshuffle, avoid selecting the same item before at least
@@ -36,15 +37,29 @@ history.
  * previous shuffle and the start of the new shuffle). */
 #define NOT_SAME_BEFORE 1
 
+#define STATE_MAGIC "MPSH"
+#define STATE_VERSION 1
+
 void shuffler_init(struct shuffler *s)
 {
 	s->head = 0;
 	s->next = 0;
 	s->history = 0;
 	s->loop = false;
+	s->rand_state = os_gettime_ns() ^ (uint64_t)(uintptr_t)s;
 	da_init(s->shuffled_files);
 }
 
+/* splitmix64, its whole state is a single integer so it can be saved and
+ * restored along with the shuffle order */
+static uint64_t shuffler_rand(struct shuffler *s)
+{
+	uint64_t z = (s->rand_state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
 void shuffler_destroy(struct shuffler *s)
 {
 	da_free(s->shuffled_files);
@@ -67,7 +82,7 @@ static inline void shuffler_determine_one_(struct shuffler *s, size_t avoid_last
 	assert(s->head < s->shuffled_files.num);
 	assert(s->shuffled_files.num - s->head > avoid_last_n);
 	size_t range_len = s->shuffled_files.num - s->head - avoid_last_n;
-	size_t selected = s->head + (rand() % range_len);
+	size_t selected = s->head + (size_t)(shuffler_rand(s) % range_len);
 	da_swap(s->shuffled_files, s->head, selected);
 
 	if (s->head == s->history)
@@ -125,7 +140,10 @@ struct media_file_data *shuffler_peek_next(struct shuffler *s)
 {
 	assert(shuffler_has_next(s));
 
-	if (s->next == s->shuffled_files.num && s->next == s->history) {
+	/* next only stays at the end once every item was determined. History
+	 * can be anywhere by then, as it wraps to 0 after a selection or a
+	 * playlist update. */
+	if (s->next == s->shuffled_files.num) {
 		assert(s->loop);
 		shuffler_auto_reshuffle(s);
 	}
@@ -137,6 +155,44 @@ struct media_file_data *shuffler_peek_next(struct shuffler *s)
 	return s->shuffled_files.array[s->next];
 }
 
+size_t shuffler_peek_upcoming(struct shuffler *s, size_t count, struct media_file_data *const **items)
+{
+	*items = NULL;
+	if (!count || !shuffler_has_next(s))
+		return 0;
+
+	if (s->next == s->shuffled_files.num) {
+		assert(s->loop);
+		shuffler_auto_reshuffle(s);
+	}
+
+	/* The span stops at the end of the cycle, as the next cycle is only
+	 * shuffled when it is reached. If next is in the history of the
+	 * previous cycle, those items are already ordered. */
+	size_t end = s->next + count;
+	if (end > s->shuffled_files.num)
+		end = s->shuffled_files.num;
+
+	if (s->next <= s->head) {
+		/* execute the Fisher-Yates steps that shuffler_next would do */
+		while (s->head < end)
+			shuffler_determine_one(s);
+	}
+
+	*items = &s->shuffled_files.array[s->next];
+	return end - s->next;
+}
+
+struct media_file_data *shuffler_peek_current(struct shuffler *s)
+{
+	if (!s->shuffled_files.num)
+		return NULL;
+	if (s->next)
+		return s->shuffled_files.array[s->next - 1];
+	/* next wraps to 0 after the last item of a cycle was played */
+	return s->loop ? s->shuffled_files.array[s->shuffled_files.num - 1] : NULL;
+}
+
 struct media_file_data *shuffler_prev(struct shuffler *s)
 {
 	assert(shuffler_has_prev(s));
@@ -200,60 +256,64 @@ void shuffler_select(struct shuffler *s, const struct media_file_data *data)
 	shuffler_select_index(s, idx);
 }
 
-static void shuffler_remove_at(struct shuffler *s, size_t index)
+static int compare_items(const void *a, const void *b)
+{
+	uintptr_t item_a = (uintptr_t)(*(struct media_file_data *const *)a);
+	uintptr_t item_b = (uintptr_t)(*(struct media_file_data *const *)b);
+	return (item_a > item_b) - (item_a < item_b);
+}
+
+void shuffler_remove(struct shuffler *s, struct media_file_data *const items[], size_t count)
 {
-	/* All this memmove magic is just an optimized way of removing the 
-	 * element from the array, so you don't have to shift the whole array
-	 * to the left when it is not needed (as there is an unordered part)
-	 * Instead of shifting the unordered part, this code just takes the last 
-	 * element from the unordered part and puts it into `index`.
-	 */
 	/*
 	 * 0          head                                history   next  size
 	 * |-----------|...................................|---------|-----|
 	 * |<--------->|                                   |<------------->|
 	 *    ordered            order irrelevant               ordered
 	 */
+	/* Removing items one by one means a linear search plus up to two
+	 * memmoves per item. Instead, sort the items to remove so each element
+	 * can be checked with a binary search, then compact the whole array in
+	 * a single pass. Keeping the relative order of the survivors keeps the
+	 * ordered parts ordered, and head, history and next only move back by
+	 * the number of removed elements that were before them.
+	 */
+	if (!count || !s->shuffled_files.num)
+		return;
+
+	struct media_file_data **sorted = bmemdup(items, count * sizeof(*items));
+	qsort(sorted, count, sizeof(*sorted), compare_items);
+
+	size_t removed_before_head = 0;
+	size_t removed_before_next = 0;
+	size_t removed_before_history = 0;
+	size_t write = 0;
+
+	for (size_t read = 0; read < s->shuffled_files.num; read++) {
+		struct media_file_data *item = s->shuffled_files.array[read];
+
+		if (bsearch(&item, sorted, count, sizeof(*sorted), compare_items)) {
+			if (read < s->head)
+				removed_before_head++;
+			if (read < s->next)
+				removed_before_next++;
+			if (read < s->history)
+				removed_before_history++;
+			continue;
+		}
 
-	/* update next before index may be updated */
-	if (index < s->next)
-		s->next--;
-
-	if (index < s->head) {
-		/* item was selected, keep the selected part ordered */
-		memmove(&s->shuffled_files.array[index], &s->shuffled_files.array[index + 1],
-			(s->head - index - 1) * sizeof(*s->shuffled_files.array));
-		s->head--;
-		index = s->head; /* the new index to remove */
-	}
-
-	if (index < s->history) {
-		/* this part is unordered, no need to shift all items */
-		s->shuffled_files.array[index] = s->shuffled_files.array[s->history - 1];
-		index = s->history - 1;
-		s->history--;
+		s->shuffled_files.array[write++] = item;
 	}
 
-	if (index < s->shuffled_files.num - 1) {
-		/* shift the ordered history part by one */
-		memmove(&s->shuffled_files.array[index], &s->shuffled_files.array[index + 1],
-			(s->shuffled_files.num - index - 1) * sizeof(*s->shuffled_files.array));
-	}
+	/* every item must exist */
+	assert(s->shuffled_files.num - write == count);
 
-	s->shuffled_files.num--;
-}
+	s->head -= removed_before_head;
+	s->next -= removed_before_next;
+	s->history -= removed_before_history;
+	s->shuffled_files.num = write;
 
-static void shuffler_remove_one(struct shuffler *s, const struct media_file_data *item)
-{
-	size_t index = da_find(s->shuffled_files, &item, 0);
-	assert(index >= 0 && index != DARRAY_INVALID); /* item must exist */
-	shuffler_remove_at(s, index);
-}
-
-void shuffler_remove(struct shuffler *s, struct media_file_data *const items[], size_t count)
-{
-	for (size_t i = 0; i < count; ++i)
-		shuffler_remove_one(s, items[i]);
+	bfree(sorted);
 }
 
 void shuffler_clear(struct shuffler *s)
@@ -305,13 +365,13 @@ size_t find_media_index(struct darray *array, struct media_file_data *search_dat
 			 * In other words, don't break this code.
 			 */
 
-			if (strcmp(current_data->parent_id, search_data->parent_id) == 0) {
+			if (current_data->parent_id && strcmp(current_data->parent_id, search_data->parent_id) == 0) {
 				int match = strcmp(search_data->filename, current_data->filename);
 				if (match == 0) {
 					return i;
 				}
 			}
-		} else if (strcmp(search_data->id, current_data->id) == 0) {
+		} else if (!current_data->parent_id && strcmp(search_data->id, current_data->id) == 0) {
 			return i;
 		}
 	}
@@ -371,6 +431,204 @@ void shuffler_update_files(struct shuffler *s, struct darray *array)
 	}
 }
 
+/* ------------------------------------------------------------------------- */
+/* State serialization
+ *
+ * Items are stored as their index in the flattened playlist (the order of
+ * build_shuffled_files), so the order can be mapped back to the new
+ * media_file_data pointers after a restart. Consecutive indexes are stored as
+ * zigzag varint deltas, which keeps mostly sorted parts (like a fresh shuffle
+ * that was only partly determined) to about a byte per item.
+ *
+ * "MPSH" version count head next history checksum rand_state deltas...
+ */
+
+static void put_varint(struct darray *out, uint64_t val)
+{
+	DARRAY(uint8_t) bytes;
+	bytes.da = *out;
+	while (val >= 0x80) {
+		uint8_t byte = (uint8_t)(val | 0x80);
+		da_push_back(bytes, &byte);
+		val >>= 7;
+	}
+	uint8_t byte = (uint8_t)val;
+	da_push_back(bytes, &byte);
+	*out = bytes.da;
+}
+
+static bool get_varint(const uint8_t **data, const uint8_t *end, uint64_t *val)
+{
+	uint64_t result = 0;
+	for (unsigned shift = 0; shift < 64 && *data < end; shift += 7) {
+		uint8_t byte = *(*data)++;
+		result |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80)) {
+			*val = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void put_u64(struct darray *out, uint64_t val)
+{
+	DARRAY(uint8_t) bytes;
+	bytes.da = *out;
+	for (size_t i = 0; i < 8; i++) {
+		uint8_t byte = (uint8_t)(val >> (i * 8));
+		da_push_back(bytes, &byte);
+	}
+	*out = bytes.da;
+}
+
+static bool get_u64(const uint8_t **data, const uint8_t *end, uint64_t *val)
+{
+	if (end - *data < 8)
+		return false;
+	*val = 0;
+	for (size_t i = 0; i < 8; i++)
+		*val |= (uint64_t)(*data)[i] << (i * 8);
+	*data += 8;
+	return true;
+}
+
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+	/* FNV-1a, including the null terminator as a separator */
+	if (str) {
+		for (; *str; str++)
+			hash = (hash ^ (uint8_t)*str) * 0x100000001B3ULL;
+	}
+	return hash * 0x100000001B3ULL;
+}
+
+/* Identifies the playlist the state was saved with, so that a stale state is
+ * not applied to a playlist that was changed while OBS was closed. */
+static uint64_t playlist_checksum(struct darray *flattened)
+{
+	DARRAY(struct media_file_data *) files;
+	files.da = *flattened;
+	uint64_t hash = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < files.num; i++) {
+		struct media_file_data *data = files.array[i];
+		if (data->parent_id) {
+			hash = hash_string(hash, data->parent_id);
+			hash = hash_string(hash, data->filename);
+		} else {
+			hash = hash_string(hash, data->id);
+		}
+	}
+	return hash;
+}
+
+void shuffler_save_state(struct shuffler *s, struct darray *files, struct darray *out)
+{
+	DARRAY(struct media_file_data) src_files;
+	DARRAY(struct media_file_data *) flattened;
+	DARRAY(size_t) offsets;
+	src_files.da = *files;
+	da_init(flattened);
+	da_init(offsets);
+
+	build_shuffled_files(files, &flattened.da);
+	if (flattened.num != s->shuffled_files.num)
+		goto end;
+
+	/* index of the first flattened item of each playlist entry */
+	da_resize(offsets, src_files.num);
+	for (size_t i = 0, offset = 0; i < src_files.num; i++) {
+		offsets.array[i] = offset;
+		offset += src_files.array[i].is_folder ? src_files.array[i].folder_items.num : 1;
+	}
+
+	DARRAY(uint8_t) bytes;
+	bytes.da = *out;
+	da_push_back_array(bytes, (const uint8_t *)STATE_MAGIC, 4);
+	uint8_t version = STATE_VERSION;
+	da_push_back(bytes, &version);
+	*out = bytes.da;
+
+	put_varint(out, s->shuffled_files.num);
+	put_varint(out, s->head);
+	put_varint(out, s->next);
+	put_varint(out, s->history);
+	put_u64(out, playlist_checksum(&flattened.da));
+	put_u64(out, s->rand_state);
+
+	int64_t prev = 0;
+	for (size_t i = 0; i < s->shuffled_files.num; i++) {
+		struct media_file_data *data = s->shuffled_files.array[i];
+		int64_t index = data->parent_id ? (int64_t)(offsets.array[data->parent->index] + data->index)
+						: (int64_t)offsets.array[data->index];
+		int64_t delta = index - prev;
+		put_varint(out, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+		prev = index;
+	}
+
+end:
+	da_free(flattened);
+	da_free(offsets);
+}
+
+bool shuffler_load_state(struct shuffler *s, struct darray *files, const uint8_t *data, size_t size)
+{
+	DARRAY(struct media_file_data *) flattened;
+	DARRAY(struct media_file_data *) shuffled_files;
+	const uint8_t *end = data + size;
+	uint64_t count, head, next, history, checksum, rand_state;
+	bool *seen = NULL;
+	bool success = false;
+
+	da_init(flattened);
+	da_init(shuffled_files);
+
+	if (size < 5 || memcmp(data, STATE_MAGIC, 4) != 0 || data[4] != STATE_VERSION)
+		return false;
+	data += 5;
+
+	if (!get_varint(&data, end, &count) || !get_varint(&data, end, &head) || !get_varint(&data, end, &next) ||
+	    !get_varint(&data, end, &history) || !get_u64(&data, end, &checksum) || !get_u64(&data, end, &rand_state))
+		return false;
+
+	build_shuffled_files(files, &flattened.da);
+	if (count != flattened.num || !count || head > count || next > count || history > count)
+		goto end;
+	if (checksum != playlist_checksum(&flattened.da))
+		goto end;
+
+	da_resize(shuffled_files, flattened.num);
+	seen = bzalloc(flattened.num * sizeof(bool));
+
+	int64_t index = 0;
+	for (size_t i = 0; i < flattened.num; i++) {
+		uint64_t zigzag;
+		if (!get_varint(&data, end, &zigzag))
+			goto end;
+		index += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+		if (index < 0 || (uint64_t)index >= flattened.num || seen[index])
+			goto end;
+		seen[index] = true;
+		shuffled_files.array[i] = flattened.array[index];
+	}
+
+	da_free(s->shuffled_files);
+	s->shuffled_files.da = shuffled_files.da;
+	da_init(shuffled_files);
+	s->head = (size_t)head;
+	s->next = (size_t)next;
+	s->history = (size_t)history;
+	s->rand_state = rand_state;
+	success = true;
+
+end:
+	bfree(seen);
+	da_free(flattened);
+	da_free(shuffled_files);
+	return success;
+}
+
 #ifdef TEST_SHUFFLER
 #include <util/dstr.h>
 static void ArrayInitOffset(struct darray *main_array, size_t len, size_t offset)
@@ -420,6 +678,7 @@ static void ArrayDeepCopy(struct darray *src, struct darray *dst)
 
 	for (size_t i = 0; i < orig.num; i++) {
 		struct media_file_data *media = &copy.array[i];
+		media->id = bstrdup(orig.array[i].id);
 		if (media->filename) {
 			media->filename = bstrdup(orig.array[i].filename);
 		}
@@ -427,6 +686,7 @@ static void ArrayDeepCopy(struct darray *src, struct darray *dst)
 		da_copy(media->folder_items, orig.array[i].folder_items);
 		for (size_t j = 0; j < media->folder_items.num; j++) {
 			struct media_file_data *folder_item = &media->folder_items.array[j];
+			folder_item->parent_id = media->id;
 			if (folder_item->filename) {
 				folder_item->filename = bstrdup(folder_item->filename);
 			}
@@ -1079,8 +1339,8 @@ static void test_has_prev_next_empty(void)
 
 	assert(!shuffler_has_prev(&shuffler));
 
-	/* there are always next items in loop mode */
-	assert(shuffler_has_next(&shuffler));
+	/* unlike VLC, there is nothing to loop over when the list is empty */
+	assert(!shuffler_has_next(&shuffler));
 
 	shuffler_destroy(&shuffler);
 }
@@ -1298,6 +1558,237 @@ static void test_update_files_folders_with_additions_and_removals(void)
 #undef SIZE
 }
 
+static void test_remove_from_all_parts(void)
+{
+	struct shuffler shuffler;
+	shuffler_init(&shuffler);
+	shuffler_set_loop(&shuffler, true);
+
+#define SIZE 120
+	DARRAY(struct media_file_data) items;
+	da_init(items);
+	ArrayInit(&items.da, SIZE);
+
+	bool ok = shuffler_add(&shuffler, items.array, 100);
+	assert(ok);
+
+	/* complete the first cycle and start the next one */
+	for (int i = 0; i < 120; ++i) {
+		assert(shuffler_has_next(&shuffler));
+		struct media_file_data *item = shuffler_next(&shuffler);
+		assert(item);
+	}
+	/* go back a bit so that next is not at head */
+	for (int i = 0; i < 5; ++i) {
+		assert(shuffler_has_prev(&shuffler));
+		struct media_file_data *item = shuffler_prev(&shuffler);
+		assert(item);
+	}
+
+	/* insert 20 new items, so that the unordered part is not empty */
+	ok = shuffler_add(&shuffler, &items.array[100], 20);
+	assert(ok);
+
+	assert(shuffler.shuffled_files.num == 120);
+	assert(shuffler.head == 20);
+	assert(shuffler.next == 15);
+	assert(shuffler.history == 40);
+
+	struct media_file_data *before[SIZE];
+	memcpy(before, shuffler.shuffled_files.array, SIZE * sizeof(*before));
+
+	struct media_file_data *to_remove[15];
+	/* 5 items already determined, 3 of them before next */
+	memcpy(to_remove, &before[12], 5 * sizeof(*to_remove));
+	/* 5 items in the unordered part */
+	memcpy(&to_remove[5], &before[25], 5 * sizeof(*to_remove));
+	/* 5 items in the history part */
+	memcpy(&to_remove[10], &before[60], 5 * sizeof(*to_remove));
+
+	shuffler_remove(&shuffler, to_remove, 15);
+
+	assert(shuffler.shuffled_files.num == 105);
+	assert(shuffler.head == 15);
+	assert(shuffler.next == 12);
+	assert(shuffler.history == 30);
+
+	/* the ordered parts must be kept in order */
+	for (int i = 0; i < 12; ++i)
+		assert(shuffler.shuffled_files.array[i] == before[i]);
+	for (int i = 12; i < 15; ++i)
+		assert(shuffler.shuffled_files.array[i] == before[i + 5]);
+	for (int i = 30; i < 50; ++i)
+		assert(shuffler.shuffled_files.array[i] == before[i + 10]);
+	for (int i = 50; i < 105; ++i)
+		assert(shuffler.shuffled_files.array[i] == before[i + 15]);
+
+	/* none of the removed items must remain */
+	for (int i = 0; i < 105; ++i)
+		for (int j = 0; j < 15; ++j)
+			assert(shuffler.shuffled_files.array[i] != to_remove[j]);
+
+	shuffler_destroy(&shuffler);
+	ArrayDestroy(&items.da);
+#undef SIZE
+}
+
+static void test_save_and_load_state(void)
+{
+	struct shuffler shuffler;
+	struct shuffler restored;
+	shuffler_init(&shuffler);
+	shuffler_init(&restored);
+	shuffler_set_loop(&shuffler, true);
+	shuffler_set_loop(&restored, true);
+
+#define SIZE 50
+	DARRAY(struct media_file_data) items;
+	da_init(items);
+	ArrayInit(&items.da, SIZE);
+	for (size_t i = 0; i < SIZE; i += 10) {
+		ArrayCreateFolderItems(&items.array[i], 5, 0);
+		for (size_t j = 0; j < items.array[i].folder_items.num; j++) {
+			items.array[i].folder_items.array[j].parent = &items.array[i];
+			items.array[i].folder_items.array[j].index = j;
+		}
+	}
+
+	shuffler_update_files(&shuffler, &items.da);
+	assert(shuffler.shuffled_files.num == 70);
+
+	/* go into the second cycle so that every part is populated */
+	for (int i = 0; i < 100; ++i) {
+		assert(shuffler_has_next(&shuffler));
+		struct media_file_data *item = shuffler_next(&shuffler);
+		assert(item);
+	}
+
+	DARRAY(uint8_t) state;
+	da_init(state);
+	shuffler_save_state(&shuffler, &items.da, &state.da);
+	assert(state.num > 0);
+
+	bool ok = shuffler_load_state(&restored, &items.da, state.array, state.num);
+	assert(ok);
+	assert(restored.shuffled_files.num == shuffler.shuffled_files.num);
+	assert(restored.head == shuffler.head);
+	assert(restored.next == shuffler.next);
+	assert(restored.history == shuffler.history);
+	for (size_t i = 0; i < shuffler.shuffled_files.num; ++i)
+		assert(restored.shuffled_files.array[i] == shuffler.shuffled_files.array[i]);
+	assert(shuffler_peek_current(&restored) == shuffler_peek_current(&shuffler));
+
+	/* the random state is restored too, so both continue the same way */
+	for (int i = 0; i < 100; ++i)
+		assert(shuffler_next(&restored) == shuffler_next(&shuffler));
+
+	/* a truncated state must be rejected */
+	ok = shuffler_load_state(&restored, &items.da, state.array, state.num - 1);
+	assert(!ok);
+
+	/* and so must the state of a playlist that was changed since */
+	bfree(items.array[SIZE - 1].id);
+	items.array[SIZE - 1].id = bstrdup("changed");
+	ok = shuffler_load_state(&restored, &items.da, state.array, state.num);
+	assert(!ok);
+
+	shuffler_destroy(&shuffler);
+	shuffler_destroy(&restored);
+	ArrayDestroy(&items.da);
+	da_free(state);
+#undef SIZE
+}
+
+static void test_peek_upcoming(void)
+{
+	struct shuffler shuffler;
+	shuffler_init(&shuffler);
+
+#define SIZE 20
+	DARRAY(struct media_file_data) items;
+	da_init(items);
+	ArrayInit(&items.da, SIZE);
+
+	bool ok = shuffler_add(&shuffler, items.array, SIZE);
+	assert(ok);
+
+	struct media_file_data *const *upcoming;
+	size_t count = shuffler_peek_upcoming(&shuffler, 5, &upcoming);
+	assert(count == 5);
+	assert(shuffler.head == 5);
+	assert(shuffler.next == 0);
+
+	/* keep a copy, the span is only valid until the shuffler changes */
+	struct media_file_data *expected[SIZE];
+	memcpy(expected, upcoming, count * sizeof(*expected));
+
+	/* peeking again must not change anything */
+	count = shuffler_peek_upcoming(&shuffler, 3, &upcoming);
+	assert(count == 3);
+	assert(shuffler.head == 5);
+	for (size_t i = 0; i < count; ++i)
+		assert(upcoming[i] == expected[i]);
+
+	for (size_t i = 0; i < 5; ++i)
+		assert(shuffler_next(&shuffler) == expected[i]);
+
+	/* the span stops at the end of the cycle */
+	count = shuffler_peek_upcoming(&shuffler, 100, &upcoming);
+	assert(count == SIZE - 5);
+	assert(shuffler.head == SIZE);
+	memcpy(expected, upcoming, count * sizeof(*expected));
+	for (size_t i = 0; i < count; ++i)
+		assert(shuffler_next(&shuffler) == expected[i]);
+
+	/* no loop, nothing left */
+	count = shuffler_peek_upcoming(&shuffler, 5, &upcoming);
+	assert(count == 0);
+	assert(!upcoming);
+
+	/* in loop mode the next cycle is started */
+	shuffler_set_loop(&shuffler, true);
+	count = shuffler_peek_upcoming(&shuffler, 5, &upcoming);
+	assert(count == 5);
+	memcpy(expected, upcoming, count * sizeof(*expected));
+	for (size_t i = 0; i < count; ++i)
+		assert(shuffler_next(&shuffler) == expected[i]);
+
+	shuffler_destroy(&shuffler);
+	ArrayDestroy(&items.da);
+#undef SIZE
+}
+
+static void test_reshuffle_when_history_wrapped(void)
+{
+	struct shuffler shuffler;
+	shuffler_init(&shuffler);
+	shuffler_set_loop(&shuffler, true);
+
+#define SIZE 10
+	DARRAY(struct media_file_data) items;
+	da_init(items);
+	ArrayInit(&items.da, SIZE);
+	shuffler_update_files(&shuffler, &items.da);
+
+	for (size_t i = 0; i < SIZE; i++)
+		shuffler_next(&shuffler);
+
+	/* a whole cycle was played, and history wrapped around */
+	shuffler.history = 0;
+	assert(shuffler.head == SIZE);
+	assert(shuffler.next == SIZE);
+
+	struct media_file_data *const *upcoming;
+	assert(shuffler_peek_upcoming(&shuffler, 1, &upcoming) == 1);
+	assert(shuffler_next(&shuffler) == upcoming[0]);
+	assert(shuffler.head == 1);
+	assert(shuffler.next == 1);
+
+	ArrayDestroy(&items.da);
+	shuffler_destroy(&shuffler);
+#undef SIZE
+}
+
 int test_shuffler()
 {
 	// vlc tests
@@ -1319,6 +1810,10 @@ int test_shuffler()
 	// my tests
 	test_update_files_with_additions_and_removals();
 	test_update_files_folders_with_additions_and_removals();
+	test_remove_from_all_parts();
+	test_save_and_load_state();
+	test_peek_upcoming();
+	test_reshuffle_when_history_wrapped();
 	return 0;
 }
 
@@ -31,6 +31,7 @@ struct shuffler {
 	size_t head;
 	size_t next;
 	size_t history;
+	uint64_t rand_state;
 };
 
 void shuffler_init(struct shuffler *s);
@@ -43,10 +44,14 @@ bool shuffler_has_prev(struct shuffler *s);
 bool shuffler_has_next(struct shuffler *s);
 struct media_file_data *shuffler_peek_prev(struct shuffler *s);
 struct media_file_data *shuffler_peek_next(struct shuffler *s);
+struct media_file_data *shuffler_peek_current(struct shuffler *s);
+size_t shuffler_peek_upcoming(struct shuffler *s, size_t count, struct media_file_data *const **items);
 struct media_file_data *shuffler_prev(struct shuffler *s);
 struct media_file_data *shuffler_next(struct shuffler *s);
 static void shuffler_select_index(struct shuffler *s, size_t index);
 void shuffler_select(struct shuffler *s, const struct media_file_data *data);
+bool shuffler_add(struct shuffler *s, struct media_file_data items[], size_t count);
+void shuffler_remove(struct shuffler *s, struct media_file_data *const items[], size_t count);
 void shuffler_clear(struct shuffler *s);
 
 // Utility functions
@@ -54,6 +59,8 @@ void build_shuffled_files(struct darray *src, struct darray *dst);
 size_t find_media_index(struct darray *array, struct media_file_data *data, size_t offset);
 void shuffler_update_files(struct shuffler *s, struct darray *array);
 void shuffler_set_loop(struct shuffler *s, bool loop);
+void shuffler_save_state(struct shuffler *s, struct darray *files, struct darray *out);
+bool shuffler_load_state(struct shuffler *s, struct darray *files, const uint8_t *data, size_t size);
 
 #ifdef TEST_SHUFFLER
 int test_shuffler();
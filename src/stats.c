@@ -0,0 +1,312 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <inttypes.h>
+#include <limits.h>
+#include <string.h>
+#include <plugin-support.h>
+#include "stats.h"
+
+static const char *timer_names[STATS_TIMER_COUNT] = {
+	"update",
+	"folder_scan",
+	"shuffler_update",
+	"transition",
+	"gap_video",
+	"gap_audio",
+};
+
+static const char *counter_names[STATS_COUNTER_COUNT] = {
+	"folder_items",
+	"nav_posted",
+	"nav_processed",
+	"audio_packets",
+	"audio_dropped",
+	"audio_resyncs",
+	"loudness_analyzed",
+	"idle_releases",
+	"decoder_evictions",
+	"fast_fails",
+};
+
+bool stats_init(struct mps_stats *stats)
+{
+	pthread_mutex_init_value(&stats->trace_mutex);
+	return pthread_mutex_init(&stats->trace_mutex, NULL) == 0;
+}
+
+void stats_free(struct mps_stats *stats)
+{
+	pthread_mutex_destroy(&stats->trace_mutex);
+}
+
+void stats_hist_record(struct stats_hist *hist, uint64_t value)
+{
+	size_t bucket = 0;
+	for (uint64_t v = value; v && bucket < STATS_HIST_BUCKETS - 1; v >>= 1)
+		bucket++;
+	os_atomic_inc_long(&hist->buckets[bucket]);
+
+	long new_max = value > LONG_MAX ? LONG_MAX : (long)value;
+	long max = os_atomic_load_long(&hist->max);
+	while (new_max > max && !os_atomic_compare_exchange_long(&hist->max, &max, new_max))
+		;
+}
+
+long stats_hist_count(const struct stats_hist *hist)
+{
+	long count = 0;
+	for (size_t i = 0; i < STATS_HIST_BUCKETS; i++)
+		count += os_atomic_load_long(&hist->buckets[i]);
+	return count;
+}
+
+/* Returns the highest value the bucket of the percentile can hold, or the
+ * max if that is lower. Only accurate to a power of 2, which is enough to see
+ * where time goes.
+ */
+uint64_t stats_hist_percentile(const struct stats_hist *hist, double percentile)
+{
+	long buckets[STATS_HIST_BUCKETS];
+	long count = 0;
+	long max = os_atomic_load_long(&hist->max);
+
+	for (size_t i = 0; i < STATS_HIST_BUCKETS; i++) {
+		buckets[i] = os_atomic_load_long(&hist->buckets[i]);
+		count += buckets[i];
+	}
+	if (!count)
+		return 0;
+
+	long rank = (long)(percentile / 100.0 * count + 0.5);
+	if (rank < 1)
+		rank = 1;
+
+	long seen = 0;
+	for (size_t i = 0; i < STATS_HIST_BUCKETS; i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			uint64_t upper = i ? (1ULL << i) - 1 : 0;
+			return upper < (uint64_t)max ? upper : (uint64_t)max;
+		}
+	}
+	return (uint64_t)max;
+}
+
+/* Moves the pending transition to the ring buffer. Requires `trace_mutex`. */
+static void finish_transition(struct mps_stats *stats)
+{
+	os_atomic_set_bool(&stats->waiting_video, false);
+	os_atomic_set_bool(&stats->waiting_audio, false);
+
+	if (stats->pending.open_ts) {
+		stats->transitions[stats->transitions_pos] = stats->pending;
+		stats->transitions_pos = (stats->transitions_pos + 1) % STATS_MAX_TRANSITIONS;
+		if (stats->transitions_count < STATS_MAX_TRANSITIONS)
+			stats->transitions_count++;
+	}
+	memset(&stats->pending, 0, sizeof(stats->pending));
+}
+
+/* The internal media source ended, and the next file will be opened */
+void stats_transition_ended(struct mps_stats *stats)
+{
+	pthread_mutex_lock(&stats->trace_mutex);
+	finish_transition(stats);
+	stats->pending.ended_ts = os_gettime_ns();
+	pthread_mutex_unlock(&stats->trace_mutex);
+}
+
+void stats_transition_open(struct mps_stats *stats)
+{
+	pthread_mutex_lock(&stats->trace_mutex);
+	if (stats->pending.open_ts)
+		finish_transition(stats);
+	stats->pending.open_ts = os_gettime_ns();
+	pthread_mutex_unlock(&stats->trace_mutex);
+}
+
+void stats_transition_opened(struct mps_stats *stats)
+{
+	pthread_mutex_lock(&stats->trace_mutex);
+	stats->pending.opened_ts = os_gettime_ns();
+	os_atomic_set_bool(&stats->waiting_video, true);
+	os_atomic_set_bool(&stats->waiting_audio, true);
+	pthread_mutex_unlock(&stats->trace_mutex);
+}
+
+static inline uint64_t transition_start(const struct stats_transition *transition)
+{
+	return transition->ended_ts ? transition->ended_ts : transition->open_ts;
+}
+
+void stats_transition_video(struct mps_stats *stats)
+{
+	if (!os_atomic_load_bool(&stats->waiting_video))
+		return;
+
+	pthread_mutex_lock(&stats->trace_mutex);
+	if (os_atomic_load_bool(&stats->waiting_video)) {
+		stats->pending.video_ts = os_gettime_ns();
+		stats_hist_record(&stats->timers[STATS_TIMER_GAP_VIDEO],
+				  (stats->pending.video_ts - transition_start(&stats->pending)) / 1000);
+		os_atomic_set_bool(&stats->waiting_video, false);
+		if (!os_atomic_load_bool(&stats->waiting_audio))
+			finish_transition(stats);
+	}
+	pthread_mutex_unlock(&stats->trace_mutex);
+}
+
+void stats_transition_audio(struct mps_stats *stats)
+{
+	if (!os_atomic_load_bool(&stats->waiting_audio))
+		return;
+
+	pthread_mutex_lock(&stats->trace_mutex);
+	if (os_atomic_load_bool(&stats->waiting_audio)) {
+		stats->pending.audio_ts = os_gettime_ns();
+		stats_hist_record(&stats->timers[STATS_TIMER_GAP_AUDIO],
+				  (stats->pending.audio_ts - transition_start(&stats->pending)) / 1000);
+		os_atomic_set_bool(&stats->waiting_audio, false);
+		if (!os_atomic_load_bool(&stats->waiting_video))
+			finish_transition(stats);
+	}
+	pthread_mutex_unlock(&stats->trace_mutex);
+}
+
+static void add_trace_event(obs_data_array_t *events, const char *name, long long tid, uint64_t begin_ts,
+			    uint64_t end_ts)
+{
+	if (!begin_ts || !end_ts)
+		return;
+
+	obs_data_t *event = obs_data_create();
+	obs_data_set_string(event, "name", name);
+	obs_data_set_string(event, "ph", "X");
+	obs_data_set_int(event, "pid", 1);
+	obs_data_set_int(event, "tid", tid);
+	obs_data_set_int(event, "ts", (long long)(begin_ts / 1000));
+	obs_data_set_int(event, "dur", (long long)((end_ts - begin_ts) / 1000));
+	obs_data_array_push_back(events, event);
+	obs_data_release(event);
+}
+
+/* Writes the recorded transitions in the Chrome trace event format, which can
+ * be opened in chrome://tracing or https://ui.perfetto.dev. The video thread
+ * is tid 1, and the audio thread is tid 2.
+ */
+bool stats_export_trace(struct mps_stats *stats, const char *path, const char *source_name)
+{
+	struct stats_transition *transitions = bzalloc(sizeof(stats->transitions));
+	size_t count;
+
+	pthread_mutex_lock(&stats->trace_mutex);
+	count = stats->transitions_count;
+	for (size_t i = 0; i < count; i++) {
+		size_t pos = (stats->transitions_pos + STATS_MAX_TRANSITIONS - count + i) % STATS_MAX_TRANSITIONS;
+		transitions[i] = stats->transitions[pos];
+	}
+	pthread_mutex_unlock(&stats->trace_mutex);
+
+	obs_data_t *root = obs_data_create();
+	obs_data_array_t *events = obs_data_array_create();
+
+	obs_data_t *process_name = obs_data_create();
+	obs_data_t *args = obs_data_create();
+	obs_data_set_string(args, "name", source_name);
+	obs_data_set_string(process_name, "name", "process_name");
+	obs_data_set_string(process_name, "ph", "M");
+	obs_data_set_int(process_name, "pid", 1);
+	obs_data_set_obj(process_name, "args", args);
+	obs_data_array_push_back(events, process_name);
+	obs_data_release(args);
+	obs_data_release(process_name);
+
+	for (size_t i = 0; i < count; i++) {
+		const struct stats_transition *t = &transitions[i];
+		add_trace_event(events, "Waiting for next file", 1, t->ended_ts, t->open_ts);
+		add_trace_event(events, "Opening file", 1, t->open_ts, t->opened_ts);
+		add_trace_event(events, "Waiting for first frame", 1, t->opened_ts, t->video_ts);
+		add_trace_event(events, "Waiting for first audio", 2, t->opened_ts, t->audio_ts);
+	}
+
+	obs_data_set_array(root, "traceEvents", events);
+	obs_data_set_string(root, "displayTimeUnit", "ms");
+	bool success = obs_data_save_json(root, path);
+	if (!success)
+		obs_log(LOG_WARNING, "[%s] Failed to write trace to %s", source_name, path);
+
+	obs_data_array_release(events);
+	obs_data_release(root);
+	bfree(transitions);
+	return success;
+}
+
+static obs_data_t *hist_get_data(const struct stats_hist *hist)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_set_int(data, "count", stats_hist_count(hist));
+	obs_data_set_int(data, "p50", stats_hist_percentile(hist, 50.0));
+	obs_data_set_int(data, "p95", stats_hist_percentile(hist, 95.0));
+	obs_data_set_int(data, "p99", stats_hist_percentile(hist, 99.0));
+	obs_data_set_int(data, "max", os_atomic_load_long(&hist->max));
+	return data;
+}
+
+obs_data_t *stats_get_data(struct mps_stats *stats)
+{
+	obs_data_t *data = obs_data_create();
+	obs_data_t *timers = obs_data_create();
+	obs_data_t *counters = obs_data_create();
+
+	for (size_t i = 0; i < STATS_TIMER_COUNT; i++) {
+		obs_data_t *timer = hist_get_data(&stats->timers[i]);
+		obs_data_set_obj(timers, timer_names[i], timer);
+		obs_data_release(timer);
+	}
+	for (size_t i = 0; i < STATS_COUNTER_COUNT; i++)
+		obs_data_set_int(counters, counter_names[i], os_atomic_load_long(&stats->counters[i]));
+
+	obs_data_t *audio_queue = hist_get_data(&stats->audio_queue);
+	obs_data_set_obj(data, "timers_us", timers);
+	obs_data_set_obj(data, "counters", counters);
+	obs_data_set_obj(data, "audio_queue", audio_queue);
+
+	obs_data_release(audio_queue);
+	obs_data_release(counters);
+	obs_data_release(timers);
+	return data;
+}
+
+void stats_log(struct mps_stats *stats, const char *source_name)
+{
+	for (size_t i = 0; i < STATS_TIMER_COUNT; i++) {
+		const struct stats_hist *hist = &stats->timers[i];
+		long count = stats_hist_count(hist);
+		if (!count)
+			continue;
+
+		obs_log(LOG_DEBUG, "[%s] %s: %ld times, p50 %" PRIu64 "us, p99 %" PRIu64 "us, max %ldus", source_name,
+			timer_names[i], count, stats_hist_percentile(hist, 50.0), stats_hist_percentile(hist, 99.0),
+			os_atomic_load_long(&hist->max));
+	}
+
+	obs_log(LOG_DEBUG, "[%s] audio queue: p99 %" PRIu64 "ms, max %ldms, %ld packets dropped", source_name,
+		stats_hist_percentile(&stats->audio_queue, 99.0), os_atomic_load_long(&stats->audio_queue.max),
+		os_atomic_load_long(&stats->counters[STATS_COUNTER_AUDIO_DROPPED]));
+}
@@ -0,0 +1,131 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+#include <util/threading.h>
+#include <util/platform.h>
+
+/* clang-format off */
+
+enum stats_timer {
+	STATS_TIMER_UPDATE,          // mps_update
+	STATS_TIMER_FOLDER_SCAN,     // add_file, only for folders
+	STATS_TIMER_SHUFFLER_UPDATE, // shuffler_update_files
+	STATS_TIMER_TRANSITION,      // opening a file in the internal media source
+	STATS_TIMER_GAP_VIDEO,       // end of a file (or a request) until the next file shows a frame
+	STATS_TIMER_GAP_AUDIO,       // end of a file (or a request) until the next file sends audio
+	STATS_TIMER_COUNT,
+};
+
+enum stats_counter {
+	STATS_COUNTER_FOLDER_ITEMS,      // folder items found while scanning
+	STATS_COUNTER_NAV_POSTED,        // Next/Previous/Select/end of file requests
+	STATS_COUNTER_NAV_PROCESSED,     // requests left after merging
+	STATS_COUNTER_AUDIO_PACKETS,     // packets relayed from the internal media source
+	STATS_COUNTER_AUDIO_DROPPED,     // packets dropped because the relay was full
+	STATS_COUNTER_AUDIO_RESYNCS,     // times the relayed timestamps jumped to the child's
+	STATS_COUNTER_LOUDNESS_ANALYZED, // files measured and added to the loudness cache
+	STATS_COUNTER_IDLE_RELEASES,     // files closed because the source was hidden
+	STATS_COUNTER_DECODER_EVICTIONS, // files closed to stay within the decoder pool's limit
+	STATS_COUNTER_FAST_FAILS,        // files quarantined because they didn't start in time
+	STATS_COUNTER_COUNT,
+};
+
+/* clang-format on */
+
+#define STATS_HIST_BUCKETS 32
+#define STATS_LOG_INTERVAL_NS 60000000000ULL
+#define STATS_MAX_TRANSITIONS 256
+
+/* Bucket i counts values that are i bits long, so bucket 0 only counts 0,
+ * and bucket i counts values from 2^(i-1) up to 2^i - 1. Timers are recorded
+ * in microseconds. The last bucket also counts anything bigger.
+ */
+struct stats_hist {
+	volatile long buckets[STATS_HIST_BUCKETS];
+	volatile long max;
+};
+
+/* Timestamps of one change of file, in os_gettime_ns. `ended_ts` is 0 if the
+ * change was requested rather than caused by the end of the previous file, and
+ * `video_ts`/`audio_ts` are 0 if the new file never got that far.
+ */
+struct stats_transition {
+	uint64_t ended_ts;
+	uint64_t open_ts;
+	uint64_t opened_ts;
+	uint64_t video_ts;
+	uint64_t audio_ts;
+};
+
+/* Counters and histograms are updated with atomics, so recording never takes a
+ * lock and can be done from any thread. Only the transition being traced uses
+ * `trace_mutex`, and the render and audio threads check `waiting_video` and
+ * `waiting_audio` before taking it.
+ */
+struct mps_stats {
+	struct stats_hist timers[STATS_TIMER_COUNT];
+	struct stats_hist audio_queue; // milliseconds of audio waiting to be relayed, sampled on each tick
+	volatile long counters[STATS_COUNTER_COUNT];
+	uint64_t last_log_ts; // only used by the video thread
+
+	pthread_mutex_t trace_mutex;
+	struct stats_transition pending;
+	volatile bool waiting_video;
+	volatile bool waiting_audio;
+	struct stats_transition transitions[STATS_MAX_TRANSITIONS]; // ring buffer
+	size_t transitions_pos;
+	size_t transitions_count;
+};
+
+extern bool stats_init(struct mps_stats *stats);
+extern void stats_free(struct mps_stats *stats);
+
+extern void stats_hist_record(struct stats_hist *hist, uint64_t value);
+extern long stats_hist_count(const struct stats_hist *hist);
+extern uint64_t stats_hist_percentile(const struct stats_hist *hist, double percentile);
+
+static inline void stats_add(struct mps_stats *stats, enum stats_counter counter, long n)
+{
+	volatile long *val = &stats->counters[counter];
+	long old_val = os_atomic_load_long(val);
+	while (!os_atomic_compare_exchange_long(val, &old_val, old_val + n))
+		;
+}
+
+static inline uint64_t stats_timer_begin(void)
+{
+	return os_gettime_ns();
+}
+
+static inline void stats_timer_end(struct mps_stats *stats, enum stats_timer timer, uint64_t start_ts)
+{
+	stats_hist_record(&stats->timers[timer], (os_gettime_ns() - start_ts) / 1000);
+}
+
+extern void stats_transition_ended(struct mps_stats *stats);
+extern void stats_transition_open(struct mps_stats *stats);
+extern void stats_transition_opened(struct mps_stats *stats);
+extern void stats_transition_video(struct mps_stats *stats);
+extern void stats_transition_audio(struct mps_stats *stats);
+extern bool stats_export_trace(struct mps_stats *stats, const char *path, const char *source_name);
+
+extern obs_data_t *stats_get_data(struct mps_stats *stats);
+extern void stats_log(struct mps_stats *stats, const char *source_name);
@@ -0,0 +1,470 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <plugin-support.h>
+#ifdef HAVE_CURL
+#include <curl/curl.h>
+#endif
+#include "url-cache.h"
+
+#define CONNECT_TIMEOUT_S 10
+#define LOW_SPEED_TIME_S 30
+#define MAX_EXTENSION_LEN 8
+
+struct cached_url {
+	char *url;
+	char *file; // in URL_CACHE_DIR
+	uint64_t size;
+	uint64_t used; // higher is more recent
+};
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool loaded = false;
+static char *dir_path = NULL;
+static char *index_path = NULL;
+static DARRAY(struct cached_url) entries;
+static uint64_t total_size = 0;
+static uint64_t max_size = 2048ULL * 1024 * 1024;
+static uint64_t next_use = 1;
+
+#ifdef HAVE_CURL
+static DARRAY(char *) queue;
+static pthread_t thread;
+static bool thread_active = false;
+static os_event_t *event = NULL;
+static volatile bool stop = false;
+#endif
+
+static bool is_cacheable(const char *url)
+{
+	return astrcmpi_n(url, "http://", 7) == 0 || astrcmpi_n(url, "https://", 8) == 0;
+}
+
+static char *get_file_path(const char *file)
+{
+	struct dstr path = {0};
+	dstr_copy(&path, dir_path);
+	dstr_cat(&path, file);
+	return path.array;
+}
+
+static void free_entry(struct cached_url *entry)
+{
+	bfree(entry->url);
+	bfree(entry->file);
+}
+
+/* Requires `cache_mutex` */
+static size_t find_entry(const char *url)
+{
+	for (size_t i = 0; i < entries.num; i++) {
+		if (strcmp(entries.array[i].url, url) == 0)
+			return i;
+	}
+	return DARRAY_INVALID;
+}
+
+/* Requires `cache_mutex`. Files that were removed since are left out. */
+static void load_index(void)
+{
+	if (loaded)
+		return;
+	loaded = true;
+
+	dir_path = obs_module_config_path(URL_CACHE_DIR);
+	index_path = obs_module_config_path(URL_CACHE_INDEX_FILE);
+	if (!dir_path || !index_path)
+		return;
+	os_mkdirs(dir_path);
+
+	obs_data_t *index = obs_data_create_from_json_file_safe(index_path, "bak");
+	obs_data_array_t *files = obs_data_get_array(index, "files");
+	size_t count = obs_data_array_count(files);
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(files, i);
+		const char *file = obs_data_get_string(item, "file");
+		char *path = get_file_path(file);
+
+		if (*file && os_file_exists(path)) {
+			struct cached_url *entry = da_push_back_new(entries);
+			entry->url = bstrdup(obs_data_get_string(item, "url"));
+			entry->file = bstrdup(file);
+			entry->size = (uint64_t)obs_data_get_int(item, "size");
+			entry->used = (uint64_t)obs_data_get_int(item, "used");
+			total_size += entry->size;
+			if (entry->used >= next_use)
+				next_use = entry->used + 1;
+		}
+
+		bfree(path);
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(files);
+	obs_data_release(index);
+}
+
+/* Requires `cache_mutex` */
+static void save_index(void)
+{
+	if (!index_path)
+		return;
+
+	obs_data_t *index = obs_data_create();
+	obs_data_array_t *files = obs_data_array_create();
+	for (size_t i = 0; i < entries.num; i++) {
+		const struct cached_url *entry = &entries.array[i];
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "url", entry->url);
+		obs_data_set_string(item, "file", entry->file);
+		obs_data_set_int(item, "size", (long long)entry->size);
+		obs_data_set_int(item, "used", (long long)entry->used);
+		obs_data_array_push_back(files, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(index, "files", files);
+	if (!obs_data_save_json_safe(index, index_path, "tmp", "bak"))
+		obs_log(LOG_WARNING, "Failed to save URL cache index to '%s'", index_path);
+
+	obs_data_array_release(files);
+	obs_data_release(index);
+}
+
+static int compare_used(const void *a, const void *b)
+{
+	const struct cached_url *entry_a = a;
+	const struct cached_url *entry_b = b;
+	return entry_a->used < entry_b->used ? -1 : entry_a->used > entry_b->used;
+}
+
+/* Removes the least recently used files until the cache fits. A file that
+ * can't be removed, like one being played on Windows, is kept for now.
+ * Requires `cache_mutex`.
+ */
+static void evict(void)
+{
+	if (total_size <= max_size)
+		return;
+
+	qsort(entries.array, entries.num, sizeof(*entries.array), compare_used);
+	for (size_t i = 0; i < entries.num && total_size > max_size; i++) {
+		struct cached_url *entry = &entries.array[i];
+		char *path = get_file_path(entry->file);
+		if (os_unlink(path) == 0 || !os_file_exists(path)) {
+			total_size -= entry->size;
+			free_entry(entry);
+			entry->url = NULL;
+		}
+		bfree(path);
+	}
+
+	for (size_t i = entries.num; i > 0; i--) {
+		if (!entries.array[i - 1].url)
+			da_erase(entries, i - 1);
+	}
+}
+
+void url_cache_set_max_size(uint64_t bytes)
+{
+	pthread_mutex_lock(&cache_mutex);
+	max_size = bytes;
+	if (loaded && total_size > max_size) {
+		evict();
+		save_index();
+	}
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+char *url_cache_get(const char *url)
+{
+	char *path = NULL;
+
+	if (!is_cacheable(url))
+		return NULL;
+
+	pthread_mutex_lock(&cache_mutex);
+	load_index();
+	size_t idx = find_entry(url);
+	if (idx != DARRAY_INVALID) {
+		struct cached_url *entry = &entries.array[idx];
+		path = get_file_path(entry->file);
+		if (os_file_exists(path)) {
+			entry->used = next_use++;
+		} else {
+			total_size -= entry->size;
+			free_entry(entry);
+			da_erase(entries, idx);
+			bfree(path);
+			path = NULL;
+		}
+		save_index();
+	}
+	pthread_mutex_unlock(&cache_mutex);
+	return path;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Downloads */
+
+#ifdef HAVE_CURL
+
+struct transfer {
+	CURL *curl;
+	FILE *file;
+	uint64_t max_size;
+	uint64_t written;
+	bool checked;
+	bool rejected; // no size, or too big for the cache
+};
+
+static size_t write_data(char *ptr, size_t size, size_t nmemb, void *param)
+{
+	struct transfer *transfer = param;
+	size_t len = size * nmemb;
+
+	if (!transfer->checked) {
+		curl_off_t length = -1;
+		curl_easy_getinfo(transfer->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+		transfer->checked = true;
+		transfer->rejected = length < 0 || (uint64_t)length > transfer->max_size;
+	}
+	if (transfer->rejected || transfer->written + len > transfer->max_size) {
+		transfer->rejected = true;
+		return 0;
+	}
+	if (fwrite(ptr, 1, len, transfer->file) != len)
+		return 0;
+
+	transfer->written += len;
+	return len;
+}
+
+static int check_stop(void *param, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(dltotal);
+	UNUSED_PARAMETER(dlnow);
+	UNUSED_PARAMETER(ultotal);
+	UNUSED_PARAMETER(ulnow);
+	return os_atomic_load_bool(&stop) ? 1 : 0;
+}
+
+/* Files are named after a hash of their URL, and keep its extension */
+static char *get_file_name(const char *url)
+{
+	struct dstr name = {0};
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (const char *c = url; *c; c++) {
+		hash ^= (uint8_t)*c;
+		hash *= 0x100000001b3ULL;
+	}
+	dstr_printf(&name, "%016" PRIx64, hash);
+
+	size_t path_len = strcspn(url, "?#");
+	const char *dot = NULL;
+	for (const char *c = url; c < url + path_len; c++) {
+		if (*c == '.')
+			dot = c;
+		else if (*c == '/')
+			dot = NULL;
+	}
+	if (dot) {
+		size_t len = url + path_len - dot;
+		bool valid = len > 1 && len <= MAX_EXTENSION_LEN;
+		for (size_t i = 1; valid && i < len; i++)
+			valid = isalnum((unsigned char)dot[i]) != 0;
+		if (valid)
+			dstr_ncat(&name, dot, len);
+	}
+	return name.array;
+}
+
+static void download(const char *url)
+{
+	struct transfer transfer = {0};
+	struct dstr part_path = {0};
+	char *file_name = get_file_name(url);
+	char *path;
+
+	pthread_mutex_lock(&cache_mutex);
+	bool cached = find_entry(url) != DARRAY_INVALID;
+	path = get_file_path(file_name);
+	transfer.max_size = max_size;
+	pthread_mutex_unlock(&cache_mutex);
+
+	if (cached)
+		goto done;
+
+	dstr_printf(&part_path, "%s.part", path);
+	transfer.file = os_fopen(part_path.array, "wb");
+	if (!transfer.file) {
+		obs_log(LOG_WARNING, "Failed to create '%s' for the URL cache", part_path.array);
+		goto done;
+	}
+
+	transfer.curl = curl_easy_init();
+	curl_easy_setopt(transfer.curl, CURLOPT_URL, url);
+	curl_easy_setopt(transfer.curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(transfer.curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(transfer.curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(transfer.curl, CURLOPT_CONNECTTIMEOUT, (long)CONNECT_TIMEOUT_S);
+	curl_easy_setopt(transfer.curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+	curl_easy_setopt(transfer.curl, CURLOPT_LOW_SPEED_TIME, (long)LOW_SPEED_TIME_S);
+	curl_easy_setopt(transfer.curl, CURLOPT_WRITEFUNCTION, write_data);
+	curl_easy_setopt(transfer.curl, CURLOPT_WRITEDATA, &transfer);
+	curl_easy_setopt(transfer.curl, CURLOPT_XFERINFOFUNCTION, check_stop);
+	curl_easy_setopt(transfer.curl, CURLOPT_NOPROGRESS, 0L);
+
+	CURLcode res = curl_easy_perform(transfer.curl);
+	bool success = fclose(transfer.file) == 0 && res == CURLE_OK && transfer.written;
+	if (!success && !transfer.rejected && !os_atomic_load_bool(&stop))
+		obs_log(LOG_WARNING, "Failed to download '%s' to the URL cache: %s", url, curl_easy_strerror(res));
+	curl_easy_cleanup(transfer.curl);
+
+	pthread_mutex_lock(&cache_mutex);
+	if (success && os_safe_replace(path, part_path.array, NULL) == 0) {
+		struct cached_url *entry = da_push_back_new(entries);
+		entry->url = bstrdup(url);
+		entry->file = file_name;
+		entry->size = transfer.written;
+		entry->used = next_use++;
+		total_size += entry->size;
+		file_name = NULL;
+		evict();
+		save_index();
+	} else {
+		os_unlink(part_path.array);
+	}
+	pthread_mutex_unlock(&cache_mutex);
+
+done:
+	dstr_free(&part_path);
+	bfree(file_name);
+	bfree(path);
+}
+
+static void *download_thread(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	os_set_thread_name("media-playlist-source: url cache");
+
+	while (os_event_wait(event) == 0 && !os_atomic_load_bool(&stop)) {
+		while (!os_atomic_load_bool(&stop)) {
+			pthread_mutex_lock(&cache_mutex);
+			char *url = queue.num ? queue.array[0] : NULL;
+			if (url)
+				da_erase(queue, 0);
+			pthread_mutex_unlock(&cache_mutex);
+			if (!url)
+				break;
+
+			download(url);
+			bfree(url);
+		}
+	}
+	return NULL;
+}
+
+/* Requires `cache_mutex` */
+static bool start_thread(void)
+{
+	if (thread_active)
+		return true;
+
+	if (!event && os_event_init(&event, OS_EVENT_TYPE_AUTO) != 0)
+		return false;
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+	thread_active = pthread_create(&thread, NULL, download_thread, NULL) == 0;
+	return thread_active;
+}
+
+void url_cache_prefetch(const char *url)
+{
+	if (!is_cacheable(url))
+		return;
+
+	pthread_mutex_lock(&cache_mutex);
+	load_index();
+	bool queued = !dir_path || find_entry(url) != DARRAY_INVALID;
+	for (size_t i = 0; !queued && i < queue.num; i++)
+		queued = strcmp(queue.array[i], url) == 0;
+	if (!queued && start_thread()) {
+		char *copy = bstrdup(url);
+		da_push_back(queue, &copy);
+		os_event_signal(event);
+	}
+	pthread_mutex_unlock(&cache_mutex);
+}
+
+static void stop_thread(void)
+{
+	if (thread_active) {
+		os_atomic_set_bool(&stop, true);
+		os_event_signal(event);
+		pthread_join(thread, NULL);
+		thread_active = false;
+		curl_global_cleanup();
+	}
+	os_event_destroy(event);
+	event = NULL;
+	os_atomic_set_bool(&stop, false);
+
+	for (size_t i = 0; i < queue.num; i++)
+		bfree(queue.array[i]);
+	da_free(queue);
+}
+
+#else
+
+void url_cache_prefetch(const char *url)
+{
+	UNUSED_PARAMETER(url);
+}
+
+static void stop_thread(void) {}
+
+#endif
+
+void url_cache_free(void)
+{
+	stop_thread();
+
+	pthread_mutex_lock(&cache_mutex);
+	for (size_t i = 0; i < entries.num; i++)
+		free_entry(&entries.array[i]);
+	da_free(entries);
+	total_size = 0;
+	next_use = 1;
+	bfree(dir_path);
+	bfree(index_path);
+	dir_path = NULL;
+	index_path = NULL;
+	loaded = false;
+	pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,47 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include <obs.h>
+
+/* Files of URL items, downloaded on a thread of their own before they are
+ * played, and shared by all sources. They are kept in the plugin's config
+ * folder, under `url-cache/`, and the least recently used ones are removed
+ * when the cache grows over its size.
+ *
+ * Only http and https files whose size the server reports are downloaded, so
+ * live streams are always played from the network. Without libcurl, nothing
+ * is ever cached.
+ */
+#define URL_CACHE_DIR "url-cache/"
+#define URL_CACHE_INDEX_FILE "url-cache/index.json"
+
+/* The cache is shared, so the size set last is used */
+extern void url_cache_set_max_size(uint64_t bytes);
+
+/* Queues the URL to be downloaded, if it isn't cached or queued already */
+extern void url_cache_prefetch(const char *url);
+
+/* Returns the path of the downloaded file, to be freed with bfree, or NULL if
+ * it isn't downloaded yet. The file is marked as the most recently used.
+ */
+extern char *url_cache_get(const char *url);
+
+/* Stops the download thread, aborting the current download */
+extern void url_cache_free(void);
@@ -0,0 +1,216 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Times the folder scan path (add_file, valid_extension, set_parents and
+ * free_files) on synthetic folder trees, and sorting all of a tree's files by
+ * name as if they were in one folder. The trees are made on tmpfs when
+ * there is one, so the numbers show the plugin's cost rather than the disk.
+ *
+ *   bench-scan [--files N] [--dir PATH]
+ *
+ * Without --files, trees of 1k, 10k and 100k files are scanned. */
+
+#include "../src/media-playlist-source.c"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#define FILES_PER_FOLDER 200
+#define EXTENSION_PASSES 10
+
+/* Mostly media, but also files that must be skipped, in different cases */
+static const char *extensions[] = {".mp4", ".mkv", ".webm", ".mp3", ".flac", ".MOV", ".txt", ".jpg", ".nfo", ".Mp4"};
+
+struct tree {
+	DARRAY(char *) folders;
+	DARRAY(char *) files;
+};
+
+static size_t peak_rss_kb(void)
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return 0;
+	return pmc.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return (size_t)usage.ru_maxrss / 1024;
+#else
+	return (size_t)usage.ru_maxrss;
+#endif
+#endif
+}
+
+static double elapsed_sec(uint64_t start_ts)
+{
+	return (double)(os_gettime_ns() - start_ts) / 1e9;
+}
+
+/* Folders are nested as a binary tree, so 100k files are 9 levels deep */
+static void make_tree(struct tree *tree, const char *base, size_t file_count)
+{
+	size_t folder_count = (file_count + FILES_PER_FOLDER - 1) / FILES_PER_FOLDER;
+	struct dstr path = {0};
+
+	da_init(tree->folders);
+	da_init(tree->files);
+
+	for (size_t i = 0; i < folder_count; i++) {
+		if (i == 0)
+			dstr_printf(&path, "%s/mps-bench-%zu", base, file_count);
+		else
+			dstr_printf(&path, "%s/d%zu", tree->folders.array[(i - 1) / 2], i);
+		os_mkdirs(path.array);
+		char *folder = bstrdup(path.array);
+		da_push_back(tree->folders, &folder);
+	}
+
+	for (size_t i = 0; i < file_count; i++) {
+		const char *ext = extensions[i % (sizeof(extensions) / sizeof(extensions[0]))];
+		dstr_printf(&path, "%s/file %zu%s", tree->folders.array[i / FILES_PER_FOLDER], i, ext);
+		FILE *file = os_fopen(path.array, "wb");
+		if (file)
+			fclose(file);
+		char *name = bstrdup(path.array);
+		da_push_back(tree->files, &name);
+	}
+
+	dstr_free(&path);
+}
+
+static void remove_tree(struct tree *tree)
+{
+	for (size_t i = 0; i < tree->files.num; i++) {
+		os_unlink(tree->files.array[i]);
+		bfree(tree->files.array[i]);
+	}
+	for (size_t i = tree->folders.num; i > 0; i--) {
+		os_rmdir(tree->folders.array[i - 1]);
+		bfree(tree->folders.array[i - 1]);
+	}
+	da_free(tree->files);
+	da_free(tree->folders);
+}
+
+static void bench(const char *base, size_t file_count)
+{
+	struct tree tree;
+	struct mps_stats stats = {0};
+	DARRAY(struct media_file_data) files;
+	size_t folder_items = 0;
+	size_t valid = 0;
+	char id[32];
+
+	make_tree(&tree, base, file_count);
+	da_init(files);
+
+	uint64_t start_ts = os_gettime_ns();
+	for (size_t i = 0; i < tree.folders.num; i++) {
+		snprintf(id, sizeof(id), "id-%zu", i);
+		add_file(&files.da, tree.folders.array[i], id, FOLDER_SORT_NONE, false, &stats);
+	}
+	double add_file_sec = elapsed_sec(start_ts);
+
+	start_ts = os_gettime_ns();
+	for (size_t pass = 0; pass < EXTENSION_PASSES; pass++) {
+		for (size_t i = 0; i < tree.files.num; i++)
+			valid += valid_extension(os_get_path_extension(tree.files.array[i]));
+	}
+	double valid_extension_sec = elapsed_sec(start_ts);
+
+	struct folder_sort_keys keys;
+	folder_sort_init(&keys, FOLDER_SORT_NAME);
+	start_ts = os_gettime_ns();
+	for (size_t i = 0; i < tree.files.num; i++)
+		folder_sort_add(&keys, tree.files.array[i], 0, 0);
+	folder_sort_run(&keys, false);
+	double sort_sec = elapsed_sec(start_ts);
+	for (size_t i = 1; i < keys.keys.num; i++) {
+		const struct folder_sort_key *a = &keys.keys.array[i - 1];
+		const struct folder_sort_key *b = &keys.keys.array[i];
+		int cmp = memcmp(keys.data.array + a->offset, keys.data.array + b->offset,
+				 a->size < b->size ? a->size : b->size);
+		assert(cmp < 0 || (cmp == 0 && a->size <= b->size));
+	}
+	folder_sort_free(&keys);
+
+	start_ts = os_gettime_ns();
+	set_parents(&files.da);
+	double set_parents_sec = elapsed_sec(start_ts);
+
+	for (size_t i = 0; i < files.num; i++)
+		folder_items += files.array[i].folder_items.num;
+
+	start_ts = os_gettime_ns();
+	free_files(&files.da);
+	double free_files_sec = elapsed_sec(start_ts);
+
+	printf("%8zu files %5zu folders | add_file %10.0f files/s (%zu media) | valid_extension %10.0f calls/s | "
+	       "sort by name %7.3f ms | set_parents %7.3f ms | free_files %7.3f ms | peak RSS %zu KB\n",
+	       file_count, tree.folders.num, (double)file_count / add_file_sec, folder_items,
+	       (double)(tree.files.num * EXTENSION_PASSES) / valid_extension_sec, sort_sec * 1000.0,
+	       set_parents_sec * 1000.0, free_files_sec * 1000.0, peak_rss_kb());
+
+	assert(valid == folder_items * EXTENSION_PASSES);
+	remove_tree(&tree);
+}
+
+static const char *default_base(void)
+{
+	if (os_file_exists("/dev/shm"))
+		return "/dev/shm";
+	const char *tmp = getenv("TMPDIR");
+	if (!tmp)
+		tmp = getenv("TEMP");
+	return tmp ? tmp : ".";
+}
+
+int main(int argc, char **argv)
+{
+	const char *base = default_base();
+	size_t file_count = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--files") == 0 && i + 1 < argc) {
+			file_count = strtoul(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc) {
+			base = argv[++i];
+		} else {
+			fprintf(stderr, "usage: %s [--files N] [--dir PATH]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (file_count) {
+		bench(base, file_count);
+	} else {
+		bench(base, 1000);
+		bench(base, 10000);
+		bench(base, 100000);
+	}
+	return 0;
+}
@@ -0,0 +1,113 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <obs.h>
+#include <util/dstr.h>
+#include "http-stand-in.h"
+
+static bool send_all(int fd, const char *data, size_t size)
+{
+	while (size) {
+		ssize_t sent = send(fd, data, size, 0);
+		if (sent <= 0)
+			return false;
+		data += sent;
+		size -= (size_t)sent;
+	}
+	return true;
+}
+
+static void handle_client(struct http_stand_in *server, int fd)
+{
+	char request[2048];
+	size_t len = 0;
+
+	while (len < sizeof(request) - 1) {
+		ssize_t received = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+		if (received <= 0)
+			return;
+		len += (size_t)received;
+		request[len] = 0;
+		if (strstr(request, "\r\n\r\n"))
+			break;
+	}
+	os_atomic_inc_long(&server->requests);
+
+	bool live = strncmp(request, "GET /live", 9) == 0;
+	struct dstr header = {0};
+	dstr_copy(&header, "HTTP/1.1 200 OK\r\nContent-Type: video/mp4\r\nConnection: close\r\n");
+	if (!live)
+		dstr_catf(&header, "Content-Length: %zu\r\n", server->body_size);
+	dstr_cat(&header, "\r\n");
+
+	char *body = bzalloc(server->body_size);
+	if (send_all(fd, header.array, header.len))
+		send_all(fd, body, server->body_size);
+	bfree(body);
+	dstr_free(&header);
+}
+
+static void *server_thread(void *data)
+{
+	struct http_stand_in *server = data;
+
+	while (true) {
+		int fd = accept(server->fd, NULL, NULL);
+		if (fd < 0)
+			break;
+		handle_client(server, fd);
+		close(fd);
+	}
+	return NULL;
+}
+
+bool http_stand_in_start(struct http_stand_in *server, size_t body_size)
+{
+	struct sockaddr_in addr = {0};
+	socklen_t addr_len = sizeof(addr);
+
+	memset(server, 0, sizeof(*server));
+	server->body_size = body_size;
+	server->fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (server->fd < 0)
+		return false;
+
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(server->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(server->fd, 8) != 0 ||
+	    getsockname(server->fd, (struct sockaddr *)&addr, &addr_len) != 0 ||
+	    pthread_create(&server->thread, NULL, server_thread, server) != 0) {
+		close(server->fd);
+		return false;
+	}
+
+	server->port = ntohs(addr.sin_port);
+	return true;
+}
+
+void http_stand_in_stop(struct http_stand_in *server)
+{
+	shutdown(server->fd, SHUT_RDWR);
+	close(server->fd);
+	pthread_join(server->thread, NULL);
+}
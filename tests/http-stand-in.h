@@ -0,0 +1,38 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* A local HTTP server for the URL cache tests. Every GET is answered with
+ * `body_size` bytes and their Content-Length, except for paths starting with
+ * /live, which are sent without a length like a live stream. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <util/threading.h>
+
+struct http_stand_in {
+	int fd;
+	int port;
+	size_t body_size;
+	pthread_t thread;
+	volatile long requests;
+};
+
+extern bool http_stand_in_start(struct http_stand_in *server, size_t body_size);
+extern void http_stand_in_stop(struct http_stand_in *server);
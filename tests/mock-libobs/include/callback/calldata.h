@@ -0,0 +1,108 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include "../util/c99defs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Name/value parameter block. Unlike libobs' packed stack this simply keeps
+ * a list of typed values, which is all the harness needs. */
+
+enum calldata_type {
+	CALLDATA_TYPE_INT,
+	CALLDATA_TYPE_FLOAT,
+	CALLDATA_TYPE_BOOL,
+	CALLDATA_TYPE_PTR,
+	CALLDATA_TYPE_STRING,
+};
+
+struct calldata_item;
+
+struct calldata {
+	struct calldata_item *items;
+	size_t num;
+	size_t capacity;
+	bool fixed;
+};
+
+typedef struct calldata calldata_t;
+
+static inline void calldata_init(struct calldata *data)
+{
+	memset(data, 0, sizeof(struct calldata));
+}
+
+EXPORT void calldata_free(struct calldata *data);
+EXPORT void calldata_clear(struct calldata *data);
+
+EXPORT void calldata_set_int(calldata_t *data, const char *name, long long val);
+EXPORT void calldata_set_float(calldata_t *data, const char *name, double val);
+EXPORT void calldata_set_bool(calldata_t *data, const char *name, bool val);
+EXPORT void calldata_set_ptr(calldata_t *data, const char *name, void *ptr);
+EXPORT void calldata_set_string(calldata_t *data, const char *name, const char *str);
+
+EXPORT bool calldata_get_int(const calldata_t *data, const char *name, long long *val);
+EXPORT bool calldata_get_float(const calldata_t *data, const char *name, double *val);
+EXPORT bool calldata_get_bool(const calldata_t *data, const char *name, bool *val);
+EXPORT bool calldata_get_ptr_(const calldata_t *data, const char *name, void **p_ptr);
+EXPORT bool calldata_get_string(const calldata_t *data, const char *name, const char **str);
+
+#define calldata_get_ptr(data, name, p_ptr) calldata_get_ptr_(data, name, (void **)(p_ptr))
+
+static inline long long calldata_int(const calldata_t *data, const char *name)
+{
+	long long val = 0;
+	calldata_get_int(data, name, &val);
+	return val;
+}
+
+static inline double calldata_float(const calldata_t *data, const char *name)
+{
+	double val = 0.0;
+	calldata_get_float(data, name, &val);
+	return val;
+}
+
+static inline bool calldata_bool(const calldata_t *data, const char *name)
+{
+	bool val = false;
+	calldata_get_bool(data, name, &val);
+	return val;
+}
+
+static inline void *calldata_ptr(const calldata_t *data, const char *name)
+{
+	void *val = NULL;
+	calldata_get_ptr_(data, name, &val);
+	return val;
+}
+
+static inline const char *calldata_string(const calldata_t *data, const char *name)
+{
+	const char *val = NULL;
+	calldata_get_string(data, name, &val);
+	return val;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,39 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include "calldata.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct proc_handler;
+typedef struct proc_handler proc_handler_t;
+typedef void (*proc_handler_proc_t)(void *data, calldata_t *cd);
+
+EXPORT proc_handler_t *proc_handler_create(void);
+EXPORT void proc_handler_destroy(proc_handler_t *handler);
+
+EXPORT void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_handler_proc_t proc, void *data);
+EXPORT bool proc_handler_call(proc_handler_t *handler, const char *name, calldata_t *params);
+
+#ifdef __cplusplus
+}
+#endif
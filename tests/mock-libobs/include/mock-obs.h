@@ -0,0 +1,80 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Controls of the stand-in libobs that only the harness uses. Time in the
+ * harness is virtual: nothing advances until mock_tick() is called. */
+
+#pragma once
+
+#include "obs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*mock_audio_output_cb)(void *param, obs_source_t *source, const struct obs_source_audio *audio);
+
+EXPORT void mock_obs_startup(void);
+EXPORT void mock_obs_shutdown(void);
+EXPORT void mock_set_config_dir(const char *dir);
+EXPORT void mock_set_speakers(enum speaker_layout speakers);
+EXPORT void mock_set_next_uuid(const char *uuid);
+
+/* Advances the virtual clock: fake media children first, then the video
+ * tick of every public source */
+EXPORT void mock_tick(uint32_t milliseconds);
+EXPORT uint64_t mock_time_ns(void);
+/* While stalled, mock_tick() only advances the fake media, like a stuck
+ * graphics thread */
+EXPORT void mock_set_video_stalled(bool stalled);
+EXPORT void mock_render(obs_source_t *source);
+EXPORT void mock_set_active(obs_source_t *source, bool active);
+EXPORT void mock_set_showing(obs_source_t *source, bool showing);
+EXPORT bool mock_press_hotkey(obs_source_t *source, const char *name);
+EXPORT bool mock_click_button(obs_source_t *source, const char *name);
+
+/* Fake ffmpeg_source behaviour, keyed by path */
+EXPORT void mock_media_set_duration(const char *path, int64_t milliseconds);
+/* A broken file reports PLAYING, like ffmpeg_source does before it decodes
+ * anything, but its time doesn't advance and it renders and sends nothing */
+EXPORT void mock_media_set_broken(const char *path, bool broken);
+EXPORT void mock_media_set_amplitude(const char *path, float amplitude);
+/* While blocked, opening a file doesn't return, like one that is slow to open.
+ * mock_media_get_opens_held() is how many opens are waiting. */
+EXPORT void mock_media_set_open_blocked(bool blocked);
+EXPORT long mock_media_get_opens_held(void);
+/* os_stat() doesn't return for paths starting with `prefix` until it is
+ * changed, NULL unblocks all */
+EXPORT void mock_set_stat_blocked(const char *prefix);
+
+/* Fake ffmpeg_source introspection */
+EXPORT obs_source_t *mock_get_active_child(obs_source_t *parent, size_t idx);
+/* Only safe while nothing else can open a file in the media source */
+EXPORT const char *mock_media_get_path(obs_source_t *media);
+EXPORT bool mock_media_has_path(obs_source_t *media, const char *path);
+EXPORT size_t mock_media_get_open_count(obs_source_t *media);
+EXPORT size_t mock_media_get_frames_rendered(obs_source_t *media);
+EXPORT bool mock_media_is_open(obs_source_t *media);
+
+/* Audio that a source hands to obs_source_output_audio */
+EXPORT void mock_set_audio_output_callback(obs_source_t *source, mock_audio_output_cb callback, void *param);
+EXPORT uint64_t mock_get_audio_frames_output(obs_source_t *source);
+
+#ifdef __cplusplus
+}
+#endif
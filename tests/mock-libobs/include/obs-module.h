@@ -0,0 +1,56 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include "obs.h"
+
+#ifdef __cplusplus
+#define MODULE_EXPORT extern "C" EXPORT
+#define MODULE_EXTERN extern "C"
+#else
+#define MODULE_EXPORT EXPORT
+#define MODULE_EXTERN extern
+#endif
+
+typedef struct obs_module obs_module_t;
+
+#define OBS_DECLARE_MODULE()                                  \
+	static obs_module_t *obs_module_pointer;              \
+	MODULE_EXPORT void obs_module_set_pointer(obs_module_t *module); \
+	void obs_module_set_pointer(obs_module_t *module)     \
+	{                                                     \
+		obs_module_pointer = module;                  \
+	}                                                     \
+	obs_module_t *obs_current_module(void)                \
+	{                                                     \
+		return obs_module_pointer;                    \
+	}
+
+#define OBS_MODULE_USE_DEFAULT_LOCALE(module_name, default_locale) \
+	const char *obs_module_text(const char *val)               \
+	{                                                          \
+		return val;                                        \
+	}
+
+MODULE_EXTERN obs_module_t *obs_current_module(void);
+MODULE_EXTERN const char *obs_module_text(const char *lookup_string);
+
+/* Returns a path under the harness' scratch config directory */
+EXPORT char *obs_module_get_config_path(obs_module_t *module, const char *file);
+#define obs_module_config_path(file) obs_module_get_config_path(obs_current_module(), file)
@@ -0,0 +1,397 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include "util/c99defs.h"
+#include "util/bmem.h"
+#include "util/base.h"
+#include "callback/signal.h"
+#include "callback/proc.h"
+#include "media-io/audio-io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* Opaque types */
+
+struct obs_source;
+struct obs_data;
+struct obs_data_array;
+struct obs_properties;
+struct obs_property;
+struct obs_hotkey;
+struct obs_missing_file;
+struct obs_missing_files;
+struct gs_effect;
+
+typedef struct obs_source obs_source_t;
+typedef struct obs_data obs_data_t;
+typedef struct obs_data_array obs_data_array_t;
+typedef struct obs_properties obs_properties_t;
+typedef struct obs_property obs_property_t;
+typedef struct obs_hotkey obs_hotkey_t;
+typedef struct obs_missing_file obs_missing_file_t;
+typedef struct obs_missing_files obs_missing_files_t;
+typedef struct gs_effect gs_effect_t;
+typedef size_t obs_hotkey_id;
+
+#define OBS_INVALID_HOTKEY_ID (~(obs_hotkey_id)0)
+
+/* ------------------------------------------------------------------------- */
+/* Settings */
+
+EXPORT obs_data_t *obs_data_create(void);
+EXPORT obs_data_t *obs_data_create_from_json(const char *json_string);
+EXPORT obs_data_t *obs_data_create_from_json_file(const char *json_file);
+EXPORT obs_data_t *obs_data_create_from_json_file_safe(const char *json_file, const char *backup_ext);
+EXPORT void obs_data_addref(obs_data_t *data);
+EXPORT void obs_data_release(obs_data_t *data);
+EXPORT const char *obs_data_get_json(obs_data_t *data);
+EXPORT bool obs_data_save_json(obs_data_t *data, const char *file);
+EXPORT bool obs_data_save_json_safe(obs_data_t *data, const char *file, const char *temp_ext, const char *backup_ext);
+EXPORT void obs_data_apply(obs_data_t *target, obs_data_t *apply_data);
+EXPORT void obs_data_erase(obs_data_t *data, const char *name);
+EXPORT void obs_data_clear(obs_data_t *data);
+EXPORT bool obs_data_has_user_value(obs_data_t *data, const char *name);
+
+EXPORT void obs_data_set_string(obs_data_t *data, const char *name, const char *val);
+EXPORT void obs_data_set_int(obs_data_t *data, const char *name, long long val);
+EXPORT void obs_data_set_double(obs_data_t *data, const char *name, double val);
+EXPORT void obs_data_set_bool(obs_data_t *data, const char *name, bool val);
+EXPORT void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj);
+EXPORT void obs_data_set_array(obs_data_t *data, const char *name, obs_data_array_t *array);
+
+EXPORT void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val);
+EXPORT void obs_data_set_default_int(obs_data_t *data, const char *name, long long val);
+EXPORT void obs_data_set_default_double(obs_data_t *data, const char *name, double val);
+EXPORT void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val);
+
+EXPORT const char *obs_data_get_string(obs_data_t *data, const char *name);
+EXPORT long long obs_data_get_int(obs_data_t *data, const char *name);
+EXPORT double obs_data_get_double(obs_data_t *data, const char *name);
+EXPORT bool obs_data_get_bool(obs_data_t *data, const char *name);
+EXPORT obs_data_t *obs_data_get_obj(obs_data_t *data, const char *name);
+EXPORT obs_data_array_t *obs_data_get_array(obs_data_t *data, const char *name);
+
+EXPORT obs_data_array_t *obs_data_array_create(void);
+EXPORT void obs_data_array_addref(obs_data_array_t *array);
+EXPORT void obs_data_array_release(obs_data_array_t *array);
+EXPORT size_t obs_data_array_count(obs_data_array_t *array);
+EXPORT obs_data_t *obs_data_array_item(obs_data_array_t *array, size_t idx);
+EXPORT size_t obs_data_array_push_back(obs_data_array_t *array, obs_data_t *obj);
+EXPORT void obs_data_array_insert(obs_data_array_t *array, size_t idx, obs_data_t *obj);
+EXPORT void obs_data_array_erase(obs_data_array_t *array, size_t idx);
+
+/* ------------------------------------------------------------------------- */
+/* Properties (recorded but otherwise inert) */
+
+enum obs_combo_type {
+	OBS_COMBO_TYPE_INVALID,
+	OBS_COMBO_TYPE_EDITABLE,
+	OBS_COMBO_TYPE_LIST,
+	OBS_COMBO_TYPE_RADIO,
+};
+
+enum obs_combo_format {
+	OBS_COMBO_FORMAT_INVALID,
+	OBS_COMBO_FORMAT_INT,
+	OBS_COMBO_FORMAT_FLOAT,
+	OBS_COMBO_FORMAT_STRING,
+	OBS_COMBO_FORMAT_BOOL,
+};
+
+enum obs_editable_list_type {
+	OBS_EDITABLE_LIST_TYPE_STRINGS,
+	OBS_EDITABLE_LIST_TYPE_FILES,
+	OBS_EDITABLE_LIST_TYPE_FILES_AND_URLS,
+};
+
+enum obs_text_type {
+	OBS_TEXT_DEFAULT,
+	OBS_TEXT_PASSWORD,
+	OBS_TEXT_MULTILINE,
+	OBS_TEXT_INFO,
+};
+
+enum obs_text_info_type {
+	OBS_TEXT_INFO_NORMAL,
+	OBS_TEXT_INFO_WARNING,
+	OBS_TEXT_INFO_ERROR,
+};
+
+enum obs_path_type {
+	OBS_PATH_FILE,
+	OBS_PATH_FILE_SAVE,
+	OBS_PATH_DIRECTORY,
+};
+
+enum obs_group_type {
+	OBS_COMBO_INVALID,
+	OBS_GROUP_NORMAL,
+	OBS_GROUP_CHECKABLE,
+};
+
+typedef bool (*obs_property_clicked_t)(obs_properties_t *props, obs_property_t *property, void *data);
+typedef bool (*obs_property_modified_t)(obs_properties_t *props, obs_property_t *property, obs_data_t *settings);
+
+EXPORT obs_properties_t *obs_properties_create(void);
+EXPORT void obs_properties_destroy(obs_properties_t *props);
+EXPORT obs_property_t *obs_properties_get(obs_properties_t *props, const char *property);
+EXPORT obs_property_t *obs_properties_add_bool(obs_properties_t *props, const char *name, const char *description);
+EXPORT obs_property_t *obs_properties_add_int(obs_properties_t *props, const char *name, const char *description,
+					      int min, int max, int step);
+EXPORT obs_property_t *obs_properties_add_int_slider(obs_properties_t *props, const char *name,
+						     const char *description, int min, int max, int step);
+EXPORT obs_property_t *obs_properties_add_float(obs_properties_t *props, const char *name, const char *description,
+						double min, double max, double step);
+EXPORT obs_property_t *obs_properties_add_float_slider(obs_properties_t *props, const char *name,
+						       const char *description, double min, double max, double step);
+EXPORT obs_property_t *obs_properties_add_text(obs_properties_t *props, const char *name, const char *description,
+					       enum obs_text_type type);
+EXPORT obs_property_t *obs_properties_add_path(obs_properties_t *props, const char *name, const char *description,
+					       enum obs_path_type type, const char *filter, const char *default_path);
+EXPORT obs_property_t *obs_properties_add_list(obs_properties_t *props, const char *name, const char *description,
+					       enum obs_combo_type type, enum obs_combo_format format);
+EXPORT obs_property_t *obs_properties_add_button(obs_properties_t *props, const char *name, const char *text,
+						 obs_property_clicked_t callback);
+EXPORT obs_property_t *obs_properties_add_editable_list(obs_properties_t *props, const char *name,
+							const char *description, enum obs_editable_list_type type,
+							const char *filter, const char *default_path);
+EXPORT obs_property_t *obs_properties_add_group(obs_properties_t *props, const char *name, const char *description,
+						enum obs_group_type type, obs_properties_t *group);
+
+EXPORT size_t obs_property_list_add_string(obs_property_t *p, const char *name, const char *val);
+EXPORT size_t obs_property_list_add_int(obs_property_t *p, const char *name, long long val);
+EXPORT void obs_property_set_long_description(obs_property_t *p, const char *long_description);
+EXPORT void obs_property_set_visible(obs_property_t *p, bool visible);
+EXPORT void obs_property_set_enabled(obs_property_t *p, bool enabled);
+EXPORT void obs_property_set_modified_callback(obs_property_t *p, obs_property_modified_t modified);
+EXPORT void obs_property_int_set_suffix(obs_property_t *p, const char *suffix);
+EXPORT void obs_property_float_set_suffix(obs_property_t *p, const char *suffix);
+EXPORT void obs_property_text_set_info_type(obs_property_t *p, enum obs_text_info_type type);
+
+/* ------------------------------------------------------------------------- */
+/* Hotkeys */
+
+typedef void (*obs_hotkey_func)(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
+
+EXPORT obs_hotkey_id obs_hotkey_register_source(obs_source_t *source, const char *name, const char *description,
+						obs_hotkey_func func, void *data);
+
+/* ------------------------------------------------------------------------- */
+/* Missing files */
+
+enum obs_missing_file_src {
+	OBS_MISSING_FILE_SOURCE,
+	OBS_MISSING_FILE_SCRIPT,
+};
+
+typedef void (*obs_missing_file_cb)(void *src, const char *new_path, void *data);
+
+EXPORT obs_missing_files_t *obs_missing_files_create(void);
+EXPORT void obs_missing_files_destroy(obs_missing_files_t *files);
+EXPORT void obs_missing_files_add_file(obs_missing_files_t *files, obs_missing_file_t *file);
+EXPORT size_t obs_missing_files_count(obs_missing_files_t *files);
+EXPORT obs_missing_file_t *obs_missing_files_get_file(obs_missing_files_t *files, int idx);
+EXPORT obs_missing_file_t *obs_missing_file_create(const char *path, obs_missing_file_cb callback, int src_type,
+						   void *src, void *data);
+EXPORT const char *obs_missing_file_get_path(obs_missing_file_t *file);
+EXPORT void obs_missing_file_issue_callback(obs_missing_file_t *file, const char *new_path);
+
+/* ------------------------------------------------------------------------- */
+/* Sources */
+
+enum obs_source_type {
+	OBS_SOURCE_TYPE_INPUT,
+	OBS_SOURCE_TYPE_FILTER,
+	OBS_SOURCE_TYPE_TRANSITION,
+	OBS_SOURCE_TYPE_SCENE,
+};
+
+enum obs_icon_type {
+	OBS_ICON_TYPE_UNKNOWN,
+	OBS_ICON_TYPE_IMAGE,
+	OBS_ICON_TYPE_COLOR,
+	OBS_ICON_TYPE_SLIDESHOW,
+	OBS_ICON_TYPE_AUDIO_INPUT,
+	OBS_ICON_TYPE_AUDIO_OUTPUT,
+	OBS_ICON_TYPE_DESKTOP_CAPTURE,
+	OBS_ICON_TYPE_WINDOW_CAPTURE,
+	OBS_ICON_TYPE_GAME_CAPTURE,
+	OBS_ICON_TYPE_CAMERA,
+	OBS_ICON_TYPE_TEXT,
+	OBS_ICON_TYPE_MEDIA,
+	OBS_ICON_TYPE_BROWSER,
+	OBS_ICON_TYPE_CUSTOM,
+	OBS_ICON_TYPE_PROCESS_AUDIO_OUTPUT,
+};
+
+enum obs_media_state {
+	OBS_MEDIA_STATE_NONE,
+	OBS_MEDIA_STATE_PLAYING,
+	OBS_MEDIA_STATE_OPENING,
+	OBS_MEDIA_STATE_BUFFERING,
+	OBS_MEDIA_STATE_PAUSED,
+	OBS_MEDIA_STATE_STOPPED,
+	OBS_MEDIA_STATE_ENDED,
+	OBS_MEDIA_STATE_ERROR,
+};
+
+#define OBS_SOURCE_VIDEO (1 << 0)
+#define OBS_SOURCE_AUDIO (1 << 1)
+#define OBS_SOURCE_ASYNC (1 << 2)
+#define OBS_SOURCE_ASYNC_VIDEO (OBS_SOURCE_ASYNC | OBS_SOURCE_VIDEO)
+#define OBS_SOURCE_CUSTOM_DRAW (1 << 3)
+#define OBS_SOURCE_INTERACTION (1 << 5)
+#define OBS_SOURCE_COMPOSITE (1 << 6)
+#define OBS_SOURCE_DO_NOT_DUPLICATE (1 << 7)
+#define OBS_SOURCE_CONTROLLABLE_MEDIA (1 << 13)
+
+struct obs_source_audio_mix {
+	struct audio_output_data {
+		float *data[MAX_AUDIO_CHANNELS];
+	} output[MAX_AUDIO_MIXES];
+};
+
+struct obs_source_audio {
+	const uint8_t *data[MAX_AV_PLANES];
+	uint32_t frames;
+
+	enum speaker_layout speakers;
+	enum audio_format format;
+	uint32_t samples_per_sec;
+
+	uint64_t timestamp;
+};
+
+typedef void (*obs_source_enum_proc_t)(obs_source_t *parent, obs_source_t *child, void *param);
+typedef void (*obs_source_audio_capture_t)(void *param, obs_source_t *source, const struct audio_data *audio_data,
+					   bool muted);
+
+struct obs_source_info {
+	const char *id;
+	enum obs_source_type type;
+	uint32_t output_flags;
+
+	const char *(*get_name)(void *type_data);
+	void *(*create)(obs_data_t *settings, obs_source_t *source);
+	void (*destroy)(void *data);
+	uint32_t (*get_width)(void *data);
+	uint32_t (*get_height)(void *data);
+	void (*get_defaults)(obs_data_t *settings);
+	obs_properties_t *(*get_properties)(void *data);
+	void (*update)(void *data, obs_data_t *settings);
+	void (*activate)(void *data);
+	void (*deactivate)(void *data);
+	void (*show)(void *data);
+	void (*hide)(void *data);
+	void (*video_tick)(void *data, float seconds);
+	void (*video_render)(void *data, gs_effect_t *effect);
+	bool (*audio_render)(void *data, uint64_t *ts_out, struct obs_source_audio_mix *audio_output,
+			     uint32_t mixers, size_t channels, size_t sample_rate);
+	void (*enum_active_sources)(void *data, obs_source_enum_proc_t enum_callback, void *param);
+	void (*save)(void *data, obs_data_t *settings);
+	void (*load)(void *data, obs_data_t *settings);
+	obs_missing_files_t *(*missing_files)(void *data);
+	enum obs_icon_type icon_type;
+
+	void (*media_play_pause)(void *data, bool pause);
+	void (*media_restart)(void *data);
+	void (*media_stop)(void *data);
+	void (*media_next)(void *data);
+	void (*media_previous)(void *data);
+	int64_t (*media_get_duration)(void *data);
+	int64_t (*media_get_time)(void *data);
+	void (*media_set_time)(void *data, int64_t miliseconds);
+	enum obs_media_state (*media_get_state)(void *data);
+};
+
+EXPORT void obs_register_source_s(const struct obs_source_info *info, size_t size);
+#define obs_register_source(info) obs_register_source_s(info, sizeof(struct obs_source_info))
+
+EXPORT obs_source_t *obs_source_create(const char *id, const char *name, obs_data_t *settings,
+				       obs_data_t *hotkey_data);
+EXPORT obs_source_t *obs_source_create_private(const char *id, const char *name, obs_data_t *settings);
+EXPORT obs_source_t *obs_source_get_ref(obs_source_t *source);
+EXPORT void obs_source_release(obs_source_t *source);
+EXPORT const char *obs_source_get_name(const obs_source_t *source);
+EXPORT const char *obs_source_get_uuid(const obs_source_t *source);
+EXPORT const char *obs_source_get_id(const obs_source_t *source);
+EXPORT obs_data_t *obs_source_get_settings(const obs_source_t *source);
+EXPORT void obs_source_update(obs_source_t *source, obs_data_t *settings);
+EXPORT void obs_source_update_properties(obs_source_t *source);
+EXPORT obs_properties_t *obs_source_properties(const obs_source_t *source);
+EXPORT void obs_source_save(obs_source_t *source);
+EXPORT void obs_source_load(obs_source_t *source);
+EXPORT void obs_source_remove(obs_source_t *source);
+EXPORT signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source);
+EXPORT proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source);
+EXPORT bool obs_source_active(const obs_source_t *source);
+EXPORT bool obs_source_showing(const obs_source_t *source);
+EXPORT uint32_t obs_source_get_width(obs_source_t *source);
+EXPORT uint32_t obs_source_get_height(obs_source_t *source);
+EXPORT void obs_source_video_render(obs_source_t *source);
+EXPORT bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child);
+EXPORT void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child);
+EXPORT void obs_source_add_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback,
+						  void *param);
+EXPORT void obs_source_remove_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback,
+						     void *param);
+EXPORT void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio *audio);
+EXPORT uint64_t obs_source_get_audio_timestamp(const obs_source_t *source);
+EXPORT void obs_source_get_audio_mix(const obs_source_t *source, struct obs_source_audio_mix *audio);
+EXPORT obs_missing_files_t *obs_source_get_missing_files(const obs_source_t *source);
+
+EXPORT void obs_source_media_play_pause(obs_source_t *source, bool pause);
+EXPORT void obs_source_media_restart(obs_source_t *source);
+EXPORT void obs_source_media_stop(obs_source_t *source);
+EXPORT void obs_source_media_next(obs_source_t *source);
+EXPORT void obs_source_media_previous(obs_source_t *source);
+EXPORT int64_t obs_source_media_get_duration(obs_source_t *source);
+EXPORT int64_t obs_source_media_get_time(obs_source_t *source);
+EXPORT void obs_source_media_set_time(obs_source_t *source, int64_t ms);
+EXPORT enum obs_media_state obs_source_media_get_state(obs_source_t *source);
+EXPORT void obs_source_media_started(obs_source_t *source);
+EXPORT void obs_source_media_ended(obs_source_t *source);
+
+/* ------------------------------------------------------------------------- */
+/* Core */
+
+enum obs_task_type {
+	OBS_TASK_UI,
+	OBS_TASK_GRAPHICS,
+	OBS_TASK_AUDIO,
+	OBS_TASK_DESTROY,
+};
+
+typedef void (*obs_task_t)(void *param);
+
+#define MAX_CHANNELS 64
+
+EXPORT uint64_t obs_get_video_frame_time(void);
+EXPORT audio_t *obs_get_audio(void);
+EXPORT void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param, bool wait);
+EXPORT void obs_set_output_source(uint32_t channel, obs_source_t *source);
+EXPORT obs_source_t *obs_get_output_source(uint32_t channel);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Stand-in for libobs used by the headless test harness. Only the parts of
+ * the API that the plugin uses are provided. */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#define UNUSED_PARAMETER(param) (void)param
+#define EXPORT
+#define OBS_DEPRECATED
+#define PRINTFATTR(f, a) __attribute__((__format__(__printf__, f, a)))
+
+#ifdef _MSC_VER
+#define force_inline __forceinline
+#else
+#define force_inline inline __attribute__((always_inline))
+#endif
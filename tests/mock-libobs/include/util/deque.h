@@ -0,0 +1,159 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include "c99defs.h"
+#include "bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same layout and semantics as libobs' double-ended ring buffer */
+
+struct deque {
+	void *data;
+	size_t size;
+
+	size_t start_pos;
+	size_t end_pos;
+	size_t capacity;
+};
+
+static inline void deque_init(struct deque *dq)
+{
+	memset(dq, 0, sizeof(struct deque));
+}
+
+static inline void deque_free(struct deque *dq)
+{
+	bfree(dq->data);
+	memset(dq, 0, sizeof(struct deque));
+}
+
+static inline void deque_reorder_data(struct deque *dq, size_t new_capacity)
+{
+	size_t difference;
+	uint8_t *data;
+
+	if (!dq->size || !dq->start_pos || dq->end_pos > dq->start_pos)
+		return;
+
+	difference = new_capacity - dq->capacity;
+	data = (uint8_t *)dq->data + dq->start_pos;
+	memmove(data + difference, data, dq->capacity - dq->start_pos);
+	dq->start_pos += difference;
+}
+
+static inline void deque_ensure_capacity(struct deque *dq)
+{
+	size_t new_capacity;
+	if (dq->size <= dq->capacity)
+		return;
+
+	new_capacity = dq->capacity * 2;
+	if (dq->size > new_capacity)
+		new_capacity = dq->size;
+
+	dq->data = brealloc(dq->data, new_capacity);
+	deque_reorder_data(dq, new_capacity);
+	dq->capacity = new_capacity;
+}
+
+static inline void deque_reserve(struct deque *dq, size_t capacity)
+{
+	if (capacity <= dq->capacity)
+		return;
+
+	dq->data = brealloc(dq->data, capacity);
+	deque_reorder_data(dq, capacity);
+	dq->capacity = capacity;
+}
+
+static inline void deque_push_back(struct deque *dq, const void *data, size_t size)
+{
+	size_t new_end_pos = dq->end_pos + size;
+
+	dq->size += size;
+	deque_ensure_capacity(dq);
+
+	if (new_end_pos > dq->capacity) {
+		size_t back_size = dq->capacity - dq->end_pos;
+		size_t loop_size = size - back_size;
+
+		if (back_size)
+			memcpy((uint8_t *)dq->data + dq->end_pos, data, back_size);
+		memcpy(dq->data, (uint8_t *)data + back_size, loop_size);
+
+		new_end_pos -= dq->capacity;
+	} else {
+		memcpy((uint8_t *)dq->data + dq->end_pos, data, size);
+	}
+
+	dq->end_pos = new_end_pos;
+}
+
+static inline void deque_peek_front(struct deque *dq, void *data, size_t size)
+{
+	assert(size <= dq->size);
+
+	if (data) {
+		size_t start_size = dq->capacity - dq->start_pos;
+
+		if (start_size < size) {
+			memcpy(data, (uint8_t *)dq->data + dq->start_pos, start_size);
+			memcpy((uint8_t *)data + start_size, dq->data, size - start_size);
+		} else {
+			memcpy(data, (uint8_t *)dq->data + dq->start_pos, size);
+		}
+	}
+}
+
+static inline void deque_pop_front(struct deque *dq, void *data, size_t size)
+{
+	deque_peek_front(dq, data, size);
+
+	dq->size -= size;
+	if (!dq->size) {
+		dq->start_pos = dq->end_pos = 0;
+		return;
+	}
+
+	dq->start_pos += size;
+	if (dq->start_pos >= dq->capacity)
+		dq->start_pos -= dq->capacity;
+}
+
+static inline void *deque_data(struct deque *dq, size_t idx)
+{
+	uint8_t *ptr = (uint8_t *)dq->data;
+	size_t offset = dq->start_pos + idx;
+
+	if (idx >= dq->size)
+		return NULL;
+
+	if (offset >= dq->capacity)
+		offset -= dq->capacity;
+
+	return ptr + offset;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,122 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include "c99defs.h"
+#include "bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dstr {
+	char *array;
+	size_t len;
+	size_t capacity;
+};
+
+EXPORT int astrcmpi(const char *str1, const char *str2);
+EXPORT int astrcmp_n(const char *str1, const char *str2, size_t n);
+EXPORT int astrcmpi_n(const char *str1, const char *str2, size_t n);
+EXPORT char *astrstri(const char *str, const char *find);
+
+EXPORT char **strlist_split(const char *str, char split_ch, bool include_empty);
+EXPORT void strlist_free(char **strlist);
+
+static inline void dstr_init(struct dstr *dst)
+{
+	dst->array = NULL;
+	dst->len = 0;
+	dst->capacity = 0;
+}
+
+static inline void dstr_free(struct dstr *dst)
+{
+	bfree(dst->array);
+	dst->array = NULL;
+	dst->len = 0;
+	dst->capacity = 0;
+}
+
+EXPORT void dstr_ensure_capacity(struct dstr *dst, const size_t new_size);
+EXPORT void dstr_copy(struct dstr *dst, const char *array);
+EXPORT void dstr_ncopy(struct dstr *dst, const char *array, const size_t len);
+EXPORT void dstr_copy_dstr(struct dstr *dst, const struct dstr *src);
+EXPORT void dstr_ncat(struct dstr *dst, const char *array, const size_t len);
+EXPORT void dstr_resize(struct dstr *dst, const size_t num);
+EXPORT void dstr_replace(struct dstr *str, const char *find, const char *replace);
+EXPORT void dstr_insert(struct dstr *dst, const size_t idx, const char *array);
+EXPORT void dstr_remove(struct dstr *dst, const size_t idx, const size_t count);
+EXPORT void dstr_printf(struct dstr *dst, const char *format, ...) PRINTFATTR(2, 3);
+EXPORT void dstr_catf(struct dstr *dst, const char *format, ...) PRINTFATTR(2, 3);
+EXPORT void dstr_vprintf(struct dstr *dst, const char *format, va_list args);
+EXPORT void dstr_vcatf(struct dstr *dst, const char *format, va_list args);
+
+static inline void dstr_cat(struct dstr *dst, const char *array)
+{
+	if (!array || !*array)
+		return;
+
+	dstr_ncat(dst, array, strlen(array));
+}
+
+static inline void dstr_cat_dstr(struct dstr *dst, const struct dstr *str)
+{
+	if (str->len)
+		dstr_ncat(dst, str->array, str->len);
+}
+
+static inline void dstr_cat_ch(struct dstr *dst, char ch)
+{
+	dstr_ensure_capacity(dst, ++dst->len + 1);
+	dst->array[dst->len - 1] = ch;
+	dst->array[dst->len] = 0;
+}
+
+static inline bool dstr_is_empty(const struct dstr *str)
+{
+	if (!str->array || !str->len)
+		return true;
+	if (!*str->array)
+		return true;
+
+	return false;
+}
+
+static inline const char *dstr_find_i(const struct dstr *str, const char *find)
+{
+	return astrstri(str->array, find);
+}
+
+static inline const char *dstr_find(const struct dstr *str, const char *find)
+{
+	return strstr(str->array, find);
+}
+
+static inline char dstr_end(const struct dstr *str)
+{
+	if (dstr_is_empty(str))
+		return 0;
+
+	return str->array[str->len - 1];
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+#pragma once
+
+#include "c99defs.h"
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+EXPORT FILE *os_fopen(const char *path, const char *mode);
+EXPORT int64_t os_fgetsize(FILE *file);
+EXPORT int os_stat(const char *file, struct stat *st);
+EXPORT char *os_quick_read_utf8_file(const char *path);
+EXPORT bool os_quick_write_utf8_file(const char *path, const char *str, size_t len, bool marker);
+EXPORT bool os_quick_write_utf8_file_safe(const char *path, const char *str, size_t len, bool marker,
+					  const char *temp_ext, const char *backup_ext);
+EXPORT int64_t os_get_file_size(const char *path);
+
+EXPORT uint64_t os_gettime_ns(void);
+EXPORT bool os_sleepto_ns(uint64_t time_target);
+EXPORT void os_sleep_ms(uint32_t duration);
+
+EXPORT bool os_file_exists(const char *path);
+EXPORT const char *os_get_path_extension(const char *path);
+
+struct os_dir;
+typedef struct os_dir os_dir_t;
+
+struct os_dirent {
+	char d_name[256];
+	bool directory;
+};
+
+EXPORT os_dir_t *os_opendir(const char *path);
+EXPORT struct os_dirent *os_readdir(os_dir_t *dir);
+EXPORT void os_closedir(os_dir_t *dir);
+
+EXPORT int os_unlink(const char *path);
+EXPORT int os_rmdir(const char *path);
+EXPORT int os_rename(const char *old_path, const char *new_path);
+EXPORT int os_safe_replace(const char *target_path, const char *from_path, const char *backup_path);
+
+#define MKDIR_EXISTS 1
+#define MKDIR_SUCCESS 0
+#define MKDIR_ERROR -1
+
+EXPORT int os_mkdir(const char *path);
+EXPORT int os_mkdirs(const char *path);
+
+EXPORT int os_get_logical_cores(void);
+
+#ifdef __cplusplus
+}
+#endif
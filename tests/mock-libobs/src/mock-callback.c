@@ -0,0 +1,291 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Calldata, signal and proc handlers of the stand-in libobs */
+
+#include <util/darray.h>
+#include <util/threading.h>
+#include <callback/signal.h>
+#include <callback/proc.h>
+
+struct calldata_item {
+	char *name;
+	enum calldata_type type;
+	union {
+		long long i;
+		double f;
+		bool b;
+		void *ptr;
+		char *str;
+	};
+};
+
+static struct calldata_item *calldata_find(const calldata_t *data, const char *name)
+{
+	for (size_t i = 0; i < data->num; i++) {
+		if (strcmp(data->items[i].name, name) == 0)
+			return &data->items[i];
+	}
+	return NULL;
+}
+
+static struct calldata_item *calldata_new_item(calldata_t *data, const char *name, enum calldata_type type)
+{
+	struct calldata_item *item = calldata_find(data, name);
+	if (item) {
+		if (item->type == CALLDATA_TYPE_STRING)
+			bfree(item->str);
+	} else {
+		if (data->num == data->capacity) {
+			data->capacity = data->capacity ? data->capacity * 2 : 8;
+			data->items = brealloc(data->items, data->capacity * sizeof(struct calldata_item));
+		}
+		item = &data->items[data->num++];
+		item->name = bstrdup(name);
+	}
+	item->type = type;
+	return item;
+}
+
+void calldata_clear(struct calldata *data)
+{
+	for (size_t i = 0; i < data->num; i++) {
+		bfree(data->items[i].name);
+		if (data->items[i].type == CALLDATA_TYPE_STRING)
+			bfree(data->items[i].str);
+	}
+	data->num = 0;
+}
+
+void calldata_free(struct calldata *data)
+{
+	calldata_clear(data);
+	bfree(data->items);
+	memset(data, 0, sizeof(*data));
+}
+
+void calldata_set_int(calldata_t *data, const char *name, long long val)
+{
+	calldata_new_item(data, name, CALLDATA_TYPE_INT)->i = val;
+}
+
+void calldata_set_float(calldata_t *data, const char *name, double val)
+{
+	calldata_new_item(data, name, CALLDATA_TYPE_FLOAT)->f = val;
+}
+
+void calldata_set_bool(calldata_t *data, const char *name, bool val)
+{
+	calldata_new_item(data, name, CALLDATA_TYPE_BOOL)->b = val;
+}
+
+void calldata_set_ptr(calldata_t *data, const char *name, void *ptr)
+{
+	calldata_new_item(data, name, CALLDATA_TYPE_PTR)->ptr = ptr;
+}
+
+void calldata_set_string(calldata_t *data, const char *name, const char *str)
+{
+	calldata_new_item(data, name, CALLDATA_TYPE_STRING)->str = bstrdup(str);
+}
+
+bool calldata_get_int(const calldata_t *data, const char *name, long long *val)
+{
+	struct calldata_item *item = calldata_find(data, name);
+	if (!item || item->type != CALLDATA_TYPE_INT)
+		return false;
+	*val = item->i;
+	return true;
+}
+
+bool calldata_get_float(const calldata_t *data, const char *name, double *val)
+{
+	struct calldata_item *item = calldata_find(data, name);
+	if (!item || item->type != CALLDATA_TYPE_FLOAT)
+		return false;
+	*val = item->f;
+	return true;
+}
+
+bool calldata_get_bool(const calldata_t *data, const char *name, bool *val)
+{
+	struct calldata_item *item = calldata_find(data, name);
+	if (!item || item->type != CALLDATA_TYPE_BOOL)
+		return false;
+	*val = item->b;
+	return true;
+}
+
+bool calldata_get_ptr_(const calldata_t *data, const char *name, void **p_ptr)
+{
+	struct calldata_item *item = calldata_find(data, name);
+	if (!item || item->type != CALLDATA_TYPE_PTR)
+		return false;
+	*p_ptr = item->ptr;
+	return true;
+}
+
+bool calldata_get_string(const calldata_t *data, const char *name, const char **str)
+{
+	struct calldata_item *item = calldata_find(data, name);
+	if (!item || item->type != CALLDATA_TYPE_STRING)
+		return false;
+	*str = item->str;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+
+/* "void name(int a, out string b)" -> "name" */
+static char *decl_name(const char *decl)
+{
+	const char *end = strchr(decl, '(');
+	const char *start;
+
+	if (!end)
+		return bstrdup(decl);
+
+	start = end;
+	while (start > decl && start[-1] != ' ')
+		start--;
+	return bstrdup_n(start, end - start);
+}
+
+struct signal_callback {
+	char *signal;
+	signal_callback_t callback;
+	void *data;
+};
+
+struct signal_handler {
+	pthread_mutex_t mutex;
+	DARRAY(struct signal_callback) callbacks;
+};
+
+signal_handler_t *signal_handler_create(void)
+{
+	struct signal_handler *handler = bzalloc(sizeof(struct signal_handler));
+	pthread_mutex_init_recursive(&handler->mutex);
+	return handler;
+}
+
+void signal_handler_destroy(signal_handler_t *handler)
+{
+	if (!handler)
+		return;
+
+	for (size_t i = 0; i < handler->callbacks.num; i++)
+		bfree(handler->callbacks.array[i].signal);
+	da_free(handler->callbacks);
+	pthread_mutex_destroy(&handler->mutex);
+	bfree(handler);
+}
+
+bool signal_handler_add(signal_handler_t *handler, const char *signal_decl)
+{
+	UNUSED_PARAMETER(handler);
+	UNUSED_PARAMETER(signal_decl);
+	return true;
+}
+
+void signal_handler_connect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data)
+{
+	struct signal_callback cb = {bstrdup(signal), callback, data};
+
+	pthread_mutex_lock(&handler->mutex);
+	da_push_back(handler->callbacks, &cb);
+	pthread_mutex_unlock(&handler->mutex);
+}
+
+void signal_handler_disconnect(signal_handler_t *handler, const char *signal, signal_callback_t callback, void *data)
+{
+	pthread_mutex_lock(&handler->mutex);
+	for (size_t i = 0; i < handler->callbacks.num; i++) {
+		struct signal_callback *cb = &handler->callbacks.array[i];
+		if (cb->callback == callback && cb->data == data && strcmp(cb->signal, signal) == 0) {
+			bfree(cb->signal);
+			da_erase(handler->callbacks, i);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&handler->mutex);
+}
+
+void signal_handler_signal(signal_handler_t *handler, const char *signal, calldata_t *params)
+{
+	calldata_t empty = {0};
+
+	if (!params)
+		params = &empty;
+
+	pthread_mutex_lock(&handler->mutex);
+	for (size_t i = 0; i < handler->callbacks.num; i++) {
+		struct signal_callback cb = handler->callbacks.array[i];
+		if (strcmp(cb.signal, signal) == 0)
+			cb.callback(cb.data, params);
+	}
+	pthread_mutex_unlock(&handler->mutex);
+
+	calldata_free(&empty);
+}
+
+/* ------------------------------------------------------------------------- */
+
+struct proc_info {
+	char *name;
+	proc_handler_proc_t proc;
+	void *data;
+};
+
+struct proc_handler {
+	DARRAY(struct proc_info) procs;
+};
+
+proc_handler_t *proc_handler_create(void)
+{
+	return bzalloc(sizeof(struct proc_handler));
+}
+
+void proc_handler_destroy(proc_handler_t *handler)
+{
+	if (!handler)
+		return;
+
+	for (size_t i = 0; i < handler->procs.num; i++)
+		bfree(handler->procs.array[i].name);
+	da_free(handler->procs);
+	bfree(handler);
+}
+
+void proc_handler_add(proc_handler_t *handler, const char *decl_string, proc_handler_proc_t proc, void *data)
+{
+	struct proc_info pi = {decl_name(decl_string), proc, data};
+	da_push_back(handler->procs, &pi);
+}
+
+bool proc_handler_call(proc_handler_t *handler, const char *name, calldata_t *params)
+{
+	for (size_t i = 0; i < handler->procs.num; i++) {
+		struct proc_info *pi = &handler->procs.array[i];
+		if (strcmp(pi->name, name) == 0) {
+			pi->proc(pi->data, params);
+			return true;
+		}
+	}
+	return false;
+}
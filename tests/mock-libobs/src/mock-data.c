@@ -0,0 +1,779 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* obs_data implementation of the stand-in libobs, with a small JSON reader
+ * and writer so that settings can round-trip through files like in OBS. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include <obs.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+enum data_type {
+	DATA_NULL,
+	DATA_STRING,
+	DATA_INT,
+	DATA_DOUBLE,
+	DATA_BOOL,
+	DATA_OBJECT,
+	DATA_ARRAY,
+};
+
+struct data_value {
+	enum data_type type;
+	union {
+		char *str;
+		long long i;
+		double d;
+		bool b;
+		obs_data_t *obj;
+		obs_data_array_t *array;
+	};
+};
+
+struct data_item {
+	char *name;
+	struct data_value user;
+	struct data_value def;
+};
+
+struct obs_data {
+	volatile long ref;
+	DARRAY(struct data_item) items;
+	char *json;
+};
+
+struct obs_data_array {
+	volatile long ref;
+	DARRAY(obs_data_t *) objects;
+};
+
+static void value_free(struct data_value *val)
+{
+	switch (val->type) {
+	case DATA_STRING:
+		bfree(val->str);
+		break;
+	case DATA_OBJECT:
+		obs_data_release(val->obj);
+		break;
+	case DATA_ARRAY:
+		obs_data_array_release(val->array);
+		break;
+	default:
+		break;
+	}
+	memset(val, 0, sizeof(*val));
+}
+
+static struct data_item *find_item(obs_data_t *data, const char *name)
+{
+	if (!data || !name)
+		return NULL;
+
+	for (size_t i = 0; i < data->items.num; i++) {
+		if (strcmp(data->items.array[i].name, name) == 0)
+			return &data->items.array[i];
+	}
+	return NULL;
+}
+
+static struct data_item *get_item(obs_data_t *data, const char *name)
+{
+	struct data_item *item = find_item(data, name);
+	if (!item) {
+		item = da_push_back_new(data->items);
+		item->name = bstrdup(name);
+	}
+	return item;
+}
+
+static struct data_value *active_value(obs_data_t *data, const char *name)
+{
+	struct data_item *item = find_item(data, name);
+	if (!item)
+		return NULL;
+	if (item->user.type != DATA_NULL)
+		return &item->user;
+	if (item->def.type != DATA_NULL)
+		return &item->def;
+	return NULL;
+}
+
+obs_data_t *obs_data_create(void)
+{
+	obs_data_t *data = bzalloc(sizeof(struct obs_data));
+	data->ref = 1;
+	return data;
+}
+
+void obs_data_addref(obs_data_t *data)
+{
+	if (data)
+		os_atomic_inc_long(&data->ref);
+}
+
+void obs_data_clear(obs_data_t *data)
+{
+	if (!data)
+		return;
+
+	for (size_t i = 0; i < data->items.num; i++) {
+		struct data_item *item = &data->items.array[i];
+		bfree(item->name);
+		value_free(&item->user);
+		value_free(&item->def);
+	}
+	da_free(data->items);
+}
+
+void obs_data_release(obs_data_t *data)
+{
+	if (!data || os_atomic_dec_long(&data->ref) != 0)
+		return;
+
+	obs_data_clear(data);
+	bfree(data->json);
+	bfree(data);
+}
+
+void obs_data_erase(obs_data_t *data, const char *name)
+{
+	struct data_item *item = find_item(data, name);
+	if (!item)
+		return;
+
+	bfree(item->name);
+	value_free(&item->user);
+	value_free(&item->def);
+	da_erase(data->items, item - data->items.array);
+}
+
+bool obs_data_has_user_value(obs_data_t *data, const char *name)
+{
+	struct data_item *item = find_item(data, name);
+	return item && item->user.type != DATA_NULL;
+}
+
+static void set_value(struct data_value *val, enum data_type type)
+{
+	value_free(val);
+	val->type = type;
+}
+
+static struct data_value *user_value(obs_data_t *data, const char *name)
+{
+	return data && name ? &get_item(data, name)->user : NULL;
+}
+
+static struct data_value *def_value(obs_data_t *data, const char *name)
+{
+	return data && name ? &get_item(data, name)->def : NULL;
+}
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val)
+{
+	struct data_value *v = user_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_STRING);
+	v->str = bstrdup(val ? val : "");
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val)
+{
+	struct data_value *v = user_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_INT);
+	v->i = val;
+}
+
+void obs_data_set_double(obs_data_t *data, const char *name, double val)
+{
+	struct data_value *v = user_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_DOUBLE);
+	v->d = val;
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val)
+{
+	struct data_value *v = user_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_BOOL);
+	v->b = val;
+}
+
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj)
+{
+	struct data_value *v = user_value(data, name);
+	if (!v)
+		return;
+	obs_data_addref(obj);
+	set_value(v, obj ? DATA_OBJECT : DATA_NULL);
+	v->obj = obj;
+}
+
+void obs_data_set_array(obs_data_t *data, const char *name, obs_data_array_t *array)
+{
+	struct data_value *v = user_value(data, name);
+	if (!v)
+		return;
+	obs_data_array_addref(array);
+	set_value(v, array ? DATA_ARRAY : DATA_NULL);
+	v->array = array;
+}
+
+void obs_data_set_default_string(obs_data_t *data, const char *name, const char *val)
+{
+	struct data_value *v = def_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_STRING);
+	v->str = bstrdup(val ? val : "");
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name, long long val)
+{
+	struct data_value *v = def_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_INT);
+	v->i = val;
+}
+
+void obs_data_set_default_double(obs_data_t *data, const char *name, double val)
+{
+	struct data_value *v = def_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_DOUBLE);
+	v->d = val;
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val)
+{
+	struct data_value *v = def_value(data, name);
+	if (!v)
+		return;
+	set_value(v, DATA_BOOL);
+	v->b = val;
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name)
+{
+	struct data_value *v = active_value(data, name);
+	return v && v->type == DATA_STRING ? v->str : "";
+}
+
+long long obs_data_get_int(obs_data_t *data, const char *name)
+{
+	struct data_value *v = active_value(data, name);
+	if (!v)
+		return 0;
+	if (v->type == DATA_INT)
+		return v->i;
+	if (v->type == DATA_DOUBLE)
+		return (long long)v->d;
+	return 0;
+}
+
+double obs_data_get_double(obs_data_t *data, const char *name)
+{
+	struct data_value *v = active_value(data, name);
+	if (!v)
+		return 0.0;
+	if (v->type == DATA_DOUBLE)
+		return v->d;
+	if (v->type == DATA_INT)
+		return (double)v->i;
+	return 0.0;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name)
+{
+	struct data_value *v = active_value(data, name);
+	return v && v->type == DATA_BOOL ? v->b : false;
+}
+
+obs_data_t *obs_data_get_obj(obs_data_t *data, const char *name)
+{
+	struct data_value *v = active_value(data, name);
+	if (!v || v->type != DATA_OBJECT)
+		return NULL;
+	obs_data_addref(v->obj);
+	return v->obj;
+}
+
+obs_data_array_t *obs_data_get_array(obs_data_t *data, const char *name)
+{
+	struct data_value *v = active_value(data, name);
+	if (!v || v->type != DATA_ARRAY)
+		return NULL;
+	obs_data_array_addref(v->array);
+	return v->array;
+}
+
+void obs_data_apply(obs_data_t *target, obs_data_t *apply_data)
+{
+	if (!target || !apply_data || target == apply_data)
+		return;
+
+	for (size_t i = 0; i < apply_data->items.num; i++) {
+		struct data_item *src = &apply_data->items.array[i];
+		struct data_value *v = &src->user;
+
+		switch (v->type) {
+		case DATA_STRING:
+			obs_data_set_string(target, src->name, v->str);
+			break;
+		case DATA_INT:
+			obs_data_set_int(target, src->name, v->i);
+			break;
+		case DATA_DOUBLE:
+			obs_data_set_double(target, src->name, v->d);
+			break;
+		case DATA_BOOL:
+			obs_data_set_bool(target, src->name, v->b);
+			break;
+		case DATA_OBJECT:
+			obs_data_set_obj(target, src->name, v->obj);
+			break;
+		case DATA_ARRAY:
+			obs_data_set_array(target, src->name, v->array);
+			break;
+		case DATA_NULL:
+			break;
+		}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+obs_data_array_t *obs_data_array_create(void)
+{
+	obs_data_array_t *array = bzalloc(sizeof(struct obs_data_array));
+	array->ref = 1;
+	return array;
+}
+
+void obs_data_array_addref(obs_data_array_t *array)
+{
+	if (array)
+		os_atomic_inc_long(&array->ref);
+}
+
+void obs_data_array_release(obs_data_array_t *array)
+{
+	if (!array || os_atomic_dec_long(&array->ref) != 0)
+		return;
+
+	for (size_t i = 0; i < array->objects.num; i++)
+		obs_data_release(array->objects.array[i]);
+	da_free(array->objects);
+	bfree(array);
+}
+
+size_t obs_data_array_count(obs_data_array_t *array)
+{
+	return array ? array->objects.num : 0;
+}
+
+obs_data_t *obs_data_array_item(obs_data_array_t *array, size_t idx)
+{
+	obs_data_t *data;
+
+	if (!array || idx >= array->objects.num)
+		return NULL;
+
+	data = array->objects.array[idx];
+	obs_data_addref(data);
+	return data;
+}
+
+size_t obs_data_array_push_back(obs_data_array_t *array, obs_data_t *obj)
+{
+	if (!array || !obj)
+		return 0;
+
+	obs_data_addref(obj);
+	return da_push_back(array->objects, &obj);
+}
+
+void obs_data_array_insert(obs_data_array_t *array, size_t idx, obs_data_t *obj)
+{
+	if (!array || !obj)
+		return;
+
+	obs_data_addref(obj);
+	da_insert(array->objects, idx, &obj);
+}
+
+void obs_data_array_erase(obs_data_array_t *array, size_t idx)
+{
+	if (!array || idx >= array->objects.num)
+		return;
+
+	obs_data_release(array->objects.array[idx]);
+	da_erase(array->objects, idx);
+}
+
+/* ------------------------------------------------------------------------- */
+/* JSON writer */
+
+static void json_write_string(struct dstr *out, const char *str)
+{
+	dstr_cat_ch(out, '"');
+	for (const char *p = str; *p; p++) {
+		switch (*p) {
+		case '"':
+			dstr_cat(out, "\\\"");
+			break;
+		case '\\':
+			dstr_cat(out, "\\\\");
+			break;
+		case '\n':
+			dstr_cat(out, "\\n");
+			break;
+		case '\r':
+			dstr_cat(out, "\\r");
+			break;
+		case '\t':
+			dstr_cat(out, "\\t");
+			break;
+		default:
+			if ((unsigned char)*p < 0x20)
+				dstr_catf(out, "\\u%04x", (unsigned char)*p);
+			else
+				dstr_cat_ch(out, *p);
+		}
+	}
+	dstr_cat_ch(out, '"');
+}
+
+static void json_write_data(struct dstr *out, obs_data_t *data);
+
+static void json_write_value(struct dstr *out, struct data_value *v)
+{
+	switch (v->type) {
+	case DATA_STRING:
+		json_write_string(out, v->str);
+		break;
+	case DATA_INT:
+		dstr_catf(out, "%lld", v->i);
+		break;
+	case DATA_DOUBLE: {
+		char num[64];
+		snprintf(num, sizeof(num), "%.17g", v->d);
+		dstr_cat(out, num);
+		if (!strpbrk(num, ".eEn"))
+			dstr_cat(out, ".0");
+		break;
+	}
+	case DATA_BOOL:
+		dstr_cat(out, v->b ? "true" : "false");
+		break;
+	case DATA_OBJECT:
+		json_write_data(out, v->obj);
+		break;
+	case DATA_ARRAY:
+		dstr_cat_ch(out, '[');
+		for (size_t i = 0; i < v->array->objects.num; i++) {
+			if (i)
+				dstr_cat_ch(out, ',');
+			json_write_data(out, v->array->objects.array[i]);
+		}
+		dstr_cat_ch(out, ']');
+		break;
+	case DATA_NULL:
+		dstr_cat(out, "null");
+		break;
+	}
+}
+
+static void json_write_data(struct dstr *out, obs_data_t *data)
+{
+	bool first = true;
+
+	dstr_cat_ch(out, '{');
+	for (size_t i = 0; i < data->items.num; i++) {
+		struct data_item *item = &data->items.array[i];
+		if (item->user.type == DATA_NULL)
+			continue;
+		if (!first)
+			dstr_cat_ch(out, ',');
+		first = false;
+		json_write_string(out, item->name);
+		dstr_cat_ch(out, ':');
+		json_write_value(out, &item->user);
+	}
+	dstr_cat_ch(out, '}');
+}
+
+const char *obs_data_get_json(obs_data_t *data)
+{
+	struct dstr out = {0};
+
+	if (!data)
+		return NULL;
+
+	json_write_data(&out, data);
+	bfree(data->json);
+	data->json = out.array;
+	return data->json;
+}
+
+bool obs_data_save_json(obs_data_t *data, const char *file)
+{
+	const char *json = obs_data_get_json(data);
+	return json && os_quick_write_utf8_file(file, json, strlen(json), false);
+}
+
+bool obs_data_save_json_safe(obs_data_t *data, const char *file, const char *temp_ext, const char *backup_ext)
+{
+	const char *json = obs_data_get_json(data);
+	return json && os_quick_write_utf8_file_safe(file, json, strlen(json), false, temp_ext, backup_ext);
+}
+
+/* ------------------------------------------------------------------------- */
+/* JSON reader */
+
+struct json_reader {
+	const char *p;
+	bool error;
+};
+
+static void json_skip_ws(struct json_reader *r)
+{
+	while (*r->p && isspace((unsigned char)*r->p))
+		r->p++;
+}
+
+static char *json_read_string(struct json_reader *r)
+{
+	struct dstr str = {0};
+
+	if (*r->p != '"') {
+		r->error = true;
+		return NULL;
+	}
+	r->p++;
+
+	while (*r->p && *r->p != '"') {
+		char ch = *r->p++;
+		if (ch == '\\') {
+			ch = *r->p++;
+			switch (ch) {
+			case 'n':
+				ch = '\n';
+				break;
+			case 'r':
+				ch = '\r';
+				break;
+			case 't':
+				ch = '\t';
+				break;
+			case 'u': {
+				unsigned int code = 0;
+				if (sscanf(r->p, "%4x", &code) == 1)
+					r->p += 4;
+				ch = (char)(code < 0x80 ? code : '?');
+				break;
+			}
+			default:
+				break;
+			}
+		}
+		dstr_cat_ch(&str, ch);
+	}
+
+	if (*r->p != '"') {
+		r->error = true;
+		dstr_free(&str);
+		return NULL;
+	}
+	r->p++;
+
+	if (!str.array)
+		return bstrdup("");
+	return str.array;
+}
+
+static obs_data_t *json_read_object(struct json_reader *r);
+
+static void json_read_value(struct json_reader *r, obs_data_t *data, const char *name)
+{
+	json_skip_ws(r);
+
+	if (*r->p == '"') {
+		char *str = json_read_string(r);
+		if (str)
+			obs_data_set_string(data, name, str);
+		bfree(str);
+
+	} else if (*r->p == '{') {
+		obs_data_t *obj = json_read_object(r);
+		obs_data_set_obj(data, name, obj);
+		obs_data_release(obj);
+
+	} else if (*r->p == '[') {
+		obs_data_array_t *array = obs_data_array_create();
+		r->p++;
+		json_skip_ws(r);
+		while (!r->error && *r->p && *r->p != ']') {
+			obs_data_t *obj = json_read_object(r);
+			obs_data_array_push_back(array, obj);
+			obs_data_release(obj);
+			json_skip_ws(r);
+			if (*r->p == ',') {
+				r->p++;
+				json_skip_ws(r);
+			}
+		}
+		if (*r->p == ']')
+			r->p++;
+		else
+			r->error = true;
+		obs_data_set_array(data, name, array);
+		obs_data_array_release(array);
+
+	} else if (strncmp(r->p, "true", 4) == 0) {
+		obs_data_set_bool(data, name, true);
+		r->p += 4;
+
+	} else if (strncmp(r->p, "false", 5) == 0) {
+		obs_data_set_bool(data, name, false);
+		r->p += 5;
+
+	} else if (strncmp(r->p, "null", 4) == 0) {
+		r->p += 4;
+
+	} else {
+		char *end;
+		const char *start = r->p;
+		bool is_double = false;
+
+		for (const char *p = start; *p && strchr("+-0123456789.eE", *p); p++) {
+			if (*p == '.' || *p == 'e' || *p == 'E')
+				is_double = true;
+		}
+
+		if (is_double) {
+			double d = strtod(start, &end);
+			obs_data_set_double(data, name, d);
+		} else {
+			long long i = strtoll(start, &end, 10);
+			obs_data_set_int(data, name, i);
+		}
+
+		if (end == start)
+			r->error = true;
+		r->p = end;
+	}
+}
+
+static obs_data_t *json_read_object(struct json_reader *r)
+{
+	obs_data_t *data = obs_data_create();
+
+	json_skip_ws(r);
+	if (*r->p != '{') {
+		r->error = true;
+		return data;
+	}
+	r->p++;
+
+	while (!r->error) {
+		char *name;
+
+		json_skip_ws(r);
+		if (*r->p == '}') {
+			r->p++;
+			break;
+		}
+
+		name = json_read_string(r);
+		json_skip_ws(r);
+		if (!name || *r->p != ':') {
+			bfree(name);
+			r->error = true;
+			break;
+		}
+		r->p++;
+
+		json_read_value(r, data, name);
+		bfree(name);
+
+		json_skip_ws(r);
+		if (*r->p == ',')
+			r->p++;
+		else if (*r->p != '}')
+			r->error = true;
+	}
+
+	return data;
+}
+
+obs_data_t *obs_data_create_from_json(const char *json_string)
+{
+	struct json_reader r = {json_string, false};
+	obs_data_t *data;
+
+	if (!json_string)
+		return NULL;
+
+	data = json_read_object(&r);
+	if (r.error) {
+		blog(LOG_ERROR, "obs-data.c: [obs_data_create_from_json] Failed reading json string");
+		obs_data_release(data);
+		return NULL;
+	}
+	return data;
+}
+
+obs_data_t *obs_data_create_from_json_file(const char *json_file)
+{
+	char *file_data = os_quick_read_utf8_file(json_file);
+	obs_data_t *data = NULL;
+
+	if (file_data && *file_data)
+		data = obs_data_create_from_json(file_data);
+
+	bfree(file_data);
+	return data;
+}
+
+obs_data_t *obs_data_create_from_json_file_safe(const char *json_file, const char *backup_ext)
+{
+	obs_data_t *data = obs_data_create_from_json_file(json_file);
+	if (!data && backup_ext && *backup_ext) {
+		struct dstr backup_file = {0};
+		dstr_printf(&backup_file, "%s.%s", json_file, backup_ext);
+		data = obs_data_create_from_json_file(backup_file.array);
+		dstr_free(&backup_file);
+	}
+	return data;
+}
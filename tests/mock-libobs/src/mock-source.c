@@ -0,0 +1,1401 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Sources, properties, hotkeys and the fake ffmpeg_source of the stand-in
+ * libobs. The fake media source "plays" a path on the virtual clock: it
+ * advances its time on mock_tick(), hands synthetic audio to the audio
+ * capture callbacks and emits media_ended when its duration is reached. */
+
+#include <stdio.h>
+#include <math.h>
+
+#include <obs-module.h>
+#include <mock-obs.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define FAKE_MEDIA_ID "ffmpeg_source"
+#define DEFAULT_DURATION_MS 5000
+#define SAMPLE_RATE 48000
+
+struct media_config {
+	char *path;
+	int64_t duration;
+	bool broken;
+	float amplitude;
+};
+
+struct capture_callback {
+	obs_source_audio_capture_t callback;
+	void *param;
+};
+
+struct hotkey {
+	obs_hotkey_id id;
+	obs_source_t *source;
+	char *name;
+	obs_hotkey_func func;
+	void *data;
+};
+
+struct fake_media {
+	pthread_mutex_t mutex;
+	char *path;
+	bool open;
+	bool broken;
+	bool restart_on_activate;
+	bool close_when_inactive;
+	enum obs_media_state state;
+	int64_t time;
+	int64_t duration;
+	float amplitude;
+	long long speed;
+	size_t open_count;
+	size_t frames_rendered;
+	double phase;
+};
+
+struct obs_source {
+	volatile long ref;
+	const struct obs_source_info *info;
+	bool is_private;
+	bool deferred_update;
+	char *name;
+	char uuid[37];
+	obs_data_t *settings;
+	void *data;
+	signal_handler_t *signals;
+	proc_handler_t *procs;
+	long active;
+	long showing;
+
+	pthread_mutex_t callbacks_mutex;
+	DARRAY(struct capture_callback) capture_callbacks;
+	pthread_mutex_t children_mutex; // children are added from other threads
+	DARRAY(obs_source_t *) children;
+
+	struct fake_media *media;
+
+	mock_audio_output_cb audio_output_cb;
+	void *audio_output_param;
+	uint64_t audio_frames_output;
+	uint64_t audio_timestamp;
+};
+
+static DARRAY(struct obs_source_info) source_types;
+static DARRAY(obs_source_t *) sources;
+static DARRAY(struct media_config) media_configs;
+static DARRAY(struct hotkey) hotkeys;
+static pthread_mutex_t mock_mutex;
+static uint64_t virtual_time_ns = 1000000000ULL;
+static long uuid_counter = 0;
+static char *config_dir = NULL;
+static char next_uuid[37] = {0};
+static bool video_stalled = false;
+static obs_source_t *output_sources[MAX_CHANNELS];
+static volatile bool open_blocked = false;
+static volatile long opens_held = 0;
+
+static struct audio_output_info audio_info = {
+	.name = "mock",
+	.samples_per_sec = SAMPLE_RATE,
+	.format = AUDIO_FORMAT_FLOAT_PLANAR,
+	.speakers = SPEAKERS_STEREO,
+};
+
+struct audio_output {
+	int unused;
+};
+static struct audio_output audio_output;
+
+/* ------------------------------------------------------------------------- */
+/* Harness controls */
+
+void mock_obs_startup(void)
+{
+	pthread_mutex_init_recursive(&mock_mutex);
+}
+
+void mock_obs_shutdown(void)
+{
+	for (size_t i = 0; i < MAX_CHANNELS; i++)
+		obs_set_output_source((uint32_t)i, NULL);
+	for (size_t i = 0; i < media_configs.num; i++)
+		bfree(media_configs.array[i].path);
+	da_free(media_configs);
+	for (size_t i = 0; i < hotkeys.num; i++)
+		bfree(hotkeys.array[i].name);
+	da_free(hotkeys);
+	da_free(source_types);
+	da_free(sources);
+	bfree(config_dir);
+	config_dir = NULL;
+	pthread_mutex_destroy(&mock_mutex);
+}
+
+void mock_set_config_dir(const char *dir)
+{
+	bfree(config_dir);
+	config_dir = bstrdup(dir);
+}
+
+void mock_set_speakers(enum speaker_layout speakers)
+{
+	audio_info.speakers = speakers;
+}
+
+void mock_set_next_uuid(const char *uuid)
+{
+	snprintf(next_uuid, sizeof(next_uuid), "%s", uuid);
+}
+
+void mock_set_video_stalled(bool stalled)
+{
+	video_stalled = stalled;
+}
+
+uint64_t mock_time_ns(void)
+{
+	return virtual_time_ns;
+}
+
+static struct media_config *find_media_config(const char *path, bool create)
+{
+	for (size_t i = 0; i < media_configs.num; i++) {
+		if (strcmp(media_configs.array[i].path, path) == 0)
+			return &media_configs.array[i];
+	}
+
+	if (!create)
+		return NULL;
+
+	struct media_config *config = da_push_back_new(media_configs);
+	config->path = bstrdup(path);
+	config->duration = DEFAULT_DURATION_MS;
+	config->amplitude = 0.25f;
+	return config;
+}
+
+void mock_media_set_duration(const char *path, int64_t milliseconds)
+{
+	pthread_mutex_lock(&mock_mutex);
+	find_media_config(path, true)->duration = milliseconds;
+	pthread_mutex_unlock(&mock_mutex);
+}
+
+void mock_media_set_broken(const char *path, bool broken)
+{
+	pthread_mutex_lock(&mock_mutex);
+	find_media_config(path, true)->broken = broken;
+	pthread_mutex_unlock(&mock_mutex);
+}
+
+void mock_media_set_open_blocked(bool blocked)
+{
+	os_atomic_set_bool(&open_blocked, blocked);
+}
+
+long mock_media_get_opens_held(void)
+{
+	return os_atomic_load_long(&opens_held);
+}
+
+void mock_media_set_amplitude(const char *path, float amplitude)
+{
+	pthread_mutex_lock(&mock_mutex);
+	find_media_config(path, true)->amplitude = amplitude;
+	pthread_mutex_unlock(&mock_mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Fake media source */
+
+static void media_signal(obs_source_t *source, const char *signal)
+{
+	calldata_t cd = {0};
+	calldata_set_ptr(&cd, "source", source);
+	signal_handler_signal(source->signals, signal, &cd);
+	calldata_free(&cd);
+}
+
+static void media_open(obs_source_t *source)
+{
+	struct fake_media *m = source->media;
+	struct media_config *config;
+
+	pthread_mutex_lock(&mock_mutex);
+	config = m->path && *m->path ? find_media_config(m->path, false) : NULL;
+	m->duration = config ? config->duration : DEFAULT_DURATION_MS;
+	m->broken = config ? config->broken : false;
+	m->amplitude = config ? config->amplitude : 0.25f;
+	pthread_mutex_unlock(&mock_mutex);
+
+	m->time = 0;
+	m->phase = 0.0;
+	if (m->path && *m->path) {
+		m->open = true;
+		m->open_count++;
+		m->state = OBS_MEDIA_STATE_PLAYING; // like ffmpeg_source, even before it decodes anything
+	} else {
+		m->open = false;
+		m->state = OBS_MEDIA_STATE_NONE;
+	}
+}
+
+static void media_update(obs_source_t *source, obs_data_t *settings)
+{
+	struct fake_media *m = source->media;
+	bool is_local = obs_data_get_bool(settings, "is_local_file");
+	const char *path = obs_data_get_string(settings, is_local ? "local_file" : "input");
+	bool path_changed;
+
+	os_atomic_inc_long(&opens_held);
+	while (os_atomic_load_bool(&open_blocked))
+		os_sleep_ms(1);
+	os_atomic_dec_long(&opens_held);
+
+	pthread_mutex_lock(&m->mutex);
+	m->restart_on_activate = obs_data_get_bool(settings, "restart_on_activate");
+	m->close_when_inactive = obs_data_get_bool(settings, "close_when_inactive");
+	m->speed = obs_data_get_int(settings, "speed_percent");
+	if (m->speed < 1 || m->speed > 200)
+		m->speed = 100;
+
+	path_changed = !m->path || strcmp(m->path, path) != 0;
+	if (path_changed) {
+		bfree(m->path);
+		m->path = bstrdup(path);
+	}
+	/* like ffmpeg_source, any update reopens the media */
+	media_open(source);
+	pthread_mutex_unlock(&m->mutex);
+
+	if (m->open)
+		media_signal(source, "media_started");
+}
+
+static void media_tick(obs_source_t *source, uint32_t ms)
+{
+	struct fake_media *m = source->media;
+	bool ended = false;
+	struct audio_data audio = {0};
+	float *planes[MAX_AUDIO_CHANNELS] = {0};
+	size_t channels = get_audio_channels(audio_info.speakers);
+
+	pthread_mutex_lock(&m->mutex);
+	if (m->state != OBS_MEDIA_STATE_PLAYING || m->broken) {
+		pthread_mutex_unlock(&m->mutex);
+		return;
+	}
+
+	int64_t advance = (int64_t)ms * m->speed / 100;
+	int64_t remaining = m->duration - m->time;
+	if (advance >= remaining) {
+		advance = remaining;
+		ended = true;
+	}
+
+	audio.frames = (uint32_t)(advance * SAMPLE_RATE / 1000);
+	audio.timestamp = virtual_time_ns;
+	for (size_t ch = 0; ch < channels && audio.frames; ch++) {
+		planes[ch] = bmalloc(audio.frames * sizeof(float));
+		for (uint32_t i = 0; i < audio.frames; i++)
+			planes[ch][i] = m->amplitude * (float)sin(m->phase + (double)i * 2.0 * M_PI * 440.0 / SAMPLE_RATE);
+		audio.data[ch] = (uint8_t *)planes[ch];
+	}
+	m->phase += (double)audio.frames * 2.0 * M_PI * 440.0 / SAMPLE_RATE;
+
+	m->time += advance;
+	if (ended)
+		m->state = OBS_MEDIA_STATE_ENDED;
+	pthread_mutex_unlock(&m->mutex);
+
+	if (audio.frames) {
+		pthread_mutex_lock(&source->callbacks_mutex);
+		for (size_t i = 0; i < source->capture_callbacks.num; i++) {
+			struct capture_callback *cb = &source->capture_callbacks.array[i];
+			cb->callback(cb->param, source, &audio, false);
+		}
+		pthread_mutex_unlock(&source->callbacks_mutex);
+	}
+
+	for (size_t ch = 0; ch < channels; ch++)
+		bfree(planes[ch]);
+
+	if (ended)
+		media_signal(source, "media_ended");
+}
+
+/* ------------------------------------------------------------------------- */
+/* Registration and lifetime */
+
+void obs_register_source_s(const struct obs_source_info *info, size_t size)
+{
+	struct obs_source_info copy = {0};
+	memcpy(&copy, info, size < sizeof(copy) ? size : sizeof(copy));
+	da_push_back(source_types, &copy);
+}
+
+static const struct obs_source_info *find_source_info(const char *id)
+{
+	for (size_t i = 0; i < source_types.num; i++) {
+		if (strcmp(source_types.array[i].id, id) == 0)
+			return &source_types.array[i];
+	}
+	return NULL;
+}
+
+static obs_source_t *source_create(const char *id, const char *name, obs_data_t *settings, bool is_private)
+{
+	obs_source_t *source = bzalloc(sizeof(struct obs_source));
+	long num = os_atomic_inc_long(&uuid_counter);
+
+	source->ref = 1;
+	source->is_private = is_private;
+	source->name = bstrdup(name);
+	if (*next_uuid) {
+		/* like a source loaded from a saved scene collection */
+		memcpy(source->uuid, next_uuid, sizeof(source->uuid));
+		*next_uuid = 0;
+	} else {
+		snprintf(source->uuid, sizeof(source->uuid), "00000000-0000-4000-8000-%012lx", num);
+	}
+	source->signals = signal_handler_create();
+	source->procs = proc_handler_create();
+	source->settings = obs_data_create();
+	pthread_mutex_init_recursive(&source->callbacks_mutex);
+	pthread_mutex_init(&source->children_mutex, NULL);
+	if (settings)
+		obs_data_apply(source->settings, settings);
+
+	if (strcmp(id, FAKE_MEDIA_ID) == 0) {
+		source->media = bzalloc(sizeof(struct fake_media));
+		pthread_mutex_init(&source->media->mutex, NULL);
+		source->media->speed = 100;
+	} else {
+		source->info = find_source_info(id);
+		if (!source->info) {
+			blog(LOG_ERROR, "Source ID '%s' not found", id);
+			obs_source_release(source);
+			return NULL;
+		}
+		if (source->info->get_defaults)
+			source->info->get_defaults(source->settings);
+		source->data = source->info->create(source->settings, source);
+		if (!source->data) {
+			obs_source_release(source);
+			return NULL;
+		}
+		if (source->deferred_update) {
+			source->deferred_update = false;
+			if (source->info->update)
+				source->info->update(source->data, source->settings);
+		}
+	}
+
+	pthread_mutex_lock(&mock_mutex);
+	da_push_back(sources, &source);
+	pthread_mutex_unlock(&mock_mutex);
+	return source;
+}
+
+obs_source_t *obs_source_create(const char *id, const char *name, obs_data_t *settings, obs_data_t *hotkey_data)
+{
+	UNUSED_PARAMETER(hotkey_data);
+	return source_create(id, name, settings, false);
+}
+
+obs_source_t *obs_source_create_private(const char *id, const char *name, obs_data_t *settings)
+{
+	return source_create(id, name, settings, true);
+}
+
+obs_source_t *obs_source_get_ref(obs_source_t *source)
+{
+	if (source)
+		os_atomic_inc_long(&source->ref);
+	return source;
+}
+
+void obs_source_release(obs_source_t *source)
+{
+	if (!source || os_atomic_dec_long(&source->ref) != 0)
+		return;
+
+	pthread_mutex_lock(&mock_mutex);
+	da_erase_item(sources, &source);
+	for (size_t i = hotkeys.num; i > 0; i--) {
+		if (hotkeys.array[i - 1].source == source) {
+			bfree(hotkeys.array[i - 1].name);
+			da_erase(hotkeys, i - 1);
+		}
+	}
+	pthread_mutex_unlock(&mock_mutex);
+
+	if (source->info && source->data)
+		source->info->destroy(source->data);
+
+	if (source->media) {
+		pthread_mutex_destroy(&source->media->mutex);
+		bfree(source->media->path);
+		bfree(source->media);
+	}
+
+	for (size_t i = 0; i < source->children.num; i++)
+		obs_source_release(source->children.array[i]);
+	da_free(source->children);
+	da_free(source->capture_callbacks);
+	pthread_mutex_destroy(&source->callbacks_mutex);
+	pthread_mutex_destroy(&source->children_mutex);
+	signal_handler_destroy(source->signals);
+	proc_handler_destroy(source->procs);
+	obs_data_release(source->settings);
+	bfree(source->name);
+	bfree(source);
+}
+
+const char *obs_source_get_name(const obs_source_t *source)
+{
+	return source ? source->name : NULL;
+}
+
+const char *obs_source_get_uuid(const obs_source_t *source)
+{
+	return source ? source->uuid : NULL;
+}
+
+const char *obs_source_get_id(const obs_source_t *source)
+{
+	if (!source)
+		return NULL;
+	return source->info ? source->info->id : FAKE_MEDIA_ID;
+}
+
+obs_data_t *obs_source_get_settings(const obs_source_t *source)
+{
+	if (!source)
+		return NULL;
+	obs_data_addref(source->settings);
+	return source->settings;
+}
+
+void obs_source_update(obs_source_t *source, obs_data_t *settings)
+{
+	if (!source)
+		return;
+
+	if (settings)
+		obs_data_apply(source->settings, settings);
+
+	if (source->media) {
+		media_update(source, source->settings);
+	} else if (!source->data) {
+		/* called from inside create, like OBS this gets deferred */
+		source->deferred_update = true;
+	} else if (source->info->update) {
+		source->info->update(source->data, source->settings);
+	}
+}
+
+void obs_source_update_properties(obs_source_t *source)
+{
+	UNUSED_PARAMETER(source);
+}
+
+obs_properties_t *obs_source_properties(const obs_source_t *source)
+{
+	if (source && source->info && source->info->get_properties)
+		return source->info->get_properties(source->data);
+	return NULL;
+}
+
+void obs_source_save(obs_source_t *source)
+{
+	if (source && source->info && source->info->save)
+		source->info->save(source->data, source->settings);
+}
+
+void obs_source_load(obs_source_t *source)
+{
+	if (source && source->info && source->info->load)
+		source->info->load(source->data, source->settings);
+}
+
+void obs_source_remove(obs_source_t *source)
+{
+	calldata_t cd = {0};
+
+	if (!source)
+		return;
+	calldata_set_ptr(&cd, "source", source);
+	signal_handler_signal(source->signals, "remove", &cd);
+	calldata_free(&cd);
+}
+
+obs_missing_files_t *obs_source_get_missing_files(const obs_source_t *source)
+{
+	if (source && source->info && source->info->missing_files)
+		return source->info->missing_files(source->data);
+	return obs_missing_files_create();
+}
+
+signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
+{
+	return source ? source->signals : NULL;
+}
+
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source)
+{
+	return source ? source->procs : NULL;
+}
+
+bool obs_source_active(const obs_source_t *source)
+{
+	return source && os_atomic_load_long(&((obs_source_t *)source)->active) > 0;
+}
+
+bool obs_source_showing(const obs_source_t *source)
+{
+	return source && os_atomic_load_long(&((obs_source_t *)source)->showing) > 0;
+}
+
+static void set_child_active(obs_source_t *child, bool active)
+{
+	struct fake_media *m = child->media;
+
+	if (active)
+		os_atomic_inc_long(&child->active);
+	else
+		os_atomic_dec_long(&child->active);
+
+	if (!m)
+		return;
+
+	pthread_mutex_lock(&m->mutex);
+	if (active && m->restart_on_activate && m->path && *m->path) {
+		media_open(child);
+	} else if (!active && m->close_when_inactive) {
+		m->open = false;
+		m->state = OBS_MEDIA_STATE_STOPPED;
+	}
+	pthread_mutex_unlock(&m->mutex);
+}
+
+void mock_set_active(obs_source_t *source, bool active)
+{
+	if (obs_source_active(source) == active)
+		return;
+
+	if (active) {
+		os_atomic_inc_long(&source->active);
+		pthread_mutex_lock(&source->children_mutex);
+		for (size_t i = 0; i < source->children.num; i++)
+			set_child_active(source->children.array[i], true);
+		pthread_mutex_unlock(&source->children_mutex);
+		if (source->info && source->info->activate)
+			source->info->activate(source->data);
+	} else {
+		if (source->info && source->info->deactivate)
+			source->info->deactivate(source->data);
+		pthread_mutex_lock(&source->children_mutex);
+		for (size_t i = 0; i < source->children.num; i++)
+			set_child_active(source->children.array[i], false);
+		pthread_mutex_unlock(&source->children_mutex);
+		os_atomic_dec_long(&source->active);
+	}
+}
+
+void mock_set_showing(obs_source_t *source, bool showing)
+{
+	if (obs_source_showing(source) == showing)
+		return;
+
+	if (showing) {
+		os_atomic_inc_long(&source->showing);
+		if (source->info && source->info->show)
+			source->info->show(source->data);
+	} else {
+		if (source->info && source->info->hide)
+			source->info->hide(source->data);
+		os_atomic_dec_long(&source->showing);
+	}
+}
+
+uint32_t obs_source_get_width(obs_source_t *source)
+{
+	if (!source)
+		return 0;
+	if (source->media)
+		return source->media->open ? 1920 : 0;
+	return source->info->get_width ? source->info->get_width(source->data) : 0;
+}
+
+uint32_t obs_source_get_height(obs_source_t *source)
+{
+	if (!source)
+		return 0;
+	if (source->media)
+		return source->media->open ? 1080 : 0;
+	return source->info->get_height ? source->info->get_height(source->data) : 0;
+}
+
+void obs_source_video_render(obs_source_t *source)
+{
+	if (!source)
+		return;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		if ((source->media->state == OBS_MEDIA_STATE_PLAYING || source->media->state == OBS_MEDIA_STATE_PAUSED) &&
+		    !source->media->broken)
+			source->media->frames_rendered++;
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->video_render) {
+		source->info->video_render(source->data, NULL);
+	}
+}
+
+void mock_render(obs_source_t *source)
+{
+	obs_source_video_render(source);
+}
+
+bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child)
+{
+	if (!parent || !child)
+		return false;
+
+	obs_source_get_ref(child);
+	pthread_mutex_lock(&parent->children_mutex);
+	da_push_back(parent->children, &child);
+	if (obs_source_active(parent))
+		set_child_active(child, true);
+	pthread_mutex_unlock(&parent->children_mutex);
+	return true;
+}
+
+void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child)
+{
+	if (!parent || !child)
+		return;
+
+	pthread_mutex_lock(&parent->children_mutex);
+	size_t idx = da_find(parent->children, &child, 0);
+	if (idx == DARRAY_INVALID) {
+		pthread_mutex_unlock(&parent->children_mutex);
+		return;
+	}
+
+	if (obs_source_active(parent))
+		set_child_active(child, false);
+	da_erase(parent->children, idx);
+	pthread_mutex_unlock(&parent->children_mutex);
+	obs_source_release(child);
+}
+
+obs_source_t *mock_get_active_child(obs_source_t *parent, size_t idx)
+{
+	if (!parent)
+		return NULL;
+
+	pthread_mutex_lock(&parent->children_mutex);
+	obs_source_t *child = idx < parent->children.num ? parent->children.array[idx] : NULL;
+	pthread_mutex_unlock(&parent->children_mutex);
+	return child;
+}
+
+void obs_source_add_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param)
+{
+	struct capture_callback cb = {callback, param};
+
+	pthread_mutex_lock(&source->callbacks_mutex);
+	da_push_back(source->capture_callbacks, &cb);
+	pthread_mutex_unlock(&source->callbacks_mutex);
+}
+
+void obs_source_remove_audio_capture_callback(obs_source_t *source, obs_source_audio_capture_t callback, void *param)
+{
+	struct capture_callback cb = {callback, param};
+
+	pthread_mutex_lock(&source->callbacks_mutex);
+	da_erase_item(source->capture_callbacks, &cb);
+	pthread_mutex_unlock(&source->callbacks_mutex);
+}
+
+void obs_source_output_audio(obs_source_t *source, const struct obs_source_audio *audio)
+{
+	if (!source || !audio)
+		return;
+
+	source->audio_frames_output += audio->frames;
+	source->audio_timestamp = audio->timestamp;
+	if (source->audio_output_cb)
+		source->audio_output_cb(source->audio_output_param, source, audio);
+}
+
+void mock_set_audio_output_callback(obs_source_t *source, mock_audio_output_cb callback, void *param)
+{
+	source->audio_output_cb = callback;
+	source->audio_output_param = param;
+}
+
+uint64_t mock_get_audio_frames_output(obs_source_t *source)
+{
+	return source->audio_frames_output;
+}
+
+uint64_t obs_source_get_audio_timestamp(const obs_source_t *source)
+{
+	return source ? source->audio_timestamp : 0;
+}
+
+void obs_source_get_audio_mix(const obs_source_t *source, struct obs_source_audio_mix *audio)
+{
+	UNUSED_PARAMETER(source);
+	memset(audio, 0, sizeof(*audio));
+}
+
+/* ------------------------------------------------------------------------- */
+/* Media controls */
+
+void obs_source_media_play_pause(obs_source_t *source, bool pause)
+{
+	if (!source)
+		return;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		if (source->media->open && (source->media->state == OBS_MEDIA_STATE_PLAYING ||
+					    source->media->state == OBS_MEDIA_STATE_PAUSED))
+			source->media->state = pause ? OBS_MEDIA_STATE_PAUSED : OBS_MEDIA_STATE_PLAYING;
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->media_play_pause) {
+		source->info->media_play_pause(source->data, pause);
+	}
+	signal_handler_signal(source->signals, pause ? "media_pause" : "media_play", NULL);
+}
+
+void obs_source_media_restart(obs_source_t *source)
+{
+	if (!source)
+		return;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		media_open(source);
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->media_restart) {
+		source->info->media_restart(source->data);
+	}
+	signal_handler_signal(source->signals, "media_restart", NULL);
+}
+
+void obs_source_media_stop(obs_source_t *source)
+{
+	if (!source)
+		return;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		source->media->open = false;
+		source->media->state = OBS_MEDIA_STATE_STOPPED;
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->media_stop) {
+		source->info->media_stop(source->data);
+	}
+	signal_handler_signal(source->signals, "media_stopped", NULL);
+}
+
+void obs_source_media_next(obs_source_t *source)
+{
+	if (source && source->info && source->info->media_next)
+		source->info->media_next(source->data);
+	if (source)
+		signal_handler_signal(source->signals, "media_next", NULL);
+}
+
+void obs_source_media_previous(obs_source_t *source)
+{
+	if (source && source->info && source->info->media_previous)
+		source->info->media_previous(source->data);
+	if (source)
+		signal_handler_signal(source->signals, "media_previous", NULL);
+}
+
+int64_t obs_source_media_get_duration(obs_source_t *source)
+{
+	int64_t duration = 0;
+
+	if (!source)
+		return 0;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		duration = source->media->open ? source->media->duration : 0;
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->media_get_duration) {
+		duration = source->info->media_get_duration(source->data);
+	}
+	return duration;
+}
+
+int64_t obs_source_media_get_time(obs_source_t *source)
+{
+	int64_t time = 0;
+
+	if (!source)
+		return 0;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		time = source->media->open ? source->media->time : 0;
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->media_get_time) {
+		time = source->info->media_get_time(source->data);
+	}
+	return time;
+}
+
+void obs_source_media_set_time(obs_source_t *source, int64_t ms)
+{
+	if (!source)
+		return;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		if (source->media->open) {
+			if (ms < 0)
+				ms = 0;
+			if (ms > source->media->duration)
+				ms = source->media->duration;
+			source->media->time = ms;
+		}
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->media_set_time) {
+		source->info->media_set_time(source->data, ms);
+	}
+}
+
+enum obs_media_state obs_source_media_get_state(obs_source_t *source)
+{
+	enum obs_media_state state = OBS_MEDIA_STATE_NONE;
+
+	if (!source)
+		return state;
+
+	if (source->media) {
+		pthread_mutex_lock(&source->media->mutex);
+		state = source->media->state;
+		pthread_mutex_unlock(&source->media->mutex);
+	} else if (source->info->media_get_state) {
+		state = source->info->media_get_state(source->data);
+	}
+	return state;
+}
+
+void obs_source_media_started(obs_source_t *source)
+{
+	if (source)
+		signal_handler_signal(source->signals, "media_started", NULL);
+}
+
+void obs_source_media_ended(obs_source_t *source)
+{
+	if (source)
+		signal_handler_signal(source->signals, "media_ended", NULL);
+}
+
+const char *mock_media_get_path(obs_source_t *media)
+{
+	return media && media->media ? media->media->path : NULL;
+}
+
+bool mock_media_has_path(obs_source_t *media, const char *path)
+{
+	bool same = false;
+	if (media && media->media) {
+		pthread_mutex_lock(&media->media->mutex);
+		same = media->media->path && strcmp(media->media->path, path) == 0;
+		pthread_mutex_unlock(&media->media->mutex);
+	}
+	return same;
+}
+
+size_t mock_media_get_open_count(obs_source_t *media)
+{
+	return media && media->media ? media->media->open_count : 0;
+}
+
+size_t mock_media_get_frames_rendered(obs_source_t *media)
+{
+	return media && media->media ? media->media->frames_rendered : 0;
+}
+
+bool mock_media_is_open(obs_source_t *media)
+{
+	return media && media->media && media->media->open;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Virtual clock */
+
+void mock_tick(uint32_t milliseconds)
+{
+	DARRAY(obs_source_t *) snapshot;
+	da_init(snapshot);
+
+	pthread_mutex_lock(&mock_mutex);
+	virtual_time_ns += (uint64_t)milliseconds * 1000000ULL;
+	da_copy(snapshot, sources);
+	for (size_t i = 0; i < snapshot.num; i++)
+		obs_source_get_ref(snapshot.array[i]);
+	pthread_mutex_unlock(&mock_mutex);
+
+	for (size_t i = 0; i < snapshot.num; i++) {
+		obs_source_t *source = snapshot.array[i];
+		if (source->media)
+			media_tick(source, milliseconds);
+	}
+
+	for (size_t i = 0; i < snapshot.num && !video_stalled; i++) {
+		obs_source_t *source = snapshot.array[i];
+		if (source->info && source->info->video_tick)
+			source->info->video_tick(source->data, (float)milliseconds / 1000.0f);
+	}
+
+	for (size_t i = 0; i < snapshot.num; i++)
+		obs_source_release(snapshot.array[i]);
+	da_free(snapshot);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Core */
+
+uint64_t obs_get_video_frame_time(void)
+{
+	return virtual_time_ns;
+}
+
+audio_t *obs_get_audio(void)
+{
+	return &audio_output;
+}
+
+const struct audio_output_info *audio_output_get_info(const audio_t *audio)
+{
+	UNUSED_PARAMETER(audio);
+	return &audio_info;
+}
+
+size_t audio_output_get_channels(const audio_t *audio)
+{
+	UNUSED_PARAMETER(audio);
+	return get_audio_channels(audio_info.speakers);
+}
+
+uint32_t audio_output_get_sample_rate(const audio_t *audio)
+{
+	UNUSED_PARAMETER(audio);
+	return audio_info.samples_per_sec;
+}
+
+void obs_queue_task(enum obs_task_type type, obs_task_t task, void *param, bool wait)
+{
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(wait);
+	task(param);
+}
+
+void obs_set_output_source(uint32_t channel, obs_source_t *source)
+{
+	obs_source_t *prev;
+
+	if (channel >= MAX_CHANNELS)
+		return;
+	obs_source_get_ref(source);
+	pthread_mutex_lock(&mock_mutex);
+	prev = output_sources[channel];
+	output_sources[channel] = source;
+	pthread_mutex_unlock(&mock_mutex);
+	obs_source_release(prev);
+}
+
+obs_source_t *obs_get_output_source(uint32_t channel)
+{
+	obs_source_t *source;
+
+	if (channel >= MAX_CHANNELS)
+		return NULL;
+	pthread_mutex_lock(&mock_mutex);
+	source = obs_source_get_ref(output_sources[channel]);
+	pthread_mutex_unlock(&mock_mutex);
+	return source;
+}
+
+char *obs_module_get_config_path(obs_module_t *module, const char *file)
+{
+	struct dstr output = {0};
+
+	UNUSED_PARAMETER(module);
+	dstr_copy(&output, config_dir ? config_dir : "/tmp/mps-test-config");
+	if (file && *file) {
+		dstr_cat_ch(&output, '/');
+		dstr_cat(&output, file);
+	}
+	return output.array;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Hotkeys */
+
+obs_hotkey_id obs_hotkey_register_source(obs_source_t *source, const char *name, const char *description,
+					 obs_hotkey_func func, void *data)
+{
+	struct hotkey hotkey = {hotkeys.num, source, bstrdup(name), func, data};
+
+	UNUSED_PARAMETER(description);
+	pthread_mutex_lock(&mock_mutex);
+	da_push_back(hotkeys, &hotkey);
+	pthread_mutex_unlock(&mock_mutex);
+	return hotkey.id;
+}
+
+bool mock_press_hotkey(obs_source_t *source, const char *name)
+{
+	struct hotkey hotkey = {0};
+	bool found = false;
+
+	pthread_mutex_lock(&mock_mutex);
+	for (size_t i = 0; i < hotkeys.num; i++) {
+		if (hotkeys.array[i].source == source && strcmp(hotkeys.array[i].name, name) == 0) {
+			hotkey = hotkeys.array[i];
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&mock_mutex);
+
+	if (found)
+		hotkey.func(hotkey.data, hotkey.id, NULL, true);
+	return found;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Properties */
+
+struct obs_property {
+	char *name;
+	obs_property_clicked_t clicked;
+	obs_property_modified_t modified;
+	bool visible;
+	bool enabled;
+	obs_properties_t *group;
+};
+
+struct obs_properties {
+	DARRAY(struct obs_property *) props;
+};
+
+obs_properties_t *obs_properties_create(void)
+{
+	return bzalloc(sizeof(struct obs_properties));
+}
+
+void obs_properties_destroy(obs_properties_t *props)
+{
+	if (!props)
+		return;
+
+	for (size_t i = 0; i < props->props.num; i++) {
+		struct obs_property *p = props->props.array[i];
+		obs_properties_destroy(p->group);
+		bfree(p->name);
+		bfree(p);
+	}
+	da_free(props->props);
+	bfree(props);
+}
+
+obs_property_t *obs_properties_get(obs_properties_t *props, const char *property)
+{
+	if (!props)
+		return NULL;
+
+	for (size_t i = 0; i < props->props.num; i++) {
+		struct obs_property *p = props->props.array[i];
+		if (strcmp(p->name, property) == 0)
+			return p;
+		if (p->group) {
+			obs_property_t *found = obs_properties_get(p->group, property);
+			if (found)
+				return found;
+		}
+	}
+	return NULL;
+}
+
+static obs_property_t *add_property(obs_properties_t *props, const char *name)
+{
+	struct obs_property *p = bzalloc(sizeof(struct obs_property));
+	p->name = bstrdup(name);
+	p->visible = true;
+	p->enabled = true;
+	da_push_back(props->props, &p);
+	return p;
+}
+
+obs_property_t *obs_properties_add_bool(obs_properties_t *props, const char *name, const char *description)
+{
+	UNUSED_PARAMETER(description);
+	return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_int(obs_properties_t *props, const char *name, const char *description, int min,
+				       int max, int step)
+{
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(min);
+	UNUSED_PARAMETER(max);
+	UNUSED_PARAMETER(step);
+	return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props, const char *name, const char *description,
+					      int min, int max, int step)
+{
+	return obs_properties_add_int(props, name, description, min, max, step);
+}
+
+obs_property_t *obs_properties_add_float(obs_properties_t *props, const char *name, const char *description,
+					 double min, double max, double step)
+{
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(min);
+	UNUSED_PARAMETER(max);
+	UNUSED_PARAMETER(step);
+	return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_float_slider(obs_properties_t *props, const char *name, const char *description,
+						double min, double max, double step)
+{
+	return obs_properties_add_float(props, name, description, min, max, step);
+}
+
+obs_property_t *obs_properties_add_text(obs_properties_t *props, const char *name, const char *description,
+					enum obs_text_type type)
+{
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(type);
+	return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_path(obs_properties_t *props, const char *name, const char *description,
+					enum obs_path_type type, const char *filter, const char *default_path)
+{
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(filter);
+	UNUSED_PARAMETER(default_path);
+	return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_list(obs_properties_t *props, const char *name, const char *description,
+					enum obs_combo_type type, enum obs_combo_format format)
+{
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(format);
+	return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_button(obs_properties_t *props, const char *name, const char *text,
+					  obs_property_clicked_t callback)
+{
+	obs_property_t *p = add_property(props, name);
+	UNUSED_PARAMETER(text);
+	p->clicked = callback;
+	return p;
+}
+
+obs_property_t *obs_properties_add_editable_list(obs_properties_t *props, const char *name, const char *description,
+						 enum obs_editable_list_type type, const char *filter,
+						 const char *default_path)
+{
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(filter);
+	UNUSED_PARAMETER(default_path);
+	return add_property(props, name);
+}
+
+obs_property_t *obs_properties_add_group(obs_properties_t *props, const char *name, const char *description,
+					 enum obs_group_type type, obs_properties_t *group)
+{
+	obs_property_t *p = add_property(props, name);
+	UNUSED_PARAMETER(description);
+	UNUSED_PARAMETER(type);
+	p->group = group;
+	return p;
+}
+
+size_t obs_property_list_add_string(obs_property_t *p, const char *name, const char *val)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(name);
+	UNUSED_PARAMETER(val);
+	return 0;
+}
+
+size_t obs_property_list_add_int(obs_property_t *p, const char *name, long long val)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(name);
+	UNUSED_PARAMETER(val);
+	return 0;
+}
+
+void obs_property_set_long_description(obs_property_t *p, const char *long_description)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(long_description);
+}
+
+void obs_property_set_visible(obs_property_t *p, bool visible)
+{
+	if (p)
+		p->visible = visible;
+}
+
+void obs_property_set_enabled(obs_property_t *p, bool enabled)
+{
+	if (p)
+		p->enabled = enabled;
+}
+
+void obs_property_set_modified_callback(obs_property_t *p, obs_property_modified_t modified)
+{
+	if (p)
+		p->modified = modified;
+}
+
+void obs_property_int_set_suffix(obs_property_t *p, const char *suffix)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(suffix);
+}
+
+void obs_property_float_set_suffix(obs_property_t *p, const char *suffix)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(suffix);
+}
+
+void obs_property_text_set_info_type(obs_property_t *p, enum obs_text_info_type type)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(type);
+}
+
+bool mock_click_button(obs_source_t *source, const char *name)
+{
+	obs_properties_t *props = obs_source_properties(source);
+	obs_property_t *p = obs_properties_get(props, name);
+	bool clicked = false;
+
+	if (p && p->clicked) {
+		p->clicked(props, p, source->data);
+		clicked = true;
+	}
+	obs_properties_destroy(props);
+	return clicked;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Missing files */
+
+struct obs_missing_file {
+	char *path;
+	obs_missing_file_cb callback;
+	int src_type;
+	void *src;
+	void *data;
+};
+
+struct obs_missing_files {
+	DARRAY(struct obs_missing_file *) files;
+};
+
+obs_missing_files_t *obs_missing_files_create(void)
+{
+	return bzalloc(sizeof(struct obs_missing_files));
+}
+
+void obs_missing_files_destroy(obs_missing_files_t *files)
+{
+	if (!files)
+		return;
+
+	for (size_t i = 0; i < files->files.num; i++) {
+		bfree(files->files.array[i]->path);
+		bfree(files->files.array[i]);
+	}
+	da_free(files->files);
+	bfree(files);
+}
+
+void obs_missing_files_add_file(obs_missing_files_t *files, obs_missing_file_t *file)
+{
+	da_push_back(files->files, &file);
+}
+
+size_t obs_missing_files_count(obs_missing_files_t *files)
+{
+	return files ? files->files.num : 0;
+}
+
+obs_missing_file_t *obs_missing_files_get_file(obs_missing_files_t *files, int idx)
+{
+	return files && (size_t)idx < files->files.num ? files->files.array[idx] : NULL;
+}
+
+obs_missing_file_t *obs_missing_file_create(const char *path, obs_missing_file_cb callback, int src_type, void *src,
+					    void *data)
+{
+	obs_missing_file_t *file = bzalloc(sizeof(struct obs_missing_file));
+	file->path = bstrdup(path);
+	file->callback = callback;
+	file->src_type = src_type;
+	file->src = src;
+	file->data = data;
+	return file;
+}
+
+const char *obs_missing_file_get_path(obs_missing_file_t *file)
+{
+	return file ? file->path : NULL;
+}
+
+/* Like libobs, a source gets its own data back rather than the source */
+void obs_missing_file_issue_callback(obs_missing_file_t *file, const char *new_path)
+{
+	void *src = file->src_type == OBS_MISSING_FILE_SOURCE ? ((obs_source_t *)file->src)->data : file->src;
+	file->callback(src, new_path, file->data);
+}
@@ -0,0 +1,842 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Utility part of the stand-in libobs: memory, logging, strings, platform and
+ * threading helpers. POSIX only, the harness is meant for CI boxes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <util/bmem.h>
+#include <util/base.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+/* ------------------------------------------------------------------------- */
+/* Memory */
+
+static volatile long num_allocs = 0;
+
+void *bmalloc(size_t size)
+{
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr) {
+		fprintf(stderr, "Out of memory while trying to allocate %zu bytes\n", size);
+		abort();
+	}
+	os_atomic_inc_long(&num_allocs);
+	return ptr;
+}
+
+void *brealloc(void *ptr, size_t size)
+{
+	if (!ptr)
+		os_atomic_inc_long(&num_allocs);
+
+	ptr = realloc(ptr, size ? size : 1);
+	if (!ptr) {
+		fprintf(stderr, "Out of memory while trying to allocate %zu bytes\n", size);
+		abort();
+	}
+	return ptr;
+}
+
+void bfree(void *ptr)
+{
+	if (ptr) {
+		os_atomic_dec_long(&num_allocs);
+		free(ptr);
+	}
+}
+
+long bnum_allocs(void)
+{
+	return os_atomic_load_long(&num_allocs);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Logging */
+
+static int log_level_limit = LOG_WARNING;
+
+void mock_set_log_level(int log_level)
+{
+	log_level_limit = log_level;
+}
+
+void blogva(int log_level, const char *format, va_list args)
+{
+	if (log_level > log_level_limit)
+		return;
+
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+void blog(int log_level, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	blogva(log_level, format, args);
+	va_end(args);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Strings */
+
+int astrcmpi(const char *str1, const char *str2)
+{
+	if (!str1)
+		str1 = "";
+	if (!str2)
+		str2 = "";
+
+	do {
+		char ch1 = (char)toupper(*str1);
+		char ch2 = (char)toupper(*str2);
+
+		if (ch1 < ch2)
+			return -1;
+		else if (ch1 > ch2)
+			return 1;
+	} while (*str1++ && *str2++);
+
+	return 0;
+}
+
+int astrcmp_n(const char *str1, const char *str2, size_t n)
+{
+	if (!n)
+		return 0;
+	if (!str1)
+		str1 = "";
+	if (!str2)
+		str2 = "";
+
+	return strncmp(str1, str2, n);
+}
+
+int astrcmpi_n(const char *str1, const char *str2, size_t n)
+{
+	if (!n)
+		return 0;
+	if (!str1)
+		str1 = "";
+	if (!str2)
+		str2 = "";
+
+	do {
+		char ch1 = (char)toupper(*str1);
+		char ch2 = (char)toupper(*str2);
+
+		if (ch1 < ch2)
+			return -1;
+		else if (ch1 > ch2)
+			return 1;
+	} while (*str1++ && *str2++ && --n);
+
+	return 0;
+}
+
+char *astrstri(const char *str, const char *find)
+{
+	size_t len;
+
+	if (!str || !find)
+		return NULL;
+
+	len = strlen(find);
+
+	do {
+		if (astrcmpi_n(str, find, len) == 0)
+			return (char *)str;
+	} while (*str++);
+
+	return NULL;
+}
+
+char **strlist_split(const char *str, char split_ch, bool include_empty)
+{
+	const char *cur_str = str;
+	const char *next_str;
+	char *out = NULL;
+	size_t count = 0;
+	size_t total_size = 0;
+
+	if (str) {
+		char **table;
+		char *offset;
+		size_t cur_idx = 0;
+		size_t cur_pos = 0;
+
+		next_str = strchr(str, split_ch);
+
+		while (next_str) {
+			size_t size = next_str - cur_str;
+
+			if (size || include_empty) {
+				++count;
+				total_size += size + 1;
+			}
+
+			cur_str = next_str + 1;
+			next_str = strchr(cur_str, split_ch);
+		}
+
+		if (*cur_str || include_empty) {
+			++count;
+			total_size += strlen(cur_str) + 1;
+		}
+
+		/* ------------------ */
+
+		cur_pos = (count + 1) * sizeof(char *);
+		total_size += cur_pos;
+		out = bmalloc(total_size);
+		offset = out + cur_pos;
+		cur_str = str;
+		table = (char **)out;
+
+		next_str = strchr(str, split_ch);
+
+		while (next_str) {
+			size_t size = next_str - cur_str;
+
+			if (size || include_empty) {
+				table[cur_idx++] = offset;
+				strncpy(offset, cur_str, size);
+				offset[size] = 0;
+				offset += size + 1;
+			}
+
+			cur_str = next_str + 1;
+			next_str = strchr(cur_str, split_ch);
+		}
+
+		if (*cur_str || include_empty) {
+			table[cur_idx++] = offset;
+			strcpy(offset, cur_str);
+		}
+
+		table[cur_idx] = NULL;
+	}
+
+	return (char **)out;
+}
+
+void strlist_free(char **strlist)
+{
+	bfree(strlist);
+}
+
+void dstr_ensure_capacity(struct dstr *dst, const size_t new_size)
+{
+	size_t new_cap;
+	if (new_size <= dst->capacity)
+		return;
+
+	new_cap = (!dst->capacity) ? new_size : dst->capacity * 2;
+	if (new_size > new_cap)
+		new_cap = new_size;
+	dst->array = brealloc(dst->array, new_cap);
+	dst->capacity = new_cap;
+}
+
+void dstr_copy(struct dstr *dst, const char *array)
+{
+	size_t len;
+
+	if (!array || !*array) {
+		dstr_free(dst);
+		return;
+	}
+
+	len = strlen(array);
+	dstr_ensure_capacity(dst, len + 1);
+	memcpy(dst->array, array, len + 1);
+	dst->len = len;
+}
+
+void dstr_ncopy(struct dstr *dst, const char *array, const size_t len)
+{
+	if (!array || !*array || !len) {
+		dstr_free(dst);
+		return;
+	}
+
+	dstr_ensure_capacity(dst, len + 1);
+	memcpy(dst->array, array, len);
+	dst->array[len] = 0;
+	dst->len = len;
+}
+
+void dstr_copy_dstr(struct dstr *dst, const struct dstr *src)
+{
+	if (!src->len) {
+		dstr_free(dst);
+		return;
+	}
+
+	dstr_ensure_capacity(dst, src->len + 1);
+	memcpy(dst->array, src->array, src->len + 1);
+	dst->len = src->len;
+}
+
+void dstr_ncat(struct dstr *dst, const char *array, const size_t len)
+{
+	size_t new_len;
+	if (!array || !*array || !len)
+		return;
+
+	new_len = dst->len + len;
+
+	dstr_ensure_capacity(dst, new_len + 1);
+	memcpy(dst->array + dst->len, array, len);
+
+	dst->len = new_len;
+	dst->array[new_len] = 0;
+}
+
+void dstr_resize(struct dstr *dst, const size_t num)
+{
+	if (!num) {
+		dstr_free(dst);
+		return;
+	}
+
+	dstr_ensure_capacity(dst, num + 1);
+	dst->array[num] = 0;
+	dst->len = num;
+}
+
+void dstr_replace(struct dstr *str, const char *find, const char *replace)
+{
+	struct dstr out = {0};
+	size_t find_len;
+	const char *cur;
+	const char *next;
+
+	if (dstr_is_empty(str) || !find || !*find)
+		return;
+	if (!replace)
+		replace = "";
+
+	find_len = strlen(find);
+	cur = str->array;
+
+	while ((next = strstr(cur, find)) != NULL) {
+		dstr_ncat(&out, cur, next - cur);
+		dstr_cat(&out, replace);
+		cur = next + find_len;
+	}
+	dstr_cat(&out, cur);
+
+	dstr_free(str);
+	*str = out;
+}
+
+void dstr_insert(struct dstr *dst, const size_t idx, const char *array)
+{
+	size_t len;
+
+	if (!array || !*array)
+		return;
+	if (idx == dst->len) {
+		dstr_cat(dst, array);
+		return;
+	}
+
+	len = strlen(array);
+	dstr_ensure_capacity(dst, dst->len + len + 1);
+	memmove(dst->array + idx + len, dst->array + idx, dst->len - idx + 1);
+	memcpy(dst->array + idx, array, len);
+	dst->len += len;
+}
+
+void dstr_remove(struct dstr *dst, const size_t idx, const size_t count)
+{
+	if (idx + count >= dst->len) {
+		dstr_resize(dst, idx);
+		return;
+	}
+
+	memmove(dst->array + idx, dst->array + idx + count, dst->len - idx - count + 1);
+	dst->len -= count;
+}
+
+void dstr_vprintf(struct dstr *dst, const char *format, va_list args)
+{
+	va_list args_cp;
+	va_copy(args_cp, args);
+
+	int len = vsnprintf(NULL, 0, format, args_cp);
+	va_end(args_cp);
+
+	if (len < 0)
+		len = 4095;
+
+	dstr_ensure_capacity(dst, ((size_t)len) + 1);
+	len = vsnprintf(dst->array, ((size_t)len) + 1, format, args);
+
+	if (!*dst->array) {
+		dstr_free(dst);
+		return;
+	}
+
+	dst->len = len < 0 ? strlen(dst->array) : (size_t)len;
+}
+
+void dstr_vcatf(struct dstr *dst, const char *format, va_list args)
+{
+	va_list args_cp;
+	va_copy(args_cp, args);
+
+	int len = vsnprintf(NULL, 0, format, args_cp);
+	va_end(args_cp);
+
+	if (len < 0)
+		len = 4095;
+
+	dstr_ensure_capacity(dst, dst->len + ((size_t)len) + 1);
+	len = vsnprintf(dst->array + dst->len, ((size_t)len) + 1, format, args);
+
+	if (!*dst->array) {
+		dstr_free(dst);
+		return;
+	}
+
+	dst->len += len < 0 ? strlen(dst->array + dst->len) : (size_t)len;
+}
+
+void dstr_printf(struct dstr *dst, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	dstr_vprintf(dst, format, args);
+	va_end(args);
+}
+
+void dstr_catf(struct dstr *dst, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	dstr_vcatf(dst, format, args);
+	va_end(args);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Platform */
+
+FILE *os_fopen(const char *path, const char *mode)
+{
+	return path ? fopen(path, mode) : NULL;
+}
+
+int64_t os_fgetsize(FILE *file)
+{
+	int64_t cur_offset = ftello(file);
+	int64_t size;
+
+	if (fseeko(file, 0, SEEK_END) != 0)
+		return -1;
+
+	size = ftello(file);
+	fseeko(file, cur_offset, SEEK_SET);
+	return size;
+}
+
+static pthread_mutex_t stat_mutex = PTHREAD_MUTEX_INITIALIZER;
+static char *stat_blocked_prefix = NULL;
+
+static bool stat_blocked(const char *file)
+{
+	pthread_mutex_lock(&stat_mutex);
+	bool blocked = stat_blocked_prefix && strncmp(file, stat_blocked_prefix, strlen(stat_blocked_prefix)) == 0;
+	pthread_mutex_unlock(&stat_mutex);
+	return blocked;
+}
+
+void mock_set_stat_blocked(const char *prefix)
+{
+	pthread_mutex_lock(&stat_mutex);
+	free(stat_blocked_prefix);
+	stat_blocked_prefix = prefix ? strdup(prefix) : NULL;
+	pthread_mutex_unlock(&stat_mutex);
+}
+
+/* Like a network share that doesn't answer, while the path is blocked */
+int os_stat(const char *file, struct stat *st)
+{
+	while (stat_blocked(file))
+		os_sleep_ms(1);
+	return stat(file, st);
+}
+
+int64_t os_get_file_size(const char *path)
+{
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return -1;
+	return (int64_t)st.st_size;
+}
+
+char *os_quick_read_utf8_file(const char *path)
+{
+	FILE *f = os_fopen(path, "rb");
+	int64_t size;
+	char *str;
+
+	if (!f)
+		return NULL;
+
+	size = os_fgetsize(f);
+	str = bzalloc((size_t)size + 1);
+	if (size && fread(str, 1, (size_t)size, f) != (size_t)size) {
+		bfree(str);
+		str = NULL;
+	}
+	fclose(f);
+	return str;
+}
+
+bool os_quick_write_utf8_file(const char *path, const char *str, size_t len, bool marker)
+{
+	FILE *f = os_fopen(path, "wb");
+	if (!f)
+		return false;
+
+	UNUSED_PARAMETER(marker);
+	if (len && fwrite(str, len, 1, f) != 1) {
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+	return true;
+}
+
+bool os_quick_write_utf8_file_safe(const char *path, const char *str, size_t len, bool marker,
+				   const char *temp_ext, const char *backup_ext)
+{
+	struct dstr temp_path = {0};
+	bool success;
+
+	UNUSED_PARAMETER(backup_ext);
+	dstr_printf(&temp_path, "%s%s%s", path, *temp_ext == '.' ? "" : ".", temp_ext);
+	success = os_quick_write_utf8_file(temp_path.array, str, len, marker) &&
+		  os_rename(temp_path.array, path) == 0;
+	dstr_free(&temp_path);
+	return success;
+}
+
+uint64_t os_gettime_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec);
+}
+
+bool os_sleepto_ns(uint64_t time_target)
+{
+	uint64_t current = os_gettime_ns();
+	if (time_target < current)
+		return false;
+
+	time_target -= current;
+
+	struct timespec req, remain;
+	memset(&req, 0, sizeof(req));
+	memset(&remain, 0, sizeof(remain));
+	req.tv_sec = time_target / 1000000000;
+	req.tv_nsec = time_target % 1000000000;
+
+	while (nanosleep(&req, &remain)) {
+		req = remain;
+		memset(&remain, 0, sizeof(remain));
+	}
+
+	return true;
+}
+
+void os_sleep_ms(uint32_t duration)
+{
+	usleep(duration * 1000);
+}
+
+bool os_file_exists(const char *path)
+{
+	return access(path, F_OK) == 0;
+}
+
+const char *os_get_path_extension(const char *path)
+{
+	struct dstr temp;
+	size_t pos = 0;
+	char *period;
+	char *slash;
+
+	if (!path[0])
+		return NULL;
+
+	dstr_init(&temp);
+	dstr_copy(&temp, path);
+	dstr_replace(&temp, "\\", "/");
+
+	slash = strrchr(temp.array, '/');
+	period = strrchr(temp.array, '.');
+	if (period)
+		pos = (size_t)(period - temp.array);
+
+	dstr_free(&temp);
+
+	if (!period || slash > period)
+		return NULL;
+
+	return path + pos;
+}
+
+struct os_dir {
+	const char *path;
+	DIR *dir;
+	struct dirent *cur_dirent;
+	struct os_dirent out;
+};
+
+os_dir_t *os_opendir(const char *path)
+{
+	struct os_dir *dir;
+	DIR *dir_val;
+
+	dir_val = opendir(path);
+	if (!dir_val)
+		return NULL;
+
+	dir = bzalloc(sizeof(struct os_dir));
+	dir->dir = dir_val;
+	dir->path = path;
+	return dir;
+}
+
+static inline bool is_dir(const char *path)
+{
+	struct stat stat_info;
+	if (stat(path, &stat_info) == 0)
+		return !!S_ISDIR(stat_info.st_mode);
+
+	return false;
+}
+
+struct os_dirent *os_readdir(os_dir_t *dir)
+{
+	struct dstr file_path = {0};
+
+	if (!dir)
+		return NULL;
+
+	dir->cur_dirent = readdir(dir->dir);
+	if (!dir->cur_dirent)
+		return NULL;
+
+	const size_t length = strlen(dir->cur_dirent->d_name);
+	if (sizeof(dir->out.d_name) <= length)
+		return NULL;
+	memcpy(dir->out.d_name, dir->cur_dirent->d_name, length + 1);
+
+	dstr_copy(&file_path, dir->path);
+	dstr_cat(&file_path, "/");
+	dstr_cat(&file_path, dir->out.d_name);
+
+	dir->out.directory = is_dir(file_path.array);
+
+	dstr_free(&file_path);
+
+	return &dir->out;
+}
+
+void os_closedir(os_dir_t *dir)
+{
+	if (dir) {
+		closedir(dir->dir);
+		bfree(dir);
+	}
+}
+
+int os_unlink(const char *path)
+{
+	return unlink(path);
+}
+
+int os_rmdir(const char *path)
+{
+	return rmdir(path);
+}
+
+int os_rename(const char *old_path, const char *new_path)
+{
+	return rename(old_path, new_path);
+}
+
+int os_safe_replace(const char *target, const char *from, const char *backup)
+{
+	UNUSED_PARAMETER(backup);
+	return rename(from, target);
+}
+
+int os_mkdir(const char *path)
+{
+	if (mkdir(path, 0755) == 0)
+		return MKDIR_SUCCESS;
+
+	return (errno == EEXIST) ? MKDIR_EXISTS : MKDIR_ERROR;
+}
+
+int os_mkdirs(const char *dir)
+{
+	struct dstr dir_str;
+	int ret;
+
+	dstr_init(&dir_str);
+	dstr_copy(&dir_str, dir);
+	dstr_replace(&dir_str, "\\", "/");
+
+	for (char *p = dir_str.array + 1; p && *p; p++) {
+		if (*p == '/') {
+			*p = 0;
+			os_mkdir(dir_str.array);
+			*p = '/';
+		}
+	}
+
+	ret = os_mkdir(dir_str.array);
+	dstr_free(&dir_str);
+	return ret;
+}
+
+int os_get_logical_cores(void)
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores > 0 ? (int)cores : 1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Threading */
+
+struct os_event_data {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	volatile bool signalled;
+	bool manual;
+};
+
+int os_event_init(os_event_t **event, enum os_event_type type)
+{
+	struct os_event_data *data = bzalloc(sizeof(struct os_event_data));
+
+	pthread_mutex_init(&data->mutex, NULL);
+	pthread_cond_init(&data->cond, NULL);
+	data->manual = (type == OS_EVENT_TYPE_MANUAL);
+	*event = data;
+	return 0;
+}
+
+void os_event_destroy(os_event_t *event)
+{
+	if (event) {
+		pthread_mutex_destroy(&event->mutex);
+		pthread_cond_destroy(&event->cond);
+		bfree(event);
+	}
+}
+
+int os_event_wait(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	while (!event->signalled)
+		pthread_cond_wait(&event->cond, &event->mutex);
+
+	if (!event->manual)
+		event->signalled = false;
+	pthread_mutex_unlock(&event->mutex);
+	return 0;
+}
+
+int os_event_timedwait(os_event_t *event, unsigned long milliseconds)
+{
+	int code = 0;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += milliseconds / 1000;
+	ts.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&event->mutex);
+	while (!event->signalled && code == 0)
+		code = pthread_cond_timedwait(&event->cond, &event->mutex, &ts);
+
+	if (event->signalled) {
+		if (!event->manual)
+			event->signalled = false;
+		code = 0;
+	}
+	pthread_mutex_unlock(&event->mutex);
+	return code;
+}
+
+int os_event_try(os_event_t *event)
+{
+	int ret = EAGAIN;
+
+	pthread_mutex_lock(&event->mutex);
+	if (event->signalled) {
+		if (!event->manual)
+			event->signalled = false;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&event->mutex);
+	return ret;
+}
+
+int os_event_signal(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	event->signalled = true;
+	pthread_cond_broadcast(&event->cond);
+	pthread_mutex_unlock(&event->mutex);
+	return 0;
+}
+
+void os_event_reset(os_event_t *event)
+{
+	pthread_mutex_lock(&event->mutex);
+	event->signalled = false;
+	pthread_mutex_unlock(&event->mutex);
+}
+
+void os_set_thread_name(const char *name)
+{
+	UNUSED_PARAMETER(name);
+}
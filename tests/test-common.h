@@ -0,0 +1,129 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Helpers shared by the tests that drive the whole source through the
+ * stand-in libobs. Navigation happens on the source's own thread, so tests
+ * wait for its effect with wait_until() instead of checking right away. */
+
+#pragma once
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <obs-module.h>
+#include <mock-obs.h>
+#include <util/platform.h>
+
+#define MPS_ID "media_playlist_source_codeyan"
+#define WAIT_TIMEOUT_MS 5000
+
+extern bool obs_module_load(void);
+
+static inline void test_startup(void)
+{
+	mock_obs_startup();
+	os_mkdirs(TEST_CONFIG_DIR);
+	mock_set_config_dir(TEST_CONFIG_DIR);
+	obs_module_load();
+}
+
+static inline void test_shutdown(void)
+{
+	mock_obs_shutdown();
+}
+
+/* Playlist of `count` files named /media/NNN.mp4, each lasting `duration_ms` */
+static inline obs_data_t *make_settings(size_t count, int64_t duration_ms, bool shuffle, bool loop)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_array_t *playlist = obs_data_array_create();
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_create();
+		char buf[64];
+
+		snprintf(buf, sizeof(buf), "/media/%03zu.mp4", i);
+		obs_data_set_string(item, "value", buf);
+		mock_media_set_duration(buf, duration_ms);
+		snprintf(buf, sizeof(buf), "id-%zu", i);
+		obs_data_set_string(item, "uuid", buf);
+		obs_data_array_push_back(playlist, item);
+		obs_data_release(item);
+	}
+
+	obs_data_set_array(settings, "playlist", playlist);
+	obs_data_set_bool(settings, "shuffle", shuffle);
+	obs_data_set_bool(settings, "loop", loop);
+	obs_data_array_release(playlist);
+	return settings;
+}
+
+/* The internal media source of the current file. While crossfading, the
+ * outgoing one is a child too, and was added before it. */
+static inline obs_source_t *child_of(obs_source_t *source)
+{
+	obs_source_t *child = NULL;
+	for (size_t i = 0; mock_get_active_child(source, i); i++)
+		child = mock_get_active_child(source, i);
+	return child;
+}
+
+#define wait_until(cond)                                                   \
+	do {                                                               \
+		int waited_ms_ = 0;                                        \
+		while (!(cond) && waited_ms_ < WAIT_TIMEOUT_MS) {          \
+			os_sleep_ms(1);                                    \
+			waited_ms_++;                                      \
+		}                                                          \
+		if (!(cond)) {                                             \
+			fprintf(stderr, "%s:%d: timed out waiting for %s\n", \
+				__FILE__, __LINE__, #cond);                \
+			assert(false);                                     \
+		}                                                          \
+	} while (false)
+
+static inline bool path_is(obs_source_t *source, const char *path)
+{
+	return mock_media_has_path(child_of(source), path);
+}
+
+/* Calls a proc that returns JSON in `out`, and parses it */
+static inline obs_data_t *call_json_proc(obs_source_t *source, const char *name, calldata_t *cd, const char *out)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	proc_handler_call(ph, name, cd);
+	return obs_data_create_from_json(calldata_string(cd, out));
+}
+
+/* Files opened so far, the time is recorded after the media source has the path */
+static inline long long transition_count(obs_source_t *source)
+{
+	calldata_t cd = {0};
+	obs_data_t *stats = call_json_proc(source, "get_stats", &cd, "stats");
+	obs_data_t *timers = obs_data_get_obj(stats, "timers_us");
+	obs_data_t *transition = obs_data_get_obj(timers, "transition");
+	long long count = obs_data_get_int(transition, "count");
+
+	obs_data_release(transition);
+	obs_data_release(timers);
+	obs_data_release(stats);
+	calldata_free(&cd);
+	return count;
+}
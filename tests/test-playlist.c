@@ -0,0 +1,1427 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Drives media-playlist-source.c through the stand-in libobs: navigation,
+ * files ending, shuffle, procs and the audio relay. */
+
+#include <math.h>
+#include "test-common.h"
+#include "url-cache.h"
+#include "path-check.h"
+#include "duration-cache.h"
+#include "quarantine.h"
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+#ifdef HAVE_HTTP_STAND_IN
+#include "http-stand-in.h"
+#endif
+
+static obs_source_t *create_playlist(obs_data_t *settings)
+{
+	obs_source_t *source = obs_source_create(MPS_ID, "playlist", settings, NULL);
+	assert(source);
+
+	/* the first file is opened by the navigation thread */
+	obs_data_array_t *playlist = obs_data_get_array(settings, "playlist");
+	if (obs_data_array_count(playlist) && !obs_data_get_int(settings, "lazy_load"))
+		wait_until(mock_media_get_open_count(child_of(source)) > 0);
+	obs_data_array_release(playlist);
+	return source;
+}
+
+static void test_next_and_previous(void)
+{
+	obs_data_t *settings = make_settings(5, 5000, false, false);
+	obs_source_t *source = create_playlist(settings);
+
+	assert(path_is(source, "/media/000.mp4"));
+
+	obs_source_media_next(source);
+	wait_until(path_is(source, "/media/001.mp4"));
+	obs_source_media_next(source);
+	wait_until(path_is(source, "/media/002.mp4"));
+	obs_source_media_previous(source);
+	wait_until(path_is(source, "/media/001.mp4"));
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+/* A burst of Next and Previous while a file is being opened gives one open */
+static void test_navigation_is_merged(void)
+{
+	obs_data_t *settings = make_settings(20, 5000, false, false);
+	obs_source_t *source = create_playlist(settings);
+	size_t open_count = mock_media_get_open_count(child_of(source));
+
+	mock_media_set_open_blocked(true);
+	obs_source_media_next(source);
+	wait_until(mock_media_get_opens_held() == 1);
+	for (size_t i = 0; i < 9; i++)
+		obs_source_media_next(source);
+	for (size_t i = 0; i < 3; i++)
+		obs_source_media_previous(source);
+	mock_media_set_open_blocked(false);
+	wait_until(path_is(source, "/media/007.mp4"));
+
+	/* the file that was being opened, then the burst */
+	assert(mock_media_get_open_count(child_of(source)) - open_count == 2);
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static volatile long end_updates = 0;
+
+/* Like a script that changes the playlist when it ends */
+static void update_on_end(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(cd);
+	obs_source_update(data, NULL);
+	os_atomic_inc_long(&end_updates);
+}
+
+static void test_end_of_file_plays_next(void)
+{
+	obs_data_t *settings = make_settings(3, 1000, false, false);
+	obs_source_t *source = create_playlist(settings);
+
+	mock_tick(1100);
+	wait_until(path_is(source, "/media/001.mp4"));
+	mock_tick(1100);
+	wait_until(path_is(source, "/media/002.mp4"));
+
+	/* the last file ends the playlist */
+	mock_tick(1100);
+	wait_until(obs_source_media_get_state(source) == OBS_MEDIA_STATE_ENDED);
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+/* A handler of the end of the playlist can update the source */
+static void test_update_when_ended(void)
+{
+	obs_data_t *settings = make_settings(2, 1000, false, false);
+	obs_source_t *source = create_playlist(settings);
+	signal_handler_connect(obs_source_get_signal_handler(source), "media_ended", update_on_end, source);
+
+	mock_tick(1100);
+	wait_until(path_is(source, "/media/001.mp4"));
+	mock_tick(1100);
+	wait_until(os_atomic_load_long(&end_updates) == 1);
+
+	/* the navigation thread is still running */
+	size_t open_count = mock_media_get_open_count(child_of(source));
+	obs_source_media_next(source);
+	wait_until(mock_media_get_open_count(child_of(source)) > open_count);
+	assert(path_is(source, "/media/001.mp4"));
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static void test_loop_wraps_around(void)
+{
+	obs_data_t *settings = make_settings(3, 1000, false, true);
+	obs_source_t *source = create_playlist(settings);
+
+	obs_source_media_previous(source);
+	wait_until(path_is(source, "/media/002.mp4"));
+	mock_tick(1100);
+	wait_until(path_is(source, "/media/000.mp4"));
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static void test_select_index(void)
+{
+	obs_data_t *settings = make_settings(5, 5000, false, false);
+	obs_source_t *source = create_playlist(settings);
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	calldata_t cd = {0};
+
+	calldata_set_int(&cd, "media_index", 3);
+	calldata_set_int(&cd, "folder_item_index", 0);
+	proc_handler_call(ph, "select_index", &cd);
+	wait_until(path_is(source, "/media/003.mp4"));
+
+	/* out of range is ignored */
+	calldata_set_int(&cd, "media_index", 30);
+	proc_handler_call(ph, "select_index", &cd);
+	obs_source_media_next(source);
+	wait_until(path_is(source, "/media/004.mp4"));
+
+	calldata_free(&cd);
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static void test_peek_upcoming_sequential(void)
+{
+	obs_data_t *settings = make_settings(4, 5000, false, true);
+	obs_source_t *source = create_playlist(settings);
+	calldata_t cd = {0};
+
+	obs_source_media_next(source);
+	wait_until(path_is(source, "/media/001.mp4"));
+
+	/* with loop, every file is listed once at most */
+	calldata_set_int(&cd, "count", 10);
+	obs_data_t *result = call_json_proc(source, "peek_upcoming", &cd, "upcoming");
+	obs_data_array_t *upcoming = obs_data_get_array(result, "upcoming");
+	const char *expected[] = {"/media/002.mp4", "/media/003.mp4", "/media/000.mp4", "/media/001.mp4"};
+
+	assert(obs_data_array_count(upcoming) == 4);
+	for (size_t i = 0; i < 4; i++) {
+		obs_data_t *item = obs_data_array_item(upcoming, i);
+		assert(strcmp(obs_data_get_string(item, "path"), expected[i]) == 0);
+		assert(obs_data_get_int(item, "media_index") == (long long)((i + 2) % 4));
+		obs_data_release(item);
+	}
+
+	/* peeking doesn't move */
+	assert(path_is(source, "/media/001.mp4"));
+
+	obs_data_array_release(upcoming);
+	obs_data_release(result);
+	calldata_free(&cd);
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+/* Returns the paths that peek_upcoming lists, the caller frees them */
+static size_t peek_upcoming_paths(obs_source_t *source, size_t count, char **paths)
+{
+	calldata_t cd = {0};
+	calldata_set_int(&cd, "count", (long long)count);
+	obs_data_t *result = call_json_proc(source, "peek_upcoming", &cd, "upcoming");
+	obs_data_array_t *upcoming = obs_data_get_array(result, "upcoming");
+	size_t num = obs_data_array_count(upcoming);
+
+	for (size_t i = 0; i < num; i++) {
+		obs_data_t *item = obs_data_array_item(upcoming, i);
+		paths[i] = bstrdup(obs_data_get_string(item, "path"));
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(upcoming);
+	obs_data_release(result);
+	calldata_free(&cd);
+	return num;
+}
+
+static void test_shuffle_plays_upcoming(void)
+{
+#define SIZE 8
+	obs_data_t *settings = make_settings(SIZE, 5000, true, true);
+	obs_source_t *source = create_playlist(settings);
+	char *paths[SIZE];
+
+	/* the rest of the current shuffle cycle, which may be a whole new one */
+	size_t num = peek_upcoming_paths(source, SIZE, paths);
+	assert(num > 0 && num <= SIZE);
+
+	for (size_t i = 0; i < num; i++) {
+		for (size_t j = 0; j < i; j++)
+			assert(strcmp(paths[i], paths[j]) != 0);
+
+		obs_source_media_next(source);
+		wait_until(path_is(source, paths[i]));
+	}
+
+	for (size_t i = 0; i < num; i++)
+		bfree(paths[i]);
+	obs_source_release(source);
+	obs_data_release(settings);
+#undef SIZE
+}
+
+static void test_shuffle_order_restored(void)
+{
+#define SIZE 10
+#define UUID "00000000-0000-4000-8000-000000000001"
+	obs_data_t *settings = make_settings(SIZE, 5000, true, true);
+	char *before[SIZE];
+	char *after[SIZE];
+
+	mock_set_next_uuid(UUID);
+	obs_source_t *source = create_playlist(settings);
+	size_t num = peek_upcoming_paths(source, 3, before);
+	for (size_t i = 0; i < num; i++) {
+		obs_source_media_next(source);
+		wait_until(path_is(source, before[i]));
+	}
+	for (size_t i = 0; i < num; i++)
+		bfree(before[i]);
+
+	obs_data_t *saved = obs_source_get_settings(source);
+	obs_data_t *copy = obs_data_create();
+	obs_data_apply(copy, saved);
+	obs_data_release(saved);
+
+	num = peek_upcoming_paths(source, SIZE, before);
+	obs_source_release(source);
+
+	mock_set_next_uuid(UUID);
+	source = create_playlist(copy);
+	size_t restored_num = peek_upcoming_paths(source, SIZE, after);
+
+	assert(restored_num == num);
+	for (size_t i = 0; i < num; i++) {
+		assert(strcmp(before[i], after[i]) == 0);
+		bfree(before[i]);
+		bfree(after[i]);
+	}
+
+	/* the state is deleted when shuffle is turned off */
+#define STATE TEST_CONFIG_DIR "/shuffle/" UUID ".bin"
+	assert(os_file_exists(STATE));
+	obs_data_set_bool(copy, "shuffle", false);
+	obs_source_update(source, copy);
+	assert(!os_file_exists(STATE));
+
+	/* or the source is removed, but not when the frontend removes every
+	 * source on exit, after clearing the output channels */
+	obs_data_set_bool(copy, "shuffle", true);
+	obs_source_update(source, copy);
+	assert(os_file_exists(STATE));
+	obs_source_remove(source);
+	assert(os_file_exists(STATE));
+	obs_set_output_source(0, source);
+	obs_source_remove(source);
+	obs_set_output_source(0, NULL);
+	assert(!os_file_exists(STATE));
+
+	obs_source_release(source);
+	obs_data_release(copy);
+	obs_data_release(settings);
+#undef STATE
+#undef UUID
+#undef SIZE
+}
+
+static void test_audio_is_relayed(void)
+{
+	obs_data_t *settings = make_settings(2, 5000, false, false);
+	obs_source_t *source = create_playlist(settings);
+
+	for (size_t i = 0; i < 10; i++)
+		mock_tick(33);
+	assert(mock_get_audio_frames_output(source) > 0);
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static long long get_counter(obs_source_t *source, const char *name)
+{
+	calldata_t cd = {0};
+	obs_data_t *stats = call_json_proc(source, "get_stats", &cd, "stats");
+	obs_data_t *counters = obs_data_get_obj(stats, "counters");
+	long long value = obs_data_get_int(counters, name);
+
+	obs_data_release(counters);
+	obs_data_release(stats);
+	calldata_free(&cd);
+	return value;
+}
+
+static void test_audio_relay_is_bounded(void)
+{
+#define MAX_LATENCY_MS 100
+	/* drop oldest, then drop newest */
+	for (int policy = 0; policy < 2; policy++) {
+		obs_data_t *settings = make_settings(2, 60000, false, false);
+		obs_data_set_int(settings, "audio_max_latency_ms", MAX_LATENCY_MS);
+		obs_data_set_int(settings, "audio_overflow_policy", policy);
+		obs_source_t *source = create_playlist(settings);
+
+		mock_tick(33);
+		uint64_t frames = mock_get_audio_frames_output(source);
+
+		/* a second of audio comes in while the graphics thread is stuck */
+		mock_set_video_stalled(true);
+		for (size_t i = 0; i < 30; i++)
+			mock_tick(33);
+		mock_set_video_stalled(false);
+		mock_tick(33);
+
+		assert(mock_get_audio_frames_output(source) - frames <= MAX_LATENCY_MS * 48);
+		assert(get_counter(source, "audio_dropped") >= 25);
+
+		obs_source_release(source);
+		obs_data_release(settings);
+	}
+#undef MAX_LATENCY_MS
+}
+
+struct relayed_audio {
+	bool layout_matched;
+	float peaks[MAX_AUDIO_CHANNELS];
+};
+
+static void record_relayed_audio(void *param, obs_source_t *source, const struct obs_source_audio *audio)
+{
+	UNUSED_PARAMETER(source);
+	struct relayed_audio *relayed = param;
+	size_t channels = get_audio_channels(audio->speakers);
+
+	if (channels != audio_output_get_channels(obs_get_audio()))
+		relayed->layout_matched = false;
+	for (size_t ch = 0; ch < channels; ch++) {
+		const float *data = (const float *)audio->data[ch];
+		for (uint32_t i = 0; i < audio->frames; i++) {
+			if (fabsf(data[i]) > relayed->peaks[ch])
+				relayed->peaks[ch] = fabsf(data[i]);
+		}
+	}
+}
+
+/* Audio queued before the output layout changed is relayed in the new one */
+static void relay_after_layout_change(enum speaker_layout speakers, struct relayed_audio *relayed)
+{
+	obs_data_t *settings = make_settings(1, 60000, false, false);
+	obs_source_t *source = create_playlist(settings);
+
+	mock_tick(33);
+	mock_set_video_stalled(true);
+	mock_tick(33);
+	mock_set_speakers(speakers);
+	mock_set_video_stalled(false);
+
+	memset(relayed, 0, sizeof(*relayed));
+	relayed->layout_matched = true;
+	mock_set_audio_output_callback(source, record_relayed_audio, relayed);
+	mock_tick(0);
+	mock_set_audio_output_callback(source, NULL, NULL);
+	mock_set_speakers(SPEAKERS_STEREO);
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static void test_audio_relay_remaps_layouts(void)
+{
+	struct relayed_audio relayed;
+
+	/* stereo to 5.1 keeps the fronts and leaves the rest silent */
+	relay_after_layout_change(SPEAKERS_5POINT1, &relayed);
+	assert(relayed.layout_matched);
+	assert(fabsf(relayed.peaks[0] - 0.25f) < 0.01f);
+	assert(fabsf(relayed.peaks[1] - 0.25f) < 0.01f);
+	for (size_t ch = 2; ch < 6; ch++)
+		assert(relayed.peaks[ch] == 0.0f);
+
+	/* stereo to mono adds both at -3dB */
+	relay_after_layout_change(SPEAKERS_MONO, &relayed);
+	assert(relayed.layout_matched);
+	assert(fabsf(relayed.peaks[0] - 0.25f * 2.0f * 0.7071f) < 0.01f);
+}
+
+static void test_crossfade(void)
+{
+	obs_data_t *settings = make_settings(3, 2000, false, false);
+	obs_data_set_int(settings, "crossfade_ms", 500);
+	obs_source_t *source = create_playlist(settings);
+	uint64_t frames = mock_get_audio_frames_output(source);
+	size_t ticks = 0;
+
+	/* the next file is opened in a second media source 500ms before the end */
+	for (; ticks < 44; ticks++)
+		mock_tick(33);
+	assert(!mock_get_active_child(source, 1));
+	for (; ticks < 47; ticks++)
+		mock_tick(33);
+	wait_until(mock_get_active_child(source, 1) != NULL);
+	assert(path_is(source, "/media/001.mp4"));
+	obs_source_t *outgoing = mock_get_active_child(source, 0);
+	assert(mock_media_has_path(outgoing, "/media/000.mp4"));
+
+	/* the overlap ends with the ramps, and the outgoing file ending does not
+	 * move the playlist */
+	for (; ticks < 70; ticks++)
+		mock_tick(33);
+	assert(!mock_get_active_child(source, 1));
+	assert(path_is(source, "/media/001.mp4"));
+	assert(!mock_media_is_open(outgoing));
+
+	/* both files were relayed as one stream */
+	uint64_t relayed = mock_get_audio_frames_output(source) - frames;
+	assert(relayed <= ticks * 33 * 48 && relayed >= (ticks - 3) * 33 * 48);
+
+	/* the next crossfade plays in the media source that was closed */
+	for (; ticks < 95; ticks++)
+		mock_tick(33);
+	wait_until(mock_get_active_child(source, 1) != NULL);
+	assert(child_of(source) == outgoing);
+	assert(path_is(source, "/media/002.mp4"));
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+/* Files are measured the first time they play through, and then play at the
+ * same loudness */
+static void test_loudness_normalization(void)
+{
+	const char *paths[2] = {TEST_CONFIG_DIR "/loud.mp4", TEST_CONFIG_DIR "/quiet.mp4"};
+	const float amplitudes[2] = {0.5f, 0.05f};
+	obs_data_t *settings = obs_data_create();
+	obs_data_array_t *playlist = obs_data_array_create();
+
+	os_unlink(TEST_CONFIG_DIR "/loudness.json");
+	for (size_t i = 0; i < 2; i++) {
+		obs_data_t *item = obs_data_create();
+		os_quick_write_utf8_file(paths[i], "", 0, false);
+		mock_media_set_duration(paths[i], 1000);
+		mock_media_set_amplitude(paths[i], amplitudes[i]);
+		obs_data_set_string(item, "value", paths[i]);
+		obs_data_set_string(item, "uuid", i ? "quiet" : "loud");
+		obs_data_array_push_back(playlist, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(settings, "playlist", playlist);
+	obs_data_set_bool(settings, "loop", true);
+	obs_data_set_bool(settings, "loudness_normalize", true);
+	obs_data_set_int(settings, "loudness_target", -20);
+	obs_source_t *source = create_playlist(settings);
+
+	struct relayed_audio relayed;
+	float peaks[2][2];
+	for (size_t round = 0; round < 2; round++) {
+		for (size_t i = 0; i < 2; i++) {
+			wait_until(path_is(source, paths[i]));
+			memset(&relayed, 0, sizeof(relayed));
+
+			/* away from the ends of the file, and the gain's ramp */
+			for (size_t ticks = 0; ticks < 25; ticks++) {
+				mock_set_audio_output_callback(source, ticks >= 3 ? record_relayed_audio : NULL, &relayed);
+				mock_tick(33);
+			}
+			mock_set_audio_output_callback(source, NULL, NULL);
+			peaks[round][i] = relayed.peaks[0];
+			while (path_is(source, paths[i]))
+				mock_tick(33);
+
+			/* measured before it plays again */
+			if (!round)
+				wait_until(get_counter(source, "loudness_analyzed") == (long long)i + 1);
+		}
+	}
+
+	assert(fabsf(peaks[0][0] / peaks[0][1] - 10.0f) < 0.1f);
+	assert(fabsf(peaks[1][0] / peaks[1][1] - 1.0f) < 0.05f);
+
+	/* a sine at 0.5 peak is -6.7 LUFS in stereo, 13.3dB above the target */
+	assert(fabsf(peaks[1][0] - 0.108f) < 0.005f);
+
+	obs_source_release(source);
+	obs_data_array_release(playlist);
+	obs_data_release(settings);
+}
+
+/* A trimmed file starts at its in-point and ends at its out-point, without
+ * playing to its end */
+static void test_trim_points(void)
+{
+	obs_data_t *settings = make_settings(2, 10000, false, false);
+	obs_data_array_t *playlist = obs_data_get_array(settings, "playlist");
+	obs_data_t *item = obs_data_array_item(playlist, 0);
+	obs_data_set_int(item, "start_ms", 3000);
+	obs_data_set_int(item, "end_ms", 4000);
+	obs_data_release(item);
+	obs_data_array_release(playlist);
+	obs_source_t *source = create_playlist(settings);
+	uint64_t frames = mock_get_audio_frames_output(source);
+
+	assert(obs_source_media_get_time(child_of(source)) == 3000);
+	assert(obs_source_media_get_time(source) == 0);
+	assert(obs_source_media_get_duration(source) == 1000);
+
+	for (size_t ticks = 0; ticks < 31; ticks++)
+		mock_tick(33);
+	wait_until(path_is(source, "/media/001.mp4"));
+
+	/* only the audio between the points was relayed */
+	uint64_t relayed = mock_get_audio_frames_output(source) - frames;
+	assert(relayed >= 967 * 48 && relayed <= 1033 * 48);
+
+	assert(obs_source_media_get_duration(source) == 10000);
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static void select_item(obs_source_t *source, size_t media_index, size_t folder_item_index)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	calldata_t cd = {0};
+	calldata_set_int(&cd, "media_index", media_index);
+	calldata_set_int(&cd, "folder_item_index", folder_item_index);
+	proc_handler_call(ph, "select_index", &cd);
+	calldata_free(&cd);
+}
+
+/* Files listed in M3U, PLS and XSPF files play like the items of a folder, and
+ * a list is parsed again when it changes */
+static void test_playlist_files(void)
+{
+	const char *paths[4] = {TEST_CONFIG_DIR "/list.m3u", TEST_CONFIG_DIR "/list.pls", TEST_CONFIG_DIR "/list.xspf",
+				TEST_CONFIG_DIR "/stream.m3u8"};
+	const char *contents[4] = {
+		"\xEF\xBB\xBF#EXTM3U\n#EXTINF:10,First\na.mp4\r\n\n/media/b.mp4\n",
+		"[playlist]\nFile1=c.mp4\nTitle1=C\nFile2=file:///media/d%20e.mp4\nNumberOfEntries=2\n",
+		"<?xml version=\"1.0\"?>\n<playlist><trackList><track>\n"
+		"<location>file:///media/f&amp;g.mp4</location></track></trackList></playlist>\n",
+		"#EXTM3U\n#EXT-X-TARGETDURATION:10\nsegment.ts\n",
+	};
+	obs_data_t *settings = obs_data_create();
+	obs_data_array_t *playlist = obs_data_array_create();
+
+	for (size_t i = 0; i < 4; i++) {
+		obs_data_t *item = obs_data_create();
+		char id[16];
+		os_quick_write_utf8_file(paths[i], contents[i], strlen(contents[i]), false);
+		snprintf(id, sizeof(id), "list-%zu", i);
+		obs_data_set_string(item, "value", paths[i]);
+		obs_data_set_string(item, "uuid", id);
+		obs_data_array_push_back(playlist, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(settings, "playlist", playlist);
+	obs_source_t *source = create_playlist(settings);
+
+	wait_until(path_is(source, TEST_CONFIG_DIR "/a.mp4"));
+	select_item(source, 0, 1);
+	wait_until(path_is(source, "/media/b.mp4"));
+	select_item(source, 1, 0);
+	wait_until(path_is(source, TEST_CONFIG_DIR "/c.mp4"));
+	select_item(source, 1, 1);
+	wait_until(path_is(source, "/media/d e.mp4"));
+	select_item(source, 2, 0);
+	wait_until(path_is(source, "/media/f&g.mp4"));
+
+	/* an HLS stream is a file of its own */
+	select_item(source, 3, 0);
+	wait_until(path_is(source, TEST_CONFIG_DIR "/stream.m3u8"));
+
+	const char *edited = "a.mp4\n/media/b.mp4\n/media/new.mp4\n";
+	os_quick_write_utf8_file(paths[0], edited, strlen(edited), false);
+	obs_source_update(source, settings);
+	select_item(source, 0, 2);
+	wait_until(path_is(source, "/media/new.mp4"));
+
+	obs_source_release(source);
+	obs_data_array_release(playlist);
+	obs_data_release(settings);
+}
+
+/* Reports the missing file at `path` as found at `new_path` */
+static void replace_missing_file(obs_source_t *source, const char *path, const char *new_path)
+{
+	obs_missing_files_t *missing = obs_source_get_missing_files(source);
+	bool found = false;
+	for (size_t i = 0; i < obs_missing_files_count(missing); i++) {
+		obs_missing_file_t *file = obs_missing_files_get_file(missing, (int)i);
+		if (strcmp(obs_missing_file_get_path(file), path) == 0) {
+			obs_missing_file_issue_callback(file, new_path);
+			found = true;
+		}
+	}
+	assert(found);
+	obs_missing_files_destroy(missing);
+}
+
+/* A saved catalog replaces the playlist in the settings, and is only used
+ * while it matches the checksum saved with them. Files added to the list are
+ * played after its items. */
+static void test_catalog(void)
+{
+	obs_data_t *settings = make_settings(3, 10000, false, false);
+	obs_data_array_t *playlist = obs_data_get_array(settings, "playlist");
+	obs_data_t *item = obs_data_array_item(playlist, 1);
+	obs_data_set_int(item, "start_ms", 2000);
+	obs_data_release(item);
+	obs_data_array_release(playlist);
+	obs_source_t *source = create_playlist(settings);
+
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	calldata_t cd = {0};
+	calldata_set_string(&cd, "path", TEST_CONFIG_DIR "/catalog.bin");
+	proc_handler_call(ph, "save_catalog", &cd);
+	assert(calldata_bool(&cd, "success"));
+	calldata_free(&cd);
+
+	obs_data_t *saved = obs_source_get_settings(source);
+	playlist = obs_data_get_array(saved, "playlist");
+	assert(obs_data_array_count(playlist) == 0);
+	assert(strcmp(obs_data_get_string(saved, "catalog"), TEST_CONFIG_DIR "/catalog.bin") == 0);
+	obs_data_array_release(playlist);
+	obs_source_release(source);
+
+	/* loaded again from the catalog alone */
+	source = create_playlist(saved);
+	wait_until(path_is(source, "/media/000.mp4"));
+	select_item(source, 1, 0);
+	wait_until(path_is(source, "/media/001.mp4"));
+	assert(obs_source_media_get_time(child_of(source)) == 2000);
+	select_item(source, 2, 0);
+	wait_until(path_is(source, "/media/002.mp4"));
+	obs_source_release(source);
+
+	/* files added to the list come after the catalog's */
+	playlist = obs_data_array_create();
+	item = obs_data_create();
+	obs_data_set_string(item, "value", "/media/added.mp4");
+	obs_data_set_string(item, "uuid", "added");
+	obs_data_array_push_back(playlist, item);
+	obs_data_release(item);
+	obs_data_set_array(saved, "playlist", playlist);
+	obs_data_array_release(playlist);
+	source = create_playlist(saved);
+	select_item(source, 3, 0);
+	wait_until(path_is(source, "/media/added.mp4"));
+
+	/* a missing file of the catalog is replaced in it */
+	replace_missing_file(source, "/media/001.mp4", "/media/moved.mp4");
+	select_item(source, 1, 0);
+	wait_until(path_is(source, "/media/moved.mp4"));
+	assert(obs_source_media_get_time(child_of(source)) == 2000);
+	obs_data_release(saved);
+	saved = obs_source_get_settings(source);
+	obs_source_release(source);
+
+	/* a missing catalog is reported rather than the list played on its own */
+	os_unlink(TEST_CONFIG_DIR "/moved.bin");
+	assert(os_rename(TEST_CONFIG_DIR "/catalog.bin", TEST_CONFIG_DIR "/moved.bin") == 0);
+	source = create_playlist(saved);
+	wait_until(path_is(source, "/media/added.mp4"));
+	replace_missing_file(source, TEST_CONFIG_DIR "/catalog.bin", TEST_CONFIG_DIR "/moved.bin");
+	select_item(source, 1, 0);
+	wait_until(path_is(source, "/media/moved.mp4"));
+	obs_data_release(saved);
+	saved = obs_source_get_settings(source);
+	obs_source_release(source);
+
+	/* a catalog that was changed since is not used, only the list is played */
+	obs_data_t *fallback = make_settings(2, 10000, false, false);
+	playlist = obs_data_get_array(fallback, "playlist");
+	obs_data_set_array(saved, "playlist", playlist);
+	obs_data_set_string(saved, "catalog_checksum", "0");
+	obs_data_set_int(saved, "current_media_index", 0);
+	obs_data_array_release(playlist);
+	obs_data_release(fallback);
+	source = create_playlist(saved);
+	wait_until(path_is(source, "/media/000.mp4"));
+	char *paths[4];
+	size_t num = peek_upcoming_paths(source, 4, paths);
+	assert(num == 1);
+	for (size_t i = 0; i < num; i++)
+		bfree(paths[i]);
+
+	obs_source_release(source);
+	obs_data_release(saved);
+	obs_data_release(settings);
+}
+
+#ifdef HAVE_HTTP_STAND_IN
+static bool is_cached(const char *url)
+{
+	char *path = url_cache_get(url);
+	bfree(path);
+	return path != NULL;
+}
+
+/* URL items are downloaded before their turn and played from the disk, and
+ * the least recently used files are removed when the cache is full */
+static void test_url_cache(void)
+{
+	struct http_stand_in server;
+	char urls[3][64];
+	os_unlink(TEST_CONFIG_DIR "/url-cache/index.json"); // from an earlier run
+	assert(http_stand_in_start(&server, 400 * 1024));
+	for (size_t i = 0; i < 3; i++)
+		snprintf(urls[i], sizeof(urls[i]), "http://127.0.0.1:%d/%zu.mp4", server.port, i);
+
+	obs_data_t *settings = make_settings(1, 10000, false, false);
+	obs_data_array_t *playlist = obs_data_get_array(settings, "playlist");
+	for (size_t i = 0; i < 2; i++) {
+		obs_data_t *item = obs_data_create();
+		char id[16];
+		snprintf(id, sizeof(id), "url-%zu", i);
+		obs_data_set_string(item, "value", urls[i]);
+		obs_data_set_string(item, "uuid", id);
+		obs_data_array_push_back(playlist, item);
+		obs_data_release(item);
+	}
+	obs_data_array_release(playlist);
+	obs_data_set_bool(settings, "url_cache", true);
+	obs_data_set_int(settings, "url_cache_size_mb", 1);
+	obs_source_t *source = create_playlist(settings);
+
+	wait_until(is_cached(urls[0]) && is_cached(urls[1]));
+	assert(os_atomic_load_long(&server.requests) == 2);
+
+	select_item(source, 1, 0);
+	char *path = url_cache_get(urls[0]);
+	assert(path);
+	wait_until(path_is(source, path));
+	obs_data_t *child_settings = obs_source_get_settings(child_of(source));
+	assert(obs_data_get_bool(child_settings, "is_local_file"));
+	obs_data_release(child_settings);
+	bfree(path);
+
+	/* the second file was used the longest ago */
+	url_cache_prefetch(urls[2]);
+	wait_until(is_cached(urls[2]));
+	assert(!is_cached(urls[1]));
+	assert(is_cached(urls[0]));
+	assert(os_atomic_load_long(&server.requests) == 3);
+
+	obs_source_release(source);
+	obs_data_release(settings);
+	url_cache_free();
+	http_stand_in_stop(&server);
+}
+#endif
+
+/* Folders count as present, URLs are never missing, and results are kept
+ * until they are old */
+static void test_missing_files(void)
+{
+	const char *paths[4] = {TEST_CONFIG_DIR "/present.mp4", TEST_CONFIG_DIR, TEST_CONFIG_DIR "/missing.mp4",
+				"http://127.0.0.1/stream.mp4"};
+	obs_data_t *settings = obs_data_create();
+	obs_data_array_t *playlist = obs_data_array_create();
+
+	os_quick_write_utf8_file(paths[0], "", 0, false);
+	os_unlink(paths[2]);
+	for (size_t i = 0; i < 4; i++) {
+		obs_data_t *item = obs_data_create();
+		char id[16];
+		snprintf(id, sizeof(id), "check-%zu", i);
+		obs_data_set_string(item, "value", paths[i]);
+		obs_data_set_string(item, "uuid", id);
+		obs_data_array_push_back(playlist, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(settings, "playlist", playlist);
+	obs_source_t *source = create_playlist(settings);
+
+	obs_missing_files_t *missing = obs_source_get_missing_files(source);
+	assert(obs_missing_files_count(missing) == 1);
+	assert(strcmp(obs_missing_file_get_path(obs_missing_files_get_file(missing, 0)), paths[2]) == 0);
+	obs_missing_files_destroy(missing);
+
+	/* still missing until the result is checked again */
+	os_quick_write_utf8_file(paths[2], "", 0, false);
+	missing = obs_source_get_missing_files(source);
+	assert(obs_missing_files_count(missing) == 1);
+	obs_missing_files_destroy(missing);
+
+	path_check_free();
+	missing = obs_source_get_missing_files(source);
+	assert(obs_missing_files_count(missing) == 0);
+	obs_missing_files_destroy(missing);
+
+	obs_source_release(source);
+	obs_data_array_release(playlist);
+	obs_data_release(settings);
+}
+
+/* Checks stuck on a share that doesn't answer neither take up all threads nor
+ * hold up path_check_free */
+static void test_path_check_stuck(void)
+{
+	const char *present = TEST_CONFIG_DIR "/present.mp4";
+	const char *stuck[PATH_CHECK_THREADS];
+	enum path_status statuses[PATH_CHECK_THREADS];
+	char names[PATH_CHECK_THREADS][32];
+
+	os_quick_write_utf8_file(present, "", 0, false);
+	mock_set_stat_blocked("/share/");
+	for (size_t i = 0; i < PATH_CHECK_THREADS; i++) {
+		snprintf(names[i], sizeof(names[i]), "/share/%zu.mp4", i);
+		stuck[i] = names[i];
+	}
+	path_check_batch(stuck, PATH_CHECK_THREADS, statuses, 50);
+	for (size_t i = 0; i < PATH_CHECK_THREADS; i++)
+		assert(statuses[i] == PATH_STATUS_UNKNOWN);
+
+	/* the stuck threads were replaced */
+	path_check_batch(&present, 1, statuses, 1000);
+	assert(statuses[0] == PATH_STATUS_FILE);
+
+	/* one of the new threads is in a stat when the results are freed */
+	const char *also_stuck = "/share/other.mp4";
+	path_check_batch(&also_stuck, 1, statuses, 10);
+	uint64_t start_ts = os_gettime_ns();
+	path_check_free();
+	assert(os_gettime_ns() - start_ts < 1000000000ULL);
+
+	/* the abandoned threads only free themselves */
+	mock_set_stat_blocked(NULL);
+	os_sleep_ms(100);
+	path_check_batch(&present, 1, statuses, 1000);
+	assert(statuses[0] == PATH_STATUS_FILE);
+	path_check_free();
+}
+
+/* A source hidden long enough closes its file, and opens it where it was, but
+ * paused, as soon as it is shown in the preview */
+static void test_idle_release(void)
+{
+	obs_data_t *settings = make_settings(2, 10000, false, false);
+	obs_data_set_int(settings, "visibility_behavior", 1); // pause and unpause
+	obs_data_set_int(settings, "idle_release_s", 1);
+	obs_source_t *source = create_playlist(settings);
+	obs_source_t *child = child_of(source);
+
+	mock_set_showing(source, true);
+	mock_set_active(source, true);
+	for (size_t ticks = 0; ticks < 30; ticks++)
+		mock_tick(33);
+	mock_set_active(source, false);
+	mock_set_showing(source, false);
+	int64_t time = obs_source_media_get_time(child);
+	assert(time > 0);
+
+	/* not yet */
+	for (size_t ticks = 0; ticks < 20; ticks++)
+		mock_tick(33);
+	assert(get_counter(source, "idle_releases") == 0);
+
+	for (size_t ticks = 0; ticks < 20; ticks++)
+		mock_tick(33);
+	wait_until(get_counter(source, "idle_releases") == 1);
+	wait_until(!path_is(source, "/media/000.mp4"));
+
+	mock_set_showing(source, true);
+	wait_until(path_is(source, "/media/000.mp4"));
+	assert(obs_source_media_get_time(child) == time);
+	assert(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PAUSED);
+
+	mock_set_active(source, true);
+	assert(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PLAYING);
+
+	/* hidden for long, but activated without being shown in the preview */
+	mock_set_active(source, false);
+	mock_set_showing(source, false);
+	for (size_t ticks = 0; ticks < 40; ticks++)
+		mock_tick(33);
+	wait_until(get_counter(source, "idle_releases") == 2);
+	mock_set_showing(source, true);
+	mock_set_active(source, true);
+	wait_until(path_is(source, "/media/000.mp4"));
+	wait_until(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PLAYING);
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+static void test_decoder_pool(void)
+{
+	obs_data_t *settings = make_settings(2, 10000, false, false);
+	obs_data_set_int(settings, "visibility_behavior", 1); // pause and unpause
+	obs_data_set_int(settings, "max_open_files", 2);
+	obs_source_t *a = create_playlist(settings);
+	obs_source_t *b = create_playlist(settings);
+
+	/* b was shown before a */
+	mock_set_showing(b, true);
+	mock_tick(33);
+	mock_set_showing(b, false);
+	mock_set_showing(a, true);
+	mock_set_active(a, true);
+	mock_tick(33);
+
+	/* never shown, so it is closed first */
+	obs_source_t *c = create_playlist(settings);
+	assert(path_is(c, "/media/000.mp4"));
+	mock_tick(33);
+	wait_until(get_counter(c, "decoder_evictions") == 1);
+	wait_until(!path_is(c, "/media/000.mp4"));
+
+	/* shown in the preview, it opens again, and the file of b makes room */
+	mock_set_active(a, false);
+	mock_set_showing(a, false);
+	mock_set_showing(c, true);
+	wait_until(path_is(c, "/media/000.mp4"));
+	/* the other sources only see that c is open on the next tick */
+	mock_tick(33);
+	mock_tick(33);
+	wait_until(get_counter(b, "decoder_evictions") == 1);
+	for (size_t ticks = 0; ticks < 10; ticks++)
+		mock_tick(33);
+	assert(get_counter(a, "decoder_evictions") == 0);
+	assert(get_counter(c, "decoder_evictions") == 1);
+	assert(path_is(a, "/media/000.mp4"));
+	assert(get_counter(a, "idle_releases") == 0);
+
+	/* active sources are never closed */
+	mock_set_showing(b, true);
+	mock_set_active(b, true);
+	wait_until(path_is(b, "/media/000.mp4"));
+	mock_tick(33);
+	mock_tick(33);
+	wait_until(get_counter(a, "decoder_evictions") == 1);
+
+	obs_source_release(c);
+	obs_source_release(b);
+	obs_source_release(a);
+	obs_data_release(settings);
+}
+
+static void test_virtual_clock(void)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_array_t *playlist = obs_data_array_create();
+	for (size_t i = 0; i < 3; i++) {
+		obs_data_t *item = obs_data_create();
+		char path[64];
+
+		/* not played by other tests, so their durations aren't known yet */
+		snprintf(path, sizeof(path), "/channel/%03zu.mp4", i);
+		obs_data_set_string(item, "value", path);
+		mock_media_set_duration(path, 10000);
+		obs_data_array_push_back(playlist, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(settings, "playlist", playlist);
+	obs_data_set_int(settings, "visibility_behavior", 4); // virtual clock
+	os_unlink(TEST_CONFIG_DIR "/durations.json");     // from an earlier run
+	duration_cache_free();
+	obs_source_t *source = create_playlist(settings);
+	obs_source_t *child = child_of(source);
+
+	mock_set_showing(source, true);
+	mock_set_active(source, true);
+	for (size_t ticks = 0; ticks < 60; ticks++)
+		mock_tick(33);
+	mock_set_active(source, false);
+	assert(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PAUSED);
+
+	/* past the end of the first file, and the second is played from its start
+	 * as its duration isn't known yet */
+	mock_tick(15000);
+	mock_set_active(source, true);
+	wait_until(path_is(source, "/channel/001.mp4"));
+	wait_until(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PLAYING);
+	assert(obs_source_media_get_time(child) == 0);
+
+	for (size_t ticks = 0; ticks < 30; ticks++)
+		mock_tick(33);
+	mock_set_active(source, false);
+	mock_tick(25000);
+	mock_set_active(source, true);
+	wait_until(path_is(source, "/channel/002.mp4"));
+	wait_until(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PLAYING);
+
+	/* every duration is known now, so it goes on from where it would be */
+	select_item(source, 0, 0);
+	wait_until(path_is(source, "/channel/000.mp4"));
+	for (size_t ticks = 0; ticks < 90; ticks++)
+		mock_tick(33);
+	int64_t time = obs_source_media_get_time(child);
+	mock_set_active(source, false);
+	mock_tick(25000);
+	mock_set_active(source, true);
+	wait_until(path_is(source, "/channel/002.mp4"));
+	wait_until(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PLAYING);
+	assert(obs_source_media_get_time(child) == time + 25000 - 20000);
+
+	/* a short break stays in the same file */
+	mock_set_active(source, false);
+	mock_tick(1000);
+	mock_set_active(source, true);
+	wait_until(obs_source_media_get_time(child) == time + 25000 - 20000 + 1000);
+	assert(path_is(source, "/channel/002.mp4"));
+	wait_until(obs_source_media_get_state(child) == OBS_MEDIA_STATE_PLAYING);
+
+	obs_source_release(source);
+	obs_data_array_release(playlist);
+	obs_data_release(settings);
+}
+
+static void test_lazy_load(void)
+{
+	obs_data_t *settings = make_settings(3, 10000, false, false);
+	obs_data_set_int(settings, "lazy_load", 1); // when shown
+	obs_data_set_int(settings, "current_media_index", 2);
+	obs_source_t *source = create_playlist(settings);
+	obs_source_t *child = child_of(source);
+
+	/* nothing is opened, and saving keeps the position */
+	mock_tick(33);
+	assert(!mock_media_has_path(child, "/media/000.mp4") && !mock_media_has_path(child, "/media/002.mp4"));
+	obs_source_save(source);
+	obs_data_t *saved = obs_source_get_settings(source);
+	assert(obs_data_get_int(saved, "current_media_index") == 2);
+	obs_data_release(saved);
+
+	mock_set_showing(source, true);
+	wait_until(path_is(source, "/media/002.mp4"));
+
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+/* In the background, lazy sources are loaded a few seconds after they were
+ * created, one after the other, even if they are never shown */
+static void test_lazy_load_in_background(void)
+{
+	obs_data_t *settings = make_settings(2, 10000, false, false);
+	obs_data_set_int(settings, "lazy_load", 2); // in the background
+	uint64_t start_ts = os_gettime_ns();
+	obs_source_t *first = create_playlist(settings);
+	obs_source_t *second = create_playlist(settings);
+
+	mock_tick(33);
+	assert(!mock_media_get_open_count(child_of(first)) && !mock_media_get_open_count(child_of(second)));
+	for (int waited_ms = 0; !mock_media_get_open_count(child_of(second)) && waited_ms < 10000; waited_ms++)
+		os_sleep_ms(1);
+	uint64_t loaded_ns = os_gettime_ns() - start_ts;
+	assert(path_is(first, "/media/000.mp4") && path_is(second, "/media/000.mp4"));
+	assert(loaded_ns >= 5000000000ULL && loaded_ns < 8000000000ULL);
+
+	obs_source_release(second);
+	obs_source_release(first);
+	obs_data_release(settings);
+}
+
+static int64_t journaled_time(const char *path)
+{
+	obs_data_t *position = obs_data_create_from_json_file(path);
+	int64_t time_ms = position ? obs_data_get_int(position, "time_ms") : 0;
+	obs_data_release(position);
+	return time_ms;
+}
+
+static void test_resume_position(void)
+{
+#define UUID "00000000-0000-4000-8000-000000000002"
+#define JOURNAL TEST_CONFIG_DIR "/positions/" UUID ".json"
+	obs_data_t *settings = make_settings(2, 60000, false, false);
+	obs_data_set_int(settings, "visibility_behavior", 1); // pause and unpause
+	obs_data_set_bool(settings, "resume_position", true);
+	os_unlink(JOURNAL); // from an earlier run
+
+	mock_set_next_uuid(UUID);
+	obs_source_t *source = create_playlist(settings);
+	mock_set_showing(source, true);
+	mock_set_active(source, true);
+	for (size_t ticks = 0; ticks < 200; ticks++)
+		mock_tick(33);
+	wait_until(journaled_time(JOURNAL) >= 5000);
+	int64_t time = journaled_time(JOURNAL);
+
+	obs_data_t *saved = obs_source_get_settings(source);
+	obs_data_t *copy = obs_data_create();
+	obs_data_apply(copy, saved);
+	obs_data_release(saved);
+	obs_source_release(source);
+
+	/* opened where it was, without showing the start of the file */
+	mock_set_next_uuid(UUID);
+	source = create_playlist(copy);
+	assert(path_is(source, "/media/000.mp4"));
+	assert(obs_source_media_get_time(child_of(source)) == time);
+
+	/* the journal is deleted when it is turned off, or the source removed */
+	assert(os_file_exists(JOURNAL));
+	obs_data_set_bool(copy, "resume_position", false);
+	obs_source_update(source, copy);
+	assert(!os_file_exists(JOURNAL));
+	obs_data_set_bool(copy, "resume_position", true);
+	obs_source_update(source, copy);
+	for (size_t ticks = 0; ticks < 200; ticks++)
+		mock_tick(33);
+	wait_until(os_file_exists(JOURNAL));
+	obs_set_output_source(0, source);
+	obs_source_remove(source);
+	obs_set_output_source(0, NULL);
+	assert(!os_file_exists(JOURNAL));
+
+	obs_source_release(source);
+	obs_data_release(copy);
+	obs_data_release(settings);
+#undef JOURNAL
+#undef UUID
+}
+
+/* A folder can be sorted by name, with numbers in order, by modification time
+ * or by size, and the order can be reversed */
+static void test_folder_sort(void)
+{
+	const char *names[3] = {"file10.mp4", "file2.mp4", "File1.mp4"};
+	const char *contents[3] = {"1", "333", "22"};
+	obs_data_t *settings = obs_data_create();
+	obs_data_array_t *playlist = obs_data_array_create();
+	obs_data_t *item = obs_data_create();
+	char path[256];
+
+	os_mkdirs(TEST_CONFIG_DIR "/sort");
+	for (size_t i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), TEST_CONFIG_DIR "/sort/%s", names[i]);
+		os_quick_write_utf8_file(path, contents[i], strlen(contents[i]), false);
+	}
+
+	obs_data_set_string(item, "value", TEST_CONFIG_DIR "/sort");
+	obs_data_set_string(item, "uuid", "sorted");
+	obs_data_set_int(item, "sort", 1); // by name
+	obs_data_array_push_back(playlist, item);
+	obs_data_set_array(settings, "playlist", playlist);
+	obs_source_t *source = create_playlist(settings);
+
+	const char *by_name[3] = {"File1.mp4", "file2.mp4", "file10.mp4"};
+	for (size_t i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), TEST_CONFIG_DIR "/sort/%s", by_name[i]);
+		select_item(source, 0, i);
+		wait_until(path_is(source, path));
+	}
+
+	/* the folder is sorted again when the settings change */
+	obs_data_set_int(item, "sort", 3); // by size
+	obs_data_set_bool(item, "sort_reverse", true);
+	obs_source_update(source, settings);
+	const char *by_size[3] = {"file2.mp4", "File1.mp4", "file10.mp4"};
+	for (size_t i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), TEST_CONFIG_DIR "/sort/%s", by_size[i]);
+		select_item(source, 0, i);
+		wait_until(path_is(source, path));
+	}
+
+	/* and keeps its order when it is saved in a catalog */
+	proc_handler_t *ph = obs_source_get_proc_handler(source);
+	calldata_t cd = {0};
+	calldata_set_string(&cd, "path", TEST_CONFIG_DIR "/sort.bin");
+	proc_handler_call(ph, "save_catalog", &cd);
+	assert(calldata_bool(&cd, "success"));
+	calldata_free(&cd);
+	obs_data_t *saved = obs_source_get_settings(source);
+	obs_source_release(source);
+
+	source = create_playlist(saved);
+	for (size_t i = 0; i < 3; i++) {
+		snprintf(path, sizeof(path), TEST_CONFIG_DIR "/sort/%s", by_size[i]);
+		select_item(source, 0, i);
+		wait_until(path_is(source, path));
+	}
+
+	obs_source_release(source);
+	obs_data_release(saved);
+	obs_data_release(item);
+	obs_data_array_release(playlist);
+	obs_data_release(settings);
+}
+
+/* A file that doesn't start in time is skipped, and Next and Previous skip it
+ * too, even after a restart, until it changes */
+static void test_fast_fail(void)
+{
+	const char *paths[3] = {"/media/fast-0.mp4", TEST_CONFIG_DIR "/broken.mp4", "/media/fast-2.mp4"};
+	obs_data_t *settings = obs_data_create();
+	obs_data_array_t *playlist = obs_data_array_create();
+	for (size_t i = 0; i < 3; i++) {
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "value", paths[i]);
+		obs_data_array_push_back(playlist, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(settings, "playlist", playlist);
+	obs_data_set_int(settings, "fast_fail_s", 2);
+	os_quick_write_utf8_file(paths[1], "truncated", 9, false);
+	mock_media_set_broken(paths[1], true);
+	os_unlink(TEST_CONFIG_DIR "/quarantine.json"); // from an earlier run
+	quarantine_free();
+	obs_source_t *source = create_playlist(settings);
+
+	/* even though it reports PLAYING, and is rendered every tick */
+	mock_set_showing(source, true);
+	mock_set_active(source, true);
+	select_item(source, 1, 0);
+	wait_until(path_is(source, paths[1]));
+	assert(obs_source_media_get_state(child_of(source)) == OBS_MEDIA_STATE_PLAYING);
+	for (size_t ticks = 0; ticks < 30; ticks++) {
+		mock_tick(33);
+		mock_render(source);
+	}
+	assert(path_is(source, paths[1]));
+	for (size_t ticks = 0; ticks < 45; ticks++) {
+		mock_tick(33);
+		mock_render(source);
+	}
+	wait_until(path_is(source, paths[2]));
+	assert(get_counter(source, "fast_fails") == 1);
+
+	/* the quarantine is read back from the config folder */
+	quarantine_free();
+	obs_source_media_previous(source);
+	wait_until(path_is(source, paths[0]));
+	obs_source_media_next(source);
+	wait_until(path_is(source, paths[2]));
+
+	/* a quarantined file on a share that doesn't answer only holds up the
+	 * source that plays it */
+	const char *stuck_paths[2] = {"/media/stuck-0.mp4", TEST_CONFIG_DIR "/share/stuck-1.mp4"};
+	obs_data_t *stuck_settings = obs_data_create();
+	obs_data_array_t *stuck_playlist = obs_data_array_create();
+	for (size_t i = 0; i < 2; i++) {
+		obs_data_t *item = obs_data_create();
+		obs_data_set_string(item, "value", stuck_paths[i]);
+		obs_data_array_push_back(stuck_playlist, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(stuck_settings, "playlist", stuck_playlist);
+	obs_source_t *stuck = create_playlist(stuck_settings);
+	quarantine_add(stuck_paths[1]);
+	mock_set_stat_blocked(TEST_CONFIG_DIR "/share/");
+	obs_source_media_next(stuck);
+	os_sleep_ms(50); // until its navigation thread is in os_stat
+	obs_source_media_previous(source);
+	wait_until(path_is(source, paths[0]));
+	obs_source_media_next(source);
+	wait_until(path_is(source, paths[2]));
+	mock_set_stat_blocked(NULL);
+	obs_source_release(stuck);
+	obs_data_array_release(stuck_playlist);
+	obs_data_release(stuck_settings);
+
+	/* selecting it still tries it */
+	select_item(source, 1, 0);
+	wait_until(path_is(source, paths[1]));
+
+	/* once it changes, it is played again */
+	struct utimbuf times = {.actime = 1000000000, .modtime = 1000000000};
+	utime(paths[1], &times);
+	mock_media_set_broken(paths[1], false);
+	select_item(source, 0, 0);
+	wait_until(path_is(source, paths[0]));
+	obs_source_media_next(source);
+	wait_until(path_is(source, paths[1]));
+	assert(!quarantine_contains(paths[1]));
+
+	obs_source_release(source);
+	obs_data_array_release(playlist);
+	obs_data_release(settings);
+}
+
+static void test_get_stats(void)
+{
+	obs_data_t *settings = make_settings(5, 1000, false, false);
+	obs_source_t *source = create_playlist(settings);
+	calldata_t cd = {0};
+
+	obs_source_media_next(source);
+	wait_until(path_is(source, "/media/001.mp4"));
+	mock_tick(1100);
+	wait_until(path_is(source, "/media/002.mp4"));
+
+	/* the first file, then one Next and one end of file */
+	wait_until(transition_count(source) == 3);
+	obs_data_t *stats = call_json_proc(source, "get_stats", &cd, "stats");
+	obs_data_t *timers = obs_data_get_obj(stats, "timers_us");
+	obs_data_t *update = obs_data_get_obj(timers, "update");
+	obs_data_t *counters = obs_data_get_obj(stats, "counters");
+
+	assert(obs_data_get_int(update, "count") == 1);
+	assert(obs_data_get_int(counters, "nav_posted") == 3);
+
+	obs_data_release(counters);
+	obs_data_release(update);
+	obs_data_release(timers);
+	obs_data_release(stats);
+	calldata_free(&cd);
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+/* The gap before a file shows a frame is only closed by a frame, not by the
+ * file reporting PLAYING as soon as it is opened */
+static void test_video_gap(void)
+{
+	obs_data_t *settings = make_settings(2, 5000, false, false);
+	obs_source_t *source = create_playlist(settings);
+	calldata_t cd = {0};
+
+	mock_render(source);
+	for (size_t ticks = 0; ticks < 5; ticks++) {
+		os_sleep_ms(20);
+		mock_tick(33);
+		mock_render(source);
+	}
+
+	obs_data_t *stats = call_json_proc(source, "get_stats", &cd, "stats");
+	obs_data_t *timers = obs_data_get_obj(stats, "timers_us");
+	obs_data_t *gap = obs_data_get_obj(timers, "gap_video");
+	assert(obs_data_get_int(gap, "count") == 1);
+	assert(obs_data_get_int(gap, "max") >= 30000); // two ticks
+
+	obs_data_release(gap);
+	obs_data_release(timers);
+	obs_data_release(stats);
+	calldata_free(&cd);
+	obs_source_release(source);
+	obs_data_release(settings);
+}
+
+int main(void)
+{
+	test_startup();
+
+	test_next_and_previous();
+	test_navigation_is_merged();
+	test_end_of_file_plays_next();
+	test_update_when_ended();
+	test_loop_wraps_around();
+	test_select_index();
+	test_peek_upcoming_sequential();
+	test_shuffle_plays_upcoming();
+	test_shuffle_order_restored();
+	test_audio_is_relayed();
+	test_audio_relay_is_bounded();
+	test_audio_relay_remaps_layouts();
+	test_crossfade();
+	test_loudness_normalization();
+	test_trim_points();
+	test_playlist_files();
+	test_catalog();
+#ifdef HAVE_HTTP_STAND_IN
+	test_url_cache();
+#endif
+	test_missing_files();
+	test_path_check_stuck();
+	test_idle_release();
+	test_decoder_pool();
+	test_virtual_clock();
+	test_lazy_load();
+	test_lazy_load_in_background();
+	test_resume_position();
+	test_folder_sort();
+	test_fast_fail();
+	test_get_stats();
+	test_video_gap();
+
+	test_shutdown();
+	return 0;
+}
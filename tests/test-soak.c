@@ -0,0 +1,97 @@
+/*
+Media Playlist Source
+Copyright (C) 2023 Ian Rodriguez ianlemuelr@gmail.com
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program. If not, see <https://www.gnu.org/licenses/>
+*/
+
+/* Plays through thousands of short files on the virtual clock while Next,
+ * Previous and playlist edits come in from another thread. */
+
+#include <util/threading.h>
+
+#include "test-common.h"
+
+#define FILE_COUNT 50
+#define TRANSITIONS 3000
+#define FILE_DURATION_MS 100
+#define TICK_MS 50
+
+struct soak_context {
+	obs_source_t *source;
+	volatile bool stop;
+};
+
+static void *navigate_thread(void *data)
+{
+	struct soak_context *ctx = data;
+	unsigned int seed = 1;
+
+	while (!os_atomic_load_bool(&ctx->stop)) {
+		seed = seed * 1103515245 + 12345;
+		if (seed & 0x10000)
+			obs_source_media_next(ctx->source);
+		else
+			obs_source_media_previous(ctx->source);
+		os_sleep_ms(1);
+	}
+	return NULL;
+}
+
+static void soak(bool shuffle)
+{
+	obs_data_t *settings = make_settings(FILE_COUNT, FILE_DURATION_MS, shuffle, true);
+	obs_data_t *edited = make_settings(FILE_COUNT / 2, FILE_DURATION_MS, shuffle, true);
+	struct soak_context ctx = {0};
+	pthread_t thread;
+	uint64_t start_ts = os_gettime_ns();
+
+	ctx.source = obs_source_create(MPS_ID, "soak", settings, NULL);
+	assert(ctx.source);
+	assert(pthread_create(&thread, NULL, navigate_thread, &ctx) == 0);
+
+	for (size_t i = 0; transition_count(ctx.source) < TRANSITIONS; i++) {
+		mock_tick(TICK_MS);
+		mock_render(ctx.source);
+
+		/* shrink and grow the playlist now and then */
+		if (i % 500 == 250)
+			obs_source_update(ctx.source, edited);
+		else if (i % 500 == 0)
+			obs_source_update(ctx.source, settings);
+
+		assert(os_gettime_ns() - start_ts < 120000000000ULL);
+	}
+
+	os_atomic_set_bool(&ctx.stop, true);
+	pthread_join(thread, NULL);
+
+	printf("%s: %lld transitions in %.2fs\n", shuffle ? "shuffle" : "sequential", transition_count(ctx.source),
+	       (double)(os_gettime_ns() - start_ts) / 1e9);
+
+	obs_source_release(ctx.source);
+	obs_data_release(edited);
+	obs_data_release(settings);
+}
+
+int main(void)
+{
+	test_startup();
+
+	soak(false);
+	soak(true);
+
+	test_shutdown();
+	return 0;
+}